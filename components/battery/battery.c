@@ -1,12 +1,10 @@
 #include "battery.h"
 #include "io_extension.h"
 #include "esp_log.h"
-#include <stdbool.h>
 
 #define BATTERY_ADC_MAX          4095
 #define BATTERY_VOLTAGE_MAX_MV   4200
 #define BATTERY_VOLTAGE_MIN_MV   3300
-#define BATTERY_EMA_ALPHA        0.1f
 
 static const char *TAG = "battery";
 
@@ -18,19 +16,9 @@ void battery_init(void)
 
 uint8_t battery_get_percentage(void)
 {
+    // Already filtered by the IO extension's background sampling: no bus access here
     uint16_t raw = IO_EXTENSION_Adc_Input();
-    uint32_t voltage_mv = (uint32_t)raw * BATTERY_VOLTAGE_MAX_MV / BATTERY_ADC_MAX;
-
-    static float s_filtered_mv = 0.0f;
-    static bool s_initialized = false;
-    if (!s_initialized) {
-        s_filtered_mv = (float)voltage_mv;
-        s_initialized = true;
-    } else {
-        s_filtered_mv = BATTERY_EMA_ALPHA * (float)voltage_mv +
-                        (1.0f - BATTERY_EMA_ALPHA) * s_filtered_mv;
-    }
-    uint32_t filt_mv = (uint32_t)s_filtered_mv;
+    uint32_t filt_mv = (uint32_t)raw * BATTERY_VOLTAGE_MAX_MV / BATTERY_ADC_MAX;
 
     if (filt_mv < BATTERY_VOLTAGE_MIN_MV) {
         return 0;
@@ -0,0 +1,222 @@
+#include "bench.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#include "sdkconfig.h"
+#define BENCH_PLATFORM CONFIG_IDF_TARGET
+#else
+#define BENCH_PLATFORM "host"
+#endif
+
+#define BENCH_DEFAULT_ITERATIONS 10
+
+static const char *TAG = "bench";
+
+static const bench_case_t *s_cases[BENCH_MAX_CASES];
+static size_t s_case_count;
+static void (*s_lock)(void);
+static void (*s_unlock)(void);
+
+esp_err_t bench_register(const bench_case_t *cases, size_t count)
+{
+    if (!cases || s_case_count + count > BENCH_MAX_CASES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        s_cases[s_case_count++] = &cases[i];
+    }
+    return ESP_OK;
+}
+
+void bench_set_lock(void (*lock)(void), void (*unlock)(void))
+{
+    s_lock = lock;
+    s_unlock = unlock;
+}
+
+void bench_list(FILE *out)
+{
+    for (size_t i = 0; i < s_case_count; ++i) {
+        fprintf(out, "%s\n", s_cases[i]->name);
+    }
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Write @p s as a JSON string; corpus paths are the only untrusted input. */
+static void json_str(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', out);
+            fputc(*s, out);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", *s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/* First line of <corpus>/VERSION, written by gen_corpus.py */
+static void corpus_version(const char *corpus, char *buf, size_t len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/VERSION", corpus);
+    snprintf(buf, len, "unknown");
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    if (fgets(buf, (int)len, f)) {
+        buf[strcspn(buf, "\r\n")] = '\0';
+    }
+    fclose(f);
+}
+
+static esp_err_t run_case(const bench_case_t *c, const char *corpus, unsigned iterations,
+                          FILE *out)
+{
+    int64_t times[BENCH_MAX_ITERATIONS];
+    uint64_t work = 0;
+    void *state = NULL;
+
+    if (s_lock) {
+        s_lock();
+    }
+    esp_err_t err = c->setup ? c->setup(c->arg, corpus, &state) : ESP_OK;
+    bool skipped = err == ESP_ERR_NOT_FOUND || err == ESP_ERR_NOT_SUPPORTED;
+    bool ready = err == ESP_OK;
+    if (ready) {
+        /* Warm-up: caches, lazily allocated decoder state */
+        err = c->run(state, &work);
+    }
+    for (unsigned i = 0; err == ESP_OK && i < iterations; ++i) {
+        work = 0;
+        int64_t start = esp_timer_get_time();
+        err = c->run(state, &work);
+        times[i] = esp_timer_get_time() - start;
+    }
+    if (ready && c->teardown) {
+        c->teardown(state);
+    }
+    if (s_unlock) {
+        s_unlock();
+    }
+
+    fputs("{\"name\":", out);
+    json_str(out, c->name);
+    if (err != ESP_OK) {
+        fprintf(out, ",\"status\":\"%s\",\"error\":\"%s\"}", skipped ? "skipped" : "failed",
+                esp_err_to_name(err));
+        ESP_LOGW(TAG, "%s %s: %s", c->name, skipped ? "skipped" : "failed", esp_err_to_name(err));
+        return skipped ? ESP_OK : err;
+    }
+    qsort(times, iterations, sizeof(times[0]), cmp_i64);
+    int64_t median = times[iterations / 2];
+    fprintf(out,
+            ",\"status\":\"ok\",\"iterations\":%u,\"median_us\":%lld,\"min_us\":%lld,"
+            "\"max_us\":%lld",
+            iterations, (long long)median, (long long)times[0], (long long)times[iterations - 1]);
+    if (c->rate_unit && work > 0 && median > 0) {
+        double rate = (double)work / c->rate_scale / ((double)median / 1e6);
+        fprintf(out, ",\"work\":%llu,\"rate\":%.3f,\"unit\":", (unsigned long long)work, rate);
+        json_str(out, c->rate_unit);
+    }
+    fputc('}', out);
+    return ESP_OK;
+}
+
+esp_err_t bench_run(const bench_config_t *cfg, FILE *out)
+{
+    unsigned iterations = cfg->iterations ? cfg->iterations : BENCH_DEFAULT_ITERATIONS;
+    if (iterations > BENCH_MAX_ITERATIONS || !cfg->corpus) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    char version[64];
+    corpus_version(cfg->corpus, version, sizeof(version));
+
+    fprintf(out, "{\"bench\":1,\"platform\":\"%s\",\"corpus_dir\":", BENCH_PLATFORM);
+    json_str(out, cfg->corpus);
+    fputs(",\"corpus\":", out);
+    json_str(out, version);
+    fputs(",\"results\":[\n", out);
+
+    esp_err_t ret = ESP_OK;
+    size_t n = 0;
+    size_t filter_len = cfg->filter ? strlen(cfg->filter) : 0;
+    for (size_t i = 0; i < s_case_count; ++i) {
+        const bench_case_t *c = s_cases[i];
+        if (filter_len && strncmp(c->name, cfg->filter, filter_len) != 0) {
+            continue;
+        }
+        if (n++) {
+            fputs(",\n", out);
+        }
+        esp_err_t err = run_case(c, cfg->corpus, iterations, out);
+        if (err != ESP_OK) {
+            ret = err;
+        }
+        fflush(out);
+    }
+    fputs("\n]}\n", out);
+    fflush(out);
+    return ret;
+}
+
+int bench_main(int argc, char **argv, const char *default_corpus)
+{
+    bench_config_t cfg = { .corpus = default_corpus };
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-l") == 0) {
+            bench_list(stdout);
+            return 0;
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            cfg.iterations = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            cfg.corpus = argv[++i];
+        } else if (argv[i][0] != '-' && !cfg.filter) {
+            cfg.filter = argv[i];
+        } else {
+            fprintf(stderr, "usage: bench [-l] [-n iterations] [-d corpus] [prefix]\n");
+            return 1;
+        }
+    }
+    fputs("BENCH-BEGIN\n", stdout);
+    esp_err_t err = bench_run(&cfg, stdout);
+    fputs("BENCH-END\n", stdout);
+    fflush(stdout);
+    return err == ESP_OK ? 0 : 1;
+}
+
+#ifdef ESP_PLATFORM
+static const char *s_default_corpus;
+
+static int cmd_bench(int argc, char **argv)
+{
+    return bench_main(argc, argv, s_default_corpus);
+}
+
+esp_err_t bench_console_register(const char *default_corpus)
+{
+    s_default_corpus = default_corpus;
+    const esp_console_cmd_t cmd = {
+        .command = "bench",
+        .help = "Run benchmarks on the corpus, JSON report: bench [-l] [-n iterations] "
+                "[-d corpus] [prefix]",
+        .hint = NULL,
+        .func = cmd_bench,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+#endif
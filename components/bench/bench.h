@@ -0,0 +1,94 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Benchmark registry and runner.
+ *
+ * Each case is timed over a number of iterations after one warm-up run and
+ * reported as one JSON object: median/min/max wall time and, when the case
+ * reports the work it did, a rate (pixels, bytes or files per second).
+ * Inputs come from a corpus directory generated by tools/gen_corpus.py;
+ * tools/bench.py compares the JSON output with per-benchmark thresholds.
+ */
+
+/** LVGL is linked in (always on target, with LVGL_DIR on the host build). */
+#if defined(ESP_PLATFORM) || defined(HOST_HAVE_LVGL)
+#define BENCH_HAVE_LVGL 1
+#else
+#define BENCH_HAVE_LVGL 0
+#endif
+
+#define BENCH_MAX_CASES      48
+#define BENCH_MAX_ITERATIONS 100
+
+typedef struct {
+    const char *name;      /*!< "group/variant", the filter matches a prefix */
+    const char *rate_unit; /*!< Unit of the reported rate, NULL for none */
+    double rate_scale;     /*!< Work units per rate unit, e.g. 1e6 for Mpx/s */
+    /**
+     * Load inputs from @p corpus and allocate buffers. Returning
+     * ESP_ERR_NOT_FOUND or ESP_ERR_NOT_SUPPORTED marks the case skipped.
+     */
+    esp_err_t (*setup)(const void *arg, const char *corpus, void **state);
+    /** One timed iteration; @p work receives the units processed. */
+    esp_err_t (*run)(void *state, uint64_t *work);
+    void (*teardown)(void *state);
+    const void *arg;
+} bench_case_t;
+
+typedef struct {
+    const char *corpus;  /*!< Corpus directory */
+    const char *filter;  /*!< Name prefix, NULL runs every case */
+    unsigned iterations; /*!< Timed runs per case, 0 for the default (10) */
+} bench_config_t;
+
+/**
+ * @brief Add @p count cases to the registry.
+ *
+ * @p cases must stay valid for the life of the program.
+ */
+esp_err_t bench_register(const bench_case_t *cases, size_t count);
+
+/** Register the kernels of bench_cases.c (decode, conversion, LVGL, FatFs). */
+esp_err_t bench_register_core(void);
+
+/**
+ * @brief Serialise the runs with the renderer.
+ *
+ * @p lock is held from setup to teardown of every case so that nothing else
+ * draws while it is measured, and so LVGL cases may call lv_* functions.
+ */
+void bench_set_lock(void (*lock)(void), void (*unlock)(void));
+
+/** Run the matching cases and write the JSON report to @p out. */
+esp_err_t bench_run(const bench_config_t *cfg, FILE *out);
+
+/** Print the registered case names, one per line. */
+void bench_list(FILE *out);
+
+/**
+ * @brief Command line front end shared by the console and the host build.
+ *
+ * `bench [-l] [-n iterations] [-d corpus] [prefix]`. The report is framed by
+ * BENCH-BEGIN/BENCH-END lines so it can be picked out of a serial log.
+ *
+ * @return 0 when every selected case ran or was skipped, 1 otherwise.
+ */
+int bench_main(int argc, char **argv, const char *default_corpus);
+
+#ifdef ESP_PLATFORM
+/** Add the `bench` command to the esp_console REPL. */
+esp_err_t bench_console_register(const char *default_corpus);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,397 @@
+/*
+ * Kernel benchmarks: PNG decode at several sizes and bit depths, on one core
+ * and with conversion offloaded to the other, the png_stream colour
+ * conversion on its own (stored, unfiltered IDAT so that inflate is a copy),
+ * LVGL blending and rotation into an RGB565 canvas, and
+ * FatFs reads through the lvgl_fs driver.
+ */
+#include "bench.h"
+#include "esp_heap_caps.h"
+#include "jobs.h"
+#include "png_stream.h"
+#include <stdlib.h>
+#include <string.h>
+#if BENCH_HAVE_LVGL
+#include "lvgl.h"
+#endif
+
+#define BENCH_FEED_CHUNK 4096
+
+static void *bench_alloc(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return p ? p : heap_caps_malloc(size, MALLOC_CAP_8BIT);
+}
+
+/* ---- PNG decode and colour conversion ---------------------------------- */
+
+typedef struct {
+    uint8_t *file;
+    size_t file_len;
+    uint8_t *pixels;
+    size_t pixels_len;
+    uint32_t width;
+    uint32_t height;
+} png_state_t;
+
+static esp_err_t load_file(const char *path, uint8_t **data, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = ESP_OK;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *data = size > 0 ? bench_alloc((size_t)size) : NULL;
+    if (!*data) {
+        err = size > 0 ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_SIZE;
+    } else if (fread(*data, 1, (size_t)size, f) != (size_t)size) {
+        heap_caps_free(*data);
+        *data = NULL;
+        err = ESP_FAIL;
+    }
+    fclose(f);
+    *len = *data ? (size_t)size : 0;
+    return err;
+}
+
+static esp_err_t png_on_header(png_stream_t *s, const png_stream_info_t *info, void *arg)
+{
+    png_state_t *st = arg;
+    /* Same choice as ui_navigation: ARGB8888 only when the image has alpha */
+    png_stream_format_t fmt = info->has_alpha ? PNG_STREAM_FMT_ARGB8888 : PNG_STREAM_FMT_RGB565;
+    size_t stride = info->width * png_stream_bpp(fmt);
+    size_t len = stride * info->height;
+    if (len > st->pixels_len) {
+        heap_caps_free(st->pixels);
+        st->pixels = bench_alloc(len);
+        st->pixels_len = st->pixels ? len : 0;
+        if (!st->pixels) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    st->width = info->width;
+    st->height = info->height;
+    return png_stream_set_output(s, fmt, st->pixels, stride);
+}
+
+static void png_teardown(void *state)
+{
+    png_state_t *st = state;
+    heap_caps_free(st->file);
+    heap_caps_free(st->pixels);
+    free(st);
+}
+
+static esp_err_t png_setup(const void *arg, const char *corpus, void **state)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/png/%s.png", corpus, (const char *)arg);
+    png_state_t *st = calloc(1, sizeof(*st));
+    if (!st) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = load_file(path, &st->file, &st->file_len);
+    if (err != ESP_OK) {
+        free(st);
+        return err;
+    }
+    *state = st;
+    return ESP_OK;
+}
+
+/* The parallel cases compare against png_decode/, meaningless without workers */
+static esp_err_t png_mt_setup(const void *arg, const char *corpus, void **state)
+{
+    return jobs_running() ? png_setup(arg, corpus, state) : ESP_ERR_NOT_SUPPORTED;
+}
+
+static esp_err_t png_decode(png_state_t *st, bool parallel, uint64_t *work)
+{
+    png_stream_config_t cfg = {
+        .on_header = png_on_header,
+        .format = PNG_STREAM_FMT_RGB565,
+        .parallel = parallel,
+        .arg = st,
+    };
+    png_stream_t *s = png_stream_create(&cfg);
+    if (!s) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = ESP_OK;
+    for (size_t off = 0; err == ESP_OK && off < st->file_len; off += BENCH_FEED_CHUNK) {
+        size_t n = st->file_len - off < BENCH_FEED_CHUNK ? st->file_len - off : BENCH_FEED_CHUNK;
+        err = png_stream_feed(s, st->file + off, n);
+    }
+    if (err == ESP_OK) {
+        err = png_stream_finish(s);
+    }
+    png_stream_destroy(s);
+    *work = (uint64_t)st->width * st->height;
+    return err;
+}
+
+static esp_err_t png_run(void *state, uint64_t *work)
+{
+    return png_decode(state, false, work);
+}
+
+static esp_err_t png_run_mt(void *state, uint64_t *work)
+{
+    return png_decode(state, true, work);
+}
+
+#define PNG_CASE(group, file)                                                         \
+    {                                                                                 \
+        .name = group "/" file, .rate_unit = "Mpx/s", .rate_scale = 1e6,              \
+        .setup = png_setup, .run = png_run, .teardown = png_teardown, .arg = file,    \
+    }
+
+#define PNG_MT_CASE(group, file)                                                      \
+    {                                                                                 \
+        .name = group "/" file, .rate_unit = "Mpx/s", .rate_scale = 1e6,              \
+        .setup = png_mt_setup, .run = png_run_mt, .teardown = png_teardown,           \
+        .arg = file,                                                                  \
+    }
+
+static const bench_case_t k_png_cases[] = {
+    PNG_CASE("png_decode", "rgb8_320x240"),
+    PNG_CASE("png_decode", "rgb8_800x480"),
+    PNG_CASE("png_decode", "rgb8_1024x600"),
+    PNG_CASE("png_decode", "rgba8_1024x600"),
+    PNG_CASE("png_decode", "rgb16_1024x600"),
+    PNG_CASE("png_decode", "pal4_1024x600"),
+    PNG_CASE("png_decode", "gray1_1024x600"),
+    /* Inflate and unfilter here, conversion on the other core */
+    PNG_MT_CASE("png_decode_mt", "rgb8_800x480"),
+    PNG_MT_CASE("png_decode_mt", "rgb8_1024x600"),
+    PNG_MT_CASE("png_decode_mt", "rgba8_1024x600"),
+    PNG_MT_CASE("png_decode_mt", "rgb16_1024x600"),
+    /* Stored deflate blocks and filter None: what is left is conversion */
+    PNG_CASE("convert", "stored_rgb8_1024x600"),
+    PNG_CASE("convert", "stored_rgba8_1024x600"),
+    PNG_MT_CASE("convert_mt", "stored_rgb8_1024x600"),
+};
+
+#if BENCH_HAVE_LVGL
+/* ---- LVGL blend and rotation -------------------------------------------- */
+
+#define CANVAS_W 480
+#define CANVAS_H 320
+
+typedef struct {
+    lv_color_format_t src_cf;
+    uint32_t src_w;
+    uint32_t src_h;
+    lv_opa_t opa;
+    int32_t rotation; /*!< 0.1 degree units */
+} draw_arg_t;
+
+typedef struct {
+    const draw_arg_t *arg;
+    lv_draw_buf_t dst;
+    lv_draw_buf_t src;
+    lv_obj_t *canvas;
+} draw_state_t;
+
+static void draw_teardown(void *state)
+{
+    draw_state_t *st = state;
+    if (st->canvas) {
+        lv_obj_delete(st->canvas);
+    }
+    heap_caps_free(st->dst.data);
+    heap_caps_free(st->src.data);
+    free(st);
+}
+
+static esp_err_t draw_buf_alloc(lv_draw_buf_t *buf, uint32_t w, uint32_t h, lv_color_format_t cf)
+{
+    uint32_t stride = lv_draw_buf_width_to_stride(w, cf);
+    uint32_t size = stride * h;
+    void *data = bench_alloc(size);
+    if (!data) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (lv_draw_buf_init(buf, w, h, cf, stride, data, size) != LV_RESULT_OK) {
+        heap_caps_free(data);
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ESP_OK;
+}
+
+/* Gradient with an alpha ramp so blending cannot take the opaque shortcut */
+static void fill_source(lv_draw_buf_t *buf)
+{
+    for (uint32_t y = 0; y < buf->header.h; ++y) {
+        uint8_t *row = buf->data + y * buf->header.stride;
+        for (uint32_t x = 0; x < buf->header.w; ++x) {
+            uint8_t r = (uint8_t)(x * 255 / buf->header.w);
+            uint8_t g = (uint8_t)(y * 255 / buf->header.h);
+            uint8_t b = (uint8_t)((x ^ y) & 0xFF);
+            if (buf->header.cf == LV_COLOR_FORMAT_ARGB8888) {
+                row[x * 4 + 0] = b;
+                row[x * 4 + 1] = g;
+                row[x * 4 + 2] = r;
+                row[x * 4 + 3] = (uint8_t)(x * 255 / buf->header.w);
+            } else {
+                uint16_t v = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+                row[x * 2 + 0] = v & 0xFF;
+                row[x * 2 + 1] = v >> 8;
+            }
+        }
+    }
+}
+
+static esp_err_t draw_setup(const void *arg, const char *corpus, void **state)
+{
+    (void)corpus;
+    const draw_arg_t *a = arg;
+    draw_state_t *st = calloc(1, sizeof(*st));
+    if (!st) {
+        return ESP_ERR_NO_MEM;
+    }
+    st->arg = a;
+    esp_err_t err = draw_buf_alloc(&st->dst, CANVAS_W, CANVAS_H, LV_COLOR_FORMAT_RGB565);
+    if (err == ESP_OK) {
+        err = draw_buf_alloc(&st->src, a->src_w, a->src_h, a->src_cf);
+    }
+    if (err == ESP_OK) {
+        st->canvas = lv_canvas_create(NULL);
+        err = st->canvas ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+    if (err != ESP_OK) {
+        draw_teardown(st);
+        return err;
+    }
+    lv_canvas_set_draw_buf(st->canvas, &st->dst);
+    lv_canvas_fill_bg(st->canvas, lv_color_hex(0x204060), LV_OPA_COVER);
+    fill_source(&st->src);
+    *state = st;
+    return ESP_OK;
+}
+
+static esp_err_t draw_run(void *state, uint64_t *work)
+{
+    draw_state_t *st = state;
+    const draw_arg_t *a = st->arg;
+    lv_layer_t layer;
+    lv_canvas_init_layer(st->canvas, &layer);
+
+    lv_draw_image_dsc_t dsc;
+    lv_draw_image_dsc_init(&dsc);
+    dsc.src = &st->src;
+    dsc.opa = a->opa;
+    dsc.rotation = a->rotation;
+    dsc.pivot.x = (int32_t)a->src_w / 2;
+    dsc.pivot.y = (int32_t)a->src_h / 2;
+    lv_area_t area = {
+        .x1 = (CANVAS_W - (int32_t)a->src_w) / 2,
+        .y1 = (CANVAS_H - (int32_t)a->src_h) / 2,
+    };
+    area.x2 = area.x1 + (int32_t)a->src_w - 1;
+    area.y2 = area.y1 + (int32_t)a->src_h - 1;
+    lv_draw_image(&layer, &dsc, &area);
+    lv_canvas_finish_layer(st->canvas, &layer);
+
+    *work = (uint64_t)a->src_w * a->src_h;
+    return ESP_OK;
+}
+
+static const draw_arg_t k_blend_argb = { LV_COLOR_FORMAT_ARGB8888, CANVAS_W, CANVAS_H, LV_OPA_COVER, 0 };
+static const draw_arg_t k_blend_opa = { LV_COLOR_FORMAT_RGB565, CANVAS_W, CANVAS_H, LV_OPA_50, 0 };
+static const draw_arg_t k_rotate_rgb565 = { LV_COLOR_FORMAT_RGB565, 320, 240, LV_OPA_COVER, 900 };
+static const draw_arg_t k_rotate_argb = { LV_COLOR_FORMAT_ARGB8888, 320, 240, LV_OPA_COVER, 900 };
+
+#define DRAW_CASE(n, a)                                                                \
+    {                                                                                  \
+        .name = n, .rate_unit = "Mpx/s", .rate_scale = 1e6, .setup = draw_setup,      \
+        .run = draw_run, .teardown = draw_teardown, .arg = &a,                         \
+    }
+
+/* ---- FatFs reads through lvgl_fs ------------------------------------------ */
+
+typedef struct {
+    char path[256];
+    size_t chunk;
+    uint8_t *buf;
+} fs_state_t;
+
+static void fs_teardown(void *state)
+{
+    fs_state_t *st = state;
+    heap_caps_free(st->buf);
+    free(st);
+}
+
+static esp_err_t fs_setup(const void *arg, const char *corpus, void **state)
+{
+    fs_state_t *st = calloc(1, sizeof(*st));
+    if (!st) {
+        return ESP_ERR_NO_MEM;
+    }
+    st->chunk = (size_t)(uintptr_t)arg;
+    snprintf(st->path, sizeof(st->path), "S:%s/fatfs/read_4m.bin", corpus);
+    /* Internal RAM: the buffer FatFs copies into, as the LVGL decoders do */
+    st->buf = heap_caps_malloc(st->chunk, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!st->buf) {
+        free(st);
+        return ESP_ERR_NO_MEM;
+    }
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, st->path, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+        fs_teardown(st);
+        return ESP_ERR_NOT_FOUND;
+    }
+    lv_fs_close(&f);
+    *state = st;
+    return ESP_OK;
+}
+
+static esp_err_t fs_run(void *state, uint64_t *work)
+{
+    fs_state_t *st = state;
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, st->path, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint64_t total = 0;
+    uint32_t br;
+    lv_fs_res_t res;
+    while ((res = lv_fs_read(&f, st->buf, (uint32_t)st->chunk, &br)) == LV_FS_RES_OK && br > 0) {
+        total += br;
+    }
+    lv_fs_close(&f);
+    *work = total;
+    return res == LV_FS_RES_OK ? ESP_OK : ESP_FAIL;
+}
+
+#define FS_CASE(n, chunk)                                                              \
+    {                                                                                  \
+        .name = n, .rate_unit = "MB/s", .rate_scale = 1e6, .setup = fs_setup,         \
+        .run = fs_run, .teardown = fs_teardown, .arg = (const void *)(uintptr_t)chunk, \
+    }
+
+static const bench_case_t k_lvgl_cases[] = {
+    DRAW_CASE("blend/argb8888_over_rgb565", k_blend_argb),
+    DRAW_CASE("blend/rgb565_opa50", k_blend_opa),
+    DRAW_CASE("rotate/rgb565_90", k_rotate_rgb565),
+    DRAW_CASE("rotate/argb8888_90", k_rotate_argb),
+    FS_CASE("fatfs_read/512", 512),
+    FS_CASE("fatfs_read/4k", 4096),
+    FS_CASE("fatfs_read/32k", 32768),
+};
+#endif /* BENCH_HAVE_LVGL */
+
+esp_err_t bench_register_core(void)
+{
+    esp_err_t err = bench_register(k_png_cases, sizeof(k_png_cases) / sizeof(k_png_cases[0]));
+#if BENCH_HAVE_LVGL
+    if (err == ESP_OK) {
+        err = bench_register(k_lvgl_cases, sizeof(k_lvgl_cases) / sizeof(k_lvgl_cases[0]));
+    }
+#endif
+    return err;
+}
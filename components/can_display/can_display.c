@@ -1,57 +1,499 @@
 #include "can_display.h"
+#include "can_isotp.h"
+#include "can_xfer.h"
+#include "config.h"
 #include "driver/twai.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "string.h"
+#include <inttypes.h>
 #include "ui_navigation.h"
-#include "gt911.h"
-#include "config.h"
 #include "esp_log.h"
-
-extern QueueHandle_t s_touch_queue;
-extern display_geometry_t g_display;
+#include "trace.h"
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#endif
 
 #define CAN_DISPLAY_TAG "CAN_DISP"
 #define CAN_TX_PIN GPIO_NUM_20
 #define CAN_RX_PIN GPIO_NUM_19
 
+#define CAN_RX_ID (CAN_DISPLAY_RX_BASE + CONFIG_CAN_NODE_ID)
+#define CAN_TX_ID (CAN_DISPLAY_TX_BASE + CONFIG_CAN_NODE_ID)
+#define CAN_DATA_RX_ID (CAN_DISPLAY_DATA_BASE + CONFIG_CAN_NODE_ID)
+#define CAN_DATA_FC_ID (CAN_DISPLAY_DATA_FC_BASE + CONFIG_CAN_NODE_ID)
+
+#if CONFIG_CAN_BITRATE_KBPS == 125
+#define CAN_TIMING_CONFIG() TWAI_TIMING_CONFIG_125KBITS()
+#elif CONFIG_CAN_BITRATE_KBPS == 250
+#define CAN_TIMING_CONFIG() TWAI_TIMING_CONFIG_250KBITS()
+#elif CONFIG_CAN_BITRATE_KBPS == 500
+#define CAN_TIMING_CONFIG() TWAI_TIMING_CONFIG_500KBITS()
+#elif CONFIG_CAN_BITRATE_KBPS == 1000
+#define CAN_TIMING_CONFIG() TWAI_TIMING_CONFIG_1MBITS()
+#else
+#error "CONFIG_CAN_BITRATE_KBPS must be 125, 250, 500 or 1000"
+#endif
+
+/* Longest request and reply; a longer request is refused with FC(OVFLW) */
+#define CAN_REQUEST_MAX 256
+#define CAN_REPLY_MAX   256
+#define CAN_REPLY_PAYLOAD_MAX 14
+
+/* ISO-TP timings: our flow control asks for whole messages without gaps,
+ * and a peer that does not send its FC within N_Bs ends the transfer */
+#define CAN_ISOTP_BS        0
+#define CAN_ISOTP_STMIN     0
+#define CAN_ISOTP_N_BS_MS   1000
+#define CAN_ISOTP_MAX_WAIT  8
+#define CAN_TX_TIMEOUT_MS   50
+
 static TaskHandle_t s_can_task_handle = NULL;
+static can_display_ops_t s_ops;
+
+static uint8_t s_request[CAN_REQUEST_MAX];
+static can_isotp_rx_t s_rx;
+
+/* Previous addressed request and its reply, to answer a retry */
+static uint8_t s_last_request[CAN_REQUEST_MAX];
+static size_t s_last_request_len;
+static uint8_t s_reply[CAN_REPLY_MAX];
+static size_t s_reply_len;
+
+/* Image data channel, streamed into can_xfer */
+static can_isotp_rx_t s_data_rx;
+
+/* Transfer counters; the console reads them from another task */
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_transfers;
+static uint32_t s_failures;
+static uint32_t s_xfer_bytes;
+static uint32_t s_xfer_frames;
+static uint32_t s_xfer_fcs;
+static uint64_t s_xfer_bits;
+static int64_t s_xfer_start_us;
+static int64_t s_xfer_last_us;
+
+uint32_t can_display_name_hash(const char *path)
+{
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    uint32_t h = 2166136261u;
+    for (; *name; name++) {
+        h ^= (uint8_t)*name;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Bits on the wire for a standard data frame and the interframe space,
+ * with worst-case stuffing so transfers are sized conservatively */
+static uint32_t frame_bits(uint8_t dlc)
+{
+    return 47 + 8u * dlc + (34 + 8u * dlc - 1) / 4;
+}
+
+static esp_err_t send_frame_to(uint32_t id, const uint8_t *data, uint8_t len)
+{
+    twai_message_t msg = {.identifier = id, .data_length_code = len};
+    memcpy(msg.data, data, len);
+    return twai_transmit(&msg, pdMS_TO_TICKS(CAN_TX_TIMEOUT_MS));
+}
+
+static esp_err_t send_frame(const uint8_t *data, uint8_t len)
+{
+    return send_frame_to(CAN_TX_ID, data, len);
+}
+
+/* Wait for the peer's flow control frame; other traffic for us is dropped meanwhile */
+static int wait_flow(can_isotp_tx_t *tx)
+{
+    for (int waits = 0; waits < CAN_ISOTP_MAX_WAIT;) {
+        twai_message_t msg;
+        if (twai_receive(&msg, pdMS_TO_TICKS(CAN_ISOTP_N_BS_MS)) != ESP_OK) {
+            return -1;
+        }
+        if (msg.extd || msg.rtr || msg.identifier != CAN_RX_ID) {
+            continue;
+        }
+        int fs = can_isotp_tx_flow(tx, msg.data, msg.data_length_code);
+        if (fs == CAN_ISOTP_FC_CTS) {
+            return fs;
+        }
+        if (fs == CAN_ISOTP_FC_WAIT) {
+            waits++;
+        } else if (fs >= 0) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+static esp_err_t send_message(const uint8_t *data, size_t len)
+{
+    can_isotp_tx_t tx;
+    esp_err_t err = can_isotp_tx_start(&tx, data, len);
+    uint8_t frame[CAN_ISOTP_FRAME_LEN];
+    while (err == ESP_OK) {
+        int n = can_isotp_tx_next(&tx, frame);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (wait_flow(&tx) < 0) {
+                ESP_LOGW(CAN_DISPLAY_TAG, "No flow control, reply dropped");
+                return ESP_ERR_TIMEOUT;
+            }
+            continue;
+        }
+        err = send_frame(frame, n);
+        if (tx.st_min_us && tx.sent < tx.len) {
+            TickType_t ticks = pdMS_TO_TICKS((tx.st_min_us + 999) / 1000);
+            vTaskDelay(ticks ? ticks : 1);
+        }
+    }
+    return err;
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v & 0xffff);
+    put_u16(p + 2, v >> 16);
+}
+
+static void count_failure(void)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    s_failures++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static uint8_t put_begin(const uint8_t *arg, uint8_t len)
+{
+    size_t name_len = len - 36;
+    char name[CAN_XFER_NAME_MAX];
+    memcpy(name, arg + 36, name_len);
+    name[name_len] = '\0';
+    s_data_rx.active = false;  // Drop what is left of an earlier message
+    esp_err_t err = can_xfer_begin(s_ops.album_dir, name, get_u32(arg), arg + 4);
+    if (err != ESP_OK) {
+        ESP_LOGW(CAN_DISPLAY_TAG, "Transfer of %s refused: %s", name, esp_err_to_name(err));
+        count_failure();
+        return CAN_STATUS_REJECTED;
+    }
+    return CAN_STATUS_OK;
+}
+
+static uint8_t put_commit(void)
+{
+    char path[CAN_XFER_PATH_MAX];
+    esp_err_t err = can_xfer_commit(path, sizeof(path));
+    if (err != ESP_OK) {
+        ESP_LOGW(CAN_DISPLAY_TAG, "Transfer not committed: %s", esp_err_to_name(err));
+        count_failure();
+        return CAN_STATUS_REJECTED;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    s_transfers++;
+    portEXIT_CRITICAL(&s_stats_lock);
+    if (s_ops.on_image_added) {
+        s_ops.on_image_added(path);
+    }
+    return CAN_STATUS_OK;
+}
+
+/* Run one command; its reply payload goes to @p out, length in @p out_len */
+static uint8_t run_command(uint8_t op, const uint8_t *arg, uint8_t len, uint8_t *out,
+                           uint8_t *out_len)
+{
+    *out_len = 0;
+    switch (op) {
+    case CAN_OP_NAV:
+        if (len != 1) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        if (!s_ops.on_nav) {
+            return CAN_STATUS_UNSUPPORTED;
+        }
+        s_ops.on_nav((nav_cmd_t)(int8_t)arg[0]);
+        return CAN_STATUS_OK;
+    case CAN_OP_GOTO_INDEX:
+        if (len != 2) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        if (!s_ops.on_goto_index) {
+            return CAN_STATUS_UNSUPPORTED;
+        }
+        return s_ops.on_goto_index(get_u16(arg)) ? CAN_STATUS_OK : CAN_STATUS_REJECTED;
+    case CAN_OP_GOTO_HASH:
+        if (len != 4) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        if (!s_ops.on_goto_hash) {
+            return CAN_STATUS_UNSUPPORTED;
+        }
+        return s_ops.on_goto_hash(get_u32(arg)) ? CAN_STATUS_OK : CAN_STATUS_REJECTED;
+    case CAN_OP_BRIGHTNESS:
+        if (len != 1) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        if (!s_ops.on_brightness) {
+            return CAN_STATUS_UNSUPPORTED;
+        }
+        return arg[0] <= 100 && s_ops.on_brightness(arg[0]) ? CAN_STATUS_OK
+                                                             : CAN_STATUS_REJECTED;
+    case CAN_OP_SLIDESHOW:
+        if (len != 2) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        if (!s_ops.on_slideshow) {
+            return CAN_STATUS_UNSUPPORTED;
+        }
+        return s_ops.on_slideshow(get_u16(arg)) ? CAN_STATUS_OK : CAN_STATUS_REJECTED;
+    case CAN_OP_STATUS: {
+        if (len != 0) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        if (!s_ops.on_status) {
+            return CAN_STATUS_UNSUPPORTED;
+        }
+        can_display_status_t st = {0};
+        s_ops.on_status(&st);
+        put_u16(&out[0], st.index);
+        put_u16(&out[2], st.count);
+        out[4] = st.brightness;
+        put_u16(&out[5], st.slideshow_s);
+        *out_len = 7;
+        return CAN_STATUS_OK;
+    }
+    case CAN_OP_PUT_BEGIN:
+        if (len <= 36 || len - 36 >= CAN_XFER_NAME_MAX) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        return s_ops.album_dir ? put_begin(arg, len) : CAN_STATUS_UNSUPPORTED;
+    case CAN_OP_PUT_COMMIT:
+        if (len != 0) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        return s_ops.album_dir ? put_commit() : CAN_STATUS_UNSUPPORTED;
+    case CAN_OP_PUT_ABORT:
+        if (len != 0) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        if (!s_ops.album_dir) {
+            return CAN_STATUS_UNSUPPORTED;
+        }
+        s_data_rx.active = false;
+        can_xfer_abort();
+        return CAN_STATUS_OK;
+    case CAN_OP_XFER_STATS: {
+        if (len != 0) {
+            return CAN_STATUS_BAD_LENGTH;
+        }
+        can_display_xfer_stats_t st;
+        can_display_get_xfer_stats(&st);
+        put_u32(&out[0], st.bytes);
+        put_u32(&out[4], st.elapsed_ms);
+        put_u32(&out[8], st.bytes_per_s);
+        put_u16(&out[12], st.bus_load_permille);
+        *out_len = 14;
+        return CAN_STATUS_OK;
+    }
+    default:
+        return CAN_STATUS_UNKNOWN_OP;
+    }
+}
 
-static void send_nav_touch(bool next)
+/* Run every command of a request; the reply is built in s_reply when @p reply */
+static void handle_request(const uint8_t *req, size_t len, bool reply)
 {
-    touch_gt911_point_t ev = { .cnt = 1 };
-    if (next) {
-        ev.x[0] = g_display.width - NAV_MARGIN - ARROW_WIDTH / 2;
-        ev.y[0] = NAV_MARGIN + ARROW_HEIGHT / 2;
+    if (len < 1) {
+        return;
+    }
+    if (reply && len == s_last_request_len && memcmp(req, s_last_request, len) == 0) {
+        // Retry of the previous request: answer again without re-running it
+        send_message(s_reply, s_reply_len);
+        return;
+    }
+
+    TRACE_BEGIN("can_request");
+    size_t pos = 1;
+    size_t out = 2;
+    uint8_t count = 0;
+    s_reply[0] = req[0];
+    while (pos + 2 <= len) {
+        uint8_t op = req[pos];
+        uint8_t arg_len = req[pos + 1];
+        pos += 2;
+        if (pos + arg_len > len || out + 3 + CAN_REPLY_PAYLOAD_MAX > CAN_REPLY_MAX) {
+            break;
+        }
+        uint8_t out_len;
+        uint8_t status = run_command(op, &req[pos], arg_len, &s_reply[out + 3], &out_len);
+        s_reply[out] = op | CAN_DISPLAY_REPLY_BIT;
+        s_reply[out + 1] = status;
+        s_reply[out + 2] = out_len;
+        out += 3 + out_len;
+        pos += arg_len;
+        count++;
+    }
+    s_reply[1] = count;
+    s_reply_len = out;
+    TRACE_END("can_request");
+
+    if (reply) {
+        memcpy(s_last_request, req, len);
+        s_last_request_len = len;
+        send_message(s_reply, s_reply_len);
     } else {
-        ev.x[0] = NAV_MARGIN + ARROW_WIDTH / 2;
-        ev.y[0] = NAV_MARGIN + ARROW_HEIGHT / 2;
+        s_last_request_len = 0;  // s_reply no longer answers the cached request
+    }
+}
+
+/* One frame of the image data channel */
+static void handle_data_frame(const twai_message_t *msg)
+{
+    uint8_t fc[CAN_ISOTP_FRAME_LEN];
+    int64_t now = esp_timer_get_time();
+    bool first = msg->data[0] >> 4 == CAN_ISOTP_PCI_FF;
+    if (first) {
+        // Accept exactly the announced image, in blocks the staging can absorb
+        uint8_t bs = CONFIG_CAN_XFER_BLOCK_SIZE;
+        uint8_t limit = can_xfer_block_limit();
+        if (limit && (bs == 0 || bs > limit)) {
+            bs = limit;
+        }
+        s_data_rx.cap = can_xfer_size();
+        s_data_rx.block_size = bs;
+    }
+    can_isotp_rx_result_t r = can_isotp_rx_frame(&s_data_rx, msg->data, msg->data_length_code, fc);
+    bool send_fc = r == CAN_ISOTP_RX_FC || r == CAN_ISOTP_RX_OVERFLOW;
+    if (r == CAN_ISOTP_RX_FC && can_xfer_flush() != ESP_OK) {
+        // The sender times out waiting for this FC
+        ESP_LOGE(CAN_DISPLAY_TAG, "Temp file write failed, transfer dropped");
+        s_data_rx.active = false;
+        can_xfer_abort();
+        count_failure();
+        send_fc = false;
+    }
+    if (send_fc) {
+        send_frame_to(CAN_DATA_FC_ID, fc, 3);
+    }
+
+    portENTER_CRITICAL(&s_stats_lock);
+    if (first) {
+        s_xfer_start_us = now;
+        s_xfer_frames = s_xfer_fcs = 0;
+        s_xfer_bits = 0;
+    }
+    s_xfer_last_us = now;
+    s_xfer_bytes = s_data_rx.got;
+    s_xfer_frames += 1 + send_fc;
+    s_xfer_fcs += send_fc;
+    s_xfer_bits += frame_bits(msg->data_length_code) + (send_fc ? frame_bits(3) : 0);
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (r == CAN_ISOTP_RX_DONE) {
+        can_xfer_flush();
+        can_display_xfer_stats_t st;
+        can_display_get_xfer_stats(&st);
+        ESP_LOGI(CAN_DISPLAY_TAG, "Received %" PRIu32 " bytes in %" PRIu32 " ms: %" PRIu32
+                 " B/s, bus load %u.%u%%", st.bytes, st.elapsed_ms, st.bytes_per_s,
+                 st.bus_load_permille / 10, st.bus_load_permille % 10);
+    } else if (r == CAN_ISOTP_RX_OVERFLOW || (r == CAN_ISOTP_RX_ERROR && can_xfer_size())) {
+        ESP_LOGW(CAN_DISPLAY_TAG, "Image data %s, transfer dropped",
+                 r == CAN_ISOTP_RX_OVERFLOW ? "not matching PUT_BEGIN" : "out of sequence");
+        can_xfer_abort();
+        count_failure();
     }
-    xQueueSend(s_touch_queue, &ev, portMAX_DELAY);
 }
 
 static void can_display_task(void *arg)
 {
     twai_message_t msg;
+    uint8_t fc[CAN_ISOTP_FRAME_LEN];
     while (1) {
-        if (twai_receive(&msg, portMAX_DELAY) == ESP_OK) {
-            if (msg.data_length_code >= 4) {
-                if (memcmp(msg.data, "NEXT", 4) == 0) {
-                    send_nav_touch(true);
-                } else if (memcmp(msg.data, "PREV", 4) == 0) {
-                    send_nav_touch(false);
-                }
+        TRACE_BEGIN("can_wait");
+        esp_err_t rx = twai_receive(&msg, portMAX_DELAY);
+        TRACE_END("can_wait");
+        if (rx != ESP_OK || msg.extd || msg.rtr || msg.data_length_code == 0) {
+            continue;
+        }
+        if (msg.identifier == CAN_DISPLAY_RX_BASE) {
+            // Broadcast: single frames only, nobody answers
+            uint8_t n = msg.data[0] & 0x0f;
+            if (msg.data[0] >> 4 == CAN_ISOTP_PCI_SF && n && n < msg.data_length_code) {
+                handle_request(&msg.data[1], n, false);
             }
+            continue;
+        }
+        if (msg.identifier == CAN_DATA_RX_ID) {
+            handle_data_frame(&msg);
+            continue;
+        }
+        if (msg.identifier != CAN_RX_ID) {
+            continue;
+        }
+        switch (can_isotp_rx_frame(&s_rx, msg.data, msg.data_length_code, fc)) {
+        case CAN_ISOTP_RX_DONE:
+            handle_request(s_rx.buf, s_rx.len, true);
+            break;
+        case CAN_ISOTP_RX_FC:
+            send_frame(fc, 3);
+            break;
+        case CAN_ISOTP_RX_OVERFLOW:
+            send_frame(fc, 3);
+            ESP_LOGW(CAN_DISPLAY_TAG, "Request too long, refused");
+            break;
+        case CAN_ISOTP_RX_ERROR:
+            ESP_LOGW(CAN_DISPLAY_TAG, "Malformed ISO-TP frame dropped");
+            break;
+        case CAN_ISOTP_RX_NONE:
+            break;
         }
     }
 }
 
-esp_err_t can_display_init(void)
+esp_err_t can_display_init(const can_display_ops_t *ops)
 {
+    if (!ops) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ops = *ops;
+    s_last_request_len = 0;
+    can_isotp_rx_init(&s_rx, s_request, sizeof(s_request), CAN_ISOTP_BS, CAN_ISOTP_STMIN);
+    can_isotp_rx_init(&s_data_rx, NULL, 0, CONFIG_CAN_XFER_BLOCK_SIZE, CONFIG_CAN_XFER_ST_MIN);
+    can_isotp_rx_set_sink(&s_data_rx, can_xfer_write, NULL);
+
     twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(CAN_TX_PIN, CAN_RX_PIN, TWAI_MODE_NORMAL);
-    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_250KBITS();
-    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    // Room for the frames arriving while a block is written to the card
+    g_config.rx_queue_len = 32;
+    twai_timing_config_t t_config = CAN_TIMING_CONFIG();
+    // Dual filter: one standard ID per filter (bits 31..21 and 15..5), RTR and data ignored.
+    // The first one leaves bit 8 open to take both 0x6xx and 0x7xx for this node.
+    twai_filter_config_t f_config = {
+        .acceptance_code = (uint32_t)CAN_RX_ID << 21 | (uint32_t)CAN_DISPLAY_RX_BASE << 5,
+        .acceptance_mask = ~((uint32_t)(0x7ff & ~0x100) << 21 | (uint32_t)0x7ff << 5),
+        .single_filter = false,
+    };
 
     esp_err_t ret = twai_driver_install(&g_config, &t_config, &f_config);
     if (ret != ESP_OK) {
@@ -64,12 +506,14 @@ esp_err_t can_display_init(void)
         return ret;
     }
 
-    if (xTaskCreate(can_display_task, "can_display_task", 2048, NULL, 5, &s_can_task_handle) != pdPASS) {
+    if (xTaskCreate(can_display_task, "can_display_task", 3072, NULL, 5, &s_can_task_handle) != pdPASS) {
         ESP_LOGE(CAN_DISPLAY_TAG, "Failed to create CAN task");
         twai_stop();
         twai_driver_uninstall();
         return ESP_FAIL;
     }
+    ESP_LOGI(CAN_DISPLAY_TAG, "Node %d at %d kbit/s: requests on 0x%03x, replies on 0x%03x",
+             CONFIG_CAN_NODE_ID, CONFIG_CAN_BITRATE_KBPS, CAN_RX_ID, CAN_TX_ID);
     return ESP_OK;
 }
 
@@ -79,6 +523,7 @@ esp_err_t can_display_deinit(void)
         vTaskDelete(s_can_task_handle);
         s_can_task_handle = NULL;
     }
+    can_xfer_abort();
     esp_err_t ret = twai_stop();
     if (ret != ESP_OK) {
         ESP_LOGE(CAN_DISPLAY_TAG, "Failed to stop TWAI: %s", esp_err_to_name(ret));
@@ -91,3 +536,55 @@ esp_err_t can_display_deinit(void)
     return ret;
 }
 
+void can_display_get_xfer_stats(can_display_xfer_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    int64_t elapsed_us = s_xfer_last_us - s_xfer_start_us;
+    *stats = (can_display_xfer_stats_t){
+        .transfers = s_transfers,
+        .failures = s_failures,
+        .bytes = s_xfer_bytes,
+        .frames = s_xfer_frames,
+        .flow_controls = s_xfer_fcs,
+        .elapsed_ms = elapsed_us / 1000,
+    };
+    uint64_t bits = s_xfer_bits;
+    portEXIT_CRITICAL(&s_stats_lock);
+    if (elapsed_us > 0) {
+        stats->bytes_per_s = (uint64_t)stats->bytes * 1000000 / elapsed_us;
+        // bits / (elapsed_us * kbit/s / 1000), in permille
+        uint64_t load = bits * 1000000 / ((uint64_t)elapsed_us * CONFIG_CAN_BITRATE_KBPS);
+        stats->bus_load_permille = load > 1000 ? 1000 : load;
+    }
+    twai_status_info_t info;
+    if (twai_get_status_info(&info) == ESP_OK) {
+        stats->rx_missed = info.rx_missed_count;
+        stats->rx_overrun = info.rx_overrun_count;
+    }
+}
+
+#ifdef ESP_PLATFORM
+static int cmd_can(int argc, char **argv)
+{
+    can_display_xfer_stats_t st;
+    can_display_get_xfer_stats(&st);
+    printf("%" PRIu32 " images received, %" PRIu32 " failed\n", st.transfers, st.failures);
+    printf("last: %" PRIu32 " bytes in %" PRIu32 " ms, %" PRIu32 " B/s, %" PRIu32 " frames, %" PRIu32
+           " FC, bus load %u.%u%% of %d kbit/s\n", st.bytes, st.elapsed_ms, st.bytes_per_s, st.frames,
+           st.flow_controls, st.bus_load_permille / 10, st.bus_load_permille % 10,
+           CONFIG_CAN_BITRATE_KBPS);
+    printf("driver: %" PRIu32 " missed, %" PRIu32 " overruns\n", st.rx_missed, st.rx_overrun);
+    return 0;
+}
+
+esp_err_t can_display_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "can",
+        .help = "CAN image transfer counters, throughput and bus load",
+        .hint = NULL,
+        .func = cmd_can,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+#endif
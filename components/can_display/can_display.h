@@ -1,21 +1,119 @@
 #pragma once
 
 #include "esp_err.h"
+#include "ui_navigation.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Initialize TWAI interface for display navigation commands.
+ * CAN control protocol.
  *
- * Installs and starts the TWAI driver on GPIO20 (TX) and GPIO19 (RX).
- * Incoming CAN frames containing the ASCII strings "NEXT" or "PREV"
- * will generate synthetic touch events to drive the image navigation.
+ * Each display listens on CAN_DISPLAY_RX_BASE + CONFIG_CAN_NODE_ID and on
+ * the broadcast ID CAN_DISPLAY_RX_BASE, both set as hardware acceptance
+ * filters so frames for other nodes never reach the CPU. Messages are
+ * ISO-TP segmented (see can_isotp.h); broadcasts must fit a single frame.
  *
+ * Request:  seq, then one or more commands: op, len, payload[len]
+ * Reply:    seq, count, then per command: op | 0x80, status, len, payload[len]
+ *
+ * Replies go to CAN_DISPLAY_TX_BASE + CONFIG_CAN_NODE_ID, for addressed
+ * requests only. Multi-byte values are little-endian. A request repeating
+ * the previous one (same seq and bytes) is answered from the previous reply
+ * without running its commands again, so a controller can retry safely.
+ * An OK status means the command was accepted; the STATUS command reports
+ * what is being shown.
+ *
+ * Images are pushed in three steps: PUT_BEGIN announces the name, size and
+ * SHA-256; the file itself is one ISO-TP message (32-bit escape FF) sent to
+ * CAN_DISPLAY_DATA_BASE + node, flow-controlled from
+ * CAN_DISPLAY_DATA_FC_BASE + node with CONFIG_CAN_XFER_BLOCK_SIZE and
+ * CONFIG_CAN_XFER_ST_MIN; PUT_COMMIT verifies it and moves it into the
+ * album. XFER_STATS reports the throughput of the last transfer.
+ */
+
+#define CAN_DISPLAY_RX_BASE      0x600
+#define CAN_DISPLAY_TX_BASE      0x680
+#define CAN_DISPLAY_DATA_BASE    0x700
+#define CAN_DISPLAY_DATA_FC_BASE 0x780
+#define CAN_DISPLAY_REPLY_BIT    0x80
+
+typedef enum {
+    CAN_OP_NAV = 0x01,        /*!< int8 nav_cmd_t, as the on-screen buttons */
+    CAN_OP_GOTO_INDEX = 0x02, /*!< uint16 index in the current list */
+    CAN_OP_GOTO_HASH = 0x03,  /*!< uint32 can_display_name_hash() of a file name */
+    CAN_OP_BRIGHTNESS = 0x04, /*!< uint8 maximum backlight level in percent */
+    CAN_OP_SLIDESHOW = 0x05,  /*!< uint16 seconds per image, 0 stops */
+    CAN_OP_STATUS = 0x06,     /*!< Reply: uint16 index, uint16 count, uint8 brightness, uint16 slideshow */
+    CAN_OP_PUT_BEGIN = 0x07,  /*!< uint32 size, uint8 sha256[32], file name (rest of the payload) */
+    CAN_OP_PUT_COMMIT = 0x08, /*!< Verify the received image and add it to the album */
+    CAN_OP_PUT_ABORT = 0x09,
+    CAN_OP_XFER_STATS = 0x0A, /*!< Reply: uint32 bytes, uint32 ms, uint32 bytes/s, uint16 bus load permille */
+} can_display_op_t;
+
+typedef enum {
+    CAN_STATUS_OK = 0,
+    CAN_STATUS_UNKNOWN_OP,
+    CAN_STATUS_BAD_LENGTH,
+    CAN_STATUS_REJECTED,     /*!< Out of range or not possible now */
+    CAN_STATUS_UNSUPPORTED,  /*!< No handler registered */
+} can_display_status_code_t;
+
+typedef struct {
+    uint16_t index;
+    uint16_t count;
+    uint8_t brightness;
+    uint16_t slideshow_s;
+} can_display_status_t;
+
+/** Image transfer counters; the last-transfer figures cover FF to last CF. */
+typedef struct {
+    uint32_t transfers;          /*!< Images committed */
+    uint32_t failures;           /*!< Transfers refused, broken off or failing verification */
+    uint32_t bytes;              /*!< Payload of the last transfer */
+    uint32_t frames;             /*!< Data and flow control frames of the last transfer */
+    uint32_t flow_controls;      /*!< FC frames sent during the last transfer */
+    uint32_t elapsed_ms;
+    uint32_t bytes_per_s;
+    uint16_t bus_load_permille;  /*!< Share of the bit rate used, worst-case bit stuffing */
+    uint32_t rx_missed;          /*!< Frames lost by the driver since start-up */
+    uint32_t rx_overrun;
+} can_display_xfer_stats_t;
+
+/**
+ * Command handlers, called from the CAN task; they must not block. A NULL
+ * handler answers CAN_STATUS_UNSUPPORTED. The bool handlers return false
+ * to answer CAN_STATUS_REJECTED.
+ */
+typedef struct {
+    nav_cmd_cb_t on_nav;
+    bool (*on_goto_index)(uint16_t index);
+    bool (*on_goto_hash)(uint32_t name_hash);
+    bool (*on_brightness)(uint8_t percent);
+    bool (*on_slideshow)(uint16_t period_s);
+    void (*on_status)(can_display_status_t *status);
+    /** Directory receiving pushed images; NULL disables the PUT commands. */
+    const char *album_dir;
+    /** An image was committed to album_dir, at @p path. */
+    void (*on_image_added)(const char *path);
+} can_display_ops_t;
+
+/** 32-bit FNV-1a of the file name part of @p path, as used by CAN_OP_GOTO_HASH. */
+uint32_t can_display_name_hash(const char *path);
+
+/**
+ * @brief Initialize the TWAI interface and start serving the protocol.
+ *
+ * Installs and starts the TWAI driver at CONFIG_CAN_BITRATE_KBPS on GPIO20
+ * (TX) and GPIO19 (RX), filtered to this node's IDs.
+ *
+ * @param ops Command handlers, copied.
  * @return ESP_OK on success, an error code otherwise.
  */
-esp_err_t can_display_init(void);
+esp_err_t can_display_init(const can_display_ops_t *ops);
 
 /**
  * @brief Deinitialize TWAI interface and delete CAN task.
@@ -27,7 +125,12 @@ esp_err_t can_display_init(void);
  */
 esp_err_t can_display_deinit(void);
 
+/** @brief Copy the image transfer counters. */
+void can_display_get_xfer_stats(can_display_xfer_stats_t *stats);
+
+/** @brief Register the "can" console command printing the transfer counters. */
+esp_err_t can_display_console_register(void);
+
 #ifdef __cplusplus
 }
 #endif
-
@@ -0,0 +1,208 @@
+#include "can_isotp.h"
+#include <string.h>
+
+void can_isotp_rx_init(can_isotp_rx_t *rx, uint8_t *buf, size_t cap, uint8_t block_size,
+                       uint8_t st_min)
+{
+    *rx = (can_isotp_rx_t){
+        .buf = buf,
+        .cap = cap,
+        .block_size = block_size,
+        .st_min = st_min,
+    };
+}
+
+void can_isotp_rx_set_sink(can_isotp_rx_t *rx, can_isotp_sink_t sink, void *arg)
+{
+    rx->sink = sink;
+    rx->sink_arg = arg;
+    rx->active = false;
+}
+
+static esp_err_t rx_store(can_isotp_rx_t *rx, const uint8_t *data, size_t n)
+{
+    if (rx->sink) {
+        return rx->sink(rx->sink_arg, data, n);
+    }
+    memcpy(rx->buf + rx->got, data, n);
+    return ESP_OK;
+}
+
+static void make_fc(uint8_t out[CAN_ISOTP_FRAME_LEN], uint8_t status, uint8_t bs, uint8_t st_min)
+{
+    memset(out, 0, CAN_ISOTP_FRAME_LEN);
+    out[0] = (CAN_ISOTP_PCI_FC << 4) | status;
+    out[1] = bs;
+    out[2] = st_min;
+}
+
+can_isotp_rx_result_t can_isotp_rx_frame(can_isotp_rx_t *rx, const uint8_t *data, uint8_t dlc,
+                                         uint8_t out[CAN_ISOTP_FRAME_LEN])
+{
+    if (dlc < 1) {
+        return CAN_ISOTP_RX_ERROR;
+    }
+    switch (data[0] >> 4) {
+    case CAN_ISOTP_PCI_SF: {
+        // A new message always replaces one still being reassembled
+        size_t len = data[0] & 0x0f;
+        rx->active = false;
+        if (len == 0 || len > CAN_ISOTP_SF_MAX || len + 1 > dlc || len > rx->cap) {
+            return CAN_ISOTP_RX_ERROR;
+        }
+        rx->got = 0;
+        if (rx_store(rx, &data[1], len) != ESP_OK) {
+            return CAN_ISOTP_RX_ERROR;
+        }
+        rx->len = rx->got = len;
+        return CAN_ISOTP_RX_DONE;
+    }
+    case CAN_ISOTP_PCI_FF: {
+        rx->active = false;
+        if (dlc < CAN_ISOTP_FRAME_LEN) {
+            return CAN_ISOTP_RX_ERROR;
+        }
+        size_t len = (data[0] & 0x0f) << 8 | data[1];
+        size_t head = 2;
+        if (len == 0) {
+            // Escape FF: 32-bit big-endian length, 2 payload bytes
+            len = (uint32_t)data[2] << 24 | (uint32_t)data[3] << 16 | data[4] << 8 | data[5];
+            head = 6;
+        }
+        if (len <= CAN_ISOTP_SF_MAX) {
+            return CAN_ISOTP_RX_ERROR;
+        }
+        rx->got = 0;
+        if (len > rx->cap || rx_store(rx, &data[head], CAN_ISOTP_FRAME_LEN - head) != ESP_OK) {
+            make_fc(out, CAN_ISOTP_FC_OVFLW, 0, 0);
+            return CAN_ISOTP_RX_OVERFLOW;
+        }
+        rx->len = len;
+        rx->got = CAN_ISOTP_FRAME_LEN - head;
+        rx->next_sn = 1;
+        rx->block_left = rx->block_size;
+        rx->active = true;
+        make_fc(out, CAN_ISOTP_FC_CTS, rx->block_size, rx->st_min);
+        return CAN_ISOTP_RX_FC;
+    }
+    case CAN_ISOTP_PCI_CF: {
+        if (!rx->active) {
+            return CAN_ISOTP_RX_NONE;  // Stray frame of a message we dropped
+        }
+        if ((data[0] & 0x0f) != rx->next_sn) {
+            rx->active = false;
+            return CAN_ISOTP_RX_ERROR;
+        }
+        size_t n = rx->len - rx->got;
+        if (n > CAN_ISOTP_FRAME_LEN - 1) {
+            n = CAN_ISOTP_FRAME_LEN - 1;
+        }
+        if (n + 1 > dlc) {
+            rx->active = false;
+            return CAN_ISOTP_RX_ERROR;
+        }
+        if (rx_store(rx, &data[1], n) != ESP_OK) {
+            rx->active = false;
+            return CAN_ISOTP_RX_ERROR;
+        }
+        rx->got += n;
+        rx->next_sn = (rx->next_sn + 1) & 0x0f;
+        if (rx->got == rx->len) {
+            rx->active = false;
+            return CAN_ISOTP_RX_DONE;
+        }
+        if (rx->block_size && --rx->block_left == 0) {
+            rx->block_left = rx->block_size;
+            make_fc(out, CAN_ISOTP_FC_CTS, rx->block_size, rx->st_min);
+            return CAN_ISOTP_RX_FC;
+        }
+        return CAN_ISOTP_RX_NONE;
+    }
+    default:
+        // Flow control frames are for the sender, anything else is not ISO-TP
+        return CAN_ISOTP_RX_ERROR;
+    }
+}
+
+esp_err_t can_isotp_tx_start(can_isotp_tx_t *tx, const uint8_t *data, size_t len)
+{
+    if (len == 0 || (uint64_t)len > UINT32_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *tx = (can_isotp_tx_t){.data = data, .len = len};
+    return ESP_OK;
+}
+
+int can_isotp_tx_next(can_isotp_tx_t *tx, uint8_t out[CAN_ISOTP_FRAME_LEN])
+{
+    if (tx->sent == tx->len) {
+        return 0;
+    }
+    if (tx->wait_fc) {
+        return -1;
+    }
+    if (tx->sent == 0 && tx->len <= CAN_ISOTP_SF_MAX) {
+        out[0] = (CAN_ISOTP_PCI_SF << 4) | tx->len;
+        memcpy(&out[1], tx->data, tx->len);
+        tx->sent = tx->len;
+        return tx->len + 1;
+    }
+    if (tx->sent == 0) {
+        size_t head = 2;
+        if (tx->len <= CAN_ISOTP_MSG_MAX) {
+            out[0] = (CAN_ISOTP_PCI_FF << 4) | (tx->len >> 8);
+            out[1] = tx->len & 0xff;
+        } else {
+            out[0] = CAN_ISOTP_PCI_FF << 4;
+            out[1] = 0;
+            out[2] = tx->len >> 24;
+            out[3] = tx->len >> 16;
+            out[4] = tx->len >> 8;
+            out[5] = tx->len;
+            head = 6;
+        }
+        memcpy(&out[head], tx->data, CAN_ISOTP_FRAME_LEN - head);
+        tx->sent = CAN_ISOTP_FRAME_LEN - head;
+        tx->next_sn = 1;
+        tx->wait_fc = true;
+        return CAN_ISOTP_FRAME_LEN;
+    }
+    size_t n = tx->len - tx->sent;
+    if (n > CAN_ISOTP_FRAME_LEN - 1) {
+        n = CAN_ISOTP_FRAME_LEN - 1;
+    }
+    out[0] = (CAN_ISOTP_PCI_CF << 4) | tx->next_sn;
+    memcpy(&out[1], tx->data + tx->sent, n);
+    tx->sent += n;
+    tx->next_sn = (tx->next_sn + 1) & 0x0f;
+    if (tx->sent < tx->len && tx->block_size && --tx->block_left == 0) {
+        tx->wait_fc = true;
+    }
+    return n + 1;
+}
+
+int can_isotp_tx_flow(can_isotp_tx_t *tx, const uint8_t *data, uint8_t dlc)
+{
+    if (dlc < 3 || data[0] >> 4 != CAN_ISOTP_PCI_FC) {
+        return -1;
+    }
+    int status = data[0] & 0x0f;
+    if (status == CAN_ISOTP_FC_CTS) {
+        tx->block_size = data[1];
+        tx->block_left = data[1];
+        tx->st_min_us = can_isotp_st_min_us(data[2]);
+        tx->wait_fc = false;
+    }
+    return status;
+}
+
+uint32_t can_isotp_st_min_us(uint8_t st_min)
+{
+    if (st_min <= 0x7f) {
+        return st_min * 1000u;
+    }
+    if (st_min >= 0xf1 && st_min <= 0xf9) {
+        return (st_min - 0xf0) * 100u;
+    }
+    return 127000;  // Reserved values: the standard says use the maximum
+}
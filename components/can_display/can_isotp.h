@@ -0,0 +1,128 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * ISO 15765-2 (ISO-TP) segmentation, normal addressing, classic 8-byte CAN.
+ *
+ * Messages of up to 7 bytes travel in one single frame (SF). Longer ones
+ * start with a first frame (FF) carrying the length, 12 bits or, with the
+ * escape FF of ISO 15765-2:2016, 32 bits for messages over 4095 bytes; the
+ * receiver answers with a flow control frame (FC) giving the block size
+ * (consecutive frames before the next FC, 0 = all) and the minimum gap
+ * between them (STmin); consecutive frames (CF) follow with a 4-bit
+ * sequence number. The functions here only build and parse frames, the
+ * caller owns the bus.
+ */
+
+#define CAN_ISOTP_FRAME_LEN  8
+#define CAN_ISOTP_SF_MAX     7
+#define CAN_ISOTP_MSG_MAX    4095  /*!< Longest message with a 12-bit FF length */
+
+#define CAN_ISOTP_PCI_SF     0x0
+#define CAN_ISOTP_PCI_FF     0x1
+#define CAN_ISOTP_PCI_CF     0x2
+#define CAN_ISOTP_PCI_FC     0x3
+
+#define CAN_ISOTP_FC_CTS     0x0  /*!< Continue to send */
+#define CAN_ISOTP_FC_WAIT    0x1
+#define CAN_ISOTP_FC_OVFLW   0x2  /*!< Message too long for the receiver */
+
+typedef enum {
+    CAN_ISOTP_RX_NONE,      /*!< Frame consumed, nothing to do */
+    CAN_ISOTP_RX_FC,        /*!< Send the flow control frame in the output */
+    CAN_ISOTP_RX_DONE,      /*!< A complete message is in buf[0..len) */
+    CAN_ISOTP_RX_OVERFLOW,  /*!< Send the FC(OVFLW) in the output, message dropped */
+    CAN_ISOTP_RX_ERROR,     /*!< Malformed or out-of-sequence frame, message dropped */
+} can_isotp_rx_result_t;
+
+/**
+ * Receives the payload of an incoming message as it arrives, instead of
+ * reassembling it; an error drops the message.
+ */
+typedef esp_err_t (*can_isotp_sink_t)(void *arg, const uint8_t *data, size_t len);
+
+/** Reassembly of one incoming message. */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;         /*!< Size of buf, or longest message accepted by the sink */
+    can_isotp_sink_t sink;
+    void *sink_arg;
+    size_t len;         /*!< Announced length */
+    size_t got;
+    uint8_t next_sn;
+    uint8_t block_size; /*!< Our BS, sent in every FC */
+    uint8_t st_min;     /*!< Our STmin, sent in every FC */
+    uint8_t block_left;
+    bool active;
+} can_isotp_rx_t;
+
+/** Segmentation of one outgoing message. */
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t sent;
+    uint8_t next_sn;
+    uint8_t block_size; /*!< Peer's BS from the last FC */
+    uint8_t block_left;
+    uint32_t st_min_us; /*!< Peer's STmin from the last FC */
+    bool wait_fc;
+} can_isotp_tx_t;
+
+/** @brief Prepare @p rx to reassemble into @p buf of @p cap bytes. */
+void can_isotp_rx_init(can_isotp_rx_t *rx, uint8_t *buf, size_t cap, uint8_t block_size,
+                       uint8_t st_min);
+
+/**
+ * @brief Stream the payload of the following messages to @p sink.
+ *
+ * buf is no longer used; messages of up to cap bytes are accepted and
+ * handed over frame by frame. A NULL @p sink reverts to reassembly.
+ */
+void can_isotp_rx_set_sink(can_isotp_rx_t *rx, can_isotp_sink_t sink, void *arg);
+
+/**
+ * @brief Feed one received frame.
+ *
+ * @param out Receives the flow control frame to send for CAN_ISOTP_RX_FC
+ *            and CAN_ISOTP_RX_OVERFLOW.
+ */
+can_isotp_rx_result_t can_isotp_rx_frame(can_isotp_rx_t *rx, const uint8_t *data, uint8_t dlc,
+                                         uint8_t out[CAN_ISOTP_FRAME_LEN]);
+
+/**
+ * @brief Start sending @p len bytes of @p data (kept by reference).
+ *
+ * Messages over CAN_ISOTP_MSG_MAX bytes use the 32-bit escape FF.
+ */
+esp_err_t can_isotp_tx_start(can_isotp_tx_t *tx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Build the next frame to send.
+ *
+ * @return Its length, 0 when the message is complete, or -1 when a flow
+ *         control frame must be received first (after the FF and after
+ *         every block).
+ */
+int can_isotp_tx_next(can_isotp_tx_t *tx, uint8_t out[CAN_ISOTP_FRAME_LEN]);
+
+/**
+ * @brief Apply a received flow control frame.
+ *
+ * @return CAN_ISOTP_FC_CTS, CAN_ISOTP_FC_WAIT or CAN_ISOTP_FC_OVFLW, or -1
+ *         when the frame is not a flow control frame.
+ */
+int can_isotp_tx_flow(can_isotp_tx_t *tx, const uint8_t *data, uint8_t dlc);
+
+/** STmin byte to microseconds (0-127 ms, 0xF1-0xF9 = 100-900 us). */
+uint32_t can_isotp_st_min_us(uint8_t st_min);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,203 @@
+#include "can_xfer.h"
+#include "config.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "mbedtls/sha256.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+static const char *TAG = "CAN_XFER";
+
+#define PART_SUFFIX   ".part"
+/* Temp file writes are batched in this buffer: one flow-control block plus
+ * the first frame's payload */
+#define FILE_BUF_SIZE 2048
+
+typedef struct {
+    bool active;
+    uint32_t size;
+    uint32_t received;
+    uint8_t expected[32];
+    mbedtls_sha256_context sha;
+    char path[CAN_XFER_PATH_MAX];
+    uint8_t *staging; /* PSRAM copy of the whole image, or NULL */
+    FILE *file;       /* Temp file when staging is NULL */
+    uint8_t *buf;
+    size_t fill;
+} xfer_t;
+
+static xfer_t s_xfer;
+
+static bool name_ok(const char *name)
+{
+    size_t len = strlen(name);
+    return len > 4 && len < CAN_XFER_NAME_MAX && name[0] != '.' && !strchr(name, '/') &&
+           strcasecmp(name + len - 4, ".png") == 0;
+}
+
+static void part_path(char *out, size_t out_len)
+{
+    snprintf(out, out_len, "%s%s", s_xfer.path, PART_SUFFIX);
+}
+
+void can_xfer_abort(void)
+{
+    if (!s_xfer.active) {
+        return;
+    }
+    if (s_xfer.file) {
+        char tmp[CAN_XFER_PATH_MAX + sizeof(PART_SUFFIX)];
+        fclose(s_xfer.file);
+        part_path(tmp, sizeof(tmp));
+        remove(tmp);
+    }
+    heap_caps_free(s_xfer.staging);
+    free(s_xfer.buf);
+    mbedtls_sha256_free(&s_xfer.sha);
+    memset(&s_xfer, 0, sizeof(s_xfer));
+}
+
+esp_err_t can_xfer_begin(const char *album_dir, const char *name, uint32_t size,
+                         const uint8_t sha256[32])
+{
+    can_xfer_abort();
+    if (!name_ok(name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size == 0 || size > CONFIG_CAN_XFER_MAX_KB * 1024u) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (mkdir(album_dir, 0755) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "mkdir %s failed: %d", album_dir, errno);
+        return ESP_FAIL;
+    }
+
+    s_xfer.size = size;
+    memcpy(s_xfer.expected, sha256, sizeof(s_xfer.expected));
+    snprintf(s_xfer.path, sizeof(s_xfer.path), "%s/%s", album_dir, name);
+    s_xfer.staging = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_xfer.staging) {
+        // Too large for PSRAM: stream to the card, a block at a time
+        char tmp[CAN_XFER_PATH_MAX + sizeof(PART_SUFFIX)];
+        part_path(tmp, sizeof(tmp));
+        s_xfer.buf = malloc(FILE_BUF_SIZE);
+        s_xfer.file = s_xfer.buf ? fopen(tmp, "wb") : NULL;
+        if (!s_xfer.file) {
+            free(s_xfer.buf);
+            memset(&s_xfer, 0, sizeof(s_xfer));
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    mbedtls_sha256_init(&s_xfer.sha);
+    mbedtls_sha256_starts(&s_xfer.sha, 0);
+    s_xfer.active = true;
+    ESP_LOGI(TAG, "Receiving %s, %" PRIu32 " bytes in %s", name, size,
+             s_xfer.staging ? "PSRAM" : "a temp file");
+    return ESP_OK;
+}
+
+esp_err_t can_xfer_flush(void)
+{
+    if (!s_xfer.file || s_xfer.fill == 0) {
+        return ESP_OK;
+    }
+    size_t n = fwrite(s_xfer.buf, 1, s_xfer.fill, s_xfer.file);
+    bool ok = n == s_xfer.fill;
+    s_xfer.fill = 0;
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t can_xfer_write(void *arg, const uint8_t *data, size_t len)
+{
+    if (!s_xfer.active || len > s_xfer.size - s_xfer.received) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    mbedtls_sha256_update(&s_xfer.sha, data, len);
+    if (s_xfer.staging) {
+        memcpy(s_xfer.staging + s_xfer.received, data, len);
+    } else {
+        // Only a sender ignoring our block size fills the buffer mid-block
+        if (s_xfer.fill + len > FILE_BUF_SIZE && can_xfer_flush() != ESP_OK) {
+            return ESP_FAIL;
+        }
+        memcpy(s_xfer.buf + s_xfer.fill, data, len);
+        s_xfer.fill += len;
+    }
+    s_xfer.received += len;
+    return ESP_OK;
+}
+
+esp_err_t can_xfer_commit(char *path, size_t path_len)
+{
+    if (!s_xfer.active || s_xfer.received != s_xfer.size) {
+        can_xfer_abort();
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t actual[32];
+    mbedtls_sha256_finish(&s_xfer.sha, actual);
+    if (memcmp(actual, s_xfer.expected, sizeof(actual)) != 0) {
+        ESP_LOGW(TAG, "%s: SHA-256 mismatch", s_xfer.path);
+        can_xfer_abort();
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    char tmp[CAN_XFER_PATH_MAX + sizeof(PART_SUFFIX)];
+    part_path(tmp, sizeof(tmp));
+    esp_err_t err = can_xfer_flush();
+    if (s_xfer.staging) {
+        FILE *f = fopen(tmp, "wb");
+        if (!f) {
+            err = ESP_FAIL;
+        } else {
+            if (fwrite(s_xfer.staging, 1, s_xfer.size, f) != s_xfer.size) {
+                err = ESP_FAIL;
+            }
+            fclose(f);
+        }
+    } else {
+        if (fclose(s_xfer.file) != 0) {
+            err = ESP_FAIL;
+        }
+        s_xfer.file = NULL;
+    }
+    if (err == ESP_OK) {
+        /* FatFs refuses to rename over an existing file */
+        remove(s_xfer.path);
+        if (rename(tmp, s_xfer.path) != 0) {
+            ESP_LOGE(TAG, "rename %s failed: %d", tmp, errno);
+            err = ESP_FAIL;
+        }
+    }
+    if (err != ESP_OK) {
+        remove(tmp);
+    } else {
+        ESP_LOGI(TAG, "Committed %s", s_xfer.path);
+        snprintf(path, path_len, "%s", s_xfer.path);
+    }
+    can_xfer_abort();
+    return err;
+}
+
+uint32_t can_xfer_size(void)
+{
+    return s_xfer.active ? s_xfer.size : 0;
+}
+
+uint8_t can_xfer_block_limit(void)
+{
+    if (!s_xfer.active || s_xfer.staging) {
+        return 0;
+    }
+    size_t frames = (FILE_BUF_SIZE - 6) / 7;
+    return frames > 255 ? 255 : frames;
+}
+
+bool can_xfer_in_psram(void)
+{
+    return s_xfer.active && s_xfer.staging;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Staging of one image pushed over CAN.
+ *
+ * The payload goes to a PSRAM buffer of the announced size or, when PSRAM
+ * cannot hold it, to "<album>/<name>.part" through a small block buffer.
+ * A running SHA-256 is kept either way, so committing only compares the
+ * digest and moves the file into place: the album never shows a partial
+ * image.
+ */
+
+#define CAN_XFER_NAME_MAX 64
+#define CAN_XFER_PATH_MAX (CAN_XFER_NAME_MAX + 96)
+
+/**
+ * @brief Start a transfer, dropping any previous one.
+ *
+ * @param name File name in @p album_dir, a .png without directory part.
+ * @return ESP_ERR_INVALID_ARG for a bad name, ESP_ERR_INVALID_SIZE above
+ *         CONFIG_CAN_XFER_MAX_KB, or the error creating the staging area.
+ */
+esp_err_t can_xfer_begin(const char *album_dir, const char *name, uint32_t size,
+                         const uint8_t sha256[32]);
+
+/** Append payload; a can_isotp_sink_t, @p arg is unused. */
+esp_err_t can_xfer_write(void *arg, const uint8_t *data, size_t len);
+
+/** Write buffered payload to the temp file; call before granting a new block. */
+esp_err_t can_xfer_flush(void);
+
+/**
+ * @brief Check size and digest and move the image into the album.
+ *
+ * The transfer is over whatever the result.
+ *
+ * @param path Receives the path of the committed image.
+ * @return ESP_ERR_INVALID_STATE if no transfer is complete,
+ *         ESP_ERR_INVALID_CRC on a digest mismatch, ESP_FAIL on a file error.
+ */
+esp_err_t can_xfer_commit(char *path, size_t path_len);
+
+/** Drop the transfer in progress and its temp file. */
+void can_xfer_abort(void);
+
+/** Announced size of the transfer in progress, 0 when there is none. */
+uint32_t can_xfer_size(void);
+
+/** Longest flow-control block the staging can absorb, 0 when unlimited. */
+uint8_t can_xfer_block_limit(void);
+
+/** True when the transfer in progress is staged in PSRAM. */
+bool can_xfer_in_psram(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -186,6 +186,75 @@
 #define CONFIG_IOEXT_LCD_VDD_EN 6
 #endif
 
+#ifndef CONFIG_IOEXT_ADC_PERIOD_MS
+#define CONFIG_IOEXT_ADC_PERIOD_MS 1000
+#endif
+
+#ifndef CONFIG_CAN_NODE_ID
+#define CONFIG_CAN_NODE_ID 1
+#endif
+
+#ifndef CONFIG_CAN_BITRATE_KBPS
+#define CONFIG_CAN_BITRATE_KBPS 250
+#endif
+
+#ifndef CONFIG_CAN_XFER_ALBUM_DIR
+#define CONFIG_CAN_XFER_ALBUM_DIR "can"
+#endif
+
+#ifndef CONFIG_CAN_XFER_MAX_KB
+#define CONFIG_CAN_XFER_MAX_KB 4096
+#endif
+
+#ifndef CONFIG_CAN_XFER_BLOCK_SIZE
+#define CONFIG_CAN_XFER_BLOCK_SIZE 32
+#endif
+
+#ifndef CONFIG_CAN_XFER_ST_MIN
+#define CONFIG_CAN_XFER_ST_MIN 0
+#endif
+
+#ifndef CONFIG_UI_FONT_CACHE_GLYPHS
+#define CONFIG_UI_FONT_CACHE_GLYPHS 64
+#endif
+
+#ifndef CONFIG_BOOT_TOUCH_SD_CORE
+#define CONFIG_BOOT_TOUCH_SD_CORE 1
+#endif
+
+#ifndef CONFIG_INPUT_REMOTE_RATE
+#define CONFIG_INPUT_REMOTE_RATE 20
+#endif
+
+#ifndef CONFIG_INPUT_REMOTE_BURST
+#define CONFIG_INPUT_REMOTE_BURST 10
+#endif
+
+#ifndef CONFIG_MODBUS_SLAVE_ID
+#define CONFIG_MODBUS_SLAVE_ID 1
+#endif
+
+#ifndef CONFIG_MODBUS_BAUD_RATE
+#define CONFIG_MODBUS_BAUD_RATE 115200
+#endif
+
+#ifndef CONFIG_RS485_DE_GPIO
+#define CONFIG_RS485_DE_GPIO -1
+#endif
+
+#ifndef CONFIG_RS485_DE_LEAD_US
+#define CONFIG_RS485_DE_LEAD_US 0
+#endif
+
+#ifndef CONFIG_RS485_DE_TAIL_US
+#define CONFIG_RS485_DE_TAIL_US 0
+#endif
+
+#if !defined(CONFIG_MODBUS_PARITY_EVEN) && !defined(CONFIG_MODBUS_PARITY_ODD) && \
+    !defined(CONFIG_MODBUS_PARITY_NONE)
+#define CONFIG_MODBUS_PARITY_EVEN 1
+#endif
+
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
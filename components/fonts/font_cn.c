@@ -0,0 +1,25 @@
+#include "fonts.h"
+#include "font_hash.h"
+#include <stddef.h>
+
+const uint8_t *cfont_find(const cFONT_Packed *font, const char *text, uint8_t *used)
+{
+    const uint8_t *p = (const uint8_t *)text;
+    uint16_t code = p[0];
+    *used = 1;
+    if (p[0] >= 0x80) {
+        if (p[1] == 0) {
+            return NULL;
+        }
+        code = p[0] << 8 | p[1];
+        *used = 2;
+    }
+    if (code == 0 || font->slots == 0) {
+        return NULL;
+    }
+    uint32_t slot = font_hash_slot(code, font->disp, font->buckets, font->slots);
+    if (font->keys[slot] != code) {
+        return NULL;
+    }
+    return font->glyphs + slot * (size_t)font->Height * ((font->Width + 7) / 8);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hash of the generated glyph indexes (hash and displace): a key goes to
+ * bucket font_hash(key, 0) % buckets, then to slot
+ * font_hash(key, disp[bucket]) % slots, where the generator picked each
+ * bucket's displacement so that no two keys share a slot. A lookup is two
+ * hashes and one compare. tools/gen_lv_font.py has the same function.
+ */
+static inline uint32_t font_hash(uint32_t key, uint32_t seed)
+{
+    uint32_t h = (key ^ seed) * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
+/** Slot of @p key, whose presence the caller checks against its key table. */
+static inline uint32_t font_hash_slot(uint32_t key, const uint16_t *disp, uint16_t buckets,
+                                      uint16_t slots)
+{
+    return font_hash(key, disp[font_hash(key, 0) % buckets]) % slots;
+}
+
+#ifdef __cplusplus
+}
+#endif
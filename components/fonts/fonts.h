@@ -79,16 +79,38 @@ typedef struct
   
 }cFONT;
 
-extern sFONT Font48;
-extern sFONT Font24;
-extern sFONT Font20;
-extern sFONT Font16;
-extern sFONT Font12;
-extern sFONT Font8;
+//GB2312, packed by tools/gen_cn_font.py
+typedef struct
+{
+  const uint8_t *glyphs;                              // Height * ceil(Width / 8) bytes per slot
+  const uint16_t *keys;                               // GB2312 code (or ASCII byte) of each slot, 0 if empty
+  const uint16_t *disp;                               // Perfect hash displacement per bucket, see font_hash.h
+  uint16_t slots;
+  uint16_t buckets;
+  uint16_t ASCII_Width;
+  uint16_t Width;
+  uint16_t Height;
 
+}cFONT_Packed;
+
+/* The sFONT/cFONT tables (fontNN.c, fontNNCN.c) are generator input and not
+   linked into the firmware. Only the host build compiles the CH_CN ones, as
+   the reference of its `fonts` command, and defines FONTS_LEGACY_CN. */
+#ifdef FONTS_LEGACY_CN
 extern cFONT Font12CN;
 extern cFONT Font24CN;
 extern cFONT Font48CN;
+#endif
+
+extern const cFONT_Packed Font12CN_Packed;
+extern const cFONT_Packed Font24CN_Packed;
+extern const cFONT_Packed Font48CN_Packed;
+
+/**
+ * Glyph of the character at @p text (one ASCII byte or two GB2312 bytes).
+ * @p used receives the bytes it takes, NULL is returned when the font lacks it.
+ */
+const uint8_t *cfont_find(const cFONT_Packed *font, const char *text, uint8_t *used);
 #ifdef __cplusplus
 }
 #endif
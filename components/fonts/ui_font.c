@@ -0,0 +1,160 @@
+#include "ui_font.h"
+#include "config.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#endif
+
+/*
+ * Direct-mapped cache of expanded glyphs. LVGL only draws from the GUI
+ * task, so the cache itself is not locked; only the counters are, for the
+ * console.
+ */
+typedef struct {
+    const ui_font_dsc_t *dsc; /* NULL when the entry is free */
+    uint32_t id;
+    size_t cap;
+    uint8_t *a8;
+} cache_entry_t;
+
+static cache_entry_t s_cache[CONFIG_UI_FONT_CACHE_GLYPHS];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static ui_font_stats_t s_stats;
+
+static void count(uint32_t *field, uint32_t n)
+{
+    portENTER_CRITICAL(&s_lock);
+    *field += n;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+/* Glyph index of @p letter, -1 when the font does not have it */
+static int32_t find_glyph(const ui_font_dsc_t *dsc, uint32_t letter)
+{
+    if (letter >= UI_FONT_ASCII_FIRST && letter <= UI_FONT_ASCII_LAST) {
+        return letter - UI_FONT_ASCII_FIRST;
+    }
+    if (dsc->hash_slots == 0 || letter == 0) {
+        return -1;
+    }
+    uint32_t slot = font_hash_slot(letter, dsc->hash_disp, dsc->hash_buckets, dsc->hash_slots);
+    return dsc->hash_keys[slot] == letter ? (int32_t)(UI_FONT_ASCII_COUNT + slot) : -1;
+}
+
+bool ui_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter,
+                           uint32_t letter_next)
+{
+    const ui_font_dsc_t *fdsc = font->dsc;
+    int32_t id = find_glyph(fdsc, letter);
+    const ui_font_glyph_t *g = id >= 0 ? &fdsc->glyphs[id] : NULL;
+    count(&s_stats.lookups, 1);
+    if (!g || g->adv_w == 0) {
+        count(&s_stats.missing, 1);
+        return false;
+    }
+    dsc->adv_w = g->adv_w;
+    dsc->box_w = g->box_w;
+    dsc->box_h = g->box_h;
+    dsc->ofs_x = g->ofs_x;
+    dsc->ofs_y = g->ofs_y;
+    dsc->format = LV_FONT_GLYPH_FORMAT_A8;
+    dsc->is_placeholder = false;
+    dsc->gid.index = id;
+    return true;
+}
+
+/* Unpack bit-packed pixels to one byte of alpha each */
+static void expand(const ui_font_dsc_t *dsc, const ui_font_glyph_t *g, uint8_t *out)
+{
+    const uint8_t *src = dsc->bitmap + g->bitmap_index;
+    const uint8_t bpp = dsc->bpp;
+    const uint8_t mask = (1 << bpp) - 1;
+    size_t n = (size_t)g->box_w * g->box_h;
+    uint32_t bit = 0;
+    for (size_t i = 0; i < n; i++, bit += bpp) {
+        uint8_t v = (src[bit >> 3] >> (8 - bpp - (bit & 7))) & mask;
+        out[i] = v * 255 / mask;
+    }
+}
+
+static const uint8_t *cached_glyph(const ui_font_dsc_t *dsc, uint32_t id)
+{
+    const ui_font_glyph_t *g = &dsc->glyphs[id];
+    cache_entry_t *e = &s_cache[font_hash(id, (uint32_t)(uintptr_t)dsc) %
+                                CONFIG_UI_FONT_CACHE_GLYPHS];
+    if (e->dsc == dsc && e->id == id) {
+        count(&s_stats.hits, 1);
+        return e->a8;
+    }
+    size_t size = (size_t)g->box_w * g->box_h;
+    if (e->cap < size) {
+        uint8_t *a8 = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!a8) {
+            return NULL;
+        }
+        heap_caps_free(e->a8);
+        count(&s_stats.cache_bytes, size - e->cap);
+        e->a8 = a8;
+        e->cap = size;
+    }
+    expand(dsc, g, e->a8);
+    e->dsc = dsc;
+    e->id = id;
+    count(&s_stats.misses, 1);
+    return e->a8;
+}
+
+const void *ui_font_get_glyph_bitmap(lv_font_glyph_dsc_t *dsc, lv_draw_buf_t *draw_buf)
+{
+    const ui_font_dsc_t *fdsc = dsc->resolved_font->dsc;
+    if (!draw_buf || dsc->box_w == 0 || dsc->box_h == 0) {
+        return NULL;
+    }
+    const uint8_t *a8 = cached_glyph(fdsc, dsc->gid.index);
+    if (!a8) {
+        return NULL;
+    }
+    uint32_t stride = draw_buf->header.stride;
+    for (uint16_t y = 0; y < dsc->box_h; y++) {
+        memcpy(draw_buf->data + y * stride, a8 + y * dsc->box_w, dsc->box_w);
+    }
+    return draw_buf;
+}
+
+void ui_font_get_stats(ui_font_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+#ifdef ESP_PLATFORM
+static int cmd_font(int argc, char **argv)
+{
+    ui_font_stats_t st;
+    ui_font_get_stats(&st);
+    uint32_t draws = st.hits + st.misses;
+    printf("glyphs: %" PRIu32 " lookups, %" PRIu32 " missing (fallback font)\n", st.lookups,
+           st.missing);
+    printf("cache: %d entries, %" PRIu32 " bytes PSRAM, %" PRIu32 " hits, %" PRIu32
+           " misses (%u%% hit)\n",
+           CONFIG_UI_FONT_CACHE_GLYPHS, st.cache_bytes, st.hits, st.misses,
+           draws ? (unsigned)((uint64_t)st.hits * 100 / draws) : 0);
+    return 0;
+}
+
+esp_err_t ui_font_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "font",
+        .help = "Glyph lookups and glyph cache statistics",
+        .hint = NULL,
+        .func = cmd_font,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+#endif
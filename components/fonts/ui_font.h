@@ -0,0 +1,76 @@
+#pragma once
+
+#include "esp_err.h"
+#include "font_hash.h"
+#include "lvgl.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * LVGL fonts generated at build time by tools/gen_lv_font.py, from the
+ * sFONT/cFONT tables of this component or from a TTF (CONFIG_UI_FONT_TTF).
+ *
+ * Glyphs are cropped to their ink and packed at 1 to 4 bits per pixel.
+ * Printable ASCII is indexed directly; other code points (accented Latin,
+ * CJK) go through a perfect hash, so finding a glyph costs the same with
+ * ten or ten thousand of them. The glyphs LVGL asks to draw are expanded to
+ * 8-bit alpha once and kept in a small cache in PSRAM
+ * (CONFIG_UI_FONT_CACHE_GLYPHS entries), so redrawing a label, which LVGL
+ * does on every invalidation, only copies rows.
+ */
+
+/** Glyph descriptor; an all-zero entry is a missing glyph. */
+typedef struct {
+    uint32_t bitmap_index; /*!< Offset of the packed bitmap in ui_font_dsc_t::bitmap */
+    uint8_t adv_w;         /*!< Advance in pixels */
+    uint8_t box_w;
+    uint8_t box_h;
+    int8_t ofs_x;
+    int8_t ofs_y;          /*!< Bottom of the box above the baseline */
+} ui_font_glyph_t;
+
+/** What lv_font_t::dsc points to in a generated font. */
+typedef struct {
+    const uint8_t *bitmap;          /*!< Rows of box_w pixels, bit-packed, MSB first */
+    const ui_font_glyph_t *glyphs;  /*!< UI_FONT_ASCII_COUNT entries, then hash_slots */
+    const uint32_t *hash_keys;      /*!< Code point held by each slot, 0 when empty */
+    const uint16_t *hash_disp;      /*!< Displacement (hash seed) per bucket */
+    uint16_t hash_slots;
+    uint16_t hash_buckets;
+    uint8_t bpp;
+} ui_font_dsc_t;
+
+#define UI_FONT_ASCII_FIRST 0x20
+#define UI_FONT_ASCII_LAST  0x7E
+#define UI_FONT_ASCII_COUNT (UI_FONT_ASCII_LAST - UI_FONT_ASCII_FIRST + 1)
+
+/** Filename bar and album names: Font20 and Font12CN, or the configured TTF. */
+extern const lv_font_t ui_font_text;
+
+/** lv_font_t::get_glyph_dsc of the generated fonts. */
+bool ui_font_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc, uint32_t letter,
+                           uint32_t letter_next);
+
+/** lv_font_t::get_glyph_bitmap of the generated fonts: 8-bit alpha in @p draw_buf. */
+const void *ui_font_get_glyph_bitmap(lv_font_glyph_dsc_t *dsc, lv_draw_buf_t *draw_buf);
+
+typedef struct {
+    uint32_t lookups; /*!< Glyph descriptors asked by LVGL */
+    uint32_t missing; /*!< Code points left to the fallback font */
+    uint32_t hits;    /*!< Bitmaps served from the cache */
+    uint32_t misses;  /*!< Bitmaps expanded from flash */
+    uint32_t cache_bytes;
+} ui_font_stats_t;
+
+/** Counters since boot. */
+void ui_font_get_stats(ui_font_stats_t *stats);
+
+/** Add the `font` command to the esp_console REPL. */
+esp_err_t ui_font_console_register(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,25 +1,149 @@
 #include "gui.h"
+#include "gui_perf.h"
+#include "image_pool.h"
+#include "trace.h"
 #include "lvgl.h"
+#include "src/draw/lv_image_decoder_private.h"
 #include "gt911.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "config.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include <string.h>
+
+/* Read period while a finger is down, the GT911 INT line only pulses */
+#define GUI_TOUCH_POLL_MS 20
+#define GUI_CMD_QUEUE_LEN 16
+/* gui_post() gives up after this long on a full queue */
+#define GUI_CMD_POST_TIMEOUT_MS 100
+
+typedef struct {
+    gui_cmd_fn_t fn;
+    void *arg;
+} gui_cmd_t;
 
 static esp_lcd_panel_handle_t s_panel;
-static lv_draw_buf_t *s_draw_buf;
 static uint8_t *s_buf1;
 static lv_display_t *s_disp;
 static TaskHandle_t s_lvgl_task;
-static esp_timer_handle_t s_lvgl_tick_timer;
+static SemaphoreHandle_t s_lvgl_mutex;
+static UBaseType_t s_lock_depth; /* Only touched by the mutex holder */
+static QueueHandle_t s_cmd_queue;
+static lv_indev_t *s_indev;
+static volatile bool s_touch_irq;
+
+/* Frame accounting for gui_perf, only touched from lvgl_task */
+static int64_t s_frame_start_us;
+static int64_t s_frame_flush_us;
+static uint32_t s_frame_px;
+static int64_t s_input_us; /* Press not yet followed by a drawn frame */
+static bool s_pressed;
+
+#define GUI_PERF_MAX_DECODERS 8
+static struct {
+    lv_image_decoder_t *decoder;
+    lv_image_decoder_open_f_t open_cb;
+} s_decoders[GUI_PERF_MAX_DECODERS];
 
 static void lvgl_flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
 {
+    TRACE_BEGIN("flush");
+    int64_t start = esp_timer_get_time();
     esp_lcd_panel_draw_bitmap(s_panel, area->x1, area->y1, area->x2 + 1, area->y2 + 1, px_map);
+    int64_t elapsed = esp_timer_get_time() - start;
+    TRACE_END("flush");
+    gui_perf_record(GUI_PERF_FLUSH, (uint32_t)elapsed);
+    s_frame_flush_us += elapsed;
+    s_frame_px += (uint32_t)lv_area_get_size(area);
     lv_display_flush_ready(disp);
 }
 
+static void lvgl_refr_event_cb(lv_event_t *e)
+{
+    int64_t now = esp_timer_get_time();
+    if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+        s_frame_start_us = now;
+        s_frame_flush_us = 0;
+        s_frame_px = 0;
+        return;
+    }
+    if (s_frame_px == 0) {
+        return; /* Nothing was invalid */
+    }
+    gui_perf_record(GUI_PERF_RENDER, (uint32_t)(now - s_frame_start_us - s_frame_flush_us));
+    gui_perf_record(GUI_PERF_AREA, s_frame_px);
+    TRACE_COUNTER("frame_px", s_frame_px);
+    if (s_input_us) {
+        gui_perf_record(GUI_PERF_INPUT_LATENCY, (uint32_t)(now - s_input_us));
+        s_input_us = 0;
+    }
+}
+
+/* Image decoders fully decode in open_cb: time it, except for the BIN
+ * decoder whose open on in-memory images is a pointer copy. */
+static lv_result_t timed_decoder_open(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+    for (size_t i = 0; i < GUI_PERF_MAX_DECODERS; ++i) {
+        if (s_decoders[i].decoder == decoder) {
+            TRACE_BEGIN("decode");
+            int64_t start = esp_timer_get_time();
+            lv_result_t res = s_decoders[i].open_cb(decoder, dsc);
+            TRACE_END("decode");
+            if (res == LV_RESULT_OK) {
+                gui_perf_record(GUI_PERF_DECODE, (uint32_t)(esp_timer_get_time() - start));
+            }
+            return res;
+        }
+    }
+    return LV_RESULT_INVALID;
+}
+
+static void hook_image_decoders(void)
+{
+    size_t n = 0;
+    lv_image_decoder_t *d = NULL;
+    while ((d = lv_image_decoder_get_next(d)) != NULL && n < GUI_PERF_MAX_DECODERS) {
+        if (!d->open_cb || d->open_cb == timed_decoder_open ||
+            (d->name && strcmp(d->name, "BIN") == 0)) {
+            continue;
+        }
+        s_decoders[n].decoder = d;
+        s_decoders[n].open_cb = d->open_cb;
+        d->open_cb = timed_decoder_open;
+        n++;
+    }
+}
+
+/*
+ * Decoded images live in image_pool slabs rather than on the heap. Unlike
+ * LVGL's default handler, no LV_DRAW_BUF_ALIGN padding is added: the pool
+ * hands out 64-byte aligned blocks, and the padding would push a full-screen
+ * ARGB8888 image past the slab size.
+ */
+static void *image_buf_malloc(size_t size, lv_color_format_t cf)
+{
+    (void)cf;
+    return image_pool_alloc(size);
+}
+
+static void image_buf_free(void *buf)
+{
+    image_pool_free(buf);
+}
+
+static void hook_image_buffers(void)
+{
+    lv_draw_buf_handlers_t *h = lv_draw_buf_get_image_handlers();
+    h->buf_malloc_cb = image_buf_malloc;
+    h->buf_free_cb = image_buf_free;
+}
+
 static void lvgl_touch_read(lv_indev_t *indev, lv_indev_data_t *data)
 {
     touch_gt911_point_t p = touch_gt911_read_point(1);
@@ -27,54 +151,174 @@ static void lvgl_touch_read(lv_indev_t *indev, lv_indev_data_t *data)
         data->state = LV_INDEV_STATE_PRESSED;
         data->point.x = p.x[0];
         data->point.y = p.y[0];
+        if (!s_pressed && !s_input_us) {
+            s_input_us = esp_timer_get_time();
+        }
+        s_pressed = true;
     } else {
         data->state = LV_INDEV_STATE_RELEASED;
+        s_pressed = false;
     }
 }
 
 static const char *TAG = "lvgl";
 
-static void lvgl_tick_timer_cb(void *arg)
+static uint32_t lvgl_tick_get(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void IRAM_ATTR lvgl_touch_isr(esp_lcd_touch_handle_t tp)
 {
-    (void)arg;
-    lv_tick_inc(1);
+    (void)tp;
+    BaseType_t hp_task_woken = pdFALSE;
+    s_touch_irq = true;
+    if (s_lvgl_task) {
+        vTaskNotifyGiveFromISR(s_lvgl_task, &hp_task_woken);
+    }
+    portYIELD_FROM_ISR(hp_task_woken);
 }
 
+void gui_wake(void)
+{
+    if (s_lvgl_task && xTaskGetCurrentTaskHandle() != s_lvgl_task) {
+        xTaskNotifyGive(s_lvgl_task);
+    }
+}
+
+/* Objects changed outside lvgl_task must be redrawn without waiting for
+ * the next timer deadline */
+static void lvgl_invalidate_event_cb(lv_event_t *e)
+{
+    (void)e;
+    gui_wake();
+}
+
+esp_err_t gui_attach_touch(esp_lcd_touch_handle_t tp)
+{
+    ESP_RETURN_ON_FALSE(tp, ESP_ERR_INVALID_ARG, TAG, "No touch handle");
+    ESP_RETURN_ON_ERROR(esp_lcd_touch_register_interrupt_callback(tp, lvgl_touch_isr), TAG,
+                        "Touch interrupt registration failed");
+    /* A finger may already be down */
+    s_touch_irq = true;
+    gui_wake();
+    return ESP_OK;
+}
+
+/* Apply the posted commands in order, with the mutex held */
+static void gui_cmd_drain(void)
+{
+    gui_cmd_t cmd;
+    while (s_cmd_queue && xQueueReceive(s_cmd_queue, &cmd, 0) == pdTRUE) {
+        cmd.fn(cmd.arg);
+    }
+}
+
+esp_err_t gui_post(gui_cmd_fn_t fn, void *arg)
+{
+    ESP_RETURN_ON_FALSE(fn, ESP_ERR_INVALID_ARG, TAG, "No command");
+    ESP_RETURN_ON_FALSE(s_cmd_queue, ESP_ERR_INVALID_STATE, TAG, "GUI not started");
+    gui_cmd_t cmd = { .fn = fn, .arg = arg };
+    if (xQueueSend(s_cmd_queue, &cmd, pdMS_TO_TICKS(GUI_CMD_POST_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "Command queue full");
+        return ESP_ERR_TIMEOUT;
+    }
+    /* Also from lvgl_task itself, the command must not wait for a timer */
+    if (s_lvgl_task) {
+        xTaskNotifyGive(s_lvgl_task);
+    }
+    return ESP_OK;
+}
+
+void gui_lock(void)
+{
+    TRACE_BEGIN("gui_lock_wait");
+    xSemaphoreTakeRecursive(s_lvgl_mutex, portMAX_DELAY);
+    TRACE_END("gui_lock_wait");
+    /* Commands posted before the lock was taken run first */
+    if (s_lock_depth++ == 0) {
+        gui_cmd_drain();
+    }
+}
+
+void gui_unlock(void)
+{
+    s_lock_depth--;
+    xSemaphoreGiveRecursive(s_lvgl_mutex);
+    gui_wake();
+}
+
+/* Runs LVGL only when there is work: a timer is due, the touch controller
+ * raised its INT line or another task posted a command or changed the UI.
+ * In between the task blocks, so a static image costs no CPU and allows
+ * tickless light sleep. Commands are applied by gui_lock(), so a batch
+ * posted together is drawn in a single frame. */
 static void lvgl_task(void *arg)
 {
     while (1) {
-        lv_timer_handler();
+        gui_lock();
+        if (s_touch_irq || s_pressed) {
+            s_touch_irq = false;
+            lv_indev_read(s_indev);
+        }
+        TRACE_BEGIN("lv_timer_handler");
+        int64_t start = esp_timer_get_time();
+        uint32_t next_ms = lv_timer_handler();
+        gui_perf_record(GUI_PERF_TIMER_HANDLER, (uint32_t)(esp_timer_get_time() - start));
+        TRACE_END("lv_timer_handler");
+        gui_unlock();
         UBaseType_t stack_words = uxTaskGetStackHighWaterMark(NULL);
         if (stack_words < 512) {
             ESP_LOGW(TAG, "Low stack: %u words remaining", stack_words);
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
+        if (s_pressed && next_ms > GUI_TOUCH_POLL_MS) {
+            next_ms = GUI_TOUCH_POLL_MS;
+        }
+        TickType_t ticks = portMAX_DELAY;
+        if (next_ms != LV_NO_TIMER_READY) {
+            ticks = pdMS_TO_TICKS(next_ms);
+            if (ticks == 0) {
+                ticks = 1;
+            }
+        }
+        TRACE_BEGIN("lvgl_wait");
+        ulTaskNotifyTake(pdTRUE, ticks);
+        TRACE_END("lvgl_wait");
     }
 }
 
 void gui_init(esp_lcd_panel_handle_t panel)
 {
     s_panel = panel;
+    s_lvgl_mutex = xSemaphoreCreateRecursiveMutex();
+    s_cmd_queue = xQueueCreate(GUI_CMD_QUEUE_LEN, sizeof(gui_cmd_t));
     lv_init();
+    lv_tick_set_cb(lvgl_tick_get);
 
-    s_draw_buf = lv_draw_buf_create(g_display.width, 10, LV_COLOR_FORMAT_NATIVE, LV_STRIDE_AUTO);
-    s_buf1 = s_draw_buf->data;
+    /* Rendered into on every frame: internal RAM, whatever lv_malloc() uses */
+    size_t buf_size = g_display.width * 10 * sizeof(lv_color_t);
+    s_buf1 = heap_caps_malloc(buf_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!s_buf1) {
+        ESP_LOGW(TAG, "No internal RAM for the render buffer, using PSRAM");
+        s_buf1 = heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    ESP_ERROR_CHECK(s_buf1 ? ESP_OK : ESP_ERR_NO_MEM);
 
     s_disp = lv_display_create(g_display.width, g_display.height);
     lv_display_set_flush_cb(s_disp, lvgl_flush_cb);
-    lv_display_set_buffers(s_disp, s_buf1, NULL, g_display.width * 10 * sizeof(lv_color_t), LV_DISPLAY_RENDER_MODE_PARTIAL);
-
-    lv_indev_t *indev = lv_indev_create();
-    lv_indev_set_read_cb(indev, lvgl_touch_read);
-    lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
-    lv_indev_set_display(indev, s_disp);
+    lv_display_set_buffers(s_disp, s_buf1, NULL, buf_size, LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_add_event_cb(s_disp, lvgl_refr_event_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(s_disp, lvgl_refr_event_cb, LV_EVENT_REFR_READY, NULL);
+    lv_display_add_event_cb(s_disp, lvgl_invalidate_event_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    hook_image_decoders();
+    hook_image_buffers();
 
-    const esp_timer_create_args_t lvgl_tick_timer_args = {
-        .callback = &lvgl_tick_timer_cb,
-        .name = "lvgl_tick"
-    };
-    esp_timer_create(&lvgl_tick_timer_args, &s_lvgl_tick_timer);
-    esp_timer_start_periodic(s_lvgl_tick_timer, 1000);
+    /* Read on the GT911 INT line (gui_attach_touch()), not on a timer */
+    s_indev = lv_indev_create();
+    lv_indev_set_read_cb(s_indev, lvgl_touch_read);
+    lv_indev_set_type(s_indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_display(s_indev, s_disp);
+    lv_indev_set_mode(s_indev, LV_INDEV_MODE_EVENT);
 
     xTaskCreatePinnedToCore(lvgl_task, "lvgl", 8192, NULL, 5, &s_lvgl_task, 1);
 }
@@ -85,19 +329,22 @@ void gui_deinit(void)
         vTaskDelete(s_lvgl_task);
         s_lvgl_task = NULL;
     }
-    if (s_lvgl_tick_timer) {
-        esp_timer_stop(s_lvgl_tick_timer);
-        esp_timer_delete(s_lvgl_tick_timer);
-        s_lvgl_tick_timer = NULL;
+    s_indev = NULL;
+    if (s_cmd_queue) {
+        /* Let pending commands release what they own */
+        gui_cmd_drain();
+        vQueueDelete(s_cmd_queue);
+        s_cmd_queue = NULL;
     }
     if (s_disp) {
         lv_display_delete(s_disp);
         s_disp = NULL;
     }
-    if (s_draw_buf) {
-        lv_draw_buf_destroy(s_draw_buf);
-        s_draw_buf = NULL;
-        s_buf1 = NULL;
-    }
+    heap_caps_free(s_buf1);
+    s_buf1 = NULL;
     lv_deinit();
+    if (s_lvgl_mutex) {
+        vSemaphoreDelete(s_lvgl_mutex);
+        s_lvgl_mutex = NULL;
+    }
 }
@@ -2,8 +2,53 @@
 #define GUI_H
 
 #include "esp_lcd_panel_ops.h"
+#include "touch.h"
 
 void gui_init(esp_lcd_panel_handle_t panel);
 void gui_deinit(void);
 
+/**
+ * @brief Feed touch input to LVGL from the controller interrupt.
+ *
+ * Takes over the interrupt callback of @p tp: lvgl_task reads the
+ * controller when its INT line fires, and every 20 ms while pressed.
+ * Without it the display gets no pointer input. The callback only wakes
+ * lvgl_task, so it may outlive gui_deinit() until the driver is deleted.
+ */
+esp_err_t gui_attach_touch(esp_lcd_touch_handle_t tp);
+
+/**
+ * @brief Wake lvgl_task to process a change made outside of it.
+ *
+ * lvgl_task sleeps until the next LVGL timer is due. Invalidated areas and
+ * gui_unlock() wake it already; call this after creating an lv_timer or
+ * starting an animation without holding the lock.
+ */
+void gui_wake(void);
+
+/**
+ * @brief Take the LVGL mutex (recursive).
+ *
+ * lvgl_task holds it while running lv_timer_handler(); other tasks must hold
+ * it around lv_* calls. Taking it first applies the commands posted with
+ * gui_post(), so a task's posts and locked sections run in program order.
+ * gui_unlock() wakes lvgl_task.
+ */
+void gui_lock(void);
+void gui_unlock(void);
+
+/** UI operation run with the LVGL mutex held; owns and releases @p arg. */
+typedef void (*gui_cmd_fn_t)(void *arg);
+
+/**
+ * @brief Queue @p fn to run with the LVGL mutex held, without waiting.
+ *
+ * lvgl_task applies every pending command before its next
+ * lv_timer_handler(), so commands posted together are drawn in one frame.
+ *
+ * @return ESP_ERR_TIMEOUT when the queue stayed full for 100 ms; @p arg is
+ *         then still owned by the caller.
+ */
+esp_err_t gui_post(gui_cmd_fn_t fn, void *arg);
+
 #endif // GUI_H
@@ -0,0 +1,225 @@
+#include "gui_perf.h"
+#include "gui.h"
+#include "lvgl.h"
+#include "freertos/FreeRTOS.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#endif
+
+#define OVERLAY_PERIOD_MS 500
+
+typedef struct {
+    uint32_t values[GUI_PERF_SAMPLES];
+    uint32_t head;
+    uint32_t count;
+    uint32_t total; /* Samples since the last reset, wrapping */
+} perf_ring_t;
+
+static perf_ring_t s_rings[GUI_PERF_METRIC_COUNT];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static lv_obj_t *s_overlay;
+static lv_timer_t *s_overlay_timer;
+
+static const char *const k_names[GUI_PERF_METRIC_COUNT] = {
+    [GUI_PERF_TIMER_HANDLER] = "timer_handler_us",
+    [GUI_PERF_RENDER] = "render_us",
+    [GUI_PERF_FLUSH] = "flush_us",
+    [GUI_PERF_AREA] = "area_px",
+    [GUI_PERF_DECODE] = "decode_us",
+    [GUI_PERF_INPUT_LATENCY] = "input_latency_us",
+};
+
+void gui_perf_record(gui_perf_metric_t metric, uint32_t value)
+{
+    if (metric >= GUI_PERF_METRIC_COUNT) {
+        return;
+    }
+    perf_ring_t *r = &s_rings[metric];
+    portENTER_CRITICAL(&s_lock);
+    r->values[r->head] = value;
+    r->head = (r->head + 1) % GUI_PERF_SAMPLES;
+    if (r->count < GUI_PERF_SAMPLES) {
+        r->count++;
+    }
+    r->total++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t gui_perf_last(gui_perf_metric_t metric)
+{
+    if (metric >= GUI_PERF_METRIC_COUNT) {
+        return 0;
+    }
+    perf_ring_t *r = &s_rings[metric];
+    portENTER_CRITICAL(&s_lock);
+    uint32_t v = r->count ? r->values[(r->head + GUI_PERF_SAMPLES - 1) % GUI_PERF_SAMPLES] : 0;
+    portEXIT_CRITICAL(&s_lock);
+    return v;
+}
+
+uint32_t gui_perf_total(gui_perf_metric_t metric)
+{
+    if (metric >= GUI_PERF_METRIC_COUNT) {
+        return 0;
+    }
+    portENTER_CRITICAL(&s_lock);
+    uint32_t n = s_rings[metric].total;
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+const char *gui_perf_metric_name(gui_perf_metric_t metric)
+{
+    return metric < GUI_PERF_METRIC_COUNT ? k_names[metric] : "?";
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+esp_err_t gui_perf_get_stats(gui_perf_metric_t metric, gui_perf_stats_t *stats)
+{
+    if (metric >= GUI_PERF_METRIC_COUNT || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t *sorted = malloc(GUI_PERF_SAMPLES * sizeof(uint32_t));
+    if (!sorted) {
+        return ESP_ERR_NO_MEM;
+    }
+    /* Copy under the lock, sort outside it */
+    portENTER_CRITICAL(&s_lock);
+    uint32_t n = s_rings[metric].count;
+    memcpy(sorted, s_rings[metric].values, n * sizeof(uint32_t));
+    portEXIT_CRITICAL(&s_lock);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->count = n;
+    if (n > 0) {
+        qsort(sorted, n, sizeof(uint32_t), cmp_u32);
+        stats->min = sorted[0];
+        stats->p50 = sorted[(n - 1) * 50 / 100];
+        stats->p90 = sorted[(n - 1) * 90 / 100];
+        stats->p99 = sorted[(n - 1) * 99 / 100];
+        stats->max = sorted[n - 1];
+    }
+    free(sorted);
+    return ESP_OK;
+}
+
+void gui_perf_reset(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(s_rings, 0, sizeof(s_rings));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void gui_perf_print(FILE *out, bool json)
+{
+    if (json) {
+        fputc('{', out);
+    } else {
+        fprintf(out, "%-18s %6s %8s %8s %8s %8s %8s\n", "metric", "n", "min", "p50", "p90",
+                "p99", "max");
+    }
+    for (int m = 0; m < GUI_PERF_METRIC_COUNT; ++m) {
+        gui_perf_stats_t st;
+        if (gui_perf_get_stats(m, &st) != ESP_OK) {
+            continue;
+        }
+        if (json) {
+            fprintf(out,
+                    "%s\"%s\":{\"n\":%u,\"min\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}",
+                    m ? "," : "", k_names[m], (unsigned)st.count, (unsigned)st.min,
+                    (unsigned)st.p50, (unsigned)st.p90, (unsigned)st.p99, (unsigned)st.max);
+        } else {
+            fprintf(out, "%-18s %6u %8u %8u %8u %8u %8u\n", k_names[m], (unsigned)st.count,
+                    (unsigned)st.min, (unsigned)st.p50, (unsigned)st.p90, (unsigned)st.p99,
+                    (unsigned)st.max);
+        }
+    }
+    if (json) {
+        fputs("}\n", out);
+    }
+}
+
+/* "p50 / p90" in ms with one decimal; lv_snprintf has no %f by default */
+static int overlay_line(char *buf, size_t len, const char *label, gui_perf_metric_t metric)
+{
+    gui_perf_stats_t st;
+    gui_perf_get_stats(metric, &st);
+    return snprintf(buf, len, "%s %u.%u / %u.%u ms\n", label, (unsigned)(st.p50 / 1000),
+                    (unsigned)(st.p50 / 100 % 10), (unsigned)(st.p90 / 1000),
+                    (unsigned)(st.p90 / 100 % 10));
+}
+
+/* Runs in lvgl_task, with the GUI lock held */
+static void overlay_update(lv_timer_t *t)
+{
+    (void)t;
+    char text[128];
+    int n = overlay_line(text, sizeof(text), "render", GUI_PERF_RENDER);
+    n += overlay_line(text + n, sizeof(text) - n, "flush ", GUI_PERF_FLUSH);
+    n += overlay_line(text + n, sizeof(text) - n, "decode", GUI_PERF_DECODE);
+    n += overlay_line(text + n, sizeof(text) - n, "input ", GUI_PERF_INPUT_LATENCY);
+    if (n > 0 && (size_t)n < sizeof(text)) {
+        text[n - 1] = '\0'; /* trailing newline */
+    }
+    lv_label_set_text(s_overlay, text);
+}
+
+esp_err_t gui_perf_overlay(bool show)
+{
+    gui_lock();
+    if (show && !s_overlay) {
+        s_overlay = lv_label_create(lv_layer_top());
+        lv_obj_set_style_bg_color(s_overlay, lv_color_black(), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(s_overlay, LV_OPA_60, LV_PART_MAIN);
+        lv_obj_set_style_text_color(s_overlay, lv_color_white(), LV_PART_MAIN);
+        lv_obj_set_style_pad_all(s_overlay, 4, LV_PART_MAIN);
+        lv_obj_align(s_overlay, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
+        s_overlay_timer = lv_timer_create(overlay_update, OVERLAY_PERIOD_MS, NULL);
+        overlay_update(NULL);
+    } else if (!show && s_overlay) {
+        lv_timer_delete(s_overlay_timer);
+        s_overlay_timer = NULL;
+        lv_obj_delete(s_overlay);
+        s_overlay = NULL;
+    }
+    gui_unlock();
+    return ESP_OK;
+}
+
+#ifdef ESP_PLATFORM
+static int cmd_perf(int argc, char **argv)
+{
+    if (argc == 1 || (argc == 2 && strcmp(argv[1], "-j") == 0)) {
+        gui_perf_print(stdout, argc == 2);
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        gui_perf_reset();
+        return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "overlay") == 0) {
+        return gui_perf_overlay(strcmp(argv[2], "on") == 0) == ESP_OK ? 0 : 1;
+    }
+    printf("usage: perf [-j] | perf reset | perf overlay on|off\n");
+    return 1;
+}
+
+esp_err_t gui_perf_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "perf",
+        .help = "Render pipeline percentiles: perf [-j] | perf reset | perf overlay on|off",
+        .hint = NULL,
+        .func = cmd_perf,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+#endif
@@ -0,0 +1,82 @@
+#ifndef GUI_PERF_H
+#define GUI_PERF_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Render pipeline instrumentation.
+ *
+ * gui.c records one sample per frame or event into a fixed ring per metric
+ * (the last GUI_PERF_SAMPLES values); percentiles are computed on demand
+ * from that window. Recording is a timestamp and a store, cheap enough to
+ * stay enabled in production builds.
+ */
+
+#define GUI_PERF_SAMPLES 256
+
+typedef enum {
+    GUI_PERF_TIMER_HANDLER = 0, /*!< lv_timer_handler() duration, us */
+    GUI_PERF_RENDER,            /*!< Frame refresh minus flushes, us */
+    GUI_PERF_FLUSH,             /*!< One flush_cb call (one area), us */
+    GUI_PERF_AREA,              /*!< Pixels redrawn in a frame */
+    GUI_PERF_DECODE,            /*!< Image decoder open (full decode), us */
+    GUI_PERF_INPUT_LATENCY,     /*!< Press to end of the next drawn frame, us */
+    GUI_PERF_METRIC_COUNT
+} gui_perf_metric_t;
+
+typedef struct {
+    uint32_t count; /*!< Samples in the window */
+    uint32_t min;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+} gui_perf_stats_t;
+
+/** Add @p value to the ring of @p metric. Callable from any task. */
+void gui_perf_record(gui_perf_metric_t metric, uint32_t value);
+
+/** Most recent sample of @p metric, 0 when there is none. */
+uint32_t gui_perf_last(gui_perf_metric_t metric);
+
+/**
+ * Samples recorded for @p metric since the last reset, wrapping at 2^32;
+ * for GUI_PERF_RENDER this counts drawn frames.
+ */
+uint32_t gui_perf_total(gui_perf_metric_t metric);
+
+/** Percentiles over the current window of @p metric. */
+esp_err_t gui_perf_get_stats(gui_perf_metric_t metric, gui_perf_stats_t *stats);
+
+/** Short name used in reports ("render_us", "area_px", ...). */
+const char *gui_perf_metric_name(gui_perf_metric_t metric);
+
+/** Drop every sample. */
+void gui_perf_reset(void);
+
+/** Write all metrics as a table, or as one JSON object with @p json. */
+void gui_perf_print(FILE *out, bool json);
+
+/**
+ * @brief Show or hide a label on the top layer with the frame, flush and
+ * input latency percentiles, refreshed twice a second.
+ */
+esp_err_t gui_perf_overlay(bool show);
+
+#ifdef ESP_PLATFORM
+/** Add the `perf` command to the esp_console REPL. */
+esp_err_t gui_perf_console_register(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GUI_PERF_H
@@ -12,6 +12,7 @@
  ******************************************************************************/
 
 #include "i2c.h"  // Include I2C driver header for I2C functions
+#include "i2c_bus.h"
 static const char *TAG = "i2c";  // Define a tag for logging
 
 // Global handle for the I2C master bus
@@ -53,73 +54,48 @@ static void i2c_bus_check_pullups(void)
 /**
  * @brief Initialize the I2C master interface.
  * 
- * This function configures the I2C master bus and adds a device with the specified address.
- * The I2C clock source, frequency, SCL/SDA pins, and other settings are configured here.
+ * This function starts the shared I2C bus service (see i2c_bus.h), which
+ * owns the master bus. Calling it again returns the running bus. Devices
+ * are added per address with DEV_I2C_Set_Slave_Addr() or i2c_bus_add_device().
  * 
- * @param Addr The I2C address of the device to be initialized.
- * @return The device handle if initialization is successful, NULL otherwise.
+ * @return The bus handle; dev is always NULL.
  */
-DEV_I2C_Port DEV_I2C_Init()
-{
-    // Verify that SDA and SCL lines are pulled high before configuring the bus
-    i2c_bus_check_pullups();
-
-    // Define I2C bus configuration parameters
-    i2c_master_bus_config_t i2c_bus_config = {
-        .clk_source = I2C_CLK_SRC_DEFAULT,       // Default clock source for I2C
-        .i2c_port = EXAMPLE_I2C_MASTER_NUM,     // I2C master port number
-        .scl_io_num = EXAMPLE_I2C_MASTER_SCL,   // I2C SCL (clock) pin
-        .sda_io_num = EXAMPLE_I2C_MASTER_SDA,   // I2C SDA (data) pin
-        .glitch_ignore_cnt = 7,                  // Ignore glitches in the I2C signal
-    };
+DEV_I2C_Port DEV_I2C_Init()
+{
+    // Verify that SDA and SCL lines are pulled high before configuring the bus
+    if (!i2c_bus_get_master()) {
+        i2c_bus_check_pullups();
+    }
 
-    // Create a new I2C master bus with the above configuration
-    ESP_ERROR_CHECK(i2c_new_master_bus(&i2c_bus_config, &handle.bus));
-    
-    // Configure the device's I2C parameters
-    i2c_device_config_t i2c_dev_conf = {
-        .scl_speed_hz = EXAMPLE_I2C_MASTER_FREQUENCY,  // Set I2C communication speed
-    };
-    
-    // Add the I2C device to the bus
-    // i2c_master_dev_handle_t dev_handle = NULL;
-    if (i2c_master_bus_add_device(handle.bus, &i2c_dev_conf, &handle.dev) != ESP_OK) {
-        ESP_LOGE(TAG, "I2C device creation failed");  // Log error if device creation fails
+    if (i2c_bus_init() != ESP_OK) {
+        ESP_LOGE(TAG, "I2C bus service start failed");
     }
 
-    return handle;  // Return the device handle if successful
+    handle.bus = i2c_bus_get_master();
+    handle.dev = NULL;
+    return handle;
 }
 
 /**
- * @brief Set a new I2C slave address for the device.
+ * @brief Get the I2C device handle for a slave address.
  * 
- * This function allows changing the I2C slave address for the specified device.
+ * The bus service keeps one device per address, so switching between
+ * slaves no longer removes and re-adds a device: this only looks it up,
+ * adding it on first use.
  * 
- * @param dev_handle The handle to the I2C device.
- * @param Addr The new I2C address for the device.
+ * @param dev_handle Receives the handle to the I2C device.
+ * @param Addr The I2C address of the device.
  */
-void DEV_I2C_Set_Slave_Addr(i2c_master_dev_handle_t *dev_handle, uint8_t Addr)
-{
-    // Configure the new device address
-    i2c_device_config_t i2c_dev_conf = {
-        .scl_speed_hz = EXAMPLE_I2C_MASTER_FREQUENCY,  // I2C frequency
-        .device_address = Addr,                        // Set new device address
-    };
-
-    if (*dev_handle) {
-        esp_err_t rm_ret = i2c_master_bus_rm_device(*dev_handle);
-        if (rm_ret != ESP_OK) {
-            ESP_LOGE(TAG, "I2C device removal failed");
-            return;
-        }
-        *dev_handle = NULL;
-    }
-
-    // Update the device with the new address
-    if (i2c_master_bus_add_device(handle.bus, &i2c_dev_conf, dev_handle) != ESP_OK) {
-        ESP_LOGE(TAG, "I2C address modification failed");  // Log error if address modification fails
-    }
-}
+void DEV_I2C_Set_Slave_Addr(i2c_master_dev_handle_t *dev_handle, uint8_t Addr)
+{
+    i2c_bus_dev_t dev;
+    if (i2c_bus_add_device(Addr, 1, "dev_i2c", &dev) != ESP_OK) {
+        ESP_LOGE(TAG, "I2C device 0x%02x unavailable", Addr);
+        *dev_handle = NULL;
+        return;
+    }
+    *dev_handle = i2c_bus_dev_handle(dev);
+}
 
 /**
  * @brief Write a single byte to the I2C device.
@@ -202,12 +178,8 @@ esp_err_t DEV_I2C_Read_Nbyte(i2c_master_dev_handle_t dev_handle, uint8_t Cmd, ui
 
 void DEV_I2C_Deinit(void)
 {
-    if (handle.dev) {
-        i2c_master_bus_rm_device(handle.dev);
-        handle.dev = NULL;
-    }
-    if (handle.bus) {
-        i2c_del_master_bus(handle.bus);
-        handle.bus = NULL;
-    }
+    // Stops the bus service, which releases every device and the bus
+    i2c_bus_deinit();
+    handle.dev = NULL;
+    handle.bus = NULL;
 }
@@ -41,21 +41,22 @@ typedef struct {
 /**
  * @brief Initialize the I2C master interface.
  * 
- * This function sets up the I2C master interface, including the SDA/SCL pins,
- * clock frequency, and device address.
+ * This function starts the shared I2C bus service (i2c_bus.h) if it is not
+ * running yet. The DEV_I2C_* transfers below go straight to the driver;
+ * new code should queue its transactions through i2c_bus.h instead.
  * 
- * @param Addr The I2C address of the device to initialize.
- * @return A handle to the I2C device if initialization is successful, NULL if failure.
+ * @return The bus handle; dev is always NULL.
  */
 DEV_I2C_Port DEV_I2C_Init();
 
 /**
- * @brief Set a new I2C slave address for the device.
+ * @brief Get the I2C device handle for a slave address.
  * 
- * This function allows you to change the slave address of an I2C device during runtime.
+ * The device is added on first use and shared afterwards; it is never
+ * removed and re-added when switching between slaves.
  * 
- * @param dev_handle The handle to the I2C device.
- * @param Addr The new I2C address to set for the device.
+ * @param dev_handle Receives the handle to the I2C device, NULL on failure.
+ * @param Addr The I2C address of the device.
  */
 void DEV_I2C_Set_Slave_Addr(i2c_master_dev_handle_t *dev_handle, uint8_t Addr);
 
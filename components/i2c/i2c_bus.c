@@ -0,0 +1,442 @@
+#include "i2c_bus.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "i2c.h"
+#include "trace.h"
+#include <inttypes.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#endif
+
+#define I2C_BUS_MAX_DEVICES 4
+#define I2C_BUS_QUEUE_LEN   8
+#define I2C_BUS_RETRIES     3
+#define I2C_BUS_TIMEOUT_MS  50
+#define I2C_BUS_TASK_STACK  3072
+#define I2C_BUS_TASK_PRIO   6
+
+static const char *TAG = "i2c_bus";
+
+struct i2c_bus_dev {
+    i2c_master_dev_handle_t handle;
+    const char *name;
+    uint8_t addr;
+    uint8_t reg_bytes;
+    i2c_bus_dev_stats_t stats;
+};
+
+typedef enum {
+    XFER_WRITE,
+    XFER_READ,
+} xfer_op_t;
+
+typedef struct {
+    i2c_bus_dev_t dev;
+    uint8_t op;
+    uint8_t wlen;
+    uint8_t wbuf[I2C_BUS_MAX_WRITE];
+    const i2c_bus_read_t *reads;
+    size_t count;
+    i2c_bus_done_cb_t cb;
+    void *arg;
+    int64_t queued_us;
+} xfer_t;
+
+typedef struct {
+    SemaphoreHandle_t done;
+    StaticSemaphore_t done_buf;
+    esp_err_t err;
+} sync_wait_t;
+
+static i2c_master_bus_handle_t s_bus;
+static struct i2c_bus_dev s_devs[I2C_BUS_MAX_DEVICES];
+static size_t s_dev_count;
+static SemaphoreHandle_t s_dev_lock;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* One queue per priority; s_pending counts the transactions of all three,
+ * so the task sleeps on a single object and then drains highest first. */
+static QueueHandle_t s_queues[I2C_BUS_PRIO_COUNT];
+static SemaphoreHandle_t s_pending;
+static SemaphoreHandle_t s_stopped;
+static TaskHandle_t s_task;
+static volatile bool s_stop;
+
+static esp_err_t run_once(const xfer_t *x, const i2c_bus_read_t *rd)
+{
+    if (x->op == XFER_WRITE) {
+        return i2c_master_transmit(x->dev->handle, x->wbuf, x->wlen, I2C_BUS_TIMEOUT_MS);
+    }
+    uint8_t reg[2];
+    size_t reg_len = 0;
+    if (x->dev->reg_bytes == 2) {
+        reg[reg_len++] = rd->reg >> 8;
+    }
+    reg[reg_len++] = rd->reg & 0xff;
+    return i2c_master_transmit_receive(x->dev->handle, reg, reg_len, rd->buf, rd->len,
+                                       I2C_BUS_TIMEOUT_MS);
+}
+
+static esp_err_t run_with_retry(const xfer_t *x, const i2c_bus_read_t *rd, uint32_t *retries)
+{
+    esp_err_t err = run_once(x, rd);
+    for (int attempt = 0; err != ESP_OK && attempt < I2C_BUS_RETRIES; attempt++) {
+        (*retries)++;
+        if (err == ESP_ERR_TIMEOUT || err == ESP_ERR_INVALID_STATE) {
+            // A slave may be holding SDA after a glitch: clock it free
+            i2c_master_bus_reset(s_bus);
+        }
+        vTaskDelay(pdMS_TO_TICKS(1 << attempt));
+        err = run_once(x, rd);
+    }
+    return err;
+}
+
+static void run_xfer(const xfer_t *x)
+{
+    int64_t start = esp_timer_get_time();
+    uint32_t retries = 0;
+    esp_err_t err = ESP_OK;
+
+    TRACE_BEGIN("i2c_xfer");
+    if (x->op == XFER_WRITE) {
+        err = run_with_retry(x, NULL, &retries);
+    } else {
+        for (size_t i = 0; i < x->count && err == ESP_OK; i++) {
+            err = run_with_retry(x, &x->reads[i], &retries);
+        }
+    }
+    TRACE_END("i2c_xfer");
+
+    int64_t end = esp_timer_get_time();
+    uint32_t total = (uint32_t)(end - x->queued_us);
+    uint32_t wait = (uint32_t)(start - x->queued_us);
+    i2c_bus_dev_stats_t *st = &x->dev->stats;
+    portENTER_CRITICAL(&s_stats_lock);
+    st->xfers++;
+    st->retries += retries;
+    st->errors += err != ESP_OK;
+    st->last_us = total;
+    st->total_us += total;
+    if (total > st->max_us) {
+        st->max_us = total;
+    }
+    if (wait > st->max_wait_us) {
+        st->max_wait_us = wait;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s (0x%02x): %s after %d retries", x->dev->name, x->dev->addr,
+                 esp_err_to_name(err), I2C_BUS_RETRIES);
+    }
+    if (x->cb) {
+        x->cb(err, x->arg);
+    }
+}
+
+static bool next_xfer(xfer_t *x)
+{
+    for (int p = 0; p < I2C_BUS_PRIO_COUNT; p++) {
+        if (xQueueReceive(s_queues[p], x, 0) == pdTRUE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void bus_task(void *arg)
+{
+    xfer_t x;
+    while (!s_stop) {
+        xSemaphoreTake(s_pending, portMAX_DELAY);
+        if (!s_stop && next_xfer(&x)) {
+            run_xfer(&x);
+        }
+    }
+    // Fail whatever is still queued so no caller waits forever
+    while (next_xfer(&x)) {
+        if (x.cb) {
+            x.cb(ESP_ERR_INVALID_STATE, x.arg);
+        }
+    }
+    xSemaphoreGive(s_stopped);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t submit(const xfer_t *x, i2c_bus_prio_t prio)
+{
+    ESP_RETURN_ON_FALSE(x->dev && prio < I2C_BUS_PRIO_COUNT, ESP_ERR_INVALID_ARG, TAG,
+                        "bad transaction");
+    ESP_RETURN_ON_FALSE(s_task && !s_stop, ESP_ERR_INVALID_STATE, TAG, "bus not running");
+    if (xTaskGetCurrentTaskHandle() == s_task) {
+        // Issued from a completion callback: queueing would deadlock
+        run_xfer(x);
+        return ESP_OK;
+    }
+    if (xQueueSend(s_queues[prio], x, pdMS_TO_TICKS(I2C_BUS_TIMEOUT_MS)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreGive(s_pending);
+    return ESP_OK;
+}
+
+static void sync_done(esp_err_t err, void *arg)
+{
+    sync_wait_t *w = arg;
+    w->err = err;
+    xSemaphoreGive(w->done);
+}
+
+static esp_err_t submit_and_wait(xfer_t *x, i2c_bus_prio_t prio)
+{
+    sync_wait_t w = {.err = ESP_OK};
+    w.done = xSemaphoreCreateBinaryStatic(&w.done_buf);
+    x->cb = sync_done;
+    x->arg = &w;
+    esp_err_t err = submit(x, prio);
+    if (err == ESP_OK) {
+        xSemaphoreTake(w.done, portMAX_DELAY);
+        err = w.err;
+    }
+    vSemaphoreDelete(w.done);
+    return err;
+}
+
+static esp_err_t make_write(xfer_t *x, i2c_bus_dev_t dev, const uint8_t *data, size_t len)
+{
+    ESP_RETURN_ON_FALSE(len && len <= I2C_BUS_MAX_WRITE, ESP_ERR_INVALID_SIZE, TAG,
+                        "write of %u bytes", (unsigned)len);
+    *x = (xfer_t){
+        .dev = dev,
+        .op = XFER_WRITE,
+        .wlen = len,
+        .queued_us = esp_timer_get_time(),
+    };
+    memcpy(x->wbuf, data, len);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_init(void)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    i2c_master_bus_config_t cfg = {
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .i2c_port = EXAMPLE_I2C_MASTER_NUM,
+        .scl_io_num = EXAMPLE_I2C_MASTER_SCL,
+        .sda_io_num = EXAMPLE_I2C_MASTER_SDA,
+        .glitch_ignore_cnt = 7,
+    };
+    ESP_RETURN_ON_ERROR(i2c_new_master_bus(&cfg, &s_bus), TAG, "bus creation failed");
+
+    s_dev_lock = xSemaphoreCreateMutex();
+    s_pending = xSemaphoreCreateCounting(I2C_BUS_PRIO_COUNT * I2C_BUS_QUEUE_LEN, 0);
+    s_stopped = xSemaphoreCreateBinary();
+    bool ok = s_dev_lock && s_pending && s_stopped;
+    for (int p = 0; p < I2C_BUS_PRIO_COUNT; p++) {
+        s_queues[p] = xQueueCreate(I2C_BUS_QUEUE_LEN, sizeof(xfer_t));
+        ok = ok && s_queues[p];
+    }
+    s_stop = false;
+    if (!ok || xTaskCreate(bus_task, "i2c_bus", I2C_BUS_TASK_STACK, NULL, I2C_BUS_TASK_PRIO,
+                           &s_task) != pdPASS) {
+        s_task = NULL;
+        i2c_bus_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void i2c_bus_deinit(void)
+{
+    if (s_task) {
+        s_stop = true;
+        xSemaphoreGive(s_pending);
+        xSemaphoreTake(s_stopped, portMAX_DELAY);
+        s_task = NULL;
+    }
+    for (int p = 0; p < I2C_BUS_PRIO_COUNT; p++) {
+        if (s_queues[p]) {
+            vQueueDelete(s_queues[p]);
+            s_queues[p] = NULL;
+        }
+    }
+    if (s_pending) {
+        vSemaphoreDelete(s_pending);
+        s_pending = NULL;
+    }
+    if (s_stopped) {
+        vSemaphoreDelete(s_stopped);
+        s_stopped = NULL;
+    }
+    if (s_dev_lock) {
+        vSemaphoreDelete(s_dev_lock);
+        s_dev_lock = NULL;
+    }
+    for (size_t i = 0; i < s_dev_count; i++) {
+        i2c_master_bus_rm_device(s_devs[i].handle);
+    }
+    memset(s_devs, 0, sizeof(s_devs));
+    s_dev_count = 0;
+    if (s_bus) {
+        i2c_del_master_bus(s_bus);
+        s_bus = NULL;
+    }
+}
+
+i2c_master_bus_handle_t i2c_bus_get_master(void)
+{
+    return s_bus;
+}
+
+esp_err_t i2c_bus_add_device(uint8_t addr, uint8_t reg_bytes, const char *name,
+                             i2c_bus_dev_t *out)
+{
+    ESP_RETURN_ON_FALSE(out && (reg_bytes == 1 || reg_bytes == 2), ESP_ERR_INVALID_ARG, TAG,
+                        "bad device 0x%02x", addr);
+    ESP_RETURN_ON_FALSE(s_dev_lock, ESP_ERR_INVALID_STATE, TAG, "bus not running");
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_dev_lock, portMAX_DELAY);
+    struct i2c_bus_dev *dev = NULL;
+    for (size_t i = 0; i < s_dev_count && !dev; i++) {
+        if (s_devs[i].addr == addr) {
+            dev = &s_devs[i];
+        }
+    }
+    if (dev && dev->reg_bytes != reg_bytes) {
+        /* Two drivers disagree on the register width: neither would work */
+        ESP_LOGE(TAG, "0x%02x (%s) uses %u-byte registers, not %u", addr, dev->name,
+                 dev->reg_bytes, reg_bytes);
+        err = ESP_ERR_INVALID_STATE;
+    } else if (!dev) {
+        if (s_dev_count == I2C_BUS_MAX_DEVICES) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            i2c_device_config_t cfg = {
+                .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+                .device_address = addr,
+                .scl_speed_hz = EXAMPLE_I2C_MASTER_FREQUENCY,
+            };
+            dev = &s_devs[s_dev_count];
+            err = i2c_master_bus_add_device(s_bus, &cfg, &dev->handle);
+            if (err == ESP_OK) {
+                dev->addr = addr;
+                dev->reg_bytes = reg_bytes;
+                dev->name = name;
+                s_dev_count++;
+            }
+        }
+    }
+    xSemaphoreGive(s_dev_lock);
+
+    ESP_RETURN_ON_ERROR(err, TAG, "adding device 0x%02x failed", addr);
+    *out = dev;
+    return ESP_OK;
+}
+
+i2c_master_dev_handle_t i2c_bus_dev_handle(i2c_bus_dev_t dev)
+{
+    return dev ? dev->handle : NULL;
+}
+
+esp_err_t i2c_bus_write(i2c_bus_dev_t dev, i2c_bus_prio_t prio, const uint8_t *data, size_t len)
+{
+    xfer_t x;
+    ESP_RETURN_ON_ERROR(make_write(&x, dev, data, len), TAG, "write");
+    return submit_and_wait(&x, prio);
+}
+
+esp_err_t i2c_bus_write_async(i2c_bus_dev_t dev, i2c_bus_prio_t prio, const uint8_t *data,
+                              size_t len, i2c_bus_done_cb_t cb, void *arg)
+{
+    xfer_t x;
+    ESP_RETURN_ON_ERROR(make_write(&x, dev, data, len), TAG, "write");
+    x.cb = cb;
+    x.arg = arg;
+    return submit(&x, prio);
+}
+
+esp_err_t i2c_bus_write_reg(i2c_bus_dev_t dev, i2c_bus_prio_t prio, uint8_t reg, uint8_t value)
+{
+    const uint8_t data[2] = {reg, value};
+    return i2c_bus_write(dev, prio, data, sizeof(data));
+}
+
+esp_err_t i2c_bus_read_reg(i2c_bus_dev_t dev, i2c_bus_prio_t prio, uint16_t reg,
+                           uint8_t *buf, size_t len)
+{
+    const i2c_bus_read_t rd = {.reg = reg, .len = len, .buf = buf};
+    return i2c_bus_read_batch(dev, prio, &rd, 1);
+}
+
+esp_err_t i2c_bus_read_batch(i2c_bus_dev_t dev, i2c_bus_prio_t prio,
+                             const i2c_bus_read_t *reads, size_t count)
+{
+    xfer_t x = {
+        .dev = dev,
+        .op = XFER_READ,
+        .reads = reads,
+        .count = count,
+        .queued_us = esp_timer_get_time(),
+    };
+    return submit_and_wait(&x, prio);
+}
+
+esp_err_t i2c_bus_read_batch_async(i2c_bus_dev_t dev, i2c_bus_prio_t prio,
+                                   const i2c_bus_read_t *reads, size_t count,
+                                   i2c_bus_done_cb_t cb, void *arg)
+{
+    const xfer_t x = {
+        .dev = dev,
+        .op = XFER_READ,
+        .reads = reads,
+        .count = count,
+        .cb = cb,
+        .arg = arg,
+        .queued_us = esp_timer_get_time(),
+    };
+    return submit(&x, prio);
+}
+
+void i2c_bus_get_stats(i2c_bus_dev_t dev, i2c_bus_dev_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = dev->stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+#ifdef ESP_PLATFORM
+static int cmd_i2c(int argc, char **argv)
+{
+    for (size_t i = 0; i < s_dev_count; i++) {
+        i2c_bus_dev_stats_t st;
+        i2c_bus_get_stats(&s_devs[i], &st);
+        uint32_t avg = st.xfers ? (uint32_t)(st.total_us / st.xfers) : 0;
+        printf("%-8s 0x%02x: %" PRIu32 " xfers, %" PRIu32 " errors, %" PRIu32 " retries, "
+               "latency avg %" PRIu32 " us max %" PRIu32 " us, queued max %" PRIu32 " us\n",
+               s_devs[i].name, s_devs[i].addr, st.xfers, st.errors, st.retries, avg,
+               st.max_us, st.max_wait_us);
+    }
+    return 0;
+}
+
+esp_err_t i2c_bus_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "i2c",
+        .help = "Per-device I2C transaction counters and latency",
+        .hint = NULL,
+        .func = cmd_i2c,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+#endif
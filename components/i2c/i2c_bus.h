@@ -0,0 +1,122 @@
+#pragma once
+#include "driver/i2c_master.h"
+#include "esp_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Arbitrated I2C bus service.
+ *
+ * One service owns the master bus and one device handle per address, added
+ * once and never re-created. Transactions are queued by priority and run
+ * one after the other by a dedicated task, so a touch read queued behind
+ * an ADC sample or an expander write is served first. Failed transfers are
+ * retried (with a bus reset after a timeout) and reported as errors instead
+ * of aborting, and every device keeps latency and error counters.
+ *
+ * Synchronous calls block the caller until their transaction completed;
+ * the *_async() variants return at once and report through a callback run
+ * on the bus task.
+ */
+
+/** Maximum payload of one write, register address included. */
+#define I2C_BUS_MAX_WRITE 16
+
+/** Transaction priority, highest first. */
+typedef enum {
+    I2C_BUS_PRIO_TOUCH = 0,    /*!< Touch controller polling */
+    I2C_BUS_PRIO_NORMAL,       /*!< Expander outputs, one-off commands */
+    I2C_BUS_PRIO_BACKGROUND,   /*!< Periodic sampling (battery ADC) */
+    I2C_BUS_PRIO_COUNT,
+} i2c_bus_prio_t;
+
+typedef struct i2c_bus_dev *i2c_bus_dev_t;
+
+/** One register read of a batch. */
+typedef struct {
+    uint16_t reg;
+    uint16_t len;
+    uint8_t *buf;
+} i2c_bus_read_t;
+
+/** Completion of an asynchronous transaction, run on the bus task. */
+typedef void (*i2c_bus_done_cb_t)(esp_err_t err, void *arg);
+
+typedef struct {
+    uint32_t xfers;        /*!< Completed transactions */
+    uint32_t errors;       /*!< Transactions that failed after every retry */
+    uint32_t retries;
+    uint32_t last_us;      /*!< Queue wait plus bus time of the last transaction */
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t max_wait_us;  /*!< Longest time spent queued */
+} i2c_bus_dev_stats_t;
+
+/** @brief Create the bus and start the service task; no-op once running. */
+esp_err_t i2c_bus_init(void);
+
+/** @brief Stop the service, then release every device and the bus. */
+void i2c_bus_deinit(void);
+
+/** Underlying master bus, NULL before i2c_bus_init(). */
+i2c_master_bus_handle_t i2c_bus_get_master(void);
+
+/**
+ * @brief Get the device at @p addr, adding it on first use.
+ *
+ * @param reg_bytes Width of the register address sent before reads, 1 or 2
+ *                  (big-endian, as the GT911 expects).
+ * @param name      Label for the statistics, kept by reference.
+ *
+ * @return ESP_ERR_INVALID_STATE when @p addr was already added with another
+ *         @p reg_bytes.
+ */
+esp_err_t i2c_bus_add_device(uint8_t addr, uint8_t reg_bytes, const char *name,
+                             i2c_bus_dev_t *out);
+
+/** Raw driver handle of @p dev, for code still using DEV_I2C_*(). */
+i2c_master_dev_handle_t i2c_bus_dev_handle(i2c_bus_dev_t dev);
+
+/** @brief Write @p len bytes (at most I2C_BUS_MAX_WRITE) and wait. */
+esp_err_t i2c_bus_write(i2c_bus_dev_t dev, i2c_bus_prio_t prio, const uint8_t *data, size_t len);
+
+/** @brief Queue a write; @p data is copied, @p cb may be NULL. */
+esp_err_t i2c_bus_write_async(i2c_bus_dev_t dev, i2c_bus_prio_t prio, const uint8_t *data,
+                              size_t len, i2c_bus_done_cb_t cb, void *arg);
+
+/** @brief Write one byte to an 8-bit register and wait. */
+esp_err_t i2c_bus_write_reg(i2c_bus_dev_t dev, i2c_bus_prio_t prio, uint8_t reg, uint8_t value);
+
+/** @brief Read @p len bytes starting at @p reg and wait. */
+esp_err_t i2c_bus_read_reg(i2c_bus_dev_t dev, i2c_bus_prio_t prio, uint16_t reg,
+                           uint8_t *buf, size_t len);
+
+/**
+ * @brief Run @p count register reads back to back and wait.
+ *
+ * The batch is a single queue entry: no other transaction is interleaved
+ * and the reads stop at the first one that still fails after its retries.
+ */
+esp_err_t i2c_bus_read_batch(i2c_bus_dev_t dev, i2c_bus_prio_t prio,
+                             const i2c_bus_read_t *reads, size_t count);
+
+/**
+ * @brief Queue a batch of register reads.
+ *
+ * @p reads and the buffers it points to must stay valid until @p cb ran.
+ */
+esp_err_t i2c_bus_read_batch_async(i2c_bus_dev_t dev, i2c_bus_prio_t prio,
+                                   const i2c_bus_read_t *reads, size_t count,
+                                   i2c_bus_done_cb_t cb, void *arg);
+
+void i2c_bus_get_stats(i2c_bus_dev_t dev, i2c_bus_dev_stats_t *stats);
+
+/** Add the `i2c` command to the esp_console REPL. */
+esp_err_t i2c_bus_console_register(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,956 @@
+#include "download_pool.h"
+#include "image_fetcher_priv.h"
+#include "esp_http_client.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+#include "sdkconfig.h"
+#include "trace.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef CONFIG_IMAGE_FETCH_PARALLEL
+#define CONFIG_IMAGE_FETCH_PARALLEL 2
+#endif
+#ifndef CONFIG_IMAGE_FETCH_CHUNK_KB
+#define CONFIG_IMAGE_FETCH_CHUNK_KB 32
+#endif
+#ifndef CONFIG_IMAGE_FETCH_BUFFERS
+#define CONFIG_IMAGE_FETCH_BUFFERS 6
+#endif
+
+#define WORKER_COUNT                                                           \
+    (CONFIG_IMAGE_FETCH_PARALLEL > DL_POOL_MAX_WORKERS ? DL_POOL_MAX_WORKERS   \
+                                                       : CONFIG_IMAGE_FETCH_PARALLEL)
+#define CHUNK_SIZE   (CONFIG_IMAGE_FETCH_CHUNK_KB * 1024)
+#define BUFFER_COUNT CONFIG_IMAGE_FETCH_BUFFERS
+#define JOB_QUEUE_LEN 16
+#define WORKER_STACK  8192
+#define WRITER_STACK  4096
+#define IDLE_BIT      BIT0
+#define HDR_MAX       96
+#define RESUME_SUFFIX ".dl"
+#define META_SUFFIX   ".meta"
+#define RESUME_MAGIC  0x31534c44 /* "DLS1" */
+/* Partial files are made resumable after this many new bytes, so a power
+ * cut does not lose more than that. */
+#define CHECKPOINT_BYTES (256 * 1024)
+#define SIDE_PATH_MAX (DL_POOL_PATH_MAX + 8)
+
+static const char *TAG = "dl_pool";
+
+typedef struct {
+    char url[DL_POOL_URL_MAX];
+    char dest[DL_POOL_PATH_MAX];
+    bool verify;
+    uint8_t expected[32];
+    uint32_t flags;
+    dl_pool_done_cb_t done;
+    void *arg;
+} dl_job_t;
+
+typedef enum {
+    WR_OPEN,
+    WR_DATA,
+    WR_CHECKPOINT, /* flush the file and save the resume state in buf */
+    WR_CLOSE,      /* keep the file, drop its resume state, ack */
+    WR_SUSPEND,    /* keep the partial file and the resume state in buf, ack */
+    WR_ABORT,      /* delete the file and its resume state, ack */
+    WR_STOP,
+} wr_type_t;
+
+typedef struct {
+    wr_type_t type;
+    uint8_t slot;
+    uint8_t *buf;
+    size_t len;
+} wr_msg_t;
+
+/* Sidecar `<dest>.dl` kept next to a partial download. The SHA-256 context
+ * covers the first `offset` bytes of the file. */
+typedef struct {
+    uint32_t magic;
+    uint32_t ctx_size;
+    uint64_t offset;
+    char url[DL_POOL_URL_MAX];
+    char etag[HDR_MAX];
+    char last_modified[HDR_MAX];
+    mbedtls_sha256_context sha;
+} dl_resume_t;
+
+typedef struct {
+    uint8_t id;
+    TaskHandle_t task;
+    esp_http_client_handle_t client;
+    bool connected; /* session left open by the previous request */
+    SemaphoreHandle_t ack;
+    /* Writer side, only touched by the writer task between OPEN and the ack */
+    FILE *file;
+    const char *path;
+    bool append;
+    volatile esp_err_t write_err;
+    /* Response headers of the current request, filled by the event handler */
+    char hdr_sha[SHA256_HEADER_MAX];
+    char hdr_etag[HDR_MAX];
+    char hdr_last_modified[HDR_MAX];
+    char hdr_content_range[64];
+    dl_resume_t resume;
+    dl_conn_stats_t stats;
+} dl_worker_t;
+
+static dl_worker_t s_workers[DL_POOL_MAX_WORKERS];
+static uint8_t *s_buffers[BUFFER_COUNT];
+static QueueHandle_t s_job_queue;
+static QueueHandle_t s_free_bufs;
+static QueueHandle_t s_wr_queue;
+static SemaphoreHandle_t s_exit_sem;
+static EventGroupHandle_t s_events;
+static SemaphoreHandle_t s_start_lock;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_running;
+
+static size_t s_pending;
+static int64_t s_active_since;
+static uint64_t s_active_us;
+static uint64_t s_written;
+static uint64_t s_write_us;
+static uint32_t s_buffer_waits;
+
+static void pending_add(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (s_pending++ == 0) {
+        s_active_since = esp_timer_get_time();
+        xEventGroupClearBits(s_events, IDLE_BIT);
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void pending_done(void)
+{
+    bool idle = false;
+    portENTER_CRITICAL(&s_lock);
+    if (--s_pending == 0) {
+        s_active_us += esp_timer_get_time() - s_active_since;
+        idle = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (idle) {
+        xEventGroupSetBits(s_events, IDLE_BIT);
+    }
+}
+
+/* "https://host:port/path" -> "https://host:port" */
+static void host_key(const char *url, char *out, size_t len)
+{
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    size_t n = strcspn(p, "/?#") + (size_t)(p - url);
+    if (n >= len) {
+        n = len - 1;
+    }
+    memcpy(out, url, n);
+    out[n] = '\0';
+}
+
+static void side_path(const char *dest, const char *suffix, char *out, size_t len)
+{
+    snprintf(out, len, "%s%s", dest, suffix);
+}
+
+static void resume_save(const char *dest, const dl_resume_t *rs)
+{
+    char path[SIDE_PATH_MAX];
+    side_path(dest, RESUME_SUFFIX, path, sizeof(path));
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return;
+    }
+    bool ok = fwrite(rs, sizeof(*rs), 1, f) == 1;
+    if (fclose(f) != 0 || !ok) {
+        remove(path);
+    }
+}
+
+static void resume_remove(const char *dest)
+{
+    char path[SIDE_PATH_MAX];
+    side_path(dest, RESUME_SUFFIX, path, sizeof(path));
+    remove(path);
+}
+
+/* Load the resume state of @p job if it still describes the partial file. */
+static bool resume_load(const dl_job_t *job, dl_resume_t *rs)
+{
+    char path[SIDE_PATH_MAX];
+    side_path(job->dest, RESUME_SUFFIX, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fread(rs, sizeof(*rs), 1, f) == 1;
+    fclose(f);
+    struct stat st;
+    ok = ok && rs->magic == RESUME_MAGIC && rs->ctx_size == sizeof(rs->sha) &&
+         rs->offset > 0 && strcmp(rs->url, job->url) == 0 &&
+         (rs->etag[0] || rs->last_modified[0]) &&
+         stat(job->dest, &st) == 0 && (uint64_t)st.st_size == rs->offset;
+    if (!ok) {
+        remove(path);
+        return false;
+    }
+    return true;
+}
+
+/* `<dest>.meta` holds the validators of a completed file: ETag, then
+ * Last-Modified, one per line. */
+static void meta_load(const char *dest, char *etag, char *last_modified)
+{
+    etag[0] = last_modified[0] = '\0';
+    struct stat st;
+    if (stat(dest, &st) != 0) {
+        return;
+    }
+    char path[SIDE_PATH_MAX];
+    side_path(dest, META_SUFFIX, path, sizeof(path));
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    if (fgets(etag, HDR_MAX, f)) {
+        etag[strcspn(etag, "\r\n")] = '\0';
+    }
+    if (fgets(last_modified, HDR_MAX, f)) {
+        last_modified[strcspn(last_modified, "\r\n")] = '\0';
+    }
+    fclose(f);
+}
+
+static void meta_save(const char *dest, const char *etag, const char *last_modified)
+{
+    char path[SIDE_PATH_MAX];
+    side_path(dest, META_SUFFIX, path, sizeof(path));
+    if (!etag[0] && !last_modified[0]) {
+        remove(path);
+        return;
+    }
+    FILE *f = fopen(path, "w");
+    if (f) {
+        fprintf(f, "%s\n%s\n", etag, last_modified);
+        fclose(f);
+    }
+}
+
+static void writer_task(void *arg)
+{
+    wr_msg_t msg;
+    while (xQueueReceive(s_wr_queue, &msg, portMAX_DELAY) == pdTRUE) {
+        if (msg.type == WR_STOP) {
+            break;
+        }
+        dl_worker_t *w = &s_workers[msg.slot];
+        int64_t t0 = esp_timer_get_time();
+        switch (msg.type) {
+        case WR_OPEN:
+            w->file = fopen(w->path, w->append ? "ab" : "wb");
+            if (!w->file) {
+                ESP_LOGE(TAG, "Cannot create %s", w->path);
+                w->write_err = ESP_FAIL;
+            }
+            break;
+        case WR_DATA:
+            if (w->file && w->write_err == ESP_OK) {
+                TRACE_BEGIN("sd_write");
+                size_t written = fwrite(msg.buf, 1, msg.len, w->file);
+                TRACE_END("sd_write");
+                if (written != msg.len) {
+                    ESP_LOGE(TAG, "fwrite wrote %zu of %zu bytes", written, msg.len);
+                    w->write_err = ESP_FAIL;
+                } else {
+                    portENTER_CRITICAL(&s_lock);
+                    s_written += written;
+                    portEXIT_CRITICAL(&s_lock);
+                }
+            }
+            xQueueSend(s_free_bufs, &msg.buf, portMAX_DELAY);
+            break;
+        case WR_CHECKPOINT:
+            if (w->file && w->write_err == ESP_OK && fflush(w->file) == 0 &&
+                fsync(fileno(w->file)) == 0) {
+                resume_save(w->path, (const dl_resume_t *)msg.buf);
+            }
+            free(msg.buf);
+            break;
+        case WR_CLOSE:
+        case WR_SUSPEND:
+        case WR_ABORT:
+            if (w->file) {
+                if (fclose(w->file) != 0) {
+                    w->write_err = ESP_FAIL;
+                }
+                w->file = NULL;
+            }
+            if (msg.type == WR_SUSPEND && w->write_err == ESP_OK) {
+                resume_save(w->path, (const dl_resume_t *)msg.buf);
+            } else {
+                resume_remove(w->path);
+                if (msg.type != WR_CLOSE || w->write_err != ESP_OK) {
+                    remove(w->path);
+                }
+            }
+            free(msg.buf);
+            xSemaphoreGive(w->ack);
+            break;
+        default:
+            break;
+        }
+        portENTER_CRITICAL(&s_lock);
+        s_write_us += esp_timer_get_time() - t0;
+        portEXIT_CRITICAL(&s_lock);
+    }
+    xSemaphoreGive(s_exit_sem);
+    vTaskDelete(NULL);
+}
+
+static void writer_post(dl_worker_t *w, wr_type_t type, uint8_t *buf, size_t len)
+{
+    wr_msg_t msg = { .type = type, .slot = w->id, .buf = buf, .len = len };
+    xQueueSend(s_wr_queue, &msg, portMAX_DELAY);
+}
+
+static void worker_disconnect(dl_worker_t *w)
+{
+    if (w->client) {
+        esp_http_client_close(w->client);
+    }
+    w->connected = false;
+}
+
+static esp_err_t worker_http_event(esp_http_client_event_t *evt)
+{
+    dl_worker_t *w = evt->user_data;
+    if (evt->event_id != HTTP_EVENT_ON_HEADER || !w) {
+        return ESP_OK;
+    }
+    struct {
+        const char *name;
+        char *dst;
+        size_t len;
+    } const wanted[] = {
+        { SHA256_HEADER, w->hdr_sha, sizeof(w->hdr_sha) },
+        { "ETag", w->hdr_etag, sizeof(w->hdr_etag) },
+        { "Last-Modified", w->hdr_last_modified, sizeof(w->hdr_last_modified) },
+        { "Content-Range", w->hdr_content_range, sizeof(w->hdr_content_range) },
+    };
+    for (size_t i = 0; i < sizeof(wanted) / sizeof(wanted[0]); ++i) {
+        if (strcasecmp(evt->header_key, wanted[i].name) == 0) {
+            strlcpy(wanted[i].dst, evt->header_value, wanted[i].len);
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+static void worker_reset_headers(dl_worker_t *w)
+{
+    w->hdr_sha[0] = '\0';
+    w->hdr_etag[0] = '\0';
+    w->hdr_last_modified[0] = '\0';
+    w->hdr_content_range[0] = '\0';
+    esp_http_client_delete_header(w->client, "Range");
+    esp_http_client_delete_header(w->client, "If-Range");
+    esp_http_client_delete_header(w->client, "If-None-Match");
+    esp_http_client_delete_header(w->client, "If-Modified-Since");
+}
+
+/* Point the worker's client at @p url, keeping the session when the host is
+ * the one it is already connected to. */
+static esp_err_t worker_prepare(dl_worker_t *w, const char *url)
+{
+    char key[DL_POOL_HOST_MAX];
+    host_key(url, key, sizeof(key));
+    if (w->client && strcmp(key, w->stats.host) == 0) {
+        return esp_http_client_set_url(w->client, url);
+    }
+    if (w->client) {
+        esp_http_client_cleanup(w->client);
+        w->client = NULL;
+        w->connected = false;
+    }
+    esp_http_client_config_t cfg = {
+        .url = url,
+        .cert_pem = cert_pem_start,
+        .keep_alive_enable = true,
+        .buffer_size = 4096,
+        .event_handler = worker_http_event,
+        .user_data = w,
+    };
+    w->client = esp_http_client_init(&cfg);
+    if (!w->client) {
+        return ESP_FAIL;
+    }
+    strlcpy(w->stats.host, key, sizeof(w->stats.host));
+    return ESP_OK;
+}
+
+static esp_err_t worker_open(dl_worker_t *w)
+{
+    esp_http_client_set_header(w->client, "Connection", "keep-alive");
+    bool reused = w->connected;
+    esp_err_t err = esp_http_client_open(w->client, 0);
+    if (err != ESP_OK && reused) {
+        /* The server dropped the idle session, retry on a fresh one */
+        worker_disconnect(w);
+        reused = false;
+        err = esp_http_client_open(w->client, 0);
+    }
+    if (err != ESP_OK) {
+        w->connected = false;
+        return err;
+    }
+    w->connected = true;
+    if (reused) {
+        w->stats.reuses++;
+    } else {
+        w->stats.connects++;
+    }
+    return ESP_OK;
+}
+
+/* Internal: the resume state was refused, retry the job from scratch */
+#define ERR_RESTART ESP_ERR_INVALID_STATE
+
+static void worker_post_state(dl_worker_t *w, wr_type_t type)
+{
+    dl_resume_t *snap = malloc(sizeof(*snap));
+    if (snap) {
+        memcpy(snap, &w->resume, sizeof(*snap));
+    } else if (type == WR_CHECKPOINT) {
+        return;
+    } else {
+        /* Without a snapshot the partial file cannot be resumed */
+        type = WR_ABORT;
+    }
+    writer_post(w, type, (uint8_t *)snap, 0);
+}
+
+/* Check that a 206 answer starts where the partial file ends. */
+static bool content_range_matches(const char *range, uint64_t offset)
+{
+    unsigned long long start;
+    if (sscanf(range, "bytes %llu-", &start) != 1) {
+        return false;
+    }
+    return start == offset;
+}
+
+static esp_err_t worker_request(dl_worker_t *w, const dl_job_t *job, bool allow_resume,
+                                size_t *out_bytes)
+{
+    *out_bytes = 0;
+    dl_resume_t *rs = &w->resume;
+    bool resume = allow_resume && resume_load(job, rs);
+
+    esp_err_t err = worker_prepare(w, job->url);
+    if (err != ESP_OK) {
+        return err;
+    }
+    worker_reset_headers(w);
+    bool conditional = false;
+    char range[40];
+    if (resume) {
+        snprintf(range, sizeof(range), "bytes=%llu-", (unsigned long long)rs->offset);
+        esp_http_client_set_header(w->client, "Range", range);
+        esp_http_client_set_header(w->client, "If-Range",
+                                   rs->etag[0] ? rs->etag : rs->last_modified);
+    } else if (job->flags & DL_POOL_CONDITIONAL) {
+        char etag[HDR_MAX];
+        char last_modified[HDR_MAX];
+        meta_load(job->dest, etag, last_modified);
+        if (etag[0]) {
+            esp_http_client_set_header(w->client, "If-None-Match", etag);
+            conditional = true;
+        }
+        if (last_modified[0]) {
+            esp_http_client_set_header(w->client, "If-Modified-Since", last_modified);
+            conditional = true;
+        }
+    }
+
+    w->stats.requests++;
+    err = worker_open(w);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP open failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    int64_t content_length = esp_http_client_fetch_headers(w->client);
+    if (content_length < 0) {
+        worker_disconnect(w);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    int status = esp_http_client_get_status_code(w->client);
+    if (status == 304 && conditional) {
+        if (esp_http_client_flush_response(w->client, NULL) != ESP_OK) {
+            worker_disconnect(w);
+        }
+        w->stats.not_modified++;
+        ESP_LOGI(TAG, "[%u] %s not modified", w->id, job->dest);
+        return ESP_OK;
+    }
+    if (resume && (status == 416 || (status == 206 &&
+                                      !content_range_matches(w->hdr_content_range, rs->offset)))) {
+        worker_disconnect(w);
+        resume_remove(job->dest);
+        return ERR_RESTART;
+    }
+    if (resume && status == 200) {
+        /* The file changed on the server (If-Range failed): start over */
+        resume = false;
+    }
+    if (status != (resume ? 206 : 200)) {
+        ESP_LOGE(TAG, "HTTP status %d for %s", status, job->url);
+        worker_disconnect(w);
+        return ESP_ERR_HTTP_STATUS;
+    }
+    uint8_t expected_hash[32];
+    err = image_fetch_resolve_hash(w->hdr_sha, job->verify ? job->expected : NULL,
+                                   expected_hash);
+    if (err != ESP_OK) {
+        worker_disconnect(w);
+        return err;
+    }
+
+    if (resume) {
+        w->stats.resumed++;
+        w->stats.resumed_bytes += rs->offset;
+        ESP_LOGI(TAG, "[%u] Resuming %s at %llu", w->id, job->dest,
+                 (unsigned long long)rs->offset);
+    } else {
+        memset(rs, 0, sizeof(*rs));
+        rs->magic = RESUME_MAGIC;
+        rs->ctx_size = sizeof(rs->sha);
+        strlcpy(rs->url, job->url, sizeof(rs->url));
+        strlcpy(rs->etag, w->hdr_etag, sizeof(rs->etag));
+        strlcpy(rs->last_modified, w->hdr_last_modified, sizeof(rs->last_modified));
+        mbedtls_sha256_init(&rs->sha);
+        mbedtls_sha256_starts(&rs->sha, 0);
+    }
+    bool resumable = rs->etag[0] || rs->last_modified[0];
+
+    w->path = job->dest;
+    w->append = resume;
+    w->write_err = ESP_OK;
+    writer_post(w, WR_OPEN, NULL, 0);
+
+    size_t total = 0;
+    size_t since_checkpoint = 0;
+    bool eof = false;
+    while (!eof && err == ESP_OK && w->write_err == ESP_OK) {
+        uint8_t *buf;
+        if (xQueueReceive(s_free_bufs, &buf, 0) != pdTRUE) {
+            portENTER_CRITICAL(&s_lock);
+            s_buffer_waits++;
+            portEXIT_CRITICAL(&s_lock);
+            TRACE_BEGIN("dl_buf_wait");
+            xQueueReceive(s_free_bufs, &buf, portMAX_DELAY);
+            TRACE_END("dl_buf_wait");
+        }
+        TRACE_COUNTER("dl_free_bufs", uxQueueMessagesWaiting(s_free_bufs));
+        size_t fill = 0;
+        while (fill < CHUNK_SIZE) {
+            TRACE_BEGIN("http_recv");
+            int r = esp_http_client_read(w->client, (char *)buf + fill, CHUNK_SIZE - fill);
+            TRACE_END("http_recv");
+            if (r < 0) {
+                err = r;
+                break;
+            } else if (r == 0) {
+                eof = true;
+                break;
+            }
+            fill += r;
+        }
+        if (fill == 0) {
+            xQueueSend(s_free_bufs, &buf, portMAX_DELAY);
+            continue;
+        }
+        mbedtls_sha256_update(&rs->sha, buf, fill);
+        rs->offset += fill;
+        total += fill;
+        writer_post(w, WR_DATA, buf, fill);
+        since_checkpoint += fill;
+        if (resumable && since_checkpoint >= CHECKPOINT_BYTES) {
+            worker_post_state(w, WR_CHECKPOINT);
+            since_checkpoint = 0;
+        }
+    }
+    *out_bytes = total;
+
+    if (err == ESP_OK && ((content_length > 0 && total != (size_t)content_length) ||
+                          !esp_http_client_is_complete_data_received(w->client))) {
+        err = ESP_ERR_HTTP_WRITE_DATA;
+    }
+    wr_type_t outcome = WR_CLOSE;
+    if (err != ESP_OK) {
+        /* Network failure: keep what was received for the next attempt */
+        outcome = resumable ? WR_SUSPEND : WR_ABORT;
+        worker_disconnect(w);
+    } else if (w->write_err != ESP_OK) {
+        err = w->write_err;
+        outcome = WR_ABORT;
+    } else {
+        mbedtls_sha256_context fin;
+        mbedtls_sha256_init(&fin);
+        mbedtls_sha256_clone(&fin, &rs->sha);
+        uint8_t actual_hash[32];
+        mbedtls_sha256_finish(&fin, actual_hash);
+        mbedtls_sha256_free(&fin);
+        if (memcmp(actual_hash, expected_hash, sizeof(expected_hash)) != 0) {
+            err = ESP_ERR_INVALID_RESPONSE;
+            outcome = WR_ABORT;
+        }
+    }
+
+    if (outcome == WR_SUSPEND) {
+        worker_post_state(w, WR_SUSPEND);
+    } else {
+        writer_post(w, outcome, NULL, 0);
+    }
+    xSemaphoreTake(w->ack, portMAX_DELAY);
+    mbedtls_sha256_free(&rs->sha);
+    if (err == ESP_OK) {
+        err = w->write_err;
+    }
+    if (err == ESP_OK && (job->flags & DL_POOL_CONDITIONAL)) {
+        meta_save(job->dest, w->hdr_etag, w->hdr_last_modified);
+    }
+    return err;
+}
+
+static esp_err_t worker_run(dl_worker_t *w, const dl_job_t *job, size_t *out_bytes)
+{
+    esp_err_t err = worker_request(w, job, true, out_bytes);
+    if (err == ERR_RESTART) {
+        ESP_LOGW(TAG, "[%u] Server refused to resume %s, starting over", w->id, job->dest);
+        err = worker_request(w, job, false, out_bytes);
+    }
+    return err;
+}
+
+static void worker_task(void *arg)
+{
+    dl_worker_t *w = arg;
+    dl_job_t *job;
+    while (xQueueReceive(s_job_queue, &job, portMAX_DELAY) == pdTRUE) {
+        if (!job) {
+            break;
+        }
+        int64_t t0 = esp_timer_get_time();
+        size_t bytes = 0;
+        esp_err_t err = worker_run(w, job, &bytes);
+        portENTER_CRITICAL(&s_lock);
+        w->stats.bytes += bytes;
+        w->stats.busy_us += esp_timer_get_time() - t0;
+        if (err != ESP_OK) {
+            w->stats.errors++;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "[%u] Downloaded %s to %s", w->id, job->url, job->dest);
+        } else {
+            ESP_LOGW(TAG, "[%u] %s failed: %s", w->id, job->url, esp_err_to_name(err));
+        }
+        if (job->done) {
+            job->done(err, bytes, job->arg);
+        }
+        free(job);
+        pending_done();
+    }
+    if (w->client) {
+        esp_http_client_cleanup(w->client);
+        w->client = NULL;
+    }
+    w->connected = false;
+    xSemaphoreGive(s_exit_sem);
+    vTaskDelete(NULL);
+}
+
+static void release_resources(void)
+{
+    for (int i = 0; i < BUFFER_COUNT; ++i) {
+        heap_caps_free(s_buffers[i]);
+        s_buffers[i] = NULL;
+    }
+    for (int i = 0; i < WORKER_COUNT; ++i) {
+        if (s_workers[i].ack) {
+            vSemaphoreDelete(s_workers[i].ack);
+            s_workers[i].ack = NULL;
+        }
+    }
+    if (s_job_queue) {
+        vQueueDelete(s_job_queue);
+        s_job_queue = NULL;
+    }
+    if (s_free_bufs) {
+        vQueueDelete(s_free_bufs);
+        s_free_bufs = NULL;
+    }
+    if (s_wr_queue) {
+        vQueueDelete(s_wr_queue);
+        s_wr_queue = NULL;
+    }
+    if (s_exit_sem) {
+        vSemaphoreDelete(s_exit_sem);
+        s_exit_sem = NULL;
+    }
+    if (s_events) {
+        vEventGroupDelete(s_events);
+        s_events = NULL;
+    }
+}
+
+static esp_err_t start_locked(void)
+{
+    s_job_queue = xQueueCreate(JOB_QUEUE_LEN, sizeof(dl_job_t *));
+    s_free_bufs = xQueueCreate(BUFFER_COUNT, sizeof(uint8_t *));
+    /* Every buffer plus one control message per worker can be in flight */
+    s_wr_queue = xQueueCreate(BUFFER_COUNT + 2 * WORKER_COUNT + 1, sizeof(wr_msg_t));
+    s_exit_sem = xSemaphoreCreateCounting(WORKER_COUNT + 1, 0);
+    s_events = xEventGroupCreate();
+    if (!s_job_queue || !s_free_bufs || !s_wr_queue || !s_exit_sem || !s_events) {
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < BUFFER_COUNT; ++i) {
+        s_buffers[i] = heap_caps_malloc(CHUNK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_buffers[i]) {
+            ESP_LOGE(TAG, "Cannot allocate %d x %d kB download buffers", BUFFER_COUNT,
+                     CONFIG_IMAGE_FETCH_CHUNK_KB);
+            release_resources();
+            return ESP_ERR_NO_MEM;
+        }
+        xQueueSend(s_free_bufs, &s_buffers[i], 0);
+    }
+    for (int i = 0; i < WORKER_COUNT; ++i) {
+        memset(&s_workers[i], 0, sizeof(s_workers[i]));
+        s_workers[i].id = i;
+        s_workers[i].ack = xSemaphoreCreateBinary();
+        if (!s_workers[i].ack) {
+            release_resources();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xEventGroupSetBits(s_events, IDLE_BIT);
+    s_pending = 0;
+
+    if (xTaskCreate(writer_task, "dl_writer", WRITER_STACK, NULL, 5, NULL) != pdPASS) {
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+    int started = 0;
+    for (; started < WORKER_COUNT; ++started) {
+        char name[12];
+        snprintf(name, sizeof(name), "dl_worker%d", started);
+        if (xTaskCreate(worker_task, name, WORKER_STACK, &s_workers[started], 5,
+                        &s_workers[started].task) != pdPASS) {
+            break;
+        }
+    }
+    if (started == 0) {
+        wr_msg_t stop = { .type = WR_STOP };
+        xQueueSend(s_wr_queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(s_exit_sem, portMAX_DELAY);
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = started; i < WORKER_COUNT; ++i) {
+        /* Never started, nothing will post its exit */
+        xSemaphoreGive(s_exit_sem);
+    }
+    s_running = true;
+    ESP_LOGI(TAG, "%d connection(s), %d x %d kB buffers", started, BUFFER_COUNT,
+             CONFIG_IMAGE_FETCH_CHUNK_KB);
+    return ESP_OK;
+}
+
+esp_err_t dl_pool_start(void)
+{
+    if (!s_start_lock) {
+        static StaticSemaphore_t lock_buf;
+        portENTER_CRITICAL(&s_lock);
+        if (!s_start_lock) {
+            s_start_lock = xSemaphoreCreateMutexStatic(&lock_buf);
+        }
+        portEXIT_CRITICAL(&s_lock);
+    }
+    xSemaphoreTake(s_start_lock, portMAX_DELAY);
+    esp_err_t err = s_running ? ESP_OK : start_locked();
+    xSemaphoreGive(s_start_lock);
+    return err;
+}
+
+void dl_pool_stop(void)
+{
+    if (!s_start_lock) {
+        return;
+    }
+    xSemaphoreTake(s_start_lock, portMAX_DELAY);
+    if (!s_running) {
+        xSemaphoreGive(s_start_lock);
+        return;
+    }
+    dl_job_t *stop = NULL;
+    for (int i = 0; i < WORKER_COUNT; ++i) {
+        xQueueSend(s_job_queue, &stop, portMAX_DELAY);
+    }
+    for (int i = 0; i < WORKER_COUNT; ++i) {
+        xSemaphoreTake(s_exit_sem, portMAX_DELAY);
+    }
+    wr_msg_t msg = { .type = WR_STOP };
+    xQueueSend(s_wr_queue, &msg, portMAX_DELAY);
+    xSemaphoreTake(s_exit_sem, portMAX_DELAY);
+    dl_pool_log_stats();
+    release_resources();
+    s_running = false;
+    xSemaphoreGive(s_start_lock);
+}
+
+esp_err_t dl_pool_submit(const char *url, const char *dest_path,
+                         const uint8_t *expected_sha256, uint32_t flags,
+                         dl_pool_done_cb_t done, void *arg)
+{
+    if (!url || !dest_path) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(url) >= DL_POOL_URL_MAX || strlen(dest_path) >= DL_POOL_PATH_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = dl_pool_start();
+    if (err != ESP_OK) {
+        return err;
+    }
+    dl_job_t *job = calloc(1, sizeof(*job));
+    if (!job) {
+        return ESP_ERR_NO_MEM;
+    }
+    strcpy(job->url, url);
+    strcpy(job->dest, dest_path);
+    if (expected_sha256) {
+        job->verify = true;
+        memcpy(job->expected, expected_sha256, sizeof(job->expected));
+    }
+    job->flags = flags;
+    job->done = done;
+    job->arg = arg;
+    pending_add();
+    xQueueSend(s_job_queue, &job, portMAX_DELAY);
+    return ESP_OK;
+}
+
+esp_err_t dl_pool_wait_idle(uint32_t timeout_ms)
+{
+    if (!s_running) {
+        return ESP_OK;
+    }
+    TickType_t ticks = timeout_ms == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(s_events, IDLE_BIT, pdFALSE, pdTRUE, ticks);
+    return (bits & IDLE_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+typedef struct {
+    SemaphoreHandle_t done;
+    esp_err_t result;
+} sync_wait_t;
+
+static void sync_done(esp_err_t result, size_t bytes, void *arg)
+{
+    sync_wait_t *wait = arg;
+    wait->result = result;
+    xSemaphoreGive(wait->done);
+}
+
+esp_err_t dl_pool_fetch(const char *url, const char *dest_path,
+                        const uint8_t *expected_sha256, uint32_t flags)
+{
+    sync_wait_t wait = { .done = xSemaphoreCreateBinary(), .result = ESP_FAIL };
+    if (!wait.done) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = dl_pool_submit(url, dest_path, expected_sha256, flags, sync_done, &wait);
+    if (err == ESP_OK) {
+        xSemaphoreTake(wait.done, portMAX_DELAY);
+        err = wait.result;
+    }
+    vSemaphoreDelete(wait.done);
+    return err;
+}
+
+void dl_pool_get_stats(dl_pool_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    portENTER_CRITICAL(&s_lock);
+    out->workers = s_running ? WORKER_COUNT : 0;
+    for (int i = 0; i < WORKER_COUNT; ++i) {
+        out->conn[i] = s_workers[i].stats;
+        out->bytes += s_workers[i].stats.bytes;
+    }
+    out->active_us = s_active_us;
+    if (s_pending) {
+        out->active_us += esp_timer_get_time() - s_active_since;
+    }
+    out->written = s_written;
+    out->write_us = s_write_us;
+    out->buffer_waits = s_buffer_waits;
+    portEXIT_CRITICAL(&s_lock);
+    if (out->active_us) {
+        out->throughput_kbps = (uint32_t)(out->bytes * 1000000ULL / out->active_us / 1024);
+    }
+}
+
+void dl_pool_reset_stats(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < WORKER_COUNT; ++i) {
+        char host[DL_POOL_HOST_MAX];
+        memcpy(host, s_workers[i].stats.host, sizeof(host));
+        memset(&s_workers[i].stats, 0, sizeof(s_workers[i].stats));
+        memcpy(s_workers[i].stats.host, host, sizeof(host));
+    }
+    s_active_us = 0;
+    s_active_since = esp_timer_get_time();
+    s_written = 0;
+    s_write_us = 0;
+    s_buffer_waits = 0;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void dl_pool_log_stats(void)
+{
+    dl_pool_stats_t st;
+    dl_pool_get_stats(&st);
+    ESP_LOGI(TAG, "%llu bytes in %llu ms (%lu kB/s), SD writer busy %llu ms, %lu buffer stalls",
+             (unsigned long long)st.bytes, (unsigned long long)(st.active_us / 1000),
+             (unsigned long)st.throughput_kbps, (unsigned long long)(st.write_us / 1000),
+             (unsigned long)st.buffer_waits);
+    for (size_t i = 0; i < st.workers; ++i) {
+        const dl_conn_stats_t *c = &st.conn[i];
+        ESP_LOGI(TAG, "  [%u] %s: %lu req, %lu new, %lu reused, %lu err, %llu bytes, busy %llu ms",
+                 (unsigned)i, c->host[0] ? c->host : "-", (unsigned long)c->requests,
+                 (unsigned long)c->connects, (unsigned long)c->reuses, (unsigned long)c->errors,
+                 (unsigned long long)c->bytes, (unsigned long long)(c->busy_us / 1000));
+        ESP_LOGI(TAG, "      %lu not modified, %lu resumed (%llu bytes not fetched again)",
+                 (unsigned long)c->not_modified, (unsigned long)c->resumed,
+                 (unsigned long long)c->resumed_bytes);
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DL_POOL_MAX_WORKERS 4
+#define DL_POOL_URL_MAX     320
+#define DL_POOL_PATH_MAX    192
+#define DL_POOL_HOST_MAX    96
+
+/** Job flags */
+#define DL_POOL_CONDITIONAL (1u << 0) /*!< Skip the transfer if the file on the card is current */
+
+/**
+ * @brief Completion callback of a queued download.
+ *
+ * Runs on the worker that handled the job, once the file is closed on the
+ * card. It must not wait on the pool (dl_pool_fetch(), dl_pool_wait_idle()).
+ *
+ * @param result ESP_OK when the file was written and its hash verified
+ * @param bytes  Payload bytes received
+ * @param arg    User pointer given to dl_pool_submit()
+ */
+typedef void (*dl_pool_done_cb_t)(esp_err_t result, size_t bytes, void *arg);
+
+/** Counters of one pooled connection (one per worker). */
+typedef struct {
+    char host[DL_POOL_HOST_MAX]; /*!< `scheme://host[:port]` currently held */
+    uint64_t bytes;              /*!< Payload bytes received */
+    uint32_t requests;           /*!< Requests sent */
+    uint32_t connects;           /*!< New TCP/TLS sessions opened */
+    uint32_t reuses;             /*!< Requests sent on an already open session */
+    uint32_t errors;             /*!< Requests that failed */
+    uint32_t not_modified;       /*!< Conditional requests answered with 304 */
+    uint32_t resumed;            /*!< Transfers continued with a Range request */
+    uint64_t resumed_bytes;      /*!< Bytes kept from earlier partial transfers */
+    uint64_t busy_us;            /*!< Time spent serving requests */
+} dl_conn_stats_t;
+
+typedef struct {
+    size_t workers;                          /*!< Connections in the pool */
+    dl_conn_stats_t conn[DL_POOL_MAX_WORKERS];
+    uint64_t bytes;                          /*!< Sum of all connections */
+    uint64_t active_us;                      /*!< Wall time with downloads in flight */
+    uint32_t throughput_kbps;                /*!< bytes / active_us, in kB/s */
+    uint64_t written;                        /*!< Bytes stored by the SD writer */
+    uint64_t write_us;                       /*!< Time the SD writer spent in fwrite/fclose */
+    uint32_t buffer_waits;                   /*!< Times a worker stalled for a free buffer */
+} dl_pool_stats_t;
+
+/**
+ * @brief Start the download workers and the SD writer task.
+ *
+ * Sizes come from `CONFIG_IMAGE_FETCH_PARALLEL`, `CONFIG_IMAGE_FETCH_CHUNK_KB`
+ * and `CONFIG_IMAGE_FETCH_BUFFERS`. The chunk buffers live in PSRAM and bound
+ * the memory used by all downloads in flight. Calling it again is a no-op.
+ */
+esp_err_t dl_pool_start(void);
+
+/**
+ * @brief Wait for queued downloads, close the pooled connections and release
+ * the buffers.
+ */
+void dl_pool_stop(void);
+
+/**
+ * @brief Queue a download to the SD card.
+ *
+ * The file is written to @p dest_path. The hash comes from the
+ * `X-File-SHA256` header and/or @p expected_sha256, as for
+ * image_fetch_http_to_sd_verified(); a file failing it is deleted.
+ *
+ * When the connection drops mid-transfer and the server sent an `ETag` or
+ * `Last-Modified` validator, the partial file is kept along with
+ * `<dest>.dl`, which records the offset, the validator and the running
+ * SHA-256 context. The next download of the same URL to the same path
+ * resumes with a `Range`/`If-Range` request.
+ *
+ * With #DL_POOL_CONDITIONAL the validators of the completed file are stored
+ * in `<dest>.meta` and sent back as `If-None-Match`/`If-Modified-Since`; a
+ * 304 answer leaves the file untouched and completes with ESP_OK and 0 bytes.
+ *
+ * Blocks while the job queue is full. Starts the pool if needed.
+ *
+ * @param expected_sha256 Optional raw 32-byte hash, may be NULL
+ * @param flags           DL_POOL_* flags
+ * @param done            Optional completion callback
+ */
+esp_err_t dl_pool_submit(const char *url, const char *dest_path,
+                         const uint8_t *expected_sha256, uint32_t flags,
+                         dl_pool_done_cb_t done, void *arg);
+
+/**
+ * @brief Block until every queued download has completed.
+ *
+ * @param timeout_ms Maximum wait, UINT32_MAX waits forever
+ *
+ * @return ESP_OK, or ESP_ERR_TIMEOUT
+ */
+esp_err_t dl_pool_wait_idle(uint32_t timeout_ms);
+
+/**
+ * @brief Download one file through the pool and wait for the result.
+ */
+esp_err_t dl_pool_fetch(const char *url, const char *dest_path,
+                        const uint8_t *expected_sha256, uint32_t flags);
+
+void dl_pool_get_stats(dl_pool_stats_t *out);
+void dl_pool_reset_stats(void);
+void dl_pool_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
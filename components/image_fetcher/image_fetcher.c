@@ -1,29 +1,37 @@
 #include "image_fetcher.h"
+#include "image_fetcher_priv.h"
+#include "download_pool.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
 #include "sdkconfig.h"
+#include "trace.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include "mbedtls/sha256.h"
 
 static const char *TAG = "image_fetcher";
 
-extern const char cert_pem_start[] asm("_binary_cert_pem_start");
-
-#define SHA256_HEADER "X-File-SHA256"
-
-#ifndef ESP_ERR_HTTP_STATUS
-#define ESP_ERR_HTTP_STATUS (ESP_ERR_HTTP_BASE + 0x0F)
-#endif
-#ifndef ESP_ERR_HTTP_FETCH_HEADER
-#define ESP_ERR_HTTP_FETCH_HEADER (ESP_ERR_HTTP_BASE + 0x07)
-#endif
+/* Read size of image_fetch_http_stream(), small enough to keep the decoder busy */
+#define STREAM_CHUNK 4096
 
+/* 64 hex digits; whitespace around them, as some proxies add, is ignored */
 static esp_err_t parse_sha256_header(const char *hash_hex, uint8_t out[32])
 {
-    if (!hash_hex || strlen(hash_hex) != 64) {
+    if (!hash_hex) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    while (isspace((unsigned char)*hash_hex)) {
+        hash_hex++;
+    }
+    size_t len = strlen(hash_hex);
+    while (len > 0 && isspace((unsigned char)hash_hex[len - 1])) {
+        len--;
+    }
+    if (len != 64) {
         return ESP_ERR_INVALID_RESPONSE;
     }
     for (int i = 0; i < 32; ++i) {
@@ -38,12 +46,66 @@ static esp_err_t parse_sha256_header(const char *hash_hex, uint8_t out[32])
     return ESP_OK;
 }
 
+esp_err_t image_fetch_resolve_hash(const char *hash_hex, const uint8_t *expected, uint8_t out[32])
+{
+    if (!hash_hex || !hash_hex[0]) {
+        if (!expected) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        memcpy(out, expected, 32);
+        return ESP_OK;
+    }
+    esp_err_t err = parse_sha256_header(hash_hex, out);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (expected && memcmp(out, expected, 32) != 0) {
+        ESP_LOGE(TAG, "Server hash does not match the expected one");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t image_fetch_parse_sha256(const char *hash_hex, uint8_t out[32])
+{
+    return parse_sha256_header(hash_hex, out);
+}
+
 esp_err_t image_fetch_http_to_sd(const char *url, const char *dest_path)
 {
+    return dl_pool_fetch(url, dest_path, NULL, DL_POOL_CONDITIONAL);
+}
+
+esp_err_t image_fetch_http_to_sd_verified(const char *url, const char *dest_path,
+                                          const uint8_t expected_sha256[32])
+{
+    return dl_pool_fetch(url, dest_path, expected_sha256, 0);
+}
+
+static esp_err_t psram_http_event(esp_http_client_event_t *evt)
+{
+    char *hash_hex = evt->user_data;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && strcasecmp(evt->header_key, SHA256_HEADER) == 0) {
+        strlcpy(hash_hex, evt->header_value, SHA256_HEADER_MAX);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t fetch_to_psram(const char *url, const uint8_t *expected, uint8_t **data,
+                                size_t *len)
+{
+    *data = NULL;
+    *len = 0;
+    /* esp_http_client_get_header() only sees request headers, the hash is
+     * picked up by the event handler instead. */
+    char hash_hex[SHA256_HEADER_MAX] = "";
     esp_http_client_config_t cfg = {
         .url = url,
         .cert_pem = cert_pem_start,
         .keep_alive_enable = true,
+        .buffer_size = 4096,
+        .event_handler = psram_http_event,
+        .user_data = hash_hex,
     };
     esp_http_client_handle_t client = esp_http_client_init(&cfg);
     if (client == NULL) {
@@ -56,14 +118,12 @@ esp_err_t image_fetch_http_to_sd(const char *url, const char *dest_path)
         esp_http_client_cleanup(client);
         return err;
     }
-
-    err = esp_http_client_fetch_headers(client);
-    if (err != ESP_OK && err != ESP_ERR_HTTP_FETCH_HEADER) {
+    int64_t content_length = esp_http_client_fetch_headers(client);
+    if (content_length < 0) {
         esp_http_client_close(client);
         esp_http_client_cleanup(client);
-        return err;
+        return ESP_ERR_HTTP_FETCH_HEADER;
     }
-    int content_length = esp_http_client_get_content_length(client);
     int status = esp_http_client_get_status_code(client);
     if (status != 200) {
         esp_http_client_close(client);
@@ -71,147 +131,120 @@ esp_err_t image_fetch_http_to_sd(const char *url, const char *dest_path)
         return ESP_ERR_HTTP_STATUS;
     }
 
-    char *hash_hex = NULL;
-    if (esp_http_client_get_header(client, SHA256_HEADER, &hash_hex) != ESP_OK || !hash_hex) {
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        return ESP_ERR_INVALID_RESPONSE;
-    }
     uint8_t expected_hash[32];
-    err = parse_sha256_header(hash_hex, expected_hash);
+    err = image_fetch_resolve_hash(hash_hex, expected, expected_hash);
     if (err != ESP_OK) {
         esp_http_client_close(client);
         esp_http_client_cleanup(client);
         return err;
     }
 
-    mbedtls_sha256_context sha_ctx;
-    mbedtls_sha256_init(&sha_ctx);
-    FILE *f = NULL;
-    int rc = mbedtls_sha256_starts(&sha_ctx, 0);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "mbedtls_sha256_starts failed: %d", rc);
-        if (f) {
-            fclose(f);
-        }
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        remove(dest_path);
-        mbedtls_sha256_free(&sha_ctx);
-        return ESP_FAIL;
-    }
-
-    f = fopen(dest_path, "wb");
-    if (!f) {
+    /* Size the buffer from Content-Length when known to avoid reallocs */
+    size_t cap = content_length > 0 ? (size_t)content_length : 64 * 1024;
+    uint8_t *buf = heap_caps_malloc(cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
         esp_http_client_close(client);
         esp_http_client_cleanup(client);
-        mbedtls_sha256_free(&sha_ctx);
-        return ESP_FAIL;
+        return ESP_ERR_NO_MEM;
     }
-    uint8_t buf[512];
-    int data_read;
-    int total_read = 0;
+    size_t total = 0;
     err = ESP_OK;
     while (1) {
-        data_read = esp_http_client_read(client, (char *)buf, sizeof(buf));
-        if (data_read < 0) {
-            err = data_read;
+        if (total == cap) {
+            uint8_t *new_buf = heap_caps_realloc(buf, cap * 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (!new_buf) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            buf = new_buf;
+            cap *= 2;
+        }
+        TRACE_BEGIN("http_recv");
+        int r = esp_http_client_read(client, (char *)buf + total, cap - total);
+        TRACE_END("http_recv");
+        if (r < 0) {
+            err = r;
             break;
-        } else if (data_read == 0) {
+        } else if (r == 0) {
             break;
         }
-        size_t bytes_written = fwrite(buf, 1, data_read, f);
-        if (bytes_written != data_read) {
-            ESP_LOGE(TAG, "fwrite wrote %zu of %d bytes", bytes_written, data_read);
-            fclose(f);
-            esp_http_client_close(client);
-            esp_http_client_cleanup(client);
-            remove(dest_path);
-            mbedtls_sha256_free(&sha_ctx);
-            return ESP_FAIL;
-        }
-        total_read += data_read;
-        rc = mbedtls_sha256_update(&sha_ctx, buf, data_read);
-        if (rc != 0) {
-            ESP_LOGE(TAG, "mbedtls_sha256_update failed: %d", rc);
-            fclose(f);
-            esp_http_client_close(client);
-            esp_http_client_cleanup(client);
-            remove(dest_path);
-            mbedtls_sha256_free(&sha_ctx);
-            return ESP_FAIL;
-        }
-    }
-    fclose(f);
-    uint8_t actual_hash[32];
-    rc = mbedtls_sha256_finish(&sha_ctx, actual_hash);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "mbedtls_sha256_finish failed: %d", rc);
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        remove(dest_path);
-        mbedtls_sha256_free(&sha_ctx);
-        return ESP_FAIL;
+        total += r;
     }
-    mbedtls_sha256_free(&sha_ctx);
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
 
-    if (err != ESP_OK || (content_length >= 0 && total_read != content_length)) {
-        remove(dest_path);
+    if (err != ESP_OK || (content_length > 0 && total != (size_t)content_length)) {
+        free(buf);
         return (err != ESP_OK) ? err : ESP_ERR_HTTP_WRITE_DATA;
     }
+
+    /* Hash the whole buffer at once, the SHA peripheral is fastest on
+     * long runs. */
+    uint8_t actual_hash[32];
+    int rc = mbedtls_sha256(buf, total, actual_hash, 0);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "mbedtls_sha256 failed: %d", rc);
+        free(buf);
+        return ESP_FAIL;
+    }
     if (memcmp(actual_hash, expected_hash, sizeof(expected_hash)) != 0) {
-        remove(dest_path);
+        free(buf);
         return ESP_ERR_INVALID_RESPONSE;
     }
 
-    ESP_LOGI(TAG, "Downloaded %s to %s", url, dest_path);
+    *data = buf;
+    *len = total;
+    ESP_LOGI(TAG, "Downloaded %d bytes from %s", (int)total, url);
     return ESP_OK;
 }
 
 esp_err_t image_fetch_http_to_psram(const char *url, uint8_t **data, size_t *len)
 {
-    *data = NULL;
-    *len = 0;
+    return fetch_to_psram(url, NULL, data, len);
+}
+
+esp_err_t image_fetch_http_to_psram_verified(const char *url, const uint8_t expected_sha256[32],
+                                             uint8_t **data, size_t *len)
+{
+    return fetch_to_psram(url, expected_sha256, data, len);
+}
+
+esp_err_t image_fetch_http_stream(const char *url, const uint8_t expected_sha256[32],
+                                  image_fetch_sink_t sink, void *arg)
+{
+    char hash_hex[SHA256_HEADER_MAX] = "";
     esp_http_client_config_t cfg = {
         .url = url,
         .cert_pem = cert_pem_start,
         .keep_alive_enable = true,
+        .buffer_size = 4096,
+        .event_handler = psram_http_event,
+        .user_data = hash_hex,
     };
     esp_http_client_handle_t client = esp_http_client_init(&cfg);
     if (client == NULL) {
         return ESP_FAIL;
     }
-    esp_http_client_set_header(client, "Connection", "keep-alive");
     esp_err_t err = esp_http_client_open(client, 0);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP open failed: %s", esp_err_to_name(err));
         esp_http_client_cleanup(client);
         return err;
     }
-    err = esp_http_client_fetch_headers(client);
-    if (err != ESP_OK && err != ESP_ERR_HTTP_FETCH_HEADER) {
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        return err;
-    }
-    int content_length = esp_http_client_get_content_length(client);
+    int64_t content_length = esp_http_client_fetch_headers(client);
     int status = esp_http_client_get_status_code(client);
-    if (status != 200) {
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        return ESP_ERR_HTTP_STATUS;
+    uint8_t expected_hash[32];
+    if (content_length < 0) {
+        err = ESP_ERR_HTTP_FETCH_HEADER;
+    } else if (status != 200) {
+        err = ESP_ERR_HTTP_STATUS;
+    } else {
+        err = image_fetch_resolve_hash(hash_hex, expected_sha256, expected_hash);
     }
-
-    char *hash_hex = NULL;
-    if (esp_http_client_get_header(client, SHA256_HEADER, &hash_hex) != ESP_OK || !hash_hex) {
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        return ESP_ERR_INVALID_RESPONSE;
+    uint8_t *buf = err == ESP_OK ? malloc(STREAM_CHUNK) : NULL;
+    if (err == ESP_OK && !buf) {
+        err = ESP_ERR_NO_MEM;
     }
-    uint8_t expected_hash[32];
-    err = parse_sha256_header(hash_hex, expected_hash);
     if (err != ESP_OK) {
         esp_http_client_close(client);
         esp_http_client_cleanup(client);
@@ -220,83 +253,34 @@ esp_err_t image_fetch_http_to_psram(const char *url, uint8_t **data, size_t *len
 
     mbedtls_sha256_context sha_ctx;
     mbedtls_sha256_init(&sha_ctx);
-    int rc = mbedtls_sha256_starts(&sha_ctx, 0);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "mbedtls_sha256_starts failed: %d", rc);
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        mbedtls_sha256_free(&sha_ctx);
-        return ESP_FAIL;
-    }
-
-    size_t cap = 4 * 1024; /* Initial capacity to limit reallocs */
-    uint8_t *buf = heap_caps_malloc(cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!buf) {
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        mbedtls_sha256_free(&sha_ctx);
-        return ESP_ERR_NO_MEM;
-    }
+    mbedtls_sha256_starts(&sha_ctx, 0);
     size_t total = 0;
-    uint8_t tmp_buf[512];
-    err = ESP_OK;
-    while (1) {
-        int r = esp_http_client_read(client, (char *)tmp_buf, sizeof(tmp_buf));
+    while (err == ESP_OK) {
+        TRACE_BEGIN("http_recv");
+        int r = esp_http_client_read(client, (char *)buf, STREAM_CHUNK);
+        TRACE_END("http_recv");
         if (r < 0) {
             err = r;
             break;
         } else if (r == 0) {
             break;
         }
-        if (total + r > cap) {
-            while (total + r > cap) {
-                cap *= 2;
-            }
-            uint8_t *new_buf = heap_caps_realloc(buf, cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-            if (!new_buf) {
-                err = ESP_ERR_NO_MEM;
-                break;
-            }
-            buf = new_buf;
-        }
-        memcpy(buf + total, tmp_buf, r);
+        mbedtls_sha256_update(&sha_ctx, buf, r);
         total += r;
-        rc = mbedtls_sha256_update(&sha_ctx, tmp_buf, r);
-        if (rc != 0) {
-            ESP_LOGE(TAG, "mbedtls_sha256_update failed: %d", rc);
-            free(buf);
-            esp_http_client_close(client);
-            esp_http_client_cleanup(client);
-            mbedtls_sha256_free(&sha_ctx);
-            return ESP_FAIL;
-        }
+        err = sink(buf, r, arg);
     }
-
     uint8_t actual_hash[32];
-    rc = mbedtls_sha256_finish(&sha_ctx, actual_hash);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "mbedtls_sha256_finish failed: %d", rc);
-        free(buf);
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
-        mbedtls_sha256_free(&sha_ctx);
-        return ESP_FAIL;
-    }
+    mbedtls_sha256_finish(&sha_ctx, actual_hash);
     mbedtls_sha256_free(&sha_ctx);
+    free(buf);
     esp_http_client_close(client);
     esp_http_client_cleanup(client);
 
-    if (err != ESP_OK || (content_length >= 0 && total != content_length)) {
-        free(buf);
-        return (err != ESP_OK) ? err : ESP_ERR_HTTP_WRITE_DATA;
+    if (err == ESP_OK && content_length > 0 && total != (size_t)content_length) {
+        err = ESP_ERR_HTTP_WRITE_DATA;
     }
-    if (memcmp(actual_hash, expected_hash, sizeof(expected_hash)) != 0) {
-        free(buf);
-        return ESP_ERR_INVALID_RESPONSE;
+    if (err == ESP_OK && memcmp(actual_hash, expected_hash, sizeof(expected_hash)) != 0) {
+        err = ESP_ERR_INVALID_RESPONSE;
     }
-
-    *data = buf;
-    *len = total;
-    ESP_LOGI(TAG, "Downloaded %d bytes from %s", (int)total, url);
-    return ESP_OK;
+    return err;
 }
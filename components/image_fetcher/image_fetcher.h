@@ -1,9 +1,34 @@
 #pragma once
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
 
 esp_err_t image_fetch_http_to_sd(const char *url, const char *dest_path);
 
+/**
+ * @brief Download a file to the SD card and check it against a known hash.
+ *
+ * Same as image_fetch_http_to_sd() but the `X-File-SHA256` header becomes
+ * optional: the payload must match @p expected_sha256, and the header, when
+ * the server sends one, must agree with it.
+ *
+ * @param url             HTTP URL of the file to download
+ * @param dest_path       Destination path on the SD card
+ * @param expected_sha256 Raw 32-byte SHA-256 the payload must match
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_RESPONSE on hash mismatch, or
+ *         another error code on failure.
+ */
+esp_err_t image_fetch_http_to_sd_verified(const char *url, const char *dest_path,
+                                          const uint8_t expected_sha256[32]);
+
+/**
+ * @brief Decode a 64-character hex SHA-256 string into 32 raw bytes.
+ *
+ * Whitespace around the digits is ignored.
+ */
+esp_err_t image_fetch_parse_sha256(const char *hash_hex, uint8_t out[32]);
+
 /**
  * @brief Download an image over HTTP into PSRAM.
  *
@@ -20,3 +45,33 @@ esp_err_t image_fetch_http_to_sd(const char *url, const char *dest_path);
  * @note The caller is responsible for calling free() on *data when done.
  */
 esp_err_t image_fetch_http_to_psram(const char *url, uint8_t **data, size_t *len);
+
+/**
+ * @brief Download a file into PSRAM and check it against a known hash.
+ *
+ * Same as image_fetch_http_to_psram() but, as for
+ * image_fetch_http_to_sd_verified(), the `X-File-SHA256` header becomes
+ * optional and the payload must match @p expected_sha256.
+ */
+esp_err_t image_fetch_http_to_psram_verified(const char *url, const uint8_t expected_sha256[32],
+                                             uint8_t **data, size_t *len);
+
+/**
+ * @brief Consumer of image_fetch_http_stream() data; a non-ESP_OK return
+ * aborts the transfer.
+ */
+typedef esp_err_t (*image_fetch_sink_t)(const uint8_t *data, size_t len, void *arg);
+
+/**
+ * @brief Download a file and hand every chunk to @p sink as it arrives.
+ *
+ * Nothing is buffered beyond one read. The SHA-256 (header and/or
+ * @p expected_sha256, which may be NULL) is checked at the end: the caller
+ * must treat what it received as provisional until this returns ESP_OK.
+ *
+ * @return ESP_OK when the whole body was received and matches the hash,
+ *         ESP_ERR_INVALID_RESPONSE on mismatch, the sink's error, or another
+ *         error code on failure.
+ */
+esp_err_t image_fetch_http_stream(const char *url, const uint8_t expected_sha256[32],
+                                  image_fetch_sink_t sink, void *arg);
@@ -0,0 +1,28 @@
+#pragma once
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include <stdint.h>
+
+/* Helpers shared by the fetcher sources; not part of the public API. */
+
+extern const char cert_pem_start[] asm("_binary_cert_pem_start");
+
+#define SHA256_HEADER "X-File-SHA256"
+/* Room for the 64 hex digits plus stray whitespace */
+#define SHA256_HEADER_MAX 72
+
+#ifndef ESP_ERR_HTTP_STATUS
+#define ESP_ERR_HTTP_STATUS (ESP_ERR_HTTP_BASE + 0x0F)
+#endif
+#ifndef ESP_ERR_HTTP_FETCH_HEADER
+#define ESP_ERR_HTTP_FETCH_HEADER (ESP_ERR_HTTP_BASE + 0x07)
+#endif
+
+/**
+ * @brief Work out the hash a response body must match.
+ *
+ * @p hash_hex is the `X-File-SHA256` response header, NULL or empty when the
+ * server did not send it. @p expected, when not NULL, is used if the header
+ * is missing and must agree with it otherwise.
+ */
+esp_err_t image_fetch_resolve_hash(const char *hash_hex, const uint8_t *expected, uint8_t out[32]);
@@ -0,0 +1,582 @@
+#include "image_sync.h"
+#include "image_fetcher.h"
+#include "download_pool.h"
+#include "cJSON.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mbedtls/sha256.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *TAG = "image_sync";
+
+#define INDEX_NAME    ".index"
+#define INDEX_TMP     ".index.tmp"
+#define JOURNAL_NAME  ".journal"
+#define PART_SUFFIX   ".part"
+#define RESUME_SUFFIX ".dl" /* download_pool's resume state, next to the .part */
+#define HASH_CHUNK    4096
+#define PATH_LEN      (IMAGE_SYNC_NAME_MAX + 96)
+
+typedef struct {
+    image_manifest_entry_t *items;
+    size_t count;
+    size_t cap;
+} entry_list_t;
+
+static int entry_cmp(const void *a, const void *b)
+{
+    const image_manifest_entry_t *ea = a;
+    const image_manifest_entry_t *eb = b;
+    return strcmp(ea->name, eb->name);
+}
+
+static const image_manifest_entry_t *entry_find(const image_manifest_entry_t *items, size_t count,
+                                                const char *name)
+{
+    image_manifest_entry_t key;
+    if (strlcpy(key.name, name, sizeof(key.name)) >= sizeof(key.name)) {
+        return NULL; /* too long to be listed */
+    }
+    return bsearch(&key, items, count, sizeof(*items), entry_cmp);
+}
+
+static esp_err_t entry_list_push(entry_list_t *list, const image_manifest_entry_t *e)
+{
+    if (list->count == list->cap) {
+        size_t new_cap = list->cap ? list->cap * 2 : 32;
+        image_manifest_entry_t *tmp = heap_caps_realloc(list->items, new_cap * sizeof(*tmp),
+                                                        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!tmp) {
+            return ESP_ERR_NO_MEM;
+        }
+        list->items = tmp;
+        list->cap = new_cap;
+    }
+    list->items[list->count++] = *e;
+    return ESP_OK;
+}
+
+/* Names end up in FAT paths, so only accept plain file names. */
+static bool name_is_safe(const char *name)
+{
+    size_t n = strlen(name);
+    if (n == 0 || n >= IMAGE_SYNC_NAME_MAX || name[0] == '.') {
+        return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)name[i];
+        if (!(isalnum(c) || c == '_' || c == '-' || c == '.' || c == ' ')) {
+            return false;
+        }
+    }
+    return strstr(name, "..") == NULL;
+}
+
+static void sha_to_hex(const uint8_t sha[32], char out[65])
+{
+    static const char hex[] = "0123456789abcdef";
+    for (int i = 0; i < 32; ++i) {
+        out[2 * i] = hex[sha[i] >> 4];
+        out[2 * i + 1] = hex[sha[i] & 0x0F];
+    }
+    out[64] = '\0';
+}
+
+static esp_err_t manifest_parse(const char *json, size_t len, const char *url, image_manifest_t *out)
+{
+    cJSON *root = cJSON_ParseWithLength(json, len);
+    if (!root) {
+        ESP_LOGE(TAG, "Manifest is not valid JSON");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    esp_err_t err = ESP_OK;
+    entry_list_t list = {0};
+
+    const cJSON *base = cJSON_GetObjectItemCaseSensitive(root, "base_url");
+    if (cJSON_IsString(base) && base->valuestring[0] != '\0') {
+        strlcpy(out->base_url, base->valuestring, sizeof(out->base_url));
+    } else {
+        /* Files live next to the manifest */
+        const char *slash = strrchr(url, '/');
+        size_t n = slash ? (size_t)(slash - url + 1) : strlen(url);
+        if (n >= sizeof(out->base_url)) {
+            n = sizeof(out->base_url) - 1;
+        }
+        memcpy(out->base_url, url, n);
+        out->base_url[n] = '\0';
+    }
+
+    const cJSON *files = cJSON_GetObjectItemCaseSensitive(root, "files");
+    if (!cJSON_IsArray(files)) {
+        ESP_LOGE(TAG, "Manifest has no \"files\" array");
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    const cJSON *item;
+    cJSON_ArrayForEach(item, files) {
+        const cJSON *name = cJSON_GetObjectItemCaseSensitive(item, "name");
+        const cJSON *size = cJSON_GetObjectItemCaseSensitive(item, "size");
+        const cJSON *sha = cJSON_GetObjectItemCaseSensitive(item, "sha256");
+        if (!cJSON_IsString(name) || !cJSON_IsNumber(size) || !cJSON_IsString(sha)) {
+            ESP_LOGW(TAG, "Skipping malformed manifest entry");
+            continue;
+        }
+        if (!name_is_safe(name->valuestring) || size->valuedouble < 0) {
+            ESP_LOGW(TAG, "Skipping unsafe entry \"%s\"", name->valuestring);
+            continue;
+        }
+        image_manifest_entry_t e = {0};
+        strlcpy(e.name, name->valuestring, sizeof(e.name));
+        e.size = (uint32_t)size->valuedouble;
+        if (image_fetch_parse_sha256(sha->valuestring, e.sha256) != ESP_OK) {
+            ESP_LOGW(TAG, "Bad sha256 for \"%s\"", e.name);
+            continue;
+        }
+        err = entry_list_push(&list, &e);
+        if (err != ESP_OK) {
+            break;
+        }
+    }
+    cJSON_Delete(root);
+
+    if (err != ESP_OK) {
+        free(list.items);
+        return err;
+    }
+    if (list.count > 1) {
+        qsort(list.items, list.count, sizeof(*list.items), entry_cmp);
+    }
+    out->entries = list.items;
+    out->count = list.count;
+    return ESP_OK;
+}
+
+esp_err_t image_manifest_fetch(const char *url, image_manifest_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    uint8_t *data = NULL;
+    size_t len = 0;
+    esp_err_t err = image_fetch_http_to_psram(url, &data, &len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Manifest download failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = manifest_parse((const char *)data, len, url, out);
+    free(data);
+    return err;
+}
+
+void image_manifest_free(image_manifest_t *manifest)
+{
+    if (!manifest) {
+        return;
+    }
+    free(manifest->entries);
+    manifest->entries = NULL;
+    manifest->count = 0;
+}
+
+esp_err_t image_manifest_entry_url(const image_manifest_t *manifest,
+                                   const image_manifest_entry_t *entry,
+                                   char *out, size_t out_len)
+{
+    size_t n = strlen(manifest->base_url);
+    const char *sep = (n > 0 && manifest->base_url[n - 1] == '/') ? "" : "/";
+    int written = snprintf(out, out_len, "%s%s%s", manifest->base_url, sep, entry->name);
+    if (written < 0 || (size_t)written >= out_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+/* Index and journal share the same line format: "<sha256 hex> <size> <name>". */
+static void index_load(const char *path, entry_list_t *list)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return;
+    }
+    char line[IMAGE_SYNC_NAME_MAX + 96];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char hex[65];
+        unsigned long size;
+        int name_pos = 0;
+        if (sscanf(line, "%64s %lu %n", hex, &size, &name_pos) != 2 || name_pos == 0) {
+            continue;
+        }
+        image_manifest_entry_t e = {0};
+        if (image_fetch_parse_sha256(hex, e.sha256) != ESP_OK ||
+            !name_is_safe(line + name_pos)) {
+            continue;
+        }
+        strlcpy(e.name, line + name_pos, sizeof(e.name));
+        e.size = (uint32_t)size;
+        if (entry_list_push(list, &e) != ESP_OK) {
+            break;
+        }
+    }
+    fclose(f);
+}
+
+static int index_write_line(FILE *f, const image_manifest_entry_t *e)
+{
+    char hex[65];
+    sha_to_hex(e->sha256, hex);
+    return fprintf(f, "%s %" PRIu32 " %s\n", hex, e->size, e->name);
+}
+
+static bool file_has_size(const char *path, uint32_t size)
+{
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode) && (uint32_t)st.st_size == size;
+}
+
+static bool file_has_sha256(const char *path, const uint8_t sha256[32])
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf = malloc(HASH_CHUNK);
+    if (!f || !buf) {
+        if (f) {
+            fclose(f);
+        }
+        free(buf);
+        return false;
+    }
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    size_t n;
+    while ((n = fread(buf, 1, HASH_CHUNK, f)) > 0) {
+        mbedtls_sha256_update(&ctx, buf, n);
+    }
+    bool ok = !ferror(f);
+    uint8_t actual[32];
+    mbedtls_sha256_finish(&ctx, actual);
+    mbedtls_sha256_free(&ctx);
+    fclose(f);
+    free(buf);
+    return ok && memcmp(actual, sha256, sizeof(actual)) == 0;
+}
+
+/* A download whose final rename failed left a complete `<path>.part`, with
+ * no resume state since the pool closed it. Finish the rename instead of
+ * fetching the file again. */
+static bool part_promote(const char *path, const image_manifest_entry_t *e)
+{
+    char part[PATH_LEN + sizeof(PART_SUFFIX RESUME_SUFFIX)];
+    struct stat st;
+    snprintf(part, sizeof(part), "%s%s", path, PART_SUFFIX RESUME_SUFFIX);
+    if (stat(part, &st) == 0) {
+        return false;
+    }
+    snprintf(part, sizeof(part), "%s%s", path, PART_SUFFIX);
+    if (!file_has_size(part, e->size) || !file_has_sha256(part, e->sha256)) {
+        return false;
+    }
+    remove(path);
+    return rename(part, path) == 0;
+}
+
+static bool entry_matches(const image_manifest_entry_t *a, const image_manifest_entry_t *b)
+{
+    return a->size == b->size && memcmp(a->sha256, b->sha256, sizeof(a->sha256)) == 0;
+}
+
+static size_t remove_orphans(const char *album_dir, const image_manifest_t *m)
+{
+    DIR *dir = opendir(album_dir);
+    if (!dir) {
+        return 0;
+    }
+    size_t removed = 0;
+    struct dirent *entry;
+    char path[PATH_LEN];
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG || entry->d_name[0] == '.') {
+            continue;
+        }
+        /* Partial downloads (`<name>.part` and its `.part.dl` resume state)
+         * are kept while the manifest still lists <name>. */
+        char base[IMAGE_SYNC_NAME_MAX + sizeof(PART_SUFFIX RESUME_SUFFIX) - 1];
+        strlcpy(base, entry->d_name, sizeof(base));
+        char *part = strstr(base, PART_SUFFIX);
+        if (part && (strcmp(part, PART_SUFFIX) == 0 ||
+                     strcmp(part, PART_SUFFIX RESUME_SUFFIX) == 0)) {
+            *part = '\0';
+        }
+        if (entry_find(m->entries, m->count, base)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", album_dir, entry->d_name);
+        if (remove(path) == 0) {
+            ESP_LOGI(TAG, "Removed %s", path);
+            removed++;
+        }
+    }
+    closedir(dir);
+    return removed;
+}
+
+typedef struct {
+    SemaphoreHandle_t lock; /* guards journal, present, stats and pending */
+    SemaphoreHandle_t done; /* given when pending drops to 0 */
+    size_t pending;         /* jobs in flight, plus 1 while submitting */
+    FILE *journal;
+    bool *present;
+    image_sync_stats_t *stats;
+} sync_ctx_t;
+
+typedef struct {
+    sync_ctx_t *ctx;
+    const image_manifest_entry_t *entry;
+    size_t index;
+    char path[PATH_LEN];
+} sync_job_t;
+
+static void sync_job_done(esp_err_t result, size_t bytes, void *arg)
+{
+    sync_job_t *job = arg;
+    sync_ctx_t *ctx = job->ctx;
+    char tmp_path[PATH_LEN + sizeof(PART_SUFFIX)];
+    snprintf(tmp_path, sizeof(tmp_path), "%s%s", job->path, PART_SUFFIX);
+    if (result == ESP_OK) {
+        /* FatFs refuses to rename over an existing file */
+        remove(job->path);
+        if (rename(tmp_path, job->path) != 0) {
+            /* Keep the verified .part: the next sync renames it */
+            ESP_LOGE(TAG, "rename %s failed: %d", tmp_path, errno);
+            result = ESP_FAIL;
+        }
+    }
+
+    xSemaphoreTake(ctx->lock, portMAX_DELAY);
+    if (result != ESP_OK) {
+        ESP_LOGW(TAG, "Fetching %s failed: %s", job->entry->name, esp_err_to_name(result));
+        ctx->stats->failed++;
+    } else {
+        ctx->present[job->index] = true;
+        ctx->stats->downloaded++;
+        ctx->stats->bytes += bytes;
+        if (ctx->journal) {
+            index_write_line(ctx->journal, job->entry);
+            fflush(ctx->journal);
+            fsync(fileno(ctx->journal));
+        }
+    }
+    bool last = --ctx->pending == 0;
+    xSemaphoreGive(ctx->lock);
+    if (last) {
+        xSemaphoreGive(ctx->done);
+    }
+}
+
+esp_err_t image_sync_album(const char *manifest_url, const char *album_dir,
+                           image_sync_stats_t *stats)
+{
+    image_sync_stats_t st = {0};
+    image_manifest_t manifest;
+    esp_err_t err = image_manifest_fetch(manifest_url, &manifest);
+    if (err != ESP_OK) {
+        return err;
+    }
+    st.total = manifest.count;
+
+    struct stat dir_st;
+    if (stat(album_dir, &dir_st) != 0 && mkdir(album_dir, 0775) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "mkdir %s failed: %d", album_dir, errno);
+        image_manifest_free(&manifest);
+        return ESP_FAIL;
+    }
+
+    char index_path[PATH_LEN];
+    char journal_path[PATH_LEN];
+    char tmp_path[PATH_LEN];
+    snprintf(index_path, sizeof(index_path), "%s/" INDEX_NAME, album_dir);
+    snprintf(journal_path, sizeof(journal_path), "%s/" JOURNAL_NAME, album_dir);
+
+    /* The journal holds downloads completed by an interrupted run; entries
+     * found there take precedence over the older index. */
+    entry_list_t journal = {0};
+    entry_list_t local = {0};
+    index_load(journal_path, &journal);
+    index_load(index_path, &local);
+    if (local.count == 0) {
+        /* A crash between removing the old index and renaming the new one
+         * leaves only the temporary copy behind. */
+        snprintf(tmp_path, sizeof(tmp_path), "%s/" INDEX_TMP, album_dir);
+        index_load(tmp_path, &local);
+    }
+    if (journal.count > 0) {
+        ESP_LOGI(TAG, "Resuming sync, %u file(s) already journaled", (unsigned)journal.count);
+    }
+    if (journal.count > 1) {
+        qsort(journal.items, journal.count, sizeof(*journal.items), entry_cmp);
+    }
+    if (local.count > 1) {
+        qsort(local.items, local.count, sizeof(*local.items), entry_cmp);
+    }
+
+    FILE *jf = fopen(journal_path, "a");
+    if (!jf) {
+        ESP_LOGW(TAG, "Cannot open journal, progress will not be resumable");
+    }
+
+    bool *present = calloc(manifest.count ? manifest.count : 1, sizeof(bool));
+    if (!present) {
+        if (jf) {
+            fclose(jf);
+        }
+        free(journal.items);
+        free(local.items);
+        image_manifest_free(&manifest);
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Downloads run concurrently on the pool; completions land in
+     * sync_job_done() on the worker tasks. */
+    sync_ctx_t ctx = {
+        .lock = xSemaphoreCreateMutex(),
+        .done = xSemaphoreCreateBinary(),
+        .pending = 1,
+        .journal = jf,
+        .present = present,
+        .stats = &st,
+    };
+    sync_job_t *jobs = calloc(manifest.count ? manifest.count : 1, sizeof(*jobs));
+    if (!ctx.lock || !ctx.done || !jobs) {
+        if (ctx.lock) {
+            vSemaphoreDelete(ctx.lock);
+        }
+        if (ctx.done) {
+            vSemaphoreDelete(ctx.done);
+        }
+        free(jobs);
+        free(present);
+        if (jf) {
+            fclose(jf);
+        }
+        free(journal.items);
+        free(local.items);
+        image_manifest_free(&manifest);
+        return ESP_ERR_NO_MEM;
+    }
+
+    char path[PATH_LEN];
+    char url[IMAGE_SYNC_URL_MAX + IMAGE_SYNC_NAME_MAX];
+    for (size_t i = 0; i < manifest.count; ++i) {
+        const image_manifest_entry_t *e = &manifest.entries[i];
+        snprintf(path, sizeof(path), "%s/%s", album_dir, e->name);
+
+        const image_manifest_entry_t *known = entry_find(journal.items, journal.count, e->name);
+        if (!known) {
+            known = entry_find(local.items, local.count, e->name);
+        }
+        if (known && entry_matches(known, e) && file_has_size(path, e->size)) {
+            present[i] = true;
+            st.skipped++;
+            continue;
+        }
+        if (part_promote(path, e)) {
+            xSemaphoreTake(ctx.lock, portMAX_DELAY);
+            present[i] = true;
+            st.downloaded++;
+            if (jf) {
+                index_write_line(jf, e);
+                fflush(jf);
+                fsync(fileno(jf));
+            }
+            xSemaphoreGive(ctx.lock);
+            continue;
+        }
+
+        if (image_manifest_entry_url(&manifest, e, url, sizeof(url)) != ESP_OK) {
+            xSemaphoreTake(ctx.lock, portMAX_DELAY);
+            st.failed++;
+            xSemaphoreGive(ctx.lock);
+            continue;
+        }
+        sync_job_t *job = &jobs[i];
+        job->ctx = &ctx;
+        job->entry = e;
+        job->index = i;
+        strlcpy(job->path, path, sizeof(job->path));
+        snprintf(tmp_path, sizeof(tmp_path), "%s%s", path, PART_SUFFIX);
+        xSemaphoreTake(ctx.lock, portMAX_DELAY);
+        ctx.pending++;
+        xSemaphoreGive(ctx.lock);
+        err = dl_pool_submit(url, tmp_path, e->sha256, 0, sync_job_done, job);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Queueing %s failed: %s", e->name, esp_err_to_name(err));
+            xSemaphoreTake(ctx.lock, portMAX_DELAY);
+            ctx.pending--;
+            st.failed++;
+            xSemaphoreGive(ctx.lock);
+        }
+    }
+    /* Wait for this album's downloads only, not for the whole pool */
+    xSemaphoreTake(ctx.lock, portMAX_DELAY);
+    bool last = --ctx.pending == 0;
+    xSemaphoreGive(ctx.lock);
+    if (!last) {
+        xSemaphoreTake(ctx.done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(ctx.lock);
+    vSemaphoreDelete(ctx.done);
+    free(jobs);
+    if (jf) {
+        fclose(jf);
+    }
+    free(journal.items);
+    free(local.items);
+
+    st.removed = remove_orphans(album_dir, &manifest);
+
+    /* Rewrite the index atomically, then drop the journal it supersedes */
+    snprintf(tmp_path, sizeof(tmp_path), "%s/" INDEX_TMP, album_dir);
+    FILE *f = fopen(tmp_path, "w");
+    if (f) {
+        bool ok = true;
+        for (size_t i = 0; i < manifest.count && ok; ++i) {
+            if (present[i]) {
+                ok = index_write_line(f, &manifest.entries[i]) > 0;
+            }
+        }
+        ok = (fclose(f) == 0) && ok;
+        if (!ok) {
+            /* The old index and the journal still describe the album */
+            ESP_LOGE(TAG, "Index write failed, journal kept");
+            remove(tmp_path);
+        } else {
+            /* FatFs refuses to rename over an existing file. Should the
+             * rename fail, the next sync loads the temporary copy instead. */
+            remove(index_path);
+            if (rename(tmp_path, index_path) == 0) {
+                remove(journal_path);
+            } else {
+                ESP_LOGE(TAG, "rename %s failed: %d, journal kept", tmp_path, errno);
+            }
+        }
+    }
+    free(present);
+    image_manifest_free(&manifest);
+
+    ESP_LOGI(TAG, "Sync of %s: %u listed, %u fetched, %u up to date, %u removed, %u failed",
+             album_dir, (unsigned)st.total, (unsigned)st.downloaded, (unsigned)st.skipped,
+             (unsigned)st.removed, (unsigned)st.failed);
+    if (stats) {
+        *stats = st;
+    }
+    return st.failed ? ESP_FAIL : ESP_OK;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IMAGE_SYNC_NAME_MAX 64
+#define IMAGE_SYNC_URL_MAX  256
+
+/** One file listed by the remote manifest. */
+typedef struct {
+    char name[IMAGE_SYNC_NAME_MAX];
+    uint32_t size;
+    uint8_t sha256[32];
+} image_manifest_entry_t;
+
+/** Parsed remote manifest. Entries are kept sorted by name. */
+typedef struct {
+    image_manifest_entry_t *entries;
+    size_t count;
+    char base_url[IMAGE_SYNC_URL_MAX];
+} image_manifest_t;
+
+typedef struct {
+    size_t total;      /*!< Files listed by the manifest */
+    size_t downloaded; /*!< Files fetched during this run */
+    size_t skipped;    /*!< Files already up to date on the card */
+    size_t removed;    /*!< Local files no longer listed by the manifest */
+    size_t failed;     /*!< Files that could not be fetched */
+    uint64_t bytes;    /*!< Payload bytes downloaded */
+} image_sync_stats_t;
+
+/**
+ * @brief Download and parse an album manifest.
+ *
+ * The manifest is a JSON document of the form
+ * `{"base_url": "...", "files": [{"name": "a.png", "size": 1234,
+ * "sha256": "<64 hex chars>"}, ...]}`. `base_url` is optional; when absent,
+ * files are fetched relative to the manifest URL. The manifest itself is
+ * downloaded with image_fetch_http_to_psram() and therefore needs the
+ * `X-File-SHA256` header like any other file.
+ *
+ * @param url Manifest URL
+ * @param out Receives the parsed manifest, release it with image_manifest_free()
+ */
+esp_err_t image_manifest_fetch(const char *url, image_manifest_t *out);
+
+/**
+ * @brief Release the entries allocated by image_manifest_fetch().
+ */
+void image_manifest_free(image_manifest_t *manifest);
+
+/**
+ * @brief Build the download URL of a manifest entry.
+ */
+esp_err_t image_manifest_entry_url(const image_manifest_t *manifest,
+                                   const image_manifest_entry_t *entry,
+                                   char *out, size_t out_len);
+
+/**
+ * @brief Bring a local album in line with a remote manifest.
+ *
+ * Only files that are missing or whose size/SHA-256 differ from the local
+ * index (`<album>/.index`) are downloaded. Every completed download is
+ * appended to `<album>/.journal` so an interrupted sync resumes where it
+ * stopped; the journal is only dropped once the new index is in place. A
+ * verified download whose final rename failed stays as `<name>.part` and is
+ * renamed by the next sync. Files that the manifest no longer lists are
+ * deleted.
+ *
+ * @param manifest_url URL of the album manifest
+ * @param album_dir    Album directory on the SD card (created if missing)
+ * @param stats        Optional, receives the sync counters
+ *
+ * @return ESP_OK when the album matches the manifest, ESP_FAIL if some files
+ *         could not be fetched, or another error code if the manifest could
+ *         not be obtained.
+ */
+esp_err_t image_sync_album(const char *manifest_url, const char *album_dir,
+                           image_sync_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
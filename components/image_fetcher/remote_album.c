@@ -0,0 +1,298 @@
+#include "remote_album.h"
+#include "image_fetcher.h"
+#include "image_sync.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "trace.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PREFETCH_STACK 6144
+#define PREFETCH_STOP  SIZE_MAX
+#define NO_INDEX       SIZE_MAX
+
+static const char *TAG = "remote_album";
+
+typedef struct {
+    size_t index;
+    uint8_t *data;
+    size_t len;
+} album_slot_t;
+
+static image_manifest_t s_manifest;
+static bool s_open;
+/* s_lock guards the slots, s_fetch_lock serialises downloads so a request
+ * for the image being prefetched waits for it instead of fetching it twice. */
+static SemaphoreHandle_t s_lock;
+static SemaphoreHandle_t s_fetch_lock;
+static SemaphoreHandle_t s_exit_sem;
+static QueueHandle_t s_prefetch_queue;
+static album_slot_t s_previous = { .index = NO_INDEX };
+static album_slot_t s_current = { .index = NO_INDEX };
+static album_slot_t s_ahead = { .index = NO_INDEX };
+static size_t s_last_index = NO_INDEX;
+static uint32_t s_hits;
+static uint32_t s_misses;
+static remote_album_ready_cb_t s_ready_cb;
+
+static void slot_free(album_slot_t *slot)
+{
+    free(slot->data);
+    slot->data = NULL;
+    slot->len = 0;
+    slot->index = NO_INDEX;
+}
+
+static esp_err_t fetch_index(size_t index, album_slot_t *out)
+{
+    const image_manifest_entry_t *e = &s_manifest.entries[index];
+    char url[IMAGE_SYNC_URL_MAX + IMAGE_SYNC_NAME_MAX];
+    esp_err_t err = image_manifest_entry_url(&s_manifest, e, url, sizeof(url));
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = image_fetch_http_to_psram_verified(url, e->sha256, &out->data, &out->len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Fetching %s failed: %s", e->name, esp_err_to_name(err));
+        return err;
+    }
+    out->index = index;
+    return ESP_OK;
+}
+
+static void prefetch_task(void *arg)
+{
+    size_t index;
+    while (xQueueReceive(s_prefetch_queue, &index, portMAX_DELAY) == pdTRUE) {
+        if (index == PREFETCH_STOP) {
+            break;
+        }
+        TRACE_BEGIN("fetch_lock_wait");
+        xSemaphoreTake(s_fetch_lock, portMAX_DELAY);
+        TRACE_END("fetch_lock_wait");
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool have = s_ahead.index == index || s_current.index == index ||
+                    s_previous.index == index;
+        xSemaphoreGive(s_lock);
+        if (!have) {
+            album_slot_t slot = { .index = NO_INDEX };
+            if (fetch_index(index, &slot) == ESP_OK) {
+                xSemaphoreTake(s_lock, portMAX_DELAY);
+                slot_free(&s_ahead);
+                s_ahead = slot;
+                xSemaphoreGive(s_lock);
+                have = true;
+            }
+        }
+        xSemaphoreGive(s_fetch_lock);
+        remote_album_ready_cb_t cb = s_ready_cb;
+        if (have && cb) {
+            cb(index);
+        }
+    }
+    xSemaphoreGive(s_exit_sem);
+    vTaskDelete(NULL);
+}
+
+static void release_all(void)
+{
+    slot_free(&s_previous);
+    slot_free(&s_current);
+    slot_free(&s_ahead);
+    if (s_prefetch_queue) {
+        vQueueDelete(s_prefetch_queue);
+        s_prefetch_queue = NULL;
+    }
+    if (s_exit_sem) {
+        vSemaphoreDelete(s_exit_sem);
+        s_exit_sem = NULL;
+    }
+    if (s_fetch_lock) {
+        vSemaphoreDelete(s_fetch_lock);
+        s_fetch_lock = NULL;
+    }
+    if (s_lock) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+    }
+    image_manifest_free(&s_manifest);
+}
+
+esp_err_t remote_album_open(const char *manifest_url)
+{
+    remote_album_close();
+    esp_err_t err = image_manifest_fetch(manifest_url, &s_manifest);
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    s_fetch_lock = xSemaphoreCreateMutex();
+    s_exit_sem = xSemaphoreCreateBinary();
+    s_prefetch_queue = xQueueCreate(1, sizeof(size_t));
+    if (!s_lock || !s_fetch_lock || !s_exit_sem || !s_prefetch_queue) {
+        release_all();
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(prefetch_task, "img_prefetch", PREFETCH_STACK, NULL, 4, NULL) != pdPASS) {
+        release_all();
+        return ESP_ERR_NO_MEM;
+    }
+    s_hits = 0;
+    s_misses = 0;
+    s_last_index = NO_INDEX;
+    s_open = true;
+    ESP_LOGI(TAG, "Album of %u image(s) opened", (unsigned)s_manifest.count);
+    return ESP_OK;
+}
+
+void remote_album_close(void)
+{
+    if (!s_open) {
+        return;
+    }
+    size_t stop = PREFETCH_STOP;
+    xQueueOverwrite(s_prefetch_queue, &stop);
+    xSemaphoreTake(s_exit_sem, portMAX_DELAY);
+    ESP_LOGI(TAG, "Closed, %lu prefetch hit(s), %lu miss(es)", (unsigned long)s_hits,
+             (unsigned long)s_misses);
+    release_all();
+    s_open = false;
+}
+
+size_t remote_album_count(void)
+{
+    return s_open ? s_manifest.count : 0;
+}
+
+const char *remote_album_name(size_t index)
+{
+    return (s_open && index < s_manifest.count) ? s_manifest.entries[index].name : NULL;
+}
+
+/* Under s_lock: take the slot holding @p index, if any. */
+static bool take_cached(size_t index, album_slot_t *out)
+{
+    album_slot_t *candidates[] = { &s_ahead, &s_previous };
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+        if (candidates[i]->index == index) {
+            *out = *candidates[i];
+            candidates[i]->data = NULL;
+            candidates[i]->index = NO_INDEX;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Neighbour of @p index in the direction the user is moving. */
+static size_t next_index(size_t from, size_t index)
+{
+    size_t count = s_manifest.count;
+    if (from != NO_INDEX && (from + count - 1) % count == index) {
+        return (index + count - 1) % count;
+    }
+    return (index + 1) % count;
+}
+
+static void queue_prefetch(size_t from, size_t index)
+{
+    size_t next = next_index(from, index);
+    if (next != index) {
+        xQueueOverwrite(s_prefetch_queue, &next);
+    }
+}
+
+static esp_err_t album_get(size_t index, bool fetch, const uint8_t **data, size_t *len)
+{
+    if (!s_open || index >= s_manifest.count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_current.index == index) {
+        *data = s_current.data;
+        *len = s_current.len;
+        xSemaphoreGive(s_lock);
+        return ESP_OK;
+    }
+    size_t from = s_last_index;
+    album_slot_t slot = { .index = NO_INDEX };
+    bool cached = take_cached(index, &slot);
+    xSemaphoreGive(s_lock);
+
+    if (!cached) {
+        /* Possibly being prefetched right now: wait for it, then look again */
+        xSemaphoreTake(s_fetch_lock, portMAX_DELAY);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        cached = take_cached(index, &slot);
+        xSemaphoreGive(s_lock);
+        esp_err_t err = cached ? ESP_OK : fetch ? fetch_index(index, &slot) : ESP_ERR_NOT_FOUND;
+        xSemaphoreGive(s_fetch_lock);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (cached) {
+        s_hits++;
+    } else {
+        s_misses++;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    slot_free(&s_previous);
+    s_previous = s_current;
+    s_current = slot;
+    s_last_index = index;
+    *data = s_current.data;
+    *len = s_current.len;
+    xSemaphoreGive(s_lock);
+
+    queue_prefetch(from, index);
+    return ESP_OK;
+}
+
+esp_err_t remote_album_get(size_t index, const uint8_t **data, size_t *len)
+{
+    return album_get(index, true, data, len);
+}
+
+esp_err_t remote_album_lookup(size_t index, const uint8_t **data, size_t *len)
+{
+    return album_get(index, false, data, len);
+}
+
+esp_err_t remote_album_source(size_t index, char *url, size_t url_len, const uint8_t **sha256)
+{
+    if (!s_open || index >= s_manifest.count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const image_manifest_entry_t *e = &s_manifest.entries[index];
+    *sha256 = e->sha256;
+    return image_manifest_entry_url(&s_manifest, e, url, url_len);
+}
+
+void remote_album_set_ready_cb(remote_album_ready_cb_t cb)
+{
+    s_ready_cb = cb;
+}
+
+void remote_album_prefetch(size_t index)
+{
+    if (s_open && index < s_manifest.count) {
+        xQueueOverwrite(s_prefetch_queue, &index);
+    }
+}
+
+void remote_album_shown(size_t index)
+{
+    if (!s_open || index >= s_manifest.count) {
+        return;
+    }
+    size_t from = s_last_index;
+    s_last_index = index;
+    s_misses++;
+    queue_prefetch(from, index);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Open a remote album for display straight from memory.
+ *
+ * Fetches the manifest (see image_manifest_fetch()). Images are then
+ * downloaded into PSRAM on demand and checked against the SHA-256 listed in
+ * the manifest; nothing is written to the SD card. A background task
+ * prefetches the image after the one being shown.
+ */
+esp_err_t remote_album_open(const char *manifest_url);
+
+/**
+ * @brief Stop the prefetch task and release every buffer.
+ */
+void remote_album_close(void);
+
+/** Number of images listed by the open album, 0 when none is open. */
+size_t remote_album_count(void);
+
+/** File name of image @p index, or NULL. */
+const char *remote_album_name(size_t index);
+
+/**
+ * @brief Get the verified PNG bytes of image @p index.
+ *
+ * Returns immediately when the image was prefetched, otherwise downloads it.
+ * Then queues the prefetch of the neighbour in the direction of travel.
+ *
+ * The buffer stays valid until the second following call, so the image
+ * currently on screen is never freed while the next one is being shown.
+ */
+esp_err_t remote_album_get(size_t index, const uint8_t **data, size_t *len);
+
+/**
+ * @brief Like remote_album_get() but never starts a download.
+ *
+ * Waits for a prefetch of @p index already in flight.
+ *
+ * @return ESP_ERR_NOT_FOUND when the image is not in memory
+ */
+esp_err_t remote_album_lookup(size_t index, const uint8_t **data, size_t *len);
+
+/**
+ * @brief URL and expected SHA-256 of image @p index, for callers that fetch
+ * it themselves (see image_fetch_http_stream()).
+ */
+esp_err_t remote_album_source(size_t index, char *url, size_t url_len, const uint8_t **sha256);
+
+/**
+ * @brief Report that image @p index was shown without remote_album_get(),
+ * so the neighbour gets prefetched.
+ */
+void remote_album_shown(size_t index);
+
+/**
+ * @brief Fetch image @p index in the background, e.g. to retry one that
+ * could not be shown. Replaces any prefetch not started yet.
+ */
+void remote_album_prefetch(size_t index);
+
+/** Called from the prefetch task once image @p index is in memory. */
+typedef void (*remote_album_ready_cb_t)(size_t index);
+
+/** Register @p cb for prefetch completions, NULL to stop. */
+void remote_album_set_ready_cb(remote_album_ready_cb_t cb);
+
+#ifdef __cplusplus
+}
+#endif
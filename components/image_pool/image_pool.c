@@ -0,0 +1,157 @@
+#include "image_pool.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#endif
+
+#define POOL_ALIGN     64 /* PSRAM cache line */
+#define POOL_MAX_SLABS 32
+/* Up to a quarter slab (icons, thumbnails): heap, not a pinned slab */
+#define POOL_MIN_FRACTION 4
+
+static const char *TAG = "image_pool";
+
+static uint8_t *s_base;
+static size_t s_slab_size;
+static uint32_t s_count;
+static uint32_t s_free_mask; /* bit i set: slab i is free */
+static image_pool_stats_t s_stats;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t image_pool_init(size_t slab_size, uint32_t count)
+{
+    if (s_base || count > POOL_MAX_SLABS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_slab_size = (slab_size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    if (count) {
+        s_base = heap_caps_aligned_alloc(POOL_ALIGN, s_slab_size * count,
+                                         MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_base) {
+            ESP_LOGE(TAG, "Cannot reserve %" PRIu32 " x %u bytes", count, (unsigned)s_slab_size);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_count = count;
+    s_free_mask = count == POOL_MAX_SLABS ? UINT32_MAX : (1u << count) - 1;
+    s_stats.slab_size = s_slab_size;
+    s_stats.slab_count = count;
+    ESP_LOGI(TAG, "%" PRIu32 " slabs of %u KB", count, (unsigned)(s_slab_size / 1024));
+    return ESP_OK;
+}
+
+bool image_pool_owns(const void *ptr)
+{
+    const uint8_t *p = ptr;
+    return s_base && p >= s_base && p < s_base + s_slab_size * s_count;
+}
+
+/* Heap allocation, counted in @p served or as a failure */
+static void *heap_alloc(size_t size, uint32_t *served)
+{
+    void *p = heap_caps_aligned_alloc(POOL_ALIGN, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    portENTER_CRITICAL(&s_lock);
+    if (p) {
+        (*served)++;
+    } else {
+        s_stats.failures++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (!p) {
+        ESP_LOGW(TAG, "No memory for %u bytes", (unsigned)size);
+    }
+    return p;
+}
+
+void *image_pool_alloc(size_t size)
+{
+    if (size <= s_slab_size / POOL_MIN_FRACTION) {
+        return heap_alloc(size, &s_stats.small);
+    }
+    if (size <= s_slab_size) {
+        portENTER_CRITICAL(&s_lock);
+        if (s_free_mask) {
+            uint32_t i = __builtin_ctz(s_free_mask);
+            s_free_mask &= ~(1u << i);
+            s_stats.allocs++;
+            if (++s_stats.slabs_used > s_stats.slabs_high_water) {
+                s_stats.slabs_high_water = s_stats.slabs_used;
+            }
+            uint32_t used = s_stats.slabs_used;
+            portEXIT_CRITICAL(&s_lock);
+            TRACE_COUNTER("pool_slabs", used);
+            return s_base + (size_t)i * s_slab_size;
+        }
+        portEXIT_CRITICAL(&s_lock);
+    }
+    return heap_alloc(size, &s_stats.fallbacks);
+}
+
+void image_pool_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    if (!image_pool_owns(ptr)) {
+        heap_caps_free(ptr);
+        return;
+    }
+    uint32_t i = ((uint8_t *)ptr - s_base) / s_slab_size;
+    portENTER_CRITICAL(&s_lock);
+    s_free_mask |= 1u << i;
+    uint32_t used = --s_stats.slabs_used;
+    portEXIT_CRITICAL(&s_lock);
+    TRACE_COUNTER("pool_slabs", used);
+}
+
+void image_pool_get_stats(image_pool_stats_t *stats)
+{
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+    stats->heap_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    stats->heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    stats->heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+}
+
+unsigned image_pool_heap_fragmentation(const image_pool_stats_t *stats)
+{
+    if (!stats->heap_free) {
+        return 0;
+    }
+    return (unsigned)(100 - (uint64_t)stats->heap_largest * 100 / stats->heap_free);
+}
+
+#ifdef ESP_PLATFORM
+static int cmd_pool(int argc, char **argv)
+{
+    image_pool_stats_t st;
+    image_pool_get_stats(&st);
+    printf("slabs: %" PRIu32 "/%" PRIu32 " used, high water %" PRIu32 ", %u KB each\n",
+           st.slabs_used, st.slab_count, st.slabs_high_water, (unsigned)(st.slab_size / 1024));
+    printf("allocs: %" PRIu32 " pooled, %" PRIu32 " small, %" PRIu32 " heap fallbacks, %" PRIu32
+           " failures\n",
+           st.allocs, st.small, st.fallbacks, st.failures);
+    printf("psram heap: %u KB free, largest block %u KB, low water %u KB, "
+           "fragmentation %u%%\n",
+           (unsigned)(st.heap_free / 1024), (unsigned)(st.heap_largest / 1024),
+           (unsigned)(st.heap_min_free / 1024), image_pool_heap_fragmentation(&st));
+    return 0;
+}
+
+esp_err_t image_pool_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "pool",
+        .help = "Image buffer pool and PSRAM heap statistics",
+        .hint = NULL,
+        .func = cmd_pool,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+#endif
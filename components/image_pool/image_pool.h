@@ -0,0 +1,68 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pool of full-screen image buffers.
+ *
+ * A few fixed-size slabs, sized for one decoded screen, are carved out of
+ * PSRAM in one piece at boot. Decoded images (LVGL's image cache and
+ * png_stream outputs) take a slab instead of a multi-megabyte heap block,
+ * so allocating one costs the same after days of image changes and the
+ * heap never has to find that much contiguous space again. Requests larger
+ * than a slab, or made while every slab is taken, fall back to the heap and
+ * are counted. Requests of a quarter slab or less (icons, small images) go
+ * straight to the heap, so they never hold a slab a screen image needs; a
+ * full-screen RGB565 frame, half a slab, still takes one.
+ */
+
+typedef struct {
+    size_t slab_size;
+    uint32_t slab_count;
+    uint32_t slabs_used;
+    uint32_t slabs_high_water;
+    uint32_t allocs;       /*!< Served by a slab */
+    uint32_t small;        /*!< Served by the heap: a quarter slab or less */
+    uint32_t fallbacks;    /*!< Served by the heap: too large or pool exhausted */
+    uint32_t failures;     /*!< Neither could serve the request */
+    size_t heap_free;      /*!< PSRAM heap, free bytes */
+    size_t heap_largest;   /*!< PSRAM heap, largest free block */
+    size_t heap_min_free;  /*!< PSRAM heap, low-water mark since boot */
+} image_pool_stats_t;
+
+/**
+ * @brief Reserve @p count slabs of @p slab_size bytes (at most 32).
+ *
+ * With @p count 0 the pool stays empty and every request goes to the heap.
+ */
+esp_err_t image_pool_init(size_t slab_size, uint32_t count);
+
+/** @brief Allocate @p size bytes, 64-byte aligned, from a slab or the heap. */
+void *image_pool_alloc(size_t size);
+
+/** @brief Release memory from image_pool_alloc(); NULL is ignored. */
+void image_pool_free(void *ptr);
+
+/** True when @p ptr is the start of a slab. */
+bool image_pool_owns(const void *ptr);
+
+void image_pool_get_stats(image_pool_stats_t *stats);
+
+/**
+ * @brief Fragmentation of the PSRAM heap in percent: the share of free
+ * memory that is not in the largest free block.
+ */
+unsigned image_pool_heap_fragmentation(const image_pool_stats_t *stats);
+
+/** Add the `pool` command to the esp_console REPL. */
+esp_err_t image_pool_console_register(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -13,9 +13,37 @@
  ******************************************************************************/
 #include "io_extension.h"  // Include IO_EXTENSION driver header for GPIO functions
 #include "config.h"
- 
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+/* Shadow registers not written to the chip yet */
+#define IO_EXTENSION_DIRTY_OUT  (1 << 0)
+#define IO_EXTENSION_DIRTY_PWM  (1 << 1)
+
+/* ADC filter: each sample moves the value 1/8 of the way (fixed point, 4 fraction bits) */
+#define IO_EXTENSION_ADC_EMA_SHIFT  3
+#define IO_EXTENSION_ADC_FRAC_BITS  4
+
+static const char *TAG = "io_ext";
+
 io_extension_obj_t IO_EXTENSION;  // Define the global IO_EXTENSION object
-
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_flush_timer;  // Writes the dirty registers one tick after the first change
+static esp_timer_handle_t s_adc_timer;    // Samples input and ADC registers in the background
+static bool s_flush_armed;
+static bool s_started;                    // Init done: the LCD and the touch driver both call it
+static volatile bool s_sampling;
+static uint32_t s_adc_ema;                // Filtered ADC value, IO_EXTENSION_ADC_FRAC_BITS fraction bits
+
+static uint8_t s_sample_in;
+static uint8_t s_sample_adc[2];
+static const i2c_bus_read_t s_sample_reads[] = {
+    {.reg = IO_EXTENSION_IO_INPUT_ADDR, .len = 1, .buf = &s_sample_in},
+    {.reg = IO_EXTENSION_ADC_ADDR, .len = 2, .buf = s_sample_adc},
+};
+
 /**
  * @brief Set the IO mode for the specified pins.
  * 
@@ -23,77 +51,249 @@ io_extension_obj_t IO_EXTENSION;  // Define the global IO_EXTENSION object
  * 
  * @param pin An 8-bit value where each bit represents a pin (0 = input, 1 = output).
  */
-void IO_EXTENSION_IO_Mode(uint8_t pin)
-{
-    uint8_t data[2] = {IO_EXTENSION_Mode, pin}; // Prepare the data to write to the mode register
-    // Write the 8-bit value to the IO mode register
-    ESP_ERROR_CHECK(DEV_I2C_Write_Nbyte(IO_EXTENSION.addr, data, 2));
-}
-
+esp_err_t IO_EXTENSION_IO_Mode(uint8_t pin)
+{
+    // Write the 8-bit value to the IO mode register
+    return i2c_bus_write_reg(IO_EXTENSION.dev, I2C_BUS_PRIO_NORMAL, IO_EXTENSION_Mode, pin);
+}
+
+/* Completion of a shadow register write: a failed register is written again with the next flush */
+static void write_done(esp_err_t err, void *arg)
+{
+    if (err != ESP_OK) {
+        portENTER_CRITICAL(&s_lock);
+        IO_EXTENSION.dirty |= (uint8_t)(uintptr_t)arg;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+/* Take the dirty shadow registers; the caller writes them */
+static uint8_t take_dirty(uint8_t *out, uint8_t *pwm)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint8_t dirty = IO_EXTENSION.dirty;
+    IO_EXTENSION.dirty = 0;
+    s_flush_armed = false;
+    *out = IO_EXTENSION.Last_io_value;
+    *pwm = IO_EXTENSION.Last_pwm_value;
+    portEXIT_CRITICAL(&s_lock);
+    return dirty;
+}
+
+static void flush_timer_cb(void *arg)
+{
+    uint8_t out, pwm;
+    uint8_t dirty = take_dirty(&out, &pwm);
+
+    // Every change made since the timer was armed goes out in one write per register
+    if (dirty & IO_EXTENSION_DIRTY_OUT) {
+        const uint8_t data[2] = {IO_EXTENSION_IO_OUTPUT_ADDR, out};
+        if (i2c_bus_write_async(IO_EXTENSION.dev, I2C_BUS_PRIO_NORMAL, data, sizeof(data), write_done,
+                                (void *)(uintptr_t)IO_EXTENSION_DIRTY_OUT) != ESP_OK) {
+            write_done(ESP_FAIL, (void *)(uintptr_t)IO_EXTENSION_DIRTY_OUT);
+        }
+    }
+    if (dirty & IO_EXTENSION_DIRTY_PWM) {
+        const uint8_t data[2] = {IO_EXTENSION_PWM_ADDR, pwm};
+        if (i2c_bus_write_async(IO_EXTENSION.dev, I2C_BUS_PRIO_NORMAL, data, sizeof(data), write_done,
+                                (void *)(uintptr_t)IO_EXTENSION_DIRTY_PWM) != ESP_OK) {
+            write_done(ESP_FAIL, (void *)(uintptr_t)IO_EXTENSION_DIRTY_PWM);
+        }
+    }
+}
+
+/* Mark @p flag dirty and arm the flush timer unless a flush is already pending */
+static void mark_dirty(uint8_t flag)
+{
+    bool arm = false;
+    portENTER_CRITICAL(&s_lock);
+    IO_EXTENSION.dirty |= flag;
+    if (!s_flush_armed) {
+        s_flush_armed = true;
+        arm = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (arm && s_flush_timer) {
+        esp_timer_start_once(s_flush_timer, portTICK_PERIOD_MS * 1000);
+    }
+}
+
+static void sample_done(esp_err_t err, void *arg)
+{
+    if (err == ESP_OK) {
+        uint32_t raw = s_sample_adc[1] << 8 | s_sample_adc[0];
+        portENTER_CRITICAL(&s_lock);
+        IO_EXTENSION.Last_in_value = s_sample_in;
+        if (!IO_EXTENSION.adc_valid) {
+            s_adc_ema = raw << IO_EXTENSION_ADC_FRAC_BITS;
+            IO_EXTENSION.adc_valid = true;
+        } else {
+            s_adc_ema += (int32_t)((raw << IO_EXTENSION_ADC_FRAC_BITS) - s_adc_ema) >>
+                         IO_EXTENSION_ADC_EMA_SHIFT;
+        }
+        IO_EXTENSION.adc_raw = raw;
+        IO_EXTENSION.adc_filtered = s_adc_ema >> IO_EXTENSION_ADC_FRAC_BITS;
+        portEXIT_CRITICAL(&s_lock);
+    }
+    // On error the cached values stay as they were until the next sample
+    s_sampling = false;
+}
+
+static void adc_timer_cb(void *arg)
+{
+    // Skip a period rather than queue a second sample behind a slow one
+    if (s_sampling) {
+        return;
+    }
+    s_sampling = true;
+    if (i2c_bus_read_batch_async(IO_EXTENSION.dev, I2C_BUS_PRIO_BACKGROUND, s_sample_reads,
+                                 sizeof(s_sample_reads) / sizeof(s_sample_reads[0]),
+                                 sample_done, NULL) != ESP_OK) {
+        s_sampling = false;
+    }
+}
+
 /**
  * @brief Initialize the IO_EXTENSION device.
  * 
- * This function configures the slave addresses for different registers of the
- * IO_EXTENSION chip via I2C, and sets the control flags for input/output modes.
+ * This function gets the IO_EXTENSION chip's device on the shared I2C bus,
+ * sets every pin to output, takes a first input/ADC sample and starts
+ * sampling them every CONFIG_IOEXT_ADC_PERIOD_MS. Calling it again before
+ * IO_EXTENSION_Deinit() does nothing, so the pin states set meanwhile stay.
  */
-void IO_EXTENSION_Init()
+esp_err_t IO_EXTENSION_Init()
 {
-    // Set the I2C slave address for the IO_EXTENSION device
-    DEV_I2C_Set_Slave_Addr(&IO_EXTENSION.addr, IO_EXTENSION_ADDR);
-
-    IO_EXTENSION_IO_Mode(0xff); // Set all pins to output mode
-
+    if (s_started) {
+        return ESP_OK;
+    }
+    // Get the shared bus device of the IO_EXTENSION chip
+    ESP_RETURN_ON_ERROR(i2c_bus_add_device(IO_EXTENSION_ADDR, 1, "io_ext", &IO_EXTENSION.dev),
+                        TAG, "IO extension not reachable");
+
     // Initialize control flags for IO output enable and open-drain output mode
+    portENTER_CRITICAL(&s_lock);
     IO_EXTENSION.Last_io_value = 0xFF; // All pins are initially set to high (output mode)
     IO_EXTENSION.Last_od_value = 0xFF; // All pins are initially set to high (open-drain mode)
+    IO_EXTENSION.dirty = 0;
+    IO_EXTENSION.adc_valid = false;
+    s_flush_armed = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!s_flush_timer) {
+        const esp_timer_create_args_t flush_args = {
+            .callback = flush_timer_cb,
+            .name = "ioext_flush",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&flush_args, &s_flush_timer), TAG, "flush timer");
+    }
+    if (!s_adc_timer) {
+        const esp_timer_create_args_t adc_args = {
+            .callback = adc_timer_cb,
+            .name = "ioext_adc",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&adc_args, &s_adc_timer), TAG, "ADC timer");
+    }
+
+    ESP_RETURN_ON_ERROR(IO_EXTENSION_IO_Mode(0xff), TAG, "mode write failed"); // Set all pins to output mode
+
+    // First sample now, so the cached values are valid before the first period ends
+    sample_done(i2c_bus_read_batch(IO_EXTENSION.dev, I2C_BUS_PRIO_NORMAL, s_sample_reads,
+                                   sizeof(s_sample_reads) / sizeof(s_sample_reads[0])), NULL);
+    esp_timer_stop(s_adc_timer);
+    ESP_RETURN_ON_ERROR(esp_timer_start_periodic(s_adc_timer, CONFIG_IOEXT_ADC_PERIOD_MS * 1000ULL),
+                        TAG, "ADC timer start");
+    s_started = true;
+    return ESP_OK;
 }
-
+
+/**
+ * @brief Stop background sampling and drop pending writes.
+ * 
+ * Call before the I2C bus service stops.
+ */
+void IO_EXTENSION_Deinit(void)
+{
+    if (s_adc_timer) {
+        esp_timer_stop(s_adc_timer);
+    }
+    if (s_flush_timer) {
+        esp_timer_stop(s_flush_timer);
+    }
+    uint8_t out, pwm;
+    take_dirty(&out, &pwm);
+    s_started = false;
+}
+
 /**
  * @brief Set the value of the IO output pins on the IO_EXTENSION device.
  * 
- * This function writes an 8-bit value to the IO output register. The value
- * determines the high or low state of the pins.
+ * This function updates the output shadow register. The register is written
+ * one tick later, together with every other pin and PWM change made in the
+ * meantime; use IO_EXTENSION_Flush() when the pin must change right away.
  * 
  * @param pin The pin number to set (0-7).
  * @param value The value to set on the specified pin (0 = low, 1 = high).
  */
-void IO_EXTENSION_Output(uint8_t pin, uint8_t value) 
+void IO_EXTENSION_Output(uint8_t pin, uint8_t value)
 {
     // Update the output value based on the pin and value
+    portENTER_CRITICAL(&s_lock);
     if (value == 1)
         IO_EXTENSION.Last_io_value |= (1 << pin); // Set the pin high
     else
         IO_EXTENSION.Last_io_value &= (~(1 << pin)); // Set the pin low
+    portEXIT_CRITICAL(&s_lock);
+
+    mark_dirty(IO_EXTENSION_DIRTY_OUT);
+}
+
+/**
+ * @brief Write the pending output and PWM changes now and wait.
+ * 
+ * @return ESP_OK, or the bus error; a register that failed stays pending.
+ */
+esp_err_t IO_EXTENSION_Flush(void)
+{
+    if (s_flush_timer) {
+        esp_timer_stop(s_flush_timer);
+    }
+    uint8_t out, pwm;
+    uint8_t dirty = take_dirty(&out, &pwm);
+    esp_err_t ret = ESP_OK;
+
+    if (dirty & IO_EXTENSION_DIRTY_OUT) {
+        esp_err_t err = i2c_bus_write_reg(IO_EXTENSION.dev, I2C_BUS_PRIO_NORMAL, IO_EXTENSION_IO_OUTPUT_ADDR, out);
+        write_done(err, (void *)(uintptr_t)IO_EXTENSION_DIRTY_OUT);
+        ret = err;
+    }
+    if (dirty & IO_EXTENSION_DIRTY_PWM) {
+        esp_err_t err = i2c_bus_write_reg(IO_EXTENSION.dev, I2C_BUS_PRIO_NORMAL, IO_EXTENSION_PWM_ADDR, pwm);
+        write_done(err, (void *)(uintptr_t)IO_EXTENSION_DIRTY_PWM);
+        ret = ret != ESP_OK ? ret : err;
+    }
+    return ret;
+}
 
-    uint8_t data[2] = {IO_EXTENSION_IO_OUTPUT_ADDR, IO_EXTENSION.Last_io_value}; // Prepare the data to write to the output register
-    // Write the 8-bit value to the IO output register
-    ESP_ERROR_CHECK(DEV_I2C_Write_Nbyte(IO_EXTENSION.addr, data, 2));
-}
-
 /**
  * @brief Read the value from the IO input pins on the IO_EXTENSION device.
  * 
- * This function reads the value of the IO input register and returns the state
- * of the specified pins.
+ * This function returns the state of the specified pin from the input
+ * register as of the last background sample; it does not touch the bus.
  * 
- * @param pin The bit mask to specify which pin to read (e.g., 0x01 for the first pin).
- * @return The value of the specified pin(s) (0 = low, 1 = high).
+ * @param pin The pin number to read (0-7).
+ * @return The value of the specified pin (0 = low, 1 = high).
  */
-uint8_t IO_EXTENSION_Input(uint8_t pin) 
+uint8_t IO_EXTENSION_Input(uint8_t pin)
 {
-    uint8_t value = 0;
-
-    // Read the value of the input pins
-    ESP_ERROR_CHECK(DEV_I2C_Read_Nbyte(IO_EXTENSION.addr, IO_EXTENSION_IO_INPUT_ADDR, &value, 1));
-    // Return the value of the specific pin(s) by masking with the provided bit mask
-    return ((value & (1 << pin)) > 0);
+    // Return the value of the specific pin by masking the cached register
+    return ((IO_EXTENSION.Last_in_value & (1 << pin)) > 0);
 }
-
+
 /**
  * @brief Set the PWM output value on the IO_EXTENSION device.
  * 
- * This function sets the PWM output value, which controls the duty cycle of the PWM signal.
- * The duty cycle is calculated based on the input value and the resolution (12 bits).
+ * This function updates the PWM shadow register, which controls the duty cycle of the PWM signal.
+ * It is written with the next flush, like IO_EXTENSION_Output().
  * 
  * @param Value PWM duty cycle percentage in the range [0, 100].
  */
@@ -103,31 +303,31 @@ void IO_EXTENSION_Pwm_Output(uint8_t Value)
     if (Value >= 97)
     {
         Value = 97;
-    }
-
-    uint8_t data[2] = {IO_EXTENSION_PWM_ADDR}; // Prepare the data to write to the PWM register
-    // Calculate the duty cycle based on the resolution (12 bits)
-    data[1] = Value * 255 / 100;
-    // Write the 8-bit value to the PWM output register
-    ESP_ERROR_CHECK(DEV_I2C_Write_Nbyte(IO_EXTENSION.addr, data, 2));
+    }
+
+    // Calculate the duty cycle based on the resolution (8 bits)
+    portENTER_CRITICAL(&s_lock);
+    IO_EXTENSION.Last_pwm_value = Value * 255 / 100;
+    portEXIT_CRITICAL(&s_lock);
+    mark_dirty(IO_EXTENSION_DIRTY_PWM);
 }
-
+
 /**
  * @brief Read the ADC input value from the IO_EXTENSION device.
  * 
- * This function reads the ADC input value from the IO_EXTENSION device.
+ * This function returns the filtered value of the background samples
+ * (see CONFIG_IOEXT_ADC_PERIOD_MS); it does not touch the bus.
  * 
- * @return The ADC input value.
+ * @return The filtered ADC input value, 0 before the first good sample.
  */
-uint16_t IO_EXTENSION_Adc_Input()
-{
-    // Read the ADC input value from the IO_EXTENSION device
-    uint16_t value = 0;
-    ESP_ERROR_CHECK(DEV_I2C_Read_Word(IO_EXTENSION.addr, IO_EXTENSION_ADC_ADDR, &value));
-    return value;
-}
+uint16_t IO_EXTENSION_Adc_Input()
+{
+    return IO_EXTENSION.adc_filtered;
+}
 
 void io_extension_lcd_vdd_enable(bool en)
-{
+{
+    // Panel power sequencing cannot wait for the next flush
     IO_EXTENSION_Output(CONFIG_IOEXT_LCD_VDD_EN, en ? 1 : 0);
-}
+    IO_EXTENSION_Flush();
+}
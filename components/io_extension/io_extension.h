@@ -18,6 +18,7 @@
  #define __IO_EXTENSION_H
  
  #include "i2c.h"  // Include I2C header for I2C communication functions
+ #include "i2c_bus.h"
  #include <stdbool.h>
  
  /* 
@@ -51,18 +52,26 @@
  
  /* Structure to represent the IO EXTENSION device */
  typedef struct _io_extension_obj_t {
-     i2c_master_dev_handle_t addr;      // Handle for mode configuration
-     uint8_t Last_io_value;
+     i2c_bus_dev_t dev;                 // Shared bus device at IO_EXTENSION_ADDR
+     uint8_t Last_io_value;             // Output register shadow
      uint8_t Last_od_value;
+     uint8_t Last_pwm_value;            // PWM register shadow
+     uint8_t Last_in_value;             // Input register, as of the last background sample
+     uint8_t dirty;                     // Shadow registers not written to the chip yet
+     bool adc_valid;                    // adc_filtered holds at least one sample
+     uint16_t adc_raw;                  // Last ADC sample
+     uint16_t adc_filtered;             // Filtered ADC value returned by IO_EXTENSION_Adc_Input()
  } io_extension_obj_t;
  
  
  /* Function declarations */
- void IO_EXTENSION_Init();                     // Initialize the IO_EXTENSION device
- void IO_EXTENSION_Output(uint8_t pin, uint8_t value);     // Set IO pin output (high/low)
- uint8_t IO_EXTENSION_Input(uint8_t pin);   // Read IO pin input state
- void IO_EXTENSION_Pwm_Output(uint8_t Value);
- uint16_t IO_EXTENSION_Adc_Input();
+ esp_err_t IO_EXTENSION_Init();                // Initialize the IO_EXTENSION device (bus service must run)
+ void IO_EXTENSION_Deinit(void);               // Stop background sampling before the bus stops
+ void IO_EXTENSION_Output(uint8_t pin, uint8_t value);     // Set IO pin output (high/low), written within one tick
+ esp_err_t IO_EXTENSION_Flush(void);           // Write pending output/PWM changes now
+ uint8_t IO_EXTENSION_Input(uint8_t pin);   // Cached IO pin input state
+ void IO_EXTENSION_Pwm_Output(uint8_t Value);
+ uint16_t IO_EXTENSION_Adc_Input();            // Cached, filtered ADC value
  void io_extension_lcd_vdd_enable(bool en);
  
  #endif  // __IO_EXTENSION_H
@@ -0,0 +1,188 @@
+#include "jobs.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "trace.h"
+
+#define JOBS_QUEUE_LEN   16
+#define JOBS_STACK_SIZE  3072
+/* Below the LVGL task, above app_main */
+#define JOBS_PRIORITY    4
+
+typedef struct {
+    job_fn_t fn;
+    void *arg;
+    job_group_t *group;
+} job_t;
+
+typedef struct {
+    portMUX_TYPE lock;
+    job_t ring[JOBS_QUEUE_LEN];
+    uint32_t head;
+    uint32_t count;
+    TaskHandle_t task;
+} worker_t;
+
+static const char *TAG = "JOBS";
+static worker_t s_workers[portNUM_PROCESSORS];
+static bool s_running;
+
+static bool pop(worker_t *w, job_t *job)
+{
+    bool got = false;
+    portENTER_CRITICAL(&w->lock);
+    if (w->count) {
+        *job = w->ring[w->head];
+        w->head = (w->head + 1) % JOBS_QUEUE_LEN;
+        w->count--;
+        got = true;
+    }
+    portEXIT_CRITICAL(&w->lock);
+    return got;
+}
+
+/* Own queue first, then steal from the others */
+static bool take(int core, job_t *job)
+{
+    if (pop(&s_workers[core], job)) {
+        return true;
+    }
+    for (int i = 1; i < portNUM_PROCESSORS; ++i) {
+        if (pop(&s_workers[(core + i) % portNUM_PROCESSORS], job)) {
+            TRACE_INSTANT("job_steal");
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run(const job_t *job)
+{
+    TRACE_BEGIN("job");
+    job->fn(job->arg);
+    TRACE_END("job");
+    job_group_t *g = job->group;
+    if (!g) {
+        return;
+    }
+    portENTER_CRITICAL(&g->lock);
+    bool last = --g->pending == 0;
+    portEXIT_CRITICAL(&g->lock);
+    if (last) {
+        xSemaphoreGive(g->done);
+    }
+}
+
+static void worker_task(void *arg)
+{
+    const int core = (int)(intptr_t)arg;
+    for (;;) {
+        job_t job;
+        if (take(core, &job)) {
+            run(&job);
+            continue;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+esp_err_t jobs_init(void)
+{
+    if (s_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        worker_t *w = &s_workers[i];
+        portMUX_INITIALIZE(&w->lock);
+        if (xTaskCreatePinnedToCore(worker_task, "jobs", JOBS_STACK_SIZE, (void *)(intptr_t)i,
+                                    JOBS_PRIORITY, &w->task, i) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start the worker of core %d", i);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_running = true;
+    ESP_LOGI(TAG, "%d workers started", portNUM_PROCESSORS);
+    return ESP_OK;
+}
+
+bool jobs_running(void)
+{
+    return s_running;
+}
+
+void jobs_group_init(job_group_t *group)
+{
+    group->pending = 0;
+    portMUX_INITIALIZE(&group->lock);
+    group->done = xSemaphoreCreateBinaryStatic(&group->done_buf);
+}
+
+void jobs_group_deinit(job_group_t *group)
+{
+    if (group->done) {
+        vSemaphoreDelete(group->done);
+        group->done = NULL;
+    }
+}
+
+void jobs_submit(job_group_t *group, int core, job_fn_t fn, void *arg)
+{
+    job_t job = { .fn = fn, .arg = arg, .group = group };
+    if (group) {
+        portENTER_CRITICAL(&group->lock);
+        group->pending++;
+        portEXIT_CRITICAL(&group->lock);
+    }
+    if (!s_running) {
+        run(&job);
+        return;
+    }
+    if (core < 0 || core >= portNUM_PROCESSORS) {
+        core = (xPortGetCoreID() + 1) % portNUM_PROCESSORS;
+    }
+    worker_t *w = &s_workers[core];
+    bool queued = false;
+    uint32_t backlog = 0;
+    portENTER_CRITICAL(&w->lock);
+    if (w->count < JOBS_QUEUE_LEN) {
+        backlog = w->count;
+        w->ring[(w->head + w->count) % JOBS_QUEUE_LEN] = job;
+        w->count++;
+        queued = true;
+    }
+    portEXIT_CRITICAL(&w->lock);
+    if (!queued) {
+        run(&job);
+        return;
+    }
+    xTaskNotifyGive(w->task);
+    if (backlog) {
+        /* The target is busy: let the other workers steal */
+        for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+            if (i != core) {
+                xTaskNotifyGive(s_workers[i].task);
+            }
+        }
+    }
+}
+
+void jobs_wait(job_group_t *group)
+{
+    const int core = xPortGetCoreID();
+    for (;;) {
+        portENTER_CRITICAL(&group->lock);
+        uint32_t pending = group->pending;
+        portEXIT_CRITICAL(&group->lock);
+        if (!pending) {
+            return;
+        }
+        job_t job;
+        if (s_running && take(core, &job)) {
+            run(&job);
+            continue;
+        }
+        /* A give left over from an earlier wait only costs one more loop */
+        TRACE_BEGIN("job_wait");
+        xSemaphoreTake(group->done, portMAX_DELAY);
+        TRACE_END("job_wait");
+    }
+}
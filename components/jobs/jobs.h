@@ -0,0 +1,61 @@
+#pragma once
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Work-stealing job system.
+ *
+ * One worker task is pinned to every core, each with a small bounded queue.
+ * A worker runs its own jobs first and steals the oldest job of another
+ * queue when it runs dry, so work submitted for a busy core still lands on
+ * whichever core is free. Jobs are short, non-blocking pieces of a larger
+ * computation (a band of rows to convert, say); a task waiting for its jobs
+ * runs queued ones itself instead of sleeping.
+ */
+
+/** Submit to the core the caller is not running on. */
+#define JOBS_OTHER_CORE (-1)
+
+typedef void (*job_fn_t)(void *arg);
+
+/** Set of jobs that can be waited for, see jobs_group_init(). */
+typedef struct {
+    uint32_t pending;
+    portMUX_TYPE lock;
+    SemaphoreHandle_t done;
+    StaticSemaphore_t done_buf;
+} job_group_t;
+
+/** @brief Start one worker per core. */
+esp_err_t jobs_init(void);
+
+/** True once jobs_init() succeeded; jobs run inline otherwise. */
+bool jobs_running(void);
+
+/** @brief Prepare @p group, which must not move afterwards. */
+void jobs_group_init(job_group_t *group);
+
+/** @brief Release @p group after jobs_wait(). */
+void jobs_group_deinit(job_group_t *group);
+
+/**
+ * @brief Queue fn(arg) on the worker of @p core (or JOBS_OTHER_CORE).
+ *
+ * Never blocks: when the queue is full or the workers are not running the
+ * job runs right away in the calling task.
+ */
+void jobs_submit(job_group_t *group, int core, job_fn_t fn, void *arg);
+
+/** @brief Wait for every job of @p group, running queued jobs meanwhile. */
+void jobs_wait(job_group_t *group);
+
+#ifdef __cplusplus
+}
+#endif
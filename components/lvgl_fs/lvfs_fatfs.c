@@ -1,6 +1,7 @@
 #include "lvgl.h"
 #include "lvfs_fatfs.h"
 #include "ff.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -43,7 +44,9 @@ static void * fs_open(lv_fs_drv_t * drv, const char * path, lv_fs_mode_t mode)
 static lv_fs_res_t fs_read(lv_fs_drv_t * drv, void * file_p, void * buf, uint32_t btr, uint32_t * br)
 {
     UINT br_tmp = 0;
+    TRACE_BEGIN("f_read");
     FRESULT res = f_read((FIL *)file_p, buf, btr, &br_tmp);
+    TRACE_END("f_read");
     if(br) *br = br_tmp;
     return res == FR_OK ? LV_FS_RES_OK : LV_FS_RES_FS_ERR;
 }
@@ -0,0 +1,280 @@
+#include "lvmem_tlsf.h"
+#include "esp_console.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "lvgl.h"
+#include "multi_heap.h"
+#include "sdkconfig.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LVMEM_ALARM_HYSTERESIS_PCT 10
+
+typedef struct {
+    const char *name;
+    uint8_t *base;
+    size_t size;
+    multi_heap_handle_t heap;
+    portMUX_TYPE lock;
+    bool alarmed;
+} lvmem_pool_t;
+
+static const char *TAG = "lvmem";
+
+static lvmem_pool_t s_internal = { .name = "internal", .lock = portMUX_INITIALIZER_UNLOCKED };
+static lvmem_pool_t s_psram = { .name = "psram", .lock = portMUX_INITIALIZER_UNLOCKED };
+static uint32_t s_spills;
+static uint32_t s_fallbacks;
+static uint32_t s_failures;
+static uint32_t s_alarms;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void count(uint32_t *field)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    (*field)++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+static bool pool_open(lvmem_pool_t *p, size_t size, uint32_t caps)
+{
+    p->base = heap_caps_malloc(size, caps);
+    if (!p->base) {
+        ESP_LOGE(TAG, "Cannot reserve %u KB of %s RAM", (unsigned)(size / 1024), p->name);
+        return false;
+    }
+    p->size = size;
+    p->heap = multi_heap_register(p->base, size);
+    if (!p->heap) {
+        heap_caps_free(p->base);
+        p->base = NULL;
+        return false;
+    }
+    /* The console reads the statistics while LVGL allocates */
+    multi_heap_set_lock(p->heap, &p->lock);
+    p->alarmed = false;
+    return true;
+}
+
+static void pool_close(lvmem_pool_t *p)
+{
+    heap_caps_free(p->base);
+    p->base = NULL;
+    p->heap = NULL;
+    p->size = 0;
+}
+
+static bool pool_owns(const lvmem_pool_t *p, const void *ptr)
+{
+    const uint8_t *b = ptr;
+    return p->heap && b >= p->base && b < p->base + p->size;
+}
+
+static void pool_check_alarm(lvmem_pool_t *p)
+{
+    size_t free_bytes = multi_heap_free_size(p->heap);
+    unsigned used_pct = (unsigned)(100 - (uint64_t)free_bytes * 100 / p->size);
+    if (!p->alarmed && used_pct >= CONFIG_LVGL_MEM_ALARM_PCT) {
+        p->alarmed = true;
+        count(&s_alarms);
+        TRACE_INSTANT("lvmem_alarm");
+        ESP_LOGW(TAG, "%s pool %u%% used, %u bytes free", p->name, used_pct,
+                 (unsigned)free_bytes);
+    } else if (p->alarmed && used_pct + LVMEM_ALARM_HYSTERESIS_PCT < CONFIG_LVGL_MEM_ALARM_PCT) {
+        p->alarmed = false;
+    }
+}
+
+static void *pool_malloc(lvmem_pool_t *p, size_t size)
+{
+    if (!p->heap) {
+        return NULL;
+    }
+    void *ptr = multi_heap_malloc(p->heap, size);
+    if (ptr) {
+        pool_check_alarm(p);
+    }
+    return ptr;
+}
+
+void lv_mem_init(void)
+{
+    if (!pool_open(&s_internal, CONFIG_LVGL_MEM_INTERNAL_KB * 1024,
+                   MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)) {
+        /* Small allocations then spill to the PSRAM pool */
+        ESP_LOGW(TAG, "No internal pool");
+    }
+    if (!pool_open(&s_psram, CONFIG_LVGL_MEM_PSRAM_KB * 1024, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)) {
+        /* Big allocations then come from the system heap */
+        ESP_LOGW(TAG, "No PSRAM pool");
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    s_spills = s_fallbacks = s_failures = s_alarms = 0;
+    portEXIT_CRITICAL(&s_stats_lock);
+    ESP_LOGI(TAG, "%u KB internal + %u KB PSRAM, above %u bytes in PSRAM",
+             (unsigned)(s_internal.size / 1024), (unsigned)(s_psram.size / 1024),
+             (unsigned)CONFIG_LVGL_MEM_SMALL_MAX);
+}
+
+void lv_mem_deinit(void)
+{
+    pool_close(&s_internal);
+    pool_close(&s_psram);
+}
+
+lv_mem_pool_t lv_mem_add_pool(void *mem, size_t bytes)
+{
+    /* The pools are fixed by Kconfig */
+    (void)mem;
+    (void)bytes;
+    return NULL;
+}
+
+void lv_mem_remove_pool(lv_mem_pool_t pool)
+{
+    (void)pool;
+}
+
+void *lv_malloc_core(size_t size)
+{
+    void *ptr = NULL;
+    if (size <= CONFIG_LVGL_MEM_SMALL_MAX) {
+        ptr = pool_malloc(&s_internal, size);
+        if (ptr) {
+            return ptr;
+        }
+        count(&s_spills);
+    }
+    ptr = pool_malloc(&s_psram, size);
+    if (ptr) {
+        return ptr;
+    }
+    ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr) {
+        count(&s_fallbacks);
+    } else {
+        count(&s_failures);
+        ESP_LOGW(TAG, "Out of memory for %u bytes", (unsigned)size);
+    }
+    return ptr;
+}
+
+void lv_free_core(void *p)
+{
+    if (pool_owns(&s_internal, p)) {
+        multi_heap_free(s_internal.heap, p);
+    } else if (pool_owns(&s_psram, p)) {
+        multi_heap_free(s_psram.heap, p);
+    } else {
+        heap_caps_free(p);
+    }
+}
+
+void *lv_realloc_core(void *p, size_t new_size)
+{
+    lvmem_pool_t *pool = pool_owns(&s_internal, p) ? &s_internal :
+                         pool_owns(&s_psram, p)    ? &s_psram : NULL;
+    if (!pool) {
+        return p ? heap_caps_realloc(p, new_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) :
+                   lv_malloc_core(new_size);
+    }
+    /* Grow in place when possible, otherwise move to wherever the new size belongs */
+    void *q = multi_heap_realloc(pool->heap, p, new_size);
+    if (q) {
+        pool_check_alarm(pool);
+        return q;
+    }
+    q = lv_malloc_core(new_size);
+    if (q) {
+        size_t old_size = multi_heap_get_allocated_size(pool->heap, p);
+        memcpy(q, p, old_size < new_size ? old_size : new_size);
+        multi_heap_free(pool->heap, p);
+    }
+    return q;
+}
+
+static void pool_stats(const lvmem_pool_t *p, lvmem_pool_stats_t *st)
+{
+    memset(st, 0, sizeof(*st));
+    if (!p->heap) {
+        return;
+    }
+    multi_heap_info_t info;
+    multi_heap_get_info(p->heap, &info);
+    st->total = info.total_free_bytes + info.total_allocated_bytes;
+    st->used = info.total_allocated_bytes;
+    st->max_used = st->total - info.minimum_free_bytes;
+    st->largest_free = info.largest_free_block;
+    st->blocks = info.allocated_blocks;
+    st->frag_pct = info.total_free_bytes ?
+                   (uint8_t)(100 - (uint64_t)info.largest_free_block * 100 / info.total_free_bytes) : 0;
+}
+
+void lvmem_get_stats(lvmem_stats_t *stats)
+{
+    pool_stats(&s_internal, &stats->internal);
+    pool_stats(&s_psram, &stats->psram);
+    portENTER_CRITICAL(&s_stats_lock);
+    stats->spills = s_spills;
+    stats->fallbacks = s_fallbacks;
+    stats->failures = s_failures;
+    stats->alarms = s_alarms;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+void lv_mem_monitor_core(lv_mem_monitor_t *mon)
+{
+    lvmem_stats_t st;
+    lvmem_get_stats(&st);
+    mon->total_size = st.internal.total + st.psram.total;
+    mon->free_size = mon->total_size - st.internal.used - st.psram.used;
+    mon->free_biggest_size = st.psram.largest_free > st.internal.largest_free ?
+                             st.psram.largest_free : st.internal.largest_free;
+    mon->used_cnt = st.internal.blocks + st.psram.blocks;
+    mon->max_used = st.internal.max_used + st.psram.max_used;
+    mon->used_pct = mon->total_size ?
+                    (uint8_t)(100 - (uint64_t)mon->free_size * 100 / mon->total_size) : 0;
+    mon->frag_pct = mon->free_size ?
+                    (uint8_t)(100 - (uint64_t)mon->free_biggest_size * 100 / mon->free_size) : 0;
+}
+
+lv_result_t lv_mem_test_core(void)
+{
+    bool ok = (!s_internal.heap || multi_heap_check(s_internal.heap, true)) &&
+              (!s_psram.heap || multi_heap_check(s_psram.heap, true));
+    return ok ? LV_RESULT_OK : LV_RESULT_INVALID;
+}
+
+static void print_pool(const char *name, const lvmem_pool_stats_t *st)
+{
+    printf("%-8s %6u/%6u KB used, peak %u KB, largest free %u KB, %u blocks, "
+           "fragmentation %u%%\n",
+           name, (unsigned)(st->used / 1024), (unsigned)(st->total / 1024),
+           (unsigned)(st->max_used / 1024), (unsigned)(st->largest_free / 1024),
+           (unsigned)st->blocks, st->frag_pct);
+}
+
+static int cmd_lvmem(int argc, char **argv)
+{
+    lvmem_stats_t st;
+    lvmem_get_stats(&st);
+    print_pool("internal", &st.internal);
+    print_pool("psram", &st.psram);
+    printf("spills %u, heap fallbacks %u, failures %u, alarms %u (at %d%%)\n",
+           (unsigned)st.spills, (unsigned)st.fallbacks, (unsigned)st.failures,
+           (unsigned)st.alarms, CONFIG_LVGL_MEM_ALARM_PCT);
+    return 0;
+}
+
+esp_err_t lvmem_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "lvmem",
+        .help = "LVGL memory pools: usage, peak and fragmentation",
+        .hint = NULL,
+        .func = cmd_lvmem,
+    };
+    return esp_console_cmd_register(&cmd);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * LVGL allocator (LV_USE_STDLIB_MALLOC = LV_STDLIB_CUSTOM).
+ *
+ * lv_malloc() is served by two TLSF heaps (ESP-IDF multi_heap) reserved
+ * when LVGL starts: a small one in internal RAM for the many small widget,
+ * style and event structures, and a large one in PSRAM for everything above
+ * CONFIG_LVGL_MEM_SMALL_MAX bytes (layers, decoder input, long texts).
+ * Small requests spill into PSRAM when internal RAM is full; big ones go to
+ * the system heap when the PSRAM pool is. When a pool's usage crosses
+ * CONFIG_LVGL_MEM_ALARM_PCT a warning is logged once, re-armed when usage
+ * drops back below the threshold minus 10 points.
+ */
+
+typedef struct {
+    size_t total;
+    size_t used;
+    size_t max_used;     /*!< High-water mark since LVGL started */
+    size_t largest_free;
+    uint32_t blocks;     /*!< Allocated blocks */
+    uint8_t frag_pct;    /*!< Free memory outside the largest free block */
+} lvmem_pool_stats_t;
+
+typedef struct {
+    lvmem_pool_stats_t internal;
+    lvmem_pool_stats_t psram;
+    uint32_t spills;     /*!< Small allocations served by the PSRAM pool */
+    uint32_t fallbacks;  /*!< Allocations served by the system heap */
+    uint32_t failures;
+    uint32_t alarms;     /*!< Times a pool crossed CONFIG_LVGL_MEM_ALARM_PCT */
+} lvmem_stats_t;
+
+/** Snapshot of both pools; zeroes before LVGL started. */
+void lvmem_get_stats(lvmem_stats_t *stats);
+
+/** Add the `lvmem` command to the esp_console REPL. */
+esp_err_t lvmem_console_register(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,846 @@
+#include "png_stream.h"
+#include "jobs.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+/* The ROM ships miniz's inflater, no need to link another one */
+#include "esp_rom_crc.h"
+#include "rom/miniz.h"
+#define png_crc32(crc, buf, len) esp_rom_crc32_le((crc), (buf), (len))
+#else
+#include <zlib.h>
+#define png_crc32(crc, buf, len) ((uint32_t)crc32((crc), (buf), (len)))
+#define INFLATE_OUT_SIZE 16384
+#endif
+
+#define CHUNK(a, b, c, d) (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (d))
+#define CHUNK_IHDR CHUNK('I', 'H', 'D', 'R')
+#define CHUNK_PLTE CHUNK('P', 'L', 'T', 'E')
+#define CHUNK_TRNS CHUNK('t', 'R', 'N', 'S')
+#define CHUNK_IDAT CHUNK('I', 'D', 'A', 'T')
+#define CHUNK_IEND CHUNK('I', 'E', 'N', 'D')
+
+#define MAX_DIMENSION 16384
+
+/* Parallel decode: rows are converted in bands on the other core */
+#define BAND_ROWS 8
+#define BAND_COUNT 3
+
+enum {
+    PNG_COLOR_GRAY = 0,
+    PNG_COLOR_RGB = 2,
+    PNG_COLOR_PALETTE = 3,
+    PNG_COLOR_GRAY_ALPHA = 4,
+    PNG_COLOR_RGBA = 6,
+};
+
+typedef enum {
+    ST_SIGNATURE,
+    ST_CHUNK_HEADER,
+    ST_CHUNK_DATA,
+    ST_CHUNK_CRC,
+    ST_END,
+    ST_FAILED,
+} parse_state_t;
+
+typedef struct {
+#ifdef ESP_PLATFORM
+    tinfl_decompressor decomp;
+    uint8_t *dict;
+    size_t dict_ofs;
+#else
+    z_stream z;
+    uint8_t *out;
+#endif
+    bool started;
+    bool done;
+} inflater_t;
+
+/* Unfiltered scanlines waiting for, or going through, conversion */
+typedef struct {
+    png_stream_t *s;
+    uint8_t *raw; /* BAND_ROWS lines of filter byte + scanline */
+    uint32_t y0;
+    uint32_t rows;
+    job_group_t group;
+} band_t;
+
+struct png_stream {
+    png_stream_config_t cfg;
+    parse_state_t state;
+    esp_err_t err;
+
+    /* Signature, chunk header and CRC are gathered here */
+    uint8_t scratch[8];
+    size_t scratch_fill;
+    uint32_t chunk_type;
+    uint32_t chunk_left;
+    uint32_t crc;
+    /* Payload of IHDR, PLTE and tRNS */
+    uint8_t small[768];
+    size_t small_fill;
+    bool collect;
+
+    png_stream_info_t info;
+    bool have_header;
+    uint8_t channels;
+    uint8_t palette[256][4];
+    uint16_t palette_len;
+    bool have_key;
+    uint16_t key[3];
+
+    size_t filter_bpp; /* bytes per pixel for the filters, at least 1 */
+    size_t row_bytes;  /* scanline without its filter byte */
+    uint8_t *cur;      /* filter byte + scanline */
+    uint8_t *prev;
+    size_t row_fill;
+    uint32_t y;
+    bool rows_started;
+
+    png_stream_format_t out_format;
+    uint8_t *out_buf;
+    size_t out_stride;
+    uint8_t *row_out;
+    uint32_t rows_out;
+
+    bool parallel;
+    band_t bands[BAND_COUNT];
+    unsigned band;
+    uint32_t band_fill; /* rows unfiltered into the current band */
+
+    inflater_t inf;
+};
+
+static const uint8_t k_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+png_stream_t *png_stream_create(const png_stream_config_t *cfg)
+{
+    png_stream_t *s = calloc(1, sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    s->cfg = *cfg;
+    s->out_format = cfg->format;
+    return s;
+}
+
+static void inflater_free(inflater_t *inf)
+{
+#ifdef ESP_PLATFORM
+    free(inf->dict);
+    inf->dict = NULL;
+#else
+    if (inf->started) {
+        inflateEnd(&inf->z);
+    }
+    free(inf->out);
+    inf->out = NULL;
+#endif
+    inf->started = false;
+}
+
+static void bands_free(png_stream_t *s)
+{
+    if (!s->parallel) {
+        return;
+    }
+    for (int i = 0; i < BAND_COUNT; ++i) {
+        band_t *b = &s->bands[i];
+        /* A failed decode can leave conversions in flight */
+        jobs_wait(&b->group);
+        jobs_group_deinit(&b->group);
+        free(b->raw);
+    }
+    s->parallel = false;
+}
+
+void png_stream_destroy(png_stream_t *s)
+{
+    if (!s) {
+        return;
+    }
+    bands_free(s);
+    inflater_free(&s->inf);
+    free(s->cur);
+    free(s->prev);
+    free(s->row_out);
+    free(s);
+}
+
+esp_err_t png_stream_set_output(png_stream_t *s, png_stream_format_t format, uint8_t *buf,
+                                size_t stride)
+{
+    if (!s || !buf || s->rows_started ||
+        stride < (size_t)s->info.width * png_stream_bpp(format)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s->out_format = format;
+    s->out_buf = buf;
+    s->out_stride = stride;
+    return ESP_OK;
+}
+
+uint32_t png_stream_rows_done(const png_stream_t *s)
+{
+    return s->rows_out;
+}
+
+static esp_err_t fail(png_stream_t *s, esp_err_t err)
+{
+    s->state = ST_FAILED;
+    s->err = err;
+    return err;
+}
+
+static esp_err_t parse_ihdr(png_stream_t *s)
+{
+    if (s->small_fill != 13 || s->have_header) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    const uint8_t *p = s->small;
+    png_stream_info_t *info = &s->info;
+    info->width = be32(p);
+    info->height = be32(p + 4);
+    info->bit_depth = p[8];
+    info->color_type = p[9];
+    if (info->width == 0 || info->height == 0 || info->width > MAX_DIMENSION ||
+        info->height > MAX_DIMENSION || p[10] != 0 || p[11] != 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (p[12] != 0) {
+        return ESP_ERR_NOT_SUPPORTED; /* Adam7 */
+    }
+    uint8_t d = info->bit_depth;
+    switch (info->color_type) {
+    case PNG_COLOR_GRAY:
+        s->channels = 1;
+        if (d != 1 && d != 2 && d != 4 && d != 8 && d != 16) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        break;
+    case PNG_COLOR_PALETTE:
+        s->channels = 1;
+        if (d != 1 && d != 2 && d != 4 && d != 8) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        break;
+    case PNG_COLOR_RGB:
+    case PNG_COLOR_GRAY_ALPHA:
+    case PNG_COLOR_RGBA:
+        s->channels = info->color_type == PNG_COLOR_RGB ? 3 :
+                      info->color_type == PNG_COLOR_RGBA ? 4 : 2;
+        if (d != 8 && d != 16) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        break;
+    default:
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    size_t bits = (size_t)s->channels * d;
+    s->filter_bpp = bits < 8 ? 1 : bits / 8;
+    s->row_bytes = ((size_t)info->width * bits + 7) / 8;
+    info->has_alpha = info->color_type == PNG_COLOR_GRAY_ALPHA ||
+                      info->color_type == PNG_COLOR_RGBA;
+    s->have_header = true;
+    return ESP_OK;
+}
+
+static esp_err_t parse_plte(png_stream_t *s)
+{
+    if (s->small_fill % 3 != 0 || s->small_fill == 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    s->palette_len = s->small_fill / 3;
+    for (size_t i = 0; i < s->palette_len; ++i) {
+        s->palette[i][0] = s->small[3 * i];
+        s->palette[i][1] = s->small[3 * i + 1];
+        s->palette[i][2] = s->small[3 * i + 2];
+        s->palette[i][3] = 0xFF;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t parse_trns(png_stream_t *s)
+{
+    switch (s->info.color_type) {
+    case PNG_COLOR_PALETTE:
+        if (s->small_fill > s->palette_len) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        for (size_t i = 0; i < s->small_fill; ++i) {
+            s->palette[i][3] = s->small[i];
+        }
+        break;
+    case PNG_COLOR_GRAY:
+        if (s->small_fill != 2) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        s->key[0] = (s->small[0] << 8) | s->small[1];
+        s->have_key = true;
+        break;
+    case PNG_COLOR_RGB:
+        if (s->small_fill != 6) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        for (int i = 0; i < 3; ++i) {
+            s->key[i] = (s->small[2 * i] << 8) | s->small[2 * i + 1];
+        }
+        s->have_key = true;
+        break;
+    default:
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    s->info.has_alpha = true;
+    return ESP_OK;
+}
+
+/* First IDAT: everything needed to decode rows is known now. */
+static esp_err_t begin_image(png_stream_t *s)
+{
+    if (!s->have_header) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (s->info.color_type == PNG_COLOR_PALETTE && s->palette_len == 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (s->cfg.on_header) {
+        esp_err_t err = s->cfg.on_header(s, &s->info, s->cfg.arg);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    s->cur = calloc(1, s->row_bytes + 1);
+    s->prev = calloc(1, s->row_bytes + 1);
+    if (!s->out_buf) {
+        s->row_out = malloc((size_t)s->info.width * png_stream_bpp(s->out_format));
+    }
+    if (!s->cur || !s->prev || (!s->out_buf && !s->row_out)) {
+        return ESP_ERR_NO_MEM;
+    }
+    /* Conversion only moves off-core when it can write the rows in place */
+    if (s->cfg.parallel && s->out_buf && jobs_running()) {
+        s->parallel = true;
+        for (int i = 0; i < BAND_COUNT; ++i) {
+            s->bands[i].s = s;
+            jobs_group_init(&s->bands[i].group);
+        }
+        for (int i = 0; i < BAND_COUNT; ++i) {
+            s->bands[i].raw = malloc((s->row_bytes + 1) * BAND_ROWS);
+            if (!s->bands[i].raw) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+
+    inflater_t *inf = &s->inf;
+#ifdef ESP_PLATFORM
+    inf->dict = malloc(TINFL_LZ_DICT_SIZE);
+    if (!inf->dict) {
+        return ESP_ERR_NO_MEM;
+    }
+    tinfl_init(&inf->decomp);
+    inf->dict_ofs = 0;
+#else
+    inf->out = malloc(INFLATE_OUT_SIZE);
+    if (!inf->out || inflateInit(&inf->z) != Z_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    inf->started = true;
+    s->rows_started = true;
+    return ESP_OK;
+}
+
+static inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+    int p = (int)a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+/* @p line and @p up_line start with the filter byte */
+static esp_err_t unfilter(const png_stream_t *s, uint8_t *line, const uint8_t *up_line)
+{
+    uint8_t *row = line + 1;
+    const uint8_t *up = up_line + 1;
+    size_t n = s->row_bytes;
+    size_t bpp = s->filter_bpp;
+    switch (line[0]) {
+    case 0:
+        break;
+    case 1:
+        for (size_t i = bpp; i < n; ++i) {
+            row[i] += row[i - bpp];
+        }
+        break;
+    case 2:
+        for (size_t i = 0; i < n; ++i) {
+            row[i] += up[i];
+        }
+        break;
+    case 3:
+        for (size_t i = 0; i < bpp; ++i) {
+            row[i] += up[i] >> 1;
+        }
+        for (size_t i = bpp; i < n; ++i) {
+            row[i] += (uint8_t)(((unsigned)row[i - bpp] + up[i]) >> 1);
+        }
+        break;
+    case 4:
+        for (size_t i = 0; i < bpp; ++i) {
+            row[i] += up[i];
+        }
+        for (size_t i = bpp; i < n; ++i) {
+            row[i] += paeth(row[i - bpp], up[i], up[i - bpp]);
+        }
+        break;
+    default:
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+static inline void put_pixel(uint8_t *out, png_stream_format_t fmt, uint8_t r, uint8_t g,
+                             uint8_t b, uint8_t a)
+{
+    if (fmt == PNG_STREAM_FMT_RGB565) {
+        uint16_t v = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+        out[0] = v & 0xFF;
+        out[1] = v >> 8;
+    } else {
+        out[0] = b;
+        out[1] = g;
+        out[2] = r;
+        out[3] = a;
+    }
+}
+
+static void convert_row(const png_stream_t *s, const uint8_t *row, uint8_t *out)
+{
+    const png_stream_format_t fmt = s->out_format;
+    const size_t step = png_stream_bpp(fmt);
+    const uint32_t w = s->info.width;
+    const uint8_t depth = s->info.bit_depth;
+
+    /* Fast paths for the common 8-bit truecolour layouts */
+    if (depth == 8 && !s->have_key &&
+        (s->info.color_type == PNG_COLOR_RGB || s->info.color_type == PNG_COLOR_RGBA)) {
+        const size_t ch = s->channels;
+        for (uint32_t x = 0; x < w; ++x, row += ch, out += step) {
+            put_pixel(out, fmt, row[0], row[1], row[2], ch == 4 ? row[3] : 0xFF);
+        }
+        return;
+    }
+
+    const size_t bytes = depth == 16 ? 2 : 1;
+    for (uint32_t x = 0; x < w; ++x, out += step) {
+        uint8_t r, g, b, a = 0xFF;
+        if (depth < 8) {
+            size_t bit = (size_t)x * depth;
+            uint8_t mask = (1u << depth) - 1;
+            uint8_t v = (row[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+            if (s->info.color_type == PNG_COLOR_PALETTE) {
+                const uint8_t *c = s->palette[v];
+                r = c[0];
+                g = c[1];
+                b = c[2];
+                a = c[3];
+            } else {
+                r = g = b = (uint8_t)(v * 255 / mask);
+                if (s->have_key && v == s->key[0]) {
+                    a = 0;
+                }
+            }
+        } else {
+            const uint8_t *p = row + (size_t)x * s->channels * bytes;
+            switch (s->info.color_type) {
+            case PNG_COLOR_PALETTE: {
+                const uint8_t *c = s->palette[p[0]];
+                r = c[0];
+                g = c[1];
+                b = c[2];
+                a = c[3];
+                break;
+            }
+            case PNG_COLOR_GRAY:
+                r = g = b = p[0];
+                if (s->have_key &&
+                    (bytes == 2 ? ((p[0] << 8) | p[1]) : p[0]) == s->key[0]) {
+                    a = 0;
+                }
+                break;
+            case PNG_COLOR_GRAY_ALPHA:
+                r = g = b = p[0];
+                a = p[bytes];
+                break;
+            case PNG_COLOR_RGB:
+                r = p[0];
+                g = p[bytes];
+                b = p[2 * bytes];
+                if (s->have_key) {
+                    uint16_t kr = bytes == 2 ? ((p[0] << 8) | p[1]) : p[0];
+                    uint16_t kg = bytes == 2 ? ((p[2] << 8) | p[3]) : p[1];
+                    uint16_t kb = bytes == 2 ? ((p[4] << 8) | p[5]) : p[2];
+                    if (kr == s->key[0] && kg == s->key[1] && kb == s->key[2]) {
+                        a = 0;
+                    }
+                }
+                break;
+            default: /* RGBA */
+                r = p[0];
+                g = p[bytes];
+                b = p[2 * bytes];
+                a = p[3 * bytes];
+                break;
+            }
+        }
+        put_pixel(out, fmt, r, g, b, a);
+    }
+}
+
+static void band_convert_job(void *arg)
+{
+    band_t *b = arg;
+    const png_stream_t *s = b->s;
+    const size_t line = s->row_bytes + 1;
+    TRACE_BEGIN("png_convert");
+    for (uint32_t i = 0; i < b->rows; ++i) {
+        convert_row(s, b->raw + i * line + 1, s->out_buf + (size_t)(b->y0 + i) * s->out_stride);
+    }
+    TRACE_END("png_convert");
+}
+
+/* Wait for the conversion of @p b and report its rows, in order. */
+static void band_collect(png_stream_t *s, band_t *b)
+{
+    jobs_wait(&b->group);
+    for (uint32_t i = 0; i < b->rows; ++i) {
+        uint32_t y = b->y0 + i;
+        if (s->cfg.on_row) {
+            s->cfg.on_row(y, s->out_buf + (size_t)y * s->out_stride, s->cfg.arg);
+        }
+    }
+    s->rows_out += b->rows;
+    b->rows = 0;
+}
+
+/*
+ * Parallel variant of consume(): scanlines are unfiltered in place inside the
+ * current band, and each full band is handed to the other core for
+ * conversion while this one goes on inflating. Bands are recycled in order,
+ * so collecting a band before refilling it also keeps on_row() in order.
+ */
+static esp_err_t consume_bands(png_stream_t *s, const uint8_t *data, size_t len)
+{
+    const size_t line = s->row_bytes + 1;
+    while (len > 0 && s->y < s->info.height) {
+        band_t *b = &s->bands[s->band];
+        const uint32_t r = s->band_fill;
+        if (s->row_fill == 0 && r == 0) {
+            /* Starting this band: its previous rows must be converted */
+            if (b->rows) {
+                band_collect(s, b);
+            }
+            b->y0 = s->y;
+        }
+        uint8_t *cur = b->raw + r * line;
+        size_t n = line - s->row_fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(cur + s->row_fill, data, n);
+        s->row_fill += n;
+        data += n;
+        len -= n;
+        if (s->row_fill < line) {
+            break;
+        }
+        /* Row 0 of a band filters against the last row of the previous one */
+        const uint8_t *up = r ? cur - line : s->prev;
+        esp_err_t err = unfilter(s, cur, up);
+        if (err != ESP_OK) {
+            return err;
+        }
+        s->row_fill = 0;
+        s->y++;
+        s->band_fill++;
+        if (s->band_fill == BAND_ROWS || s->y == s->info.height) {
+            b->rows = s->band_fill;
+            memcpy(s->prev, cur, line);
+            jobs_submit(&b->group, JOBS_OTHER_CORE, band_convert_job, b);
+            s->band = (s->band + 1) % BAND_COUNT;
+            s->band_fill = 0;
+        }
+    }
+    if (s->y == s->info.height) {
+        /* Oldest band first */
+        for (int i = 0; i < BAND_COUNT; ++i) {
+            band_t *b = &s->bands[(s->band + i) % BAND_COUNT];
+            if (b->rows) {
+                band_collect(s, b);
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+/* Inflated bytes: assemble scanlines and emit the finished ones. */
+static esp_err_t consume(png_stream_t *s, const uint8_t *data, size_t len)
+{
+    if (s->parallel) {
+        return consume_bands(s, data, len);
+    }
+    const size_t line = s->row_bytes + 1;
+    while (len > 0) {
+        if (s->y >= s->info.height) {
+            /* Trailing bytes after the last row are tolerated */
+            return ESP_OK;
+        }
+        size_t n = line - s->row_fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s->cur + s->row_fill, data, n);
+        s->row_fill += n;
+        data += n;
+        len -= n;
+        if (s->row_fill < line) {
+            break;
+        }
+        esp_err_t err = unfilter(s, s->cur, s->prev);
+        if (err != ESP_OK) {
+            return err;
+        }
+        uint8_t *out = s->out_buf ? s->out_buf + (size_t)s->y * s->out_stride : s->row_out;
+        convert_row(s, s->cur + 1, out);
+        if (s->cfg.on_row) {
+            s->cfg.on_row(s->y, out, s->cfg.arg);
+        }
+        uint8_t *tmp = s->prev;
+        s->prev = s->cur;
+        s->cur = tmp;
+        s->row_fill = 0;
+        s->y++;
+        s->rows_out++;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t inflate_feed(png_stream_t *s, const uint8_t *in, size_t len)
+{
+    inflater_t *inf = &s->inf;
+    if (inf->done) {
+        return ESP_OK;
+    }
+#ifdef ESP_PLATFORM
+    for (;;) {
+        size_t in_bytes = len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - inf->dict_ofs;
+        tinfl_status st = tinfl_decompress(&inf->decomp, in, &in_bytes, inf->dict,
+                                           inf->dict + inf->dict_ofs, &out_bytes,
+                                           TINFL_FLAG_PARSE_ZLIB_HEADER |
+                                           TINFL_FLAG_HAS_MORE_INPUT);
+        in += in_bytes;
+        len -= in_bytes;
+        if (out_bytes) {
+            esp_err_t err = consume(s, inf->dict + inf->dict_ofs, out_bytes);
+            if (err != ESP_OK) {
+                return err;
+            }
+            inf->dict_ofs = (inf->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+        if (st == TINFL_STATUS_DONE) {
+            inf->done = true;
+            return ESP_OK;
+        }
+        if (st < 0) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (st == TINFL_STATUS_NEEDS_MORE_INPUT && (len == 0 || (!in_bytes && !out_bytes))) {
+            return ESP_OK;
+        }
+    }
+#else
+    inf->z.next_in = (Bytef *)in;
+    inf->z.avail_in = len;
+    for (;;) {
+        inf->z.next_out = inf->out;
+        inf->z.avail_out = INFLATE_OUT_SIZE;
+        int ret = inflate(&inf->z, Z_NO_FLUSH);
+        size_t produced = INFLATE_OUT_SIZE - inf->z.avail_out;
+        if (produced) {
+            esp_err_t err = consume(s, inf->out, produced);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        if (ret == Z_STREAM_END) {
+            inf->done = true;
+            return ESP_OK;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (inf->z.avail_in == 0 && inf->z.avail_out != 0) {
+            return ESP_OK;
+        }
+        if (ret == Z_BUF_ERROR && produced == 0) {
+            return ESP_OK;
+        }
+    }
+#endif
+}
+
+static esp_err_t chunk_begin(png_stream_t *s)
+{
+    s->small_fill = 0;
+    s->collect = false;
+    switch (s->chunk_type) {
+    case CHUNK_IHDR:
+    case CHUNK_PLTE:
+    case CHUNK_TRNS:
+        if (s->chunk_left > sizeof(s->small)) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        s->collect = true;
+        break;
+    case CHUNK_IDAT:
+        if (!s->rows_started) {
+            return begin_image(s);
+        }
+        break;
+    case CHUNK_IEND:
+        break;
+    default:
+        /* Unknown critical chunks (upper case first letter) can't be skipped */
+        if (!(s->chunk_type & 0x20000000)) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        break;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t chunk_end(png_stream_t *s)
+{
+    switch (s->chunk_type) {
+    case CHUNK_IHDR:
+        return parse_ihdr(s);
+    case CHUNK_PLTE:
+        return s->info.color_type == PNG_COLOR_PALETTE ? parse_plte(s) : ESP_OK;
+    case CHUNK_TRNS:
+        return parse_trns(s);
+    case CHUNK_IEND:
+        s->state = ST_END;
+        return ESP_OK;
+    default:
+        return ESP_OK;
+    }
+}
+
+esp_err_t png_stream_feed(png_stream_t *s, const uint8_t *data, size_t len)
+{
+    if (s->state == ST_FAILED) {
+        return s->err;
+    }
+    while (len > 0 && s->state != ST_END) {
+        switch (s->state) {
+        case ST_SIGNATURE:
+        case ST_CHUNK_HEADER:
+        case ST_CHUNK_CRC: {
+            size_t want = s->state == ST_CHUNK_CRC ? 4 : 8;
+            size_t n = want - s->scratch_fill;
+            if (n > len) {
+                n = len;
+            }
+            memcpy(s->scratch + s->scratch_fill, data, n);
+            s->scratch_fill += n;
+            data += n;
+            len -= n;
+            if (s->scratch_fill < want) {
+                break;
+            }
+            s->scratch_fill = 0;
+            if (s->state == ST_SIGNATURE) {
+                if (memcmp(s->scratch, k_signature, sizeof(k_signature)) != 0) {
+                    return fail(s, ESP_ERR_INVALID_RESPONSE);
+                }
+                s->state = ST_CHUNK_HEADER;
+            } else if (s->state == ST_CHUNK_HEADER) {
+                s->chunk_left = be32(s->scratch);
+                s->chunk_type = be32(s->scratch + 4);
+                if (s->chunk_left > 0x7FFFFFFF) {
+                    return fail(s, ESP_ERR_INVALID_RESPONSE);
+                }
+                if (!s->have_header && s->chunk_type != CHUNK_IHDR) {
+                    return fail(s, ESP_ERR_INVALID_RESPONSE);
+                }
+                s->crc = png_crc32(0, s->scratch + 4, 4);
+                esp_err_t err = chunk_begin(s);
+                if (err != ESP_OK) {
+                    return fail(s, err);
+                }
+                s->state = s->chunk_left ? ST_CHUNK_DATA : ST_CHUNK_CRC;
+            } else {
+                if (be32(s->scratch) != s->crc) {
+                    return fail(s, ESP_ERR_INVALID_CRC);
+                }
+                s->state = ST_CHUNK_HEADER;
+                esp_err_t err = chunk_end(s);
+                if (err != ESP_OK) {
+                    return fail(s, err);
+                }
+            }
+            break;
+        }
+        case ST_CHUNK_DATA: {
+            size_t n = s->chunk_left < len ? s->chunk_left : len;
+            s->crc = png_crc32(s->crc, data, n);
+            if (s->chunk_type == CHUNK_IDAT) {
+                TRACE_BEGIN("png_decode");
+                esp_err_t err = inflate_feed(s, data, n);
+                TRACE_END("png_decode");
+                if (err != ESP_OK) {
+                    return fail(s, err);
+                }
+            } else if (s->collect) {
+                memcpy(s->small + s->small_fill, data, n);
+                s->small_fill += n;
+            }
+            data += n;
+            len -= n;
+            s->chunk_left -= n;
+            if (s->chunk_left == 0) {
+                s->state = ST_CHUNK_CRC;
+            }
+            break;
+        }
+        default:
+            return fail(s, ESP_ERR_INVALID_STATE);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t png_stream_finish(png_stream_t *s)
+{
+    if (s->state == ST_FAILED) {
+        return s->err;
+    }
+    if (s->state != ST_END || !s->have_header || s->rows_out != s->info.height) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Incremental PNG decoder.
+ *
+ * Bytes are pushed with png_stream_feed() as they arrive; chunks are parsed,
+ * IDAT data is inflated and every scanline is unfiltered and converted as
+ * soon as it is complete. Interlaced (Adam7) images are not supported.
+ *
+ * With `parallel` set and an output buffer given from on_header, the
+ * feeding task only inflates and unfilters: completed bands of rows are
+ * converted by the job system (see jobs.h) on the other core, and on_row()
+ * lags behind by up to a few bands.
+ */
+typedef struct png_stream png_stream_t;
+
+typedef enum {
+    PNG_STREAM_FMT_RGB565 = 0, /*!< 16-bit, little endian, alpha dropped */
+    PNG_STREAM_FMT_ARGB8888,   /*!< 32-bit, B G R A byte order */
+} png_stream_format_t;
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint8_t bit_depth;
+    uint8_t color_type;
+    bool has_alpha; /*!< Alpha channel or tRNS chunk present */
+} png_stream_info_t;
+
+typedef struct {
+    /**
+     * Called once the header is parsed and before the first row. May call
+     * png_stream_set_output() to have rows written straight into a caller
+     * buffer; returning an error stops the decode.
+     */
+    esp_err_t (*on_header)(png_stream_t *s, const png_stream_info_t *info, void *arg);
+    /**
+     * Called for every decoded row. @p pixels points into the output buffer
+     * when one was set, into an internal row otherwise.
+     */
+    void (*on_row)(uint32_t y, const uint8_t *pixels, void *arg);
+    png_stream_format_t format; /*!< Default output format */
+    bool parallel;              /*!< Convert rows on the other core, see above */
+    void *arg;
+} png_stream_config_t;
+
+png_stream_t *png_stream_create(const png_stream_config_t *cfg);
+void png_stream_destroy(png_stream_t *s);
+
+/**
+ * @brief Direct rows into @p buf, row y at `buf + y * stride`.
+ *
+ * Only valid from the on_header callback.
+ */
+esp_err_t png_stream_set_output(png_stream_t *s, png_stream_format_t format, uint8_t *buf,
+                                size_t stride);
+
+/**
+ * @brief Push the next @p len bytes of the file.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_RESPONSE on corrupt data,
+ *         ESP_ERR_NOT_SUPPORTED for unsupported images, or the error
+ *         returned by on_header.
+ */
+esp_err_t png_stream_feed(png_stream_t *s, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check that the whole image was decoded (all rows and IEND seen).
+ */
+esp_err_t png_stream_finish(png_stream_t *s);
+
+/** Rows decoded and converted so far. */
+uint32_t png_stream_rows_done(const png_stream_t *s);
+
+/** Bytes per pixel of @p format. */
+static inline size_t png_stream_bpp(png_stream_format_t format)
+{
+    return format == PNG_STREAM_FMT_ARGB8888 ? 4 : 2;
+}
+
+#ifdef __cplusplus
+}
+#endif
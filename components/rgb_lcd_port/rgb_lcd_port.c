@@ -107,6 +107,8 @@ esp_lcd_panel_handle_t waveshare_esp32_s3_rgb_lcd_init()
     // Log the initialization of the RGB LCD panel
     ESP_LOGI(TAG, "Initialize RGB LCD panel");
 
+    // DISP goes out with the VDD flush; the touch reset no longer toggles it
+    IO_EXTENSION_Output(IO_EXTENSION_IO_2, 1);
     io_extension_lcd_vdd_enable(true);
     // Initialize the RGB LCD panel
     ret = esp_lcd_panel_init(panel_handle);
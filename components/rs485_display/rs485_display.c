@@ -1,102 +1,356 @@
 #include "rs485_display.h"
-#include "driver/uart.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "freertos/queue.h"
+#include "config.h"
 #include "string.h"
+#include "uart_transport.h"
 #include "ui_navigation.h"
-#include "gt911.h"
-#include "config.h"
 #include "esp_log.h"
-
-extern QueueHandle_t s_touch_queue;
-extern display_geometry_t g_display;
+#include "trace.h"
 
 #define RS485_DISPLAY_TAG "RS485_DISP"
 #define RS485_UART UART_NUM_1
 #define RS485_TXD GPIO_NUM_15
 #define RS485_RXD GPIO_NUM_16
 
-static TaskHandle_t s_rs485_task_handle = NULL;
+/* A frame ends after 3.5 character times of silence; the UART counts whole
+ * characters, and 3 is what the ESP-IDF Modbus stack uses for t3.5 */
+#define MODBUS_RX_TOUT 3
+#define MODBUS_FRAME_MAX 256
+#define MODBUS_BROADCAST 0
+
+#define MODBUS_FC_READ_HOLDING   0x03
+#define MODBUS_FC_READ_INPUT     0x04
+#define MODBUS_FC_WRITE_SINGLE   0x06
+#define MODBUS_FC_WRITE_MULTIPLE 0x10
+
+#define MODBUS_EX_ILLEGAL_FUNCTION 0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS  0x02
+#define MODBUS_EX_ILLEGAL_VALUE    0x03
 
-static void send_nav_touch(bool next)
+#if CONFIG_MODBUS_PARITY_NONE
+#define MODBUS_PARITY UART_PARITY_DISABLE
+#elif CONFIG_MODBUS_PARITY_ODD
+#define MODBUS_PARITY UART_PARITY_ODD
+#else
+#define MODBUS_PARITY UART_PARITY_EVEN
+#endif
+
+static uart_transport_t *s_transport;
+static rs485_display_ops_t s_ops;
+static uint8_t s_reply[MODBUS_FRAME_MAX];
+
+/* High word of the folder hash, waiting for the low word */
+static uint16_t s_folder_hi;
+
+/* Diagnostic counters, exposed as input registers; the transport counts
+ * overruns and framing errors */
+static uint16_t s_requests;
+static uint16_t s_crc_errors;
+static uint16_t s_short_frames;
+static uint16_t s_exceptions;
+
+static uint16_t modbus_crc(const uint8_t *p, size_t len)
 {
-    touch_gt911_point_t ev = { .cnt = 1 };
-    if (next) {
-        ev.x[0] = g_display.width - NAV_MARGIN - ARROW_WIDTH / 2;
-        ev.y[0] = NAV_MARGIN + ARROW_HEIGHT / 2;
-    } else {
-        ev.x[0] = NAV_MARGIN + ARROW_WIDTH / 2;
-        ev.y[0] = NAV_MARGIN + ARROW_HEIGHT / 2;
+    uint16_t crc = 0xffff;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+static uint16_t get_be16(const uint8_t *p)
+{
+    return p[0] << 8 | p[1];
+}
+
+static void put_be16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xff;
+}
+
+/* Append the CRC (low byte first) and transmit */
+static void send_reply(size_t len)
+{
+    uint16_t crc = modbus_crc(s_reply, len);
+    s_reply[len] = crc & 0xff;
+    s_reply[len + 1] = crc >> 8;
+    uart_transport_send(s_transport, s_reply, len + 2);
+}
+
+static void send_exception(uint8_t fc, uint8_t code)
+{
+    s_reply[0] = CONFIG_MODBUS_SLAVE_ID;
+    s_reply[1] = fc | 0x80;
+    s_reply[2] = code;
+    s_exceptions++;
+    send_reply(3);
+}
+
+static uint8_t read_holding(uint16_t reg, const rs485_display_status_t *st, uint16_t *value)
+{
+    if (reg == RS485_HREG_NAV) {
+        *value = 0;
+        return s_ops.on_nav ? 0 : MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+    if (!st) {
+        return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+    switch (reg) {
+    case RS485_HREG_INDEX:
+        *value = st->index;
+        break;
+    case RS485_HREG_FOLDER_HI:
+        *value = st->folder_hash >> 16;
+        break;
+    case RS485_HREG_FOLDER_LO:
+        *value = st->folder_hash & 0xffff;
+        break;
+    case RS485_HREG_BRIGHTNESS:
+        *value = st->brightness;
+        break;
+    case RS485_HREG_SLIDESHOW:
+        *value = st->slideshow_s;
+        break;
+    default:
+        return MODBUS_EX_ILLEGAL_ADDRESS;
     }
-    xQueueSend(s_touch_queue, &ev, portMAX_DELAY);
+    return 0;
 }
 
-static void rs485_display_task(void *arg)
+static uint8_t read_input(uint16_t reg, const rs485_display_status_t *st, uint16_t *value)
 {
-    uint8_t buf[8];
-    while (1) {
-        int len = uart_read_bytes(RS485_UART, buf, sizeof(buf), portMAX_DELAY);
-        if (len >= 4) {
-            if (memcmp(buf, "NEXT", 4) == 0) {
-                send_nav_touch(true);
-            } else if (memcmp(buf, "PREV", 4) == 0) {
-                send_nav_touch(false);
-            }
+    switch (reg) {
+    case RS485_IREG_REQUESTS:
+        *value = s_requests;
+        return 0;
+    case RS485_IREG_CRC_ERRORS:
+        *value = s_crc_errors;
+        return 0;
+    case RS485_IREG_LINE_ERRORS: {
+        uart_transport_stats_t st;
+        uart_transport_get_stats(s_transport, &st);
+        *value = s_short_frames + st.overruns + st.framing_errors + st.oversize;
+        return 0;
+    }
+    case RS485_IREG_EXCEPTIONS:
+        *value = s_exceptions;
+        return 0;
+    default:
+        break;
+    }
+    if (!st) {
+        return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+    switch (reg) {
+    case RS485_IREG_IMAGE_COUNT:
+        *value = st->image_count;
+        break;
+    case RS485_IREG_DECODE_MS:
+        *value = st->decode_ms;
+        break;
+    case RS485_IREG_BATTERY:
+        *value = st->battery;
+        break;
+    case RS485_IREG_FPS_X10:
+        *value = st->fps_x10;
+        break;
+    default:
+        return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+    return 0;
+}
+
+static uint8_t write_holding(uint16_t reg, uint16_t value)
+{
+    switch (reg) {
+    case RS485_HREG_INDEX:
+        if (!s_ops.on_goto_index) {
+            return MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        return s_ops.on_goto_index(value) ? 0 : MODBUS_EX_ILLEGAL_VALUE;
+    case RS485_HREG_FOLDER_HI:
+        if (!s_ops.on_open_folder) {
+            return MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        s_folder_hi = value;
+        return 0;
+    case RS485_HREG_FOLDER_LO:
+        if (!s_ops.on_open_folder) {
+            return MODBUS_EX_ILLEGAL_ADDRESS;
         }
+        return s_ops.on_open_folder((uint32_t)s_folder_hi << 16 | value) ? 0
+                                                                        : MODBUS_EX_ILLEGAL_VALUE;
+    case RS485_HREG_BRIGHTNESS:
+        if (!s_ops.on_brightness) {
+            return MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        return value <= 100 && s_ops.on_brightness(value) ? 0 : MODBUS_EX_ILLEGAL_VALUE;
+    case RS485_HREG_SLIDESHOW:
+        if (!s_ops.on_slideshow) {
+            return MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        return s_ops.on_slideshow(value) ? 0 : MODBUS_EX_ILLEGAL_VALUE;
+    case RS485_HREG_NAV: {
+        if (!s_ops.on_nav) {
+            return MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        int16_t cmd = (int16_t)value;
+        if (cmd < NAV_CMD_PREV || cmd > NAV_CMD_EXIT) {
+            return MODBUS_EX_ILLEGAL_VALUE;
+        }
+        s_ops.on_nav((nav_cmd_t)cmd);
+        return 0;
+    }
+    default:
+        return MODBUS_EX_ILLEGAL_ADDRESS;
     }
 }
 
-esp_err_t rs485_display_init(void)
+/* Serve one complete frame; the caller checked address and CRC */
+static void handle_request(const uint8_t *req, size_t len, bool reply)
 {
-    uart_config_t cfg = {
-        .baud_rate = 115200,
-        .data_bits = UART_DATA_8_BITS,
-        .parity = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
-        .source_clk = UART_SCLK_DEFAULT,
-    };
+    uint8_t fc = req[1];
+    uint8_t ex = 0;
+    size_t out = 0;
+    s_reply[0] = CONFIG_MODBUS_SLAVE_ID;
+    s_reply[1] = fc;
 
-    esp_err_t ret = uart_param_config(RS485_UART, &cfg);
-    if (ret != ESP_OK) {
-        ESP_LOGE(RS485_DISPLAY_TAG, "uart_param_config failed: %s", esp_err_to_name(ret));
-        return ret;
+    switch (fc) {
+    case MODBUS_FC_READ_HOLDING:
+    case MODBUS_FC_READ_INPUT: {
+        if (len != 6) {
+            ex = MODBUS_EX_ILLEGAL_VALUE;
+            break;
+        }
+        uint16_t start = get_be16(&req[2]);
+        uint16_t count = get_be16(&req[4]);
+        if (count == 0 || count > RS485_MODBUS_MAX_REGS) {
+            ex = MODBUS_EX_ILLEGAL_VALUE;
+            break;
+        }
+        // One snapshot per request, so multi-register reads are consistent
+        rs485_display_status_t st = {0};
+        const rs485_display_status_t *pst = NULL;
+        if (s_ops.on_status) {
+            s_ops.on_status(&st);
+            pst = &st;
+        }
+        for (uint16_t i = 0; i < count && !ex; i++) {
+            uint16_t v = 0;
+            ex = fc == MODBUS_FC_READ_HOLDING ? read_holding(start + i, pst, &v)
+                                              : read_input(start + i, pst, &v);
+            put_be16(&s_reply[3 + 2 * i], v);
+        }
+        s_reply[2] = count * 2;
+        out = 3 + count * 2;
+        break;
     }
-    ret = uart_set_pin(RS485_UART, RS485_TXD, RS485_RXD, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    if (ret != ESP_OK) {
-        ESP_LOGE(RS485_DISPLAY_TAG, "uart_set_pin failed: %s", esp_err_to_name(ret));
-        return ret;
+    case MODBUS_FC_WRITE_SINGLE:
+        if (len != 6) {
+            ex = MODBUS_EX_ILLEGAL_VALUE;
+            break;
+        }
+        ex = write_holding(get_be16(&req[2]), get_be16(&req[4]));
+        memcpy(s_reply, req, 6);  // The reply echoes the request
+        s_reply[0] = CONFIG_MODBUS_SLAVE_ID;
+        out = 6;
+        break;
+    case MODBUS_FC_WRITE_MULTIPLE: {
+        uint16_t start = len >= 7 ? get_be16(&req[2]) : 0;
+        uint16_t count = len >= 7 ? get_be16(&req[4]) : 0;
+        if (len < 7 || count == 0 || count > RS485_MODBUS_MAX_REGS || req[6] != count * 2 ||
+            len != 7u + req[6]) {
+            ex = MODBUS_EX_ILLEGAL_VALUE;
+            break;
+        }
+        for (uint16_t i = 0; i < count && !ex; i++) {
+            ex = write_holding(start + i, get_be16(&req[7 + 2 * i]));
+        }
+        put_be16(&s_reply[2], start);
+        put_be16(&s_reply[4], count);
+        out = 6;
+        break;
     }
-    ret = uart_driver_install(RS485_UART, 256, 0, 0, NULL, 0);
-    if (ret != ESP_OK) {
-        ESP_LOGE(RS485_DISPLAY_TAG, "uart_driver_install failed: %s", esp_err_to_name(ret));
-        return ret;
+    default:
+        ex = MODBUS_EX_ILLEGAL_FUNCTION;
+        break;
     }
-    ret = uart_set_mode(RS485_UART, UART_MODE_RS485_HALF_DUPLEX);
-    if (ret != ESP_OK) {
-        ESP_LOGE(RS485_DISPLAY_TAG, "uart_set_mode failed: %s", esp_err_to_name(ret));
-        return ret;
+
+    if (!reply) {
+        return;
+    }
+    if (ex) {
+        send_exception(fc, ex);
+    } else {
+        send_reply(out);
     }
+}
 
-    if (xTaskCreate(rs485_display_task, "rs485_display_task", 2048, NULL, 5, &s_rs485_task_handle) != pdPASS) {
-        ESP_LOGE(RS485_DISPLAY_TAG, "Failed to create RS485 task");
-        uart_driver_delete(RS485_UART);
-        return ESP_FAIL;
+/* One frame per line silence, from the transport task */
+static void on_frame(void *arg, const uint8_t *f, size_t len)
+{
+    if (len < 4 || len > MODBUS_FRAME_MAX) {
+        s_short_frames++;
+        return;
     }
-    return ESP_OK;
+    if (modbus_crc(f, len - 2) != (f[len - 2] | f[len - 1] << 8)) {
+        s_crc_errors++;
+        return;
+    }
+    if (f[0] != CONFIG_MODBUS_SLAVE_ID && f[0] != MODBUS_BROADCAST) {
+        return;
+    }
+    s_requests++;
+    TRACE_BEGIN("modbus_request");
+    handle_request(f, len - 2, f[0] != MODBUS_BROADCAST);
+    TRACE_END("modbus_request");
 }
 
-esp_err_t rs485_display_deinit(void)
+esp_err_t rs485_display_init(const rs485_display_ops_t *ops)
 {
-    if (s_rs485_task_handle) {
-        vTaskDelete(s_rs485_task_handle);
-        s_rs485_task_handle = NULL;
+    if (!ops) {
+        return ESP_ERR_INVALID_ARG;
     }
-    esp_err_t ret = uart_driver_delete(RS485_UART);
+    s_ops = *ops;
+    const uart_transport_config_t cfg = {
+        .port = RS485_UART,
+        .tx_pin = RS485_TXD,
+        .rx_pin = RS485_RXD,
+        .baud_rate = CONFIG_MODBUS_BAUD_RATE,
+        .parity = MODBUS_PARITY,
+        // Modbus keeps 11 bits per character: two stop bits without parity
+        .stop_bits = MODBUS_PARITY == UART_PARITY_DISABLE ? UART_STOP_BITS_2 : UART_STOP_BITS_1,
+        .rx_buf_size = MODBUS_FRAME_MAX,
+        .tx_batch_size = MODBUS_FRAME_MAX,
+        .rx_timeout = MODBUS_RX_TOUT,
+        .rs485 = true,
+        .de_pin = CONFIG_RS485_DE_GPIO,
+        .de_lead_us = CONFIG_RS485_DE_LEAD_US,
+        .de_tail_us = CONFIG_RS485_DE_TAIL_US,
+        .framer = uart_framer_modbus,
+        .on_frame = on_frame,
+        .task_name = "rs485_display_task",
+        .task_priority = 5,
+    };
+    esp_err_t ret = uart_transport_open(&cfg, &s_transport);
     if (ret != ESP_OK) {
-        ESP_LOGE(RS485_DISPLAY_TAG, "uart_driver_delete failed: %s", esp_err_to_name(ret));
+        ESP_LOGE(RS485_DISPLAY_TAG, "RS485 transport failed: %s", esp_err_to_name(ret));
+        return ret;
     }
-    return ret;
+    ESP_LOGI(RS485_DISPLAY_TAG, "Modbus slave %d at %d baud", CONFIG_MODBUS_SLAVE_ID,
+             CONFIG_MODBUS_BAUD_RATE);
+    return ESP_OK;
 }
 
+esp_err_t rs485_display_deinit(void)
+{
+    if (!s_transport) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart_transport_close(s_transport);
+    s_transport = NULL;
+    return ESP_OK;
+}
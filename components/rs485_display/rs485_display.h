@@ -1,21 +1,88 @@
 #pragma once
 
 #include "esp_err.h"
+#include "ui_navigation.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Initialize UART1 in RS485 half-duplex mode for navigation commands.
+ * Modbus RTU slave on the RS485 bus.
  *
- * The UART is configured on GPIO15 (TXD) and GPIO16 (RXD).
- * ASCII frames "NEXT" or "PREV" received over the bus generate
- * synthetic touch events to control image navigation.
+ * The display answers at address CONFIG_MODBUS_SLAVE_ID; address 0 is a
+ * broadcast, executed without a reply. Supported functions: 0x03 read
+ * holding registers, 0x04 read input registers, 0x06 write single register
+ * and 0x10 write multiple registers, up to RS485_MODBUS_MAX_REGS registers
+ * per request. Frames are delimited by the UART receive timeout (3.5
+ * character times of silence), not by reading fixed-size blocks.
  *
+ * 32-bit values span two registers, high word first. The folder hash is
+ * applied when its low word is written, so it takes either one 0x10 request
+ * or 0x06 to the high word then to the low word.
+ */
+
+#define RS485_MODBUS_MAX_REGS 64
+
+typedef enum {
+    RS485_HREG_INDEX = 0,    /*!< Image shown in the current folder; write to jump */
+    RS485_HREG_FOLDER_HI,    /*!< FNV-1a of the folder name (can_display_name_hash()), */
+    RS485_HREG_FOLDER_LO,    /*!< written to open that folder */
+    RS485_HREG_BRIGHTNESS,   /*!< Maximum backlight level, percent */
+    RS485_HREG_SLIDESHOW,    /*!< Seconds per image, 0 = stopped */
+    RS485_HREG_NAV,          /*!< Write a nav_cmd_t (1 next, 0xFFFF previous...); reads 0 */
+    RS485_HREG_COUNT
+} rs485_holding_reg_t;
+
+typedef enum {
+    RS485_IREG_IMAGE_COUNT = 0,
+    RS485_IREG_DECODE_MS,    /*!< Duration of the last image decode */
+    RS485_IREG_BATTERY,      /*!< Percent */
+    RS485_IREG_FPS_X10,      /*!< Frames drawn per second over the last second, x10 */
+    RS485_IREG_REQUESTS,     /*!< Valid requests for this slave, modulo 65536 */
+    RS485_IREG_CRC_ERRORS,
+    RS485_IREG_LINE_ERRORS,  /*!< Overruns, framing and parity errors, oversized frames */
+    RS485_IREG_EXCEPTIONS,   /*!< Exception replies sent */
+    RS485_IREG_COUNT
+} rs485_input_reg_t;
+
+/** Values behind the registers, read once per request. */
+typedef struct {
+    uint16_t index;
+    uint32_t folder_hash;
+    uint8_t brightness;
+    uint16_t slideshow_s;
+    uint16_t image_count;
+    uint16_t decode_ms;
+    uint8_t battery;
+    uint16_t fps_x10;
+} rs485_display_status_t;
+
+/**
+ * Register handlers, called from the RS485 task; they must not block. A
+ * register whose handler is NULL answers ILLEGAL DATA ADDRESS. The bool
+ * handlers return false to answer ILLEGAL DATA VALUE.
+ */
+typedef struct {
+    nav_cmd_cb_t on_nav;
+    bool (*on_goto_index)(uint16_t index);
+    bool (*on_open_folder)(uint32_t name_hash);
+    bool (*on_brightness)(uint8_t percent);
+    bool (*on_slideshow)(uint16_t period_s);
+    void (*on_status)(rs485_display_status_t *status);
+} rs485_display_ops_t;
+
+/**
+ * @brief Initialize UART1 in RS485 half-duplex mode and start the slave.
+ *
+ * The UART runs at CONFIG_MODBUS_BAUD_RATE on GPIO15 (TXD) and GPIO16 (RXD).
+ *
+ * @param ops Register handlers, copied.
  * @return ESP_OK on success, an error code otherwise.
  */
-esp_err_t rs485_display_init(void);
+esp_err_t rs485_display_init(const rs485_display_ops_t *ops);
 
 /**
  * @brief Deinitialize RS485 display UART and delete task.
@@ -30,4 +97,3 @@ esp_err_t rs485_display_deinit(void);
 #ifdef __cplusplus
 }
 #endif
-
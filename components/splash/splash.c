@@ -0,0 +1,55 @@
+#include "splash.h"
+#include "config.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+
+static const char *TAG = "splash";
+
+static splash_image_t s_image;
+
+esp_err_t splash_load(splash_image_t *out)
+{
+    if (s_image.pixels) {
+        *out = s_image;
+        return ESP_OK;
+    }
+    const esp_partition_t *part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, SPLASH_PARTITION_SUBTYPE, SPLASH_PARTITION_LABEL);
+    if (!part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* Map the header first: the partition is much larger than most images */
+    const void *ptr;
+    esp_partition_mmap_handle_t map;
+    ESP_RETURN_ON_ERROR(esp_partition_mmap(part, 0, sizeof(splash_header_t),
+                                           ESP_PARTITION_MMAP_DATA, &ptr, &map),
+                        TAG, "header map failed");
+    splash_header_t hdr = *(const splash_header_t *)ptr;
+    esp_partition_munmap(map);
+
+    size_t size = (size_t)hdr.width * hdr.height * 2;
+    if (hdr.magic != SPLASH_MAGIC || hdr.data_size != size || size == 0 ||
+        hdr.width > LCD_H_RES || hdr.height > LCD_V_RES ||
+        sizeof(hdr) + size > part->size) {
+        ESP_LOGW(TAG, "No image in partition \"%s\"", part->label);
+        return ESP_ERR_INVALID_STATE;
+    }
+    ESP_RETURN_ON_ERROR(esp_partition_mmap(part, 0, sizeof(hdr) + size,
+                                           ESP_PARTITION_MMAP_DATA, &ptr, &map),
+                        TAG, "image map failed");
+    s_image.pixels = (const uint16_t *)((const uint8_t *)ptr + sizeof(hdr));
+    s_image.width = hdr.width;
+    s_image.height = hdr.height;
+    *out = s_image;
+    return ESP_OK;
+}
+
+esp_err_t splash_draw(esp_lcd_panel_handle_t panel, const splash_image_t *img)
+{
+    ESP_RETURN_ON_FALSE(panel && img && img->pixels, ESP_ERR_INVALID_ARG, TAG, "no image");
+    int x = (LCD_H_RES - img->width) / 2;
+    int y = (LCD_V_RES - img->height) / 2;
+    return esp_lcd_panel_draw_bitmap(panel, x, y, x + img->width, y + img->height, img->pixels);
+}
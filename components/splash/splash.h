@@ -0,0 +1,52 @@
+#pragma once
+#include "esp_err.h"
+#include "esp_lcd_panel_ops.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Boot splash stored raw in the "splash" data partition.
+ *
+ * The image is written by tools/mk_splash.py (CONFIG_BOOT_SPLASH_PNG) as a
+ * small header followed by RGB565 pixels, the panel's own format. It is
+ * mapped from flash, not copied: drawing it needs no decoder, no SD card
+ * and no PSRAM, so it can be on screen right after the panel init.
+ */
+
+#define SPLASH_PARTITION_LABEL "splash"
+#define SPLASH_PARTITION_SUBTYPE 0x40
+#define SPLASH_MAGIC 0x484C5053 /* "SPLH" read as a little-endian word */
+
+/** On-flash header, little endian, followed by width * height pixels. */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t width;
+    uint16_t height;
+    uint32_t data_size; /*!< width * height * 2 */
+} splash_header_t;
+
+typedef struct {
+    const uint16_t *pixels; /*!< RGB565, rows of width pixels, in mapped flash */
+    uint16_t width;
+    uint16_t height;
+} splash_image_t;
+
+/**
+ * @brief Map the splash partition and check its header.
+ *
+ * The mapping is kept for the whole run; later calls return the same image.
+ *
+ * @return ESP_ERR_NOT_FOUND without a partition, ESP_ERR_INVALID_STATE when
+ *         it does not hold an image (never flashed, or too large).
+ */
+esp_err_t splash_load(splash_image_t *out);
+
+/** @brief Draw @p img centred on @p panel, whose size is LCD_H_RES x LCD_V_RES. */
+esp_err_t splash_draw(esp_lcd_panel_handle_t panel, const splash_image_t *img);
+
+#ifdef __cplusplus
+}
+#endif
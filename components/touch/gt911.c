@@ -14,14 +14,16 @@
 #include "esp_check.h"
 
 #include "i2c.h"
+#include "i2c_bus.h"
 #include "gpio.h"
 #include "io_extension.h"
 #include "rgb_lcd_port.h"
 
 #include "gt911.h"
+#include "trace.h"
 
 static const char *TAG = "GT911";
-extern DEV_I2C_Port handle;                // I2C bus/device handle from i2c.c
+static i2c_bus_dev_t s_dev;                // GT911 on the shared I2C bus service
 extern esp_lcd_touch_handle_t s_touch_handle; // Touch handle used by touch task
 
 /* GT911 registers */
@@ -34,6 +36,11 @@ extern esp_lcd_touch_handle_t s_touch_handle; // Touch handle used by touch task
 /* GT911 support key num */
 #define ESP_GT911_TOUCH_MAX_BUTTONS         (4)
 
+/* Reset sequence (GT911 datasheet: >= 100 us low, INT held >= 5 ms, 50 ms to ready) */
+#define GT911_RESET_LOW_MS                  (10)
+#define GT911_INT_HOLD_MS                   (10)
+#define GT911_READY_MS                      (50)
+
 esp_lcd_touch_handle_t tp_handle = NULL; // Declare a handle for the touch panel
 /*******************************************************************************
 * Function definitions
@@ -60,11 +67,11 @@ static esp_err_t esp_lcd_touch_gt911_exit_sleep(esp_lcd_touch_handle_t tp);
 * Public API functions
 *******************************************************************************/
 
-esp_err_t esp_lcd_touch_new_i2c_gt911(const esp_lcd_panel_io_handle_t io, const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *out_touch)
+esp_err_t esp_lcd_touch_new_i2c_gt911(struct i2c_bus_dev *dev, const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *out_touch)
 {
     esp_err_t ret = ESP_OK;
 
-    assert(io != NULL);
+    assert(dev != NULL);
     assert(config != NULL);
     assert(out_touch != NULL);
 
@@ -72,8 +79,9 @@ esp_err_t esp_lcd_touch_new_i2c_gt911(const esp_lcd_panel_io_handle_t io, const
     esp_lcd_touch_handle_t esp_lcd_touch_gt911 = heap_caps_calloc(1, sizeof(esp_lcd_touch_t), MALLOC_CAP_DEFAULT);
     ESP_GOTO_ON_FALSE(esp_lcd_touch_gt911, ESP_ERR_NO_MEM, err, TAG, "no mem for GT911 controller");
 
-    /* Communication interface */
-    esp_lcd_touch_gt911->io = io;
+    /* Communication interface: transactions go through the bus service, not a panel IO */
+    s_dev = dev;
+    esp_lcd_touch_gt911->io = NULL;
 
     /* Only supported callbacks are set */
     esp_lcd_touch_gt911->read_data = esp_lcd_touch_gt911_read_data;
@@ -225,7 +233,8 @@ static esp_err_t esp_lcd_touch_gt911_read_data(esp_lcd_touch_handle_t tp)
 
     assert(tp != NULL);
 
-    err = touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, buf, 1);
+    /* Status and first point in one read: a single touch costs one transaction */
+    err = touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, buf, 9);
     ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
 
     /* Any touch data? */
@@ -268,9 +277,11 @@ static esp_err_t esp_lcd_touch_gt911_read_data(esp_lcd_touch_handle_t tp)
             return ESP_OK;
         }
 
-        /* Read all points */
-        err = touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG + 1, &buf[1], touch_cnt * 8);
-        ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
+        /* Read the remaining points */
+        if (touch_cnt > 1) {
+            err = touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG + 9, &buf[9], (touch_cnt - 1) * 8);
+            ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
+        }
 
         /* Clear all */
         err = touch_gt911_i2c_write(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, clear);
@@ -373,33 +384,45 @@ static esp_err_t esp_lcd_touch_gt911_del(esp_lcd_touch_handle_t tp)
 // Function to initialize the GT911 touch controller
 esp_err_t touch_gt911_init(esp_lcd_touch_handle_t *out_touch)
 {
-    esp_lcd_panel_io_handle_t tp_io_handle = NULL;  // Declare a handle for touch panel I/O
-    const esp_lcd_panel_io_i2c_config_t tp_io_config = ESP_LCD_TOUCH_IO_I2C_GT911_CONFIG();
+    i2c_bus_dev_t dev = NULL;
 
-    DEV_I2C_Port port = DEV_I2C_Init();  // Initialize I2C port
-    IO_EXTENSION_Init();  // Initialize the IO extension for DISP and TP_RST control
+    /*
+     * The bus and the IO extension are shared with the panel, which may be
+     * starting on the other core: they are only started here if nobody did
+     * (both calls do nothing when running) and never stopped on failure.
+     * The application stops them in its cleanup, after every user.
+     */
+    DEV_I2C_Init();  // Start the shared I2C bus service
+    esp_err_t ret = IO_EXTENSION_Init();  // Initialize the IO extension for TP_RST control
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "IO extension init failed: %s", esp_err_to_name(ret));
+        return ESP_ERR_INVALID_STATE;
+    }
     DEV_GPIO_Mode(EXAMPLE_PIN_NUM_TOUCH_INT, GPIO_MODE_OUTPUT);  // Drive INT pin during reset sequence
 
-    /* Keep display backlight off and hold touch reset low */
-    IO_EXTENSION_Output(IO_EXTENSION_IO_2, 0);  // DISP off
+    /*
+     * GT911 reset with address selection, timed like the datasheet and the
+     * esp_lcd_touch driver: INT low (address 0x5D) while TP_RST is low, held
+     * a few ms past the reset, then 50 ms before the first I2C command. DISP
+     * belongs to the panel (rgb_lcd_port) and is left alone, so a splash
+     * already on screen stays visible.
+     */
+    DEV_Digital_Write(EXAMPLE_PIN_NUM_TOUCH_INT, 0);
     IO_EXTENSION_Output(IO_EXTENSION_IO_1, 0);  // Assert TP_RST low
+    IO_EXTENSION_Flush();
+    vTaskDelay(pdMS_TO_TICKS(GT911_RESET_LOW_MS));
 
-    vTaskDelay(pdMS_TO_TICKS(100));
-    DEV_Digital_Write(EXAMPLE_PIN_NUM_TOUCH_INT, 0);  // Set interrupt pin low (disable interrupt)
-
-    vTaskDelay(pdMS_TO_TICKS(100));
     IO_EXTENSION_Output(IO_EXTENSION_IO_1, 1);  // Release TP_RST
-    IO_EXTENSION_Output(IO_EXTENSION_IO_2, 1);  // Enable DISP
-
-    vTaskDelay(pdMS_TO_TICKS(200));  // Wait for 200ms to ensure the touch controller is ready
+    IO_EXTENSION_Flush();
+    vTaskDelay(pdMS_TO_TICKS(GT911_INT_HOLD_MS));
     DEV_GPIO_Mode(EXAMPLE_PIN_NUM_TOUCH_INT, GPIO_MODE_INPUT);
+    vTaskDelay(pdMS_TO_TICKS(GT911_READY_MS));
     gpio_set_intr_type(EXAMPLE_PIN_NUM_TOUCH_INT, GPIO_INTR_NEGEDGE);
 
-    ESP_LOGI(TAG, "Initialize I2C panel IO");
-    esp_err_t ret = esp_lcd_new_panel_io_i2c(port.bus, &tp_io_config, &tp_io_handle);
+    ESP_LOGI(TAG, "Add GT911 to the I2C bus");
+    ret = i2c_bus_add_device(ESP_LCD_TOUCH_IO_I2C_GT911_ADDRESS, 2, "gt911", &dev);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Panel IO init failed: %s", esp_err_to_name(ret));
-        DEV_I2C_Deinit();
+        ESP_LOGE(TAG, "I2C device init failed: %s", esp_err_to_name(ret));
         return ESP_ERR_INVALID_STATE;
     }
 
@@ -426,14 +449,10 @@ esp_err_t touch_gt911_init(esp_lcd_touch_handle_t *out_touch)
     };
 
     // Create a new touch controller instance using the configured I2C and settings
-    ret = esp_lcd_touch_new_i2c_gt911(tp_io_handle, &tp_cfg, &tp_handle);
+    ret = esp_lcd_touch_new_i2c_gt911(dev, &tp_cfg, &tp_handle);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "GT911 init failed: %s", esp_err_to_name(ret));
-        if (tp_io_handle) {
-            esp_lcd_panel_io_del(tp_io_handle);
-            tp_io_handle = NULL;
-        }
-        DEV_I2C_Deinit();
+        s_dev = NULL;  // The bus service keeps the device until it stops
         return ESP_ERR_INVALID_STATE;
     }
 
@@ -444,7 +463,7 @@ esp_err_t touch_gt911_init(esp_lcd_touch_handle_t *out_touch)
     return ESP_OK;  // Initialization successful
 }
 
-// Function to deinitialize the GT911 touch controller and I2C resources
+// Function to deinitialize the GT911 touch controller (the shared bus stays up)
 void touch_gt911_deinit(void)
 {
     // Delete touch controller instance if initialized
@@ -453,16 +472,8 @@ void touch_gt911_deinit(void)
         tp_handle = NULL;
         s_touch_handle = NULL;
     }
-
-    // Release I2C device and bus
-    if (handle.dev) {
-        i2c_master_bus_rm_device(handle.dev);
-        handle.dev = NULL;
-    }
-    if (handle.bus) {
-        i2c_del_master_bus(handle.bus);
-        handle.bus = NULL;
-    }
+    // The device itself belongs to the bus service, released when it stops
+    s_dev = NULL;
 }
 
 // Function to read touch points from the GT911 touch controller
@@ -471,7 +482,9 @@ touch_gt911_point_t touch_gt911_read_point(uint8_t max_touch_cnt)
     touch_gt911_point_t data;  // Declare a structure to hold touch point data
 
     /* Read touch data from the touch controller */
+    TRACE_BEGIN("touch_read");
     esp_lcd_touch_read_data(tp_handle);  // Read raw data from the touch controller
+    TRACE_END("touch_read");
 
     /* Get the touch coordinates and count of touch points */
     esp_lcd_touch_get_coordinates(tp_handle, data.x, data.y, NULL, &data.cnt, max_touch_cnt);
@@ -504,16 +517,15 @@ static esp_err_t touch_gt911_i2c_read(esp_lcd_touch_handle_t tp, uint16_t reg, u
     assert(tp != NULL);
     assert(data != NULL);
 
-    /* Read data */
-    return esp_lcd_panel_io_rx_param(tp->io, reg, data, len);
+    /* Read data, ahead of any other queued bus traffic */
+    return i2c_bus_read_reg(s_dev, I2C_BUS_PRIO_TOUCH, reg, data, len);
 }
 
 static esp_err_t touch_gt911_i2c_write(esp_lcd_touch_handle_t tp, uint16_t reg, uint8_t data)
 {
     assert(tp != NULL);
 
-    // *INDENT-OFF*
-    /* Write data */
-    return esp_lcd_panel_io_tx_param(tp->io, reg, (uint8_t[]){data}, 1);
-    // *INDENT-ON*
+    /* Write data; nothing waits on it, so it completes in the background */
+    const uint8_t buf[3] = {reg >> 8, reg & 0xff, data};
+    return i2c_bus_write_async(s_dev, I2C_BUS_PRIO_TOUCH, buf, sizeof(buf), NULL, NULL);
 }
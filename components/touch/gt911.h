@@ -58,16 +58,17 @@ typedef struct {
  * This function initializes a new instance of the GT911 touch driver by configuring
  * the touch screen using the I2C communication protocol.
  *
- * @note The I2C communication should be initialized before calling this function.
+ * @note The I2C bus service should be running before calling this function.
  *
- * @param io LCD/Touch panel I/O handle to interface with the I2C bus.
+ * @param dev GT911 device on the I2C bus service (16-bit registers).
  * @param config Configuration structure with touch screen settings (resolution, GPIO, etc.).
  * @param out_touch Output handle for the touch driver instance.
  * @return
  *      - ESP_OK: Successfully created a new touch driver instance
  *      - ESP_ERR_NO_MEM: Insufficient memory to allocate the touch instance
  */
-esp_err_t esp_lcd_touch_new_i2c_gt911(const esp_lcd_panel_io_handle_t io, const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *out_touch);
+struct i2c_bus_dev;
+esp_err_t esp_lcd_touch_new_i2c_gt911(struct i2c_bus_dev *dev, const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *out_touch);
 
 /**
  * @brief Initialize the GT911 touch controller
@@ -94,7 +95,11 @@ esp_err_t touch_gt911_init(esp_lcd_touch_handle_t *out_touch);
 touch_gt911_point_t touch_gt911_read_point(uint8_t max_touch_cnt);
 
 /**
- * @brief Deinitialize the GT911 touch controller and release I2C resources
+ * @brief Deinitialize the GT911 touch controller
+ *
+ * The shared I2C bus and the IO extension are left running: they also
+ * serve the panel. Stop them with IO_EXTENSION_Deinit() and
+ * DEV_I2C_Deinit() once every user is done.
  */
 void touch_gt911_deinit(void);
 
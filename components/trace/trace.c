@@ -0,0 +1,322 @@
+#include "trace.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "esp_console.h"
+#endif
+
+#define TRACE_MIN_EVENTS    64
+#define TRACE_MAX_TASKS     31 /* tid 31 collects tasks beyond the table */
+#define TRACE_TASK_NAME_LEN 16
+#define TRACE_OUT_CHUNK     1024
+
+static const char *TAG = "trace";
+
+typedef struct {
+    int64_t ts;       /*!< esp_timer_get_time(), us */
+    const char *name; /*!< String literal */
+    int32_t value;    /*!< Counter value */
+    uint8_t tid;      /*!< Index in s_tasks */
+    uint8_t type;     /*!< trace_event_type_t, 0 for an empty slot; written last */
+} trace_event_t;
+
+typedef struct {
+    trace_event_t *events;
+    uint32_t head; /*!< Slots ever claimed; the slot is head & s_mask */
+} trace_ring_t;
+
+static trace_ring_t s_rings[portNUM_PROCESSORS];
+static uint32_t s_mask;
+static volatile bool s_running;
+
+/* Tasks get an id on their first event. Entries are only appended, so
+ * readers scan [0, s_task_count) without the lock. */
+static struct {
+    TaskHandle_t handle;
+    char name[TRACE_TASK_NAME_LEN];
+} s_tasks[TRACE_MAX_TASKS];
+static uint32_t s_task_count;
+static portMUX_TYPE s_task_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t trace_init(size_t events_per_core)
+{
+    if (s_rings[0].events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t n = TRACE_MIN_EVENTS;
+    while (n * 2 <= events_per_core) {
+        n *= 2;
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+        trace_event_t *ev = heap_caps_calloc(n, sizeof(trace_event_t), MALLOC_CAP_SPIRAM);
+        if (!ev) {
+            ev = heap_caps_calloc(n, sizeof(trace_event_t), MALLOC_CAP_DEFAULT);
+        }
+        if (!ev) {
+            for (int i = 0; i < core; ++i) {
+                heap_caps_free(s_rings[i].events);
+                s_rings[i].events = NULL;
+            }
+            return ESP_ERR_NO_MEM;
+        }
+        s_rings[core].events = ev;
+        s_rings[core].head = 0;
+    }
+    s_mask = (uint32_t)n - 1;
+    s_running = true;
+    ESP_LOGI(TAG, "%u events per core", (unsigned)n);
+    return ESP_OK;
+}
+
+static uint8_t task_id(TaskHandle_t task)
+{
+    uint32_t n = __atomic_load_n(&s_task_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < n; ++i) {
+        if (s_tasks[i].handle == task) {
+            return (uint8_t)i;
+        }
+    }
+    /* First event of this task: slow path, once per task */
+    portENTER_CRITICAL(&s_task_lock);
+    uint32_t id = TRACE_MAX_TASKS;
+    for (uint32_t i = n; i < s_task_count; ++i) {
+        if (s_tasks[i].handle == task) {
+            id = i;
+            break;
+        }
+    }
+    if (id == TRACE_MAX_TASKS && s_task_count < TRACE_MAX_TASKS) {
+        id = s_task_count;
+        const char *name = pcTaskGetName(task);
+        size_t len = 0;
+        /* Kept JSON-safe: names are written without escaping */
+        for (; name && name[len] && len < TRACE_TASK_NAME_LEN - 1; ++len) {
+            char c = name[len];
+            s_tasks[id].name[len] = (c == '"' || c == '\\' || c < ' ') ? '_' : c;
+        }
+        s_tasks[id].name[len] = '\0';
+        s_tasks[id].handle = task;
+        __atomic_store_n(&s_task_count, id + 1, __ATOMIC_RELEASE);
+    }
+    portEXIT_CRITICAL(&s_task_lock);
+    return (uint8_t)id;
+}
+
+void trace_record(trace_event_type_t type, const char *name, int32_t value)
+{
+    if (!s_running) {
+        return;
+    }
+    int64_t ts = esp_timer_get_time();
+    uint8_t tid = task_id(xTaskGetCurrentTaskHandle());
+    /* A task moved to the other core since xPortGetCoreID() still claims a
+     * slot atomically, it only lands in the other ring. */
+    trace_ring_t *r = &s_rings[xPortGetCoreID()];
+    uint32_t slot = __atomic_fetch_add(&r->head, 1, __ATOMIC_RELAXED) & s_mask;
+    trace_event_t *ev = &r->events[slot];
+    __atomic_store_n(&ev->type, 0, __ATOMIC_RELAXED);
+    ev->ts = ts;
+    ev->name = name;
+    ev->value = value;
+    ev->tid = tid;
+    __atomic_store_n(&ev->type, (uint8_t)type, __ATOMIC_RELEASE);
+}
+
+void trace_start(void)
+{
+    s_running = s_rings[0].events != NULL;
+}
+
+void trace_stop(void)
+{
+    s_running = false;
+}
+
+bool trace_is_running(void)
+{
+    return s_running;
+}
+
+void trace_clear(void)
+{
+    bool was_running = s_running;
+    s_running = false;
+    for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+        if (s_rings[core].events) {
+            memset(s_rings[core].events, 0, (s_mask + 1) * sizeof(trace_event_t));
+        }
+        __atomic_store_n(&s_rings[core].head, 0, __ATOMIC_RELAXED);
+    }
+    s_running = was_running;
+}
+
+typedef struct {
+    trace_write_fn_t write;
+    void *ctx;
+    esp_err_t err;
+    size_t len;
+    char buf[TRACE_OUT_CHUNK];
+} json_out_t;
+
+static void out_flush(json_out_t *o)
+{
+    if (o->err == ESP_OK && o->len > 0) {
+        o->err = o->write(o->ctx, o->buf, o->len);
+    }
+    o->len = 0;
+}
+
+static void out_printf(json_out_t *o, const char *fmt, ...)
+{
+    char line[160];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n >= sizeof(line)) {
+        n = sizeof(line) - 1;
+    }
+    if (o->len + (size_t)n > sizeof(o->buf)) {
+        out_flush(o);
+    }
+    memcpy(o->buf + o->len, line, (size_t)n);
+    o->len += (size_t)n;
+}
+
+static void out_thread_name(json_out_t *o, uint32_t tid, const char *name, bool *first)
+{
+    out_printf(o, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%" PRIu32
+                  ",\"args\":{\"name\":\"%s\"}}",
+               *first ? "" : ",\n", tid, name);
+    *first = false;
+}
+
+static void out_event(json_out_t *o, const trace_event_t *ev, bool *first)
+{
+    const char *sep = *first ? "" : ",\n";
+    *first = false;
+    switch (ev->type) {
+    case TRACE_EV_COUNTER:
+        out_printf(o, "%s{\"ph\":\"C\",\"name\":\"%s\",\"ts\":%" PRId64
+                      ",\"pid\":1,\"tid\":%u,\"args\":{\"value\":%" PRId32 "}}",
+                   sep, ev->name, ev->ts, ev->tid, ev->value);
+        break;
+    case TRACE_EV_INSTANT:
+        out_printf(o, "%s{\"ph\":\"i\",\"s\":\"t\",\"name\":\"%s\",\"ts\":%" PRId64
+                      ",\"pid\":1,\"tid\":%u}",
+                   sep, ev->name, ev->ts, ev->tid);
+        break;
+    default:
+        out_printf(o, "%s{\"ph\":\"%c\",\"name\":\"%s\",\"ts\":%" PRId64 ",\"pid\":1,\"tid\":%u}",
+                   sep, ev->type, ev->name, ev->ts, ev->tid);
+        break;
+    }
+}
+
+esp_err_t trace_export_json(trace_write_fn_t write, void *ctx)
+{
+    if (!write) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_rings[0].events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    json_out_t *o = malloc(sizeof(json_out_t));
+    if (!o) {
+        return ESP_ERR_NO_MEM;
+    }
+    o->write = write;
+    o->ctx = ctx;
+    o->err = ESP_OK;
+    o->len = 0;
+
+    bool was_running = s_running;
+    s_running = false;
+    bool first = true;
+    out_printf(o, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    uint32_t tasks = __atomic_load_n(&s_task_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < tasks; ++i) {
+        out_thread_name(o, i, s_tasks[i].name, &first);
+    }
+    if (tasks == TRACE_MAX_TASKS) {
+        out_thread_name(o, TRACE_MAX_TASKS, "other", &first);
+    }
+    for (int core = 0; core < portNUM_PROCESSORS && o->err == ESP_OK; ++core) {
+        const trace_ring_t *r = &s_rings[core];
+        uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint32_t count = head > s_mask + 1 ? s_mask + 1 : head;
+        for (uint32_t i = head - count; i != head && o->err == ESP_OK; ++i) {
+            const trace_event_t *ev = &r->events[i & s_mask];
+            if (__atomic_load_n(&ev->type, __ATOMIC_ACQUIRE) != 0) {
+                out_event(o, ev, &first);
+            }
+        }
+    }
+    out_printf(o, "\n]}\n");
+    out_flush(o);
+    s_running = was_running;
+
+    esp_err_t err = o->err;
+    free(o);
+    return err;
+}
+
+esp_err_t trace_write_file(void *ctx, const char *data, size_t len)
+{
+    return fwrite(data, 1, len, (FILE *)ctx) == len ? ESP_OK : ESP_FAIL;
+}
+
+#ifdef ESP_PLATFORM
+static int cmd_trace(int argc, char **argv)
+{
+    const char *action = argc > 1 ? argv[1] : "";
+    if (strcmp(action, "start") == 0) {
+        trace_start();
+    } else if (strcmp(action, "stop") == 0) {
+        trace_stop();
+    } else if (strcmp(action, "clear") == 0) {
+        trace_clear();
+    } else if (strcmp(action, "dump") == 0) {
+        fputs("TRACE-BEGIN\n", stdout);
+        esp_err_t err = trace_export_json(trace_write_file, stdout);
+        fputs("TRACE-END\n", stdout);
+        fflush(stdout);
+        return err == ESP_OK ? 0 : 1;
+    } else if (argc == 1) {
+        uint32_t buffered = 0;
+        for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+            uint32_t head = s_rings[core].head;
+            buffered += head > s_mask + 1 ? s_mask + 1 : head;
+        }
+        printf("%s, %" PRIu32 " events buffered, %" PRIu32 " per core\n",
+               s_running ? "recording" : "stopped", buffered,
+               s_rings[0].events ? s_mask + 1 : 0);
+    } else {
+        printf("usage: trace [start|stop|clear|dump]\n");
+        return 1;
+    }
+    return 0;
+}
+
+esp_err_t trace_console_register(void)
+{
+    const esp_console_cmd_t cmd = {
+        .command = "trace",
+        .help = "Timeline trace: trace [start|stop|clear|dump]; dump prints Chrome trace JSON",
+        .hint = NULL,
+        .func = cmd_trace,
+    };
+    return esp_console_cmd_register(&cmd);
+}
+#endif
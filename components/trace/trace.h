@@ -0,0 +1,84 @@
+#pragma once
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * System-wide timeline trace.
+ *
+ * Every core has its own ring of fixed-size events; a writer claims a slot
+ * with one atomic increment and fills it, so recording never takes a lock
+ * and never blocks. The rings wrap, keeping the most recent events: the
+ * recorder runs from trace_init() on, and the last seconds before a slow
+ * image switch can be dumped after the fact as Chrome trace JSON (open it
+ * in ui.perfetto.dev or chrome://tracing).
+ *
+ * Event names are stored by pointer and must be string literals.
+ */
+
+#if CONFIG_APP_TRACE
+#define TRACE_BEGIN(name)          trace_record(TRACE_EV_BEGIN, (name), 0)
+#define TRACE_END(name)            trace_record(TRACE_EV_END, (name), 0)
+#define TRACE_COUNTER(name, value) trace_record(TRACE_EV_COUNTER, (name), (int32_t)(value))
+#define TRACE_INSTANT(name)        trace_record(TRACE_EV_INSTANT, (name), 0)
+#else
+#define TRACE_BEGIN(name)          ((void)0)
+#define TRACE_END(name)            ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_INSTANT(name)        ((void)0)
+#endif
+
+/** Chrome trace phases */
+typedef enum {
+    TRACE_EV_BEGIN = 'B',
+    TRACE_EV_END = 'E',
+    TRACE_EV_COUNTER = 'C',
+    TRACE_EV_INSTANT = 'i',
+} trace_event_type_t;
+
+/**
+ * Sink for trace_export_json(). Called with consecutive pieces of the
+ * document; a non-ESP_OK return aborts the export.
+ */
+typedef esp_err_t (*trace_write_fn_t)(void *ctx, const char *data, size_t len);
+
+/**
+ * @brief Allocate @p events_per_core events per core (rounded down to a
+ * power of two, in PSRAM when available) and start recording.
+ */
+esp_err_t trace_init(size_t events_per_core);
+
+/** Add one event for the calling task. No-op before trace_init() or when stopped. */
+void trace_record(trace_event_type_t type, const char *name, int32_t value);
+
+/** Resume or pause recording; the buffered events are kept. */
+void trace_start(void);
+void trace_stop(void);
+bool trace_is_running(void);
+
+/** Drop every buffered event. */
+void trace_clear(void);
+
+/**
+ * @brief Write the buffered events as one Chrome trace JSON object, with a
+ * thread_name record per task. Recording is paused while exporting.
+ */
+esp_err_t trace_export_json(trace_write_fn_t write, void *ctx);
+
+/** trace_write_fn_t writing to a FILE *. */
+esp_err_t trace_write_file(void *ctx, const char *data, size_t len);
+
+#ifdef ESP_PLATFORM
+/** Add the `trace` command to the esp_console REPL. */
+esp_err_t trace_console_register(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,372 @@
+#include "uart_transport.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "UART_TP";
+
+#define EVENT_QUEUE_LEN 16
+#define TASK_STACK 3072
+#define TX_DONE_TIMEOUT_MS 200
+#define DRIVER_MIN_BUF 256
+// Posted by uart_transport_close(), never by the driver
+#define EVENT_STOP UART_EVENT_MAX
+
+#define SLIP_END     0xC0
+#define SLIP_ESC     0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+struct uart_transport {
+    uart_transport_config_t cfg;
+    QueueHandle_t events;
+    TaskHandle_t task;
+    TaskHandle_t closer; /* Notified when the task has left its loop */
+    volatile bool stop;
+    SemaphoreHandle_t tx_lock;
+    uint8_t *rx;
+    size_t rx_len;
+    bool discard; /* A line error hit the frame being received */
+    uint8_t *tx;
+    size_t tx_len;
+    portMUX_TYPE stats_lock;
+    uart_transport_stats_t stats;
+};
+
+size_t uart_framer_line(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame)
+{
+    const uint8_t *lf = memchr(buf, '\n', len);
+    if (!lf) {
+        return 0;
+    }
+    size_t n = lf - buf;
+    frame->data = buf;
+    frame->len = n > 0 && buf[n - 1] == '\r' ? n - 1 : n;
+    return n + 1;
+}
+
+size_t uart_framer_slip(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame)
+{
+    const uint8_t *end = memchr(buf, SLIP_END, len);
+    if (!end) {
+        return 0;
+    }
+    size_t n = end - buf;
+    size_t out = 0;
+    bool ok = true;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t c = buf[i];
+        if (c == SLIP_ESC) {
+            c = i + 1 < n ? buf[++i] : 0;
+            if (c == SLIP_ESC_END) {
+                c = SLIP_END;
+            } else if (c == SLIP_ESC_ESC) {
+                c = SLIP_ESC;
+            } else {
+                ok = false;
+                break;
+            }
+        }
+        buf[out++] = c;
+    }
+    frame->data = ok ? buf : NULL;
+    frame->len = ok ? out : 0;
+    return n + 1;
+}
+
+size_t uart_framer_modbus(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame)
+{
+    if (!idle) {
+        return 0;
+    }
+    frame->data = buf;
+    frame->len = len;
+    return len;
+}
+
+size_t uart_framer_len16(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame)
+{
+    size_t need = len >= 2 ? 2 + (buf[0] << 8 | buf[1]) : 2;
+    if (len < need) {
+        return 0;
+    }
+    frame->data = buf + 2;
+    frame->len = need - 2;
+    return need;
+}
+
+static void count(uart_transport_t *t, uint32_t *field, uint32_t n)
+{
+    portENTER_CRITICAL(&t->stats_lock);
+    *field += n;
+    portEXIT_CRITICAL(&t->stats_lock);
+}
+
+/* Cut every complete frame out of the buffer, then move the rest to the front */
+static void run_framer(uart_transport_t *t, bool idle)
+{
+    size_t off = 0;
+    while (off < t->rx_len) {
+        uart_frame_t f = { 0 };
+        size_t used = t->cfg.framer(t->rx + off, t->rx_len - off, idle, &f);
+        if (used == 0) {
+            break;
+        }
+        off += used;
+        if (!f.data) {
+            count(t, &t->stats.noise_bytes, used);
+            continue;
+        }
+        if (t->discard) {
+            t->discard = false;
+            continue;
+        }
+        if (f.len == 0) {
+            continue;
+        }
+        count(t, &t->stats.frames, 1);
+        t->cfg.on_frame(t->cfg.arg, f.data, f.len);
+    }
+    t->rx_len -= off;
+    if (t->rx_len > 0 && off > 0) {
+        memmove(t->rx, t->rx + off, t->rx_len);
+    }
+    if (t->rx_len == t->cfg.rx_buf_size) {
+        // No boundary in a full buffer: nothing to salvage
+        count(t, &t->stats.oversize, 1);
+        t->rx_len = 0;
+        t->discard = false;
+    }
+}
+
+static void receive(uart_transport_t *t, size_t size, bool idle)
+{
+    while (size > 0) {
+        size_t want = t->cfg.rx_buf_size - t->rx_len;
+        if (want > size) {
+            want = size;
+        }
+        int n = uart_read_bytes(t->cfg.port, t->rx + t->rx_len, want, pdMS_TO_TICKS(10));
+        if (n <= 0) {
+            break;
+        }
+        t->rx_len += n;
+        size -= n;
+        count(t, &t->stats.rx_bytes, n);
+        run_framer(t, idle && size == 0);
+    }
+}
+
+static void transport_task(void *arg)
+{
+    uart_transport_t *t = arg;
+    uart_event_t evt;
+    while (!t->stop) {
+        TRACE_BEGIN("uart_wait");
+        BaseType_t got = xQueueReceive(t->events, &evt, portMAX_DELAY);
+        TRACE_END("uart_wait");
+        if (got != pdTRUE) {
+            continue;
+        }
+        switch (evt.type) {
+        case UART_DATA:
+            receive(t, evt.size, evt.timeout_flag);
+            break;
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            // Bytes were lost: drop everything and resynchronise
+            uart_flush_input(t->cfg.port);
+            xQueueReset(t->events);
+            t->rx_len = 0;
+            t->discard = false;
+            count(t, &t->stats.overruns, 1);
+            break;
+        case UART_PARITY_ERR:
+        case UART_FRAME_ERR:
+            t->discard = true;
+            count(t, &t->stats.framing_errors, 1);
+            break;
+        default:
+            break;
+        }
+    }
+    // t may be freed as soon as the closer wakes up
+    xTaskNotifyGive(t->closer);
+    vTaskDelete(NULL);
+}
+
+static void transport_free(uart_transport_t *t)
+{
+    if (t->tx_lock) {
+        vSemaphoreDelete(t->tx_lock);
+    }
+    free(t->rx);
+    free(t->tx);
+    free(t);
+}
+
+esp_err_t uart_transport_open(const uart_transport_config_t *cfg, uart_transport_t **out)
+{
+    if (!cfg || !out || !cfg->framer || !cfg->on_frame || cfg->rx_buf_size == 0 ||
+        cfg->tx_batch_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_transport_t *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->cfg = *cfg;
+    portMUX_INITIALIZE(&t->stats_lock);
+    t->rx = malloc(cfg->rx_buf_size);
+    t->tx = malloc(cfg->tx_batch_size);
+    t->tx_lock = xSemaphoreCreateMutex();
+    if (!t->rx || !t->tx || !t->tx_lock) {
+        transport_free(t);
+        return ESP_ERR_NO_MEM;
+    }
+
+    uart_config_t ucfg = {
+        .baud_rate = cfg->baud_rate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = cfg->parity,
+        .stop_bits = cfg->stop_bits,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    esp_err_t ret = uart_param_config(cfg->port, &ucfg);
+    if (ret == ESP_OK) {
+        ret = uart_set_pin(cfg->port, cfg->tx_pin, cfg->rx_pin, UART_PIN_NO_CHANGE,
+                           UART_PIN_NO_CHANGE);
+    }
+    if (ret == ESP_OK) {
+        // The driver's ring buffers hold two batches in flight, and must be
+        // larger than the hardware FIFO
+        size_t rx_ring = cfg->rx_buf_size * 2;
+        size_t tx_ring = cfg->tx_batch_size * 2;
+        ret = uart_driver_install(cfg->port, rx_ring > DRIVER_MIN_BUF ? rx_ring : DRIVER_MIN_BUF,
+                                  tx_ring > DRIVER_MIN_BUF ? tx_ring : DRIVER_MIN_BUF,
+                                  EVENT_QUEUE_LEN, &t->events, 0);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d setup failed: %s", cfg->port, esp_err_to_name(ret));
+        transport_free(t);
+        return ret;
+    }
+    bool soft_de = cfg->rs485 && cfg->de_pin != UART_PIN_NO_CHANGE;
+    if (cfg->rs485 && !soft_de) {
+        ret = uart_set_mode(cfg->port, UART_MODE_RS485_HALF_DUPLEX);
+    } else if (soft_de) {
+        gpio_set_direction(cfg->de_pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(cfg->de_pin, 0);
+    }
+    if (ret == ESP_OK && cfg->rx_timeout) {
+        ret = uart_set_rx_timeout(cfg->port, cfg->rx_timeout);
+    }
+    if (ret == ESP_OK &&
+        xTaskCreate(transport_task, cfg->task_name ? cfg->task_name : "uart_transport",
+                    TASK_STACK, t, cfg->task_priority, &t->task) != pdPASS) {
+        ret = ESP_ERR_NO_MEM;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d start failed: %s", cfg->port, esp_err_to_name(ret));
+        uart_driver_delete(cfg->port);
+        transport_free(t);
+        return ret;
+    }
+    *out = t;
+    return ESP_OK;
+}
+
+void uart_transport_close(uart_transport_t *t)
+{
+    if (!t) {
+        return;
+    }
+    // Let the task finish the frame in hand: on_frame may be holding tx_lock.
+    // The flag covers a stop event dropped by an overrun's queue reset.
+    t->closer = xTaskGetCurrentTaskHandle();
+    t->stop = true;
+    const uart_event_t stop = {.type = EVENT_STOP};
+    xQueueSend(t->events, &stop, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uart_driver_delete(t->cfg.port);
+    transport_free(t);
+}
+
+/* Called with tx_lock held */
+static esp_err_t flush_locked(uart_transport_t *t)
+{
+    if (t->tx_len == 0) {
+        return ESP_OK;
+    }
+    bool soft_de = t->cfg.rs485 && t->cfg.de_pin != UART_PIN_NO_CHANGE;
+    if (soft_de) {
+        gpio_set_level(t->cfg.de_pin, 1);
+        esp_rom_delay_us(t->cfg.de_lead_us);
+    }
+    int n = uart_write_bytes(t->cfg.port, t->tx, t->tx_len);
+    esp_err_t ret = n == (int)t->tx_len ? ESP_OK : ESP_FAIL;
+    if (soft_de) {
+        // DE must stay up until the stop bit of the last byte has left
+        if (uart_wait_tx_done(t->cfg.port, pdMS_TO_TICKS(TX_DONE_TIMEOUT_MS)) != ESP_OK) {
+            ret = ESP_ERR_TIMEOUT;
+        }
+        esp_rom_delay_us(t->cfg.de_tail_us);
+        gpio_set_level(t->cfg.de_pin, 0);
+    }
+    portENTER_CRITICAL(&t->stats_lock);
+    t->stats.tx_bytes += n > 0 ? n : 0;
+    t->stats.tx_batches++;
+    portEXIT_CRITICAL(&t->stats_lock);
+    t->tx_len = 0;
+    return ret;
+}
+
+esp_err_t uart_transport_write(uart_transport_t *t, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(t->tx_lock, portMAX_DELAY);
+    while (len > 0 && ret == ESP_OK) {
+        if (t->tx_len == t->cfg.tx_batch_size) {
+            ret = flush_locked(t);
+        }
+        size_t n = t->cfg.tx_batch_size - t->tx_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(t->tx + t->tx_len, p, n);
+        t->tx_len += n;
+        p += n;
+        len -= n;
+    }
+    xSemaphoreGive(t->tx_lock);
+    return ret;
+}
+
+esp_err_t uart_transport_flush(uart_transport_t *t)
+{
+    xSemaphoreTake(t->tx_lock, portMAX_DELAY);
+    esp_err_t ret = flush_locked(t);
+    xSemaphoreGive(t->tx_lock);
+    return ret;
+}
+
+esp_err_t uart_transport_send(uart_transport_t *t, const void *data, size_t len)
+{
+    esp_err_t ret = uart_transport_write(t, data, len);
+    return ret == ESP_OK ? uart_transport_flush(t) : ret;
+}
+
+void uart_transport_get_stats(uart_transport_t *t, uart_transport_stats_t *stats)
+{
+    portENTER_CRITICAL(&t->stats_lock);
+    *stats = t->stats;
+    portEXIT_CRITICAL(&t->stats_lock);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "driver/uart.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Buffered UART transport shared by the serial protocols.
+ *
+ * A task per port blocks on the UART driver's event queue and appends what
+ * arrives to a reassembly buffer. A framer then cuts frames out of that
+ * buffer in place, and the callback gets a pointer into it: no copy, no
+ * fixed-size reads, no polling. Bursts end on the UART receive timeout, so
+ * framers that rely on line silence (Modbus RTU) see it as @p idle.
+ *
+ * Transmission is batched: uart_transport_write() gathers bytes and
+ * uart_transport_flush() hands them to the driver in one contiguous write,
+ * which on RS485 is also one bus turnaround. DE is either driven by the
+ * UART's RTS in hardware half-duplex mode, or by a GPIO with configurable
+ * lead and tail times for transceivers that need them.
+ */
+
+/** A frame found by a framer, pointing into the reassembly buffer. */
+typedef struct {
+    const uint8_t *data; /*!< NULL when the consumed bytes are noise */
+    size_t len;
+} uart_frame_t;
+
+/**
+ * Look for one frame at the start of @p buf.
+ *
+ * The framer may rewrite @p buf in place (unescaping), never beyond the
+ * bytes it consumes. @p idle is true when the line went quiet after the
+ * last byte.
+ *
+ * @return Bytes consumed, 0 when more data is needed.
+ */
+typedef size_t (*uart_framer_t)(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame);
+
+/** Text lines ending in LF; a trailing CR is dropped. */
+size_t uart_framer_line(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame);
+/** SLIP (RFC 1055): frames end with 0xC0, unescaped in place. */
+size_t uart_framer_slip(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame);
+/** Modbus RTU: everything received before the line goes idle. */
+size_t uart_framer_modbus(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame);
+/**
+ * Big-endian 16-bit length, then that many bytes. Gaps inside a frame are
+ * allowed; a length beyond the buffer is dropped once the buffer fills.
+ */
+size_t uart_framer_len16(uint8_t *buf, size_t len, bool idle, uart_frame_t *frame);
+
+/** Called from the transport task; @p data is only valid during the call. */
+typedef void (*uart_frame_cb_t)(void *arg, const uint8_t *data, size_t len);
+
+typedef struct {
+    uart_port_t port;
+    int tx_pin;
+    int rx_pin;
+    int baud_rate;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    size_t rx_buf_size;   /*!< Reassembly buffer, bounds the largest frame */
+    size_t tx_batch_size; /*!< Bytes gathered before they must be flushed */
+    uint8_t rx_timeout;   /*!< Character times of silence that end a burst */
+    bool rs485;           /*!< Half-duplex RS485 */
+    int de_pin;           /*!< GPIO driving DE, UART_PIN_NO_CHANGE for hardware RTS */
+    uint16_t de_lead_us;  /*!< DE raised this long before the first bit */
+    uint16_t de_tail_us;  /*!< DE held this long after the last stop bit */
+    uart_framer_t framer;
+    uart_frame_cb_t on_frame;
+    void *arg;
+    const char *task_name;
+    UBaseType_t task_priority;
+} uart_transport_config_t;
+
+typedef struct {
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t frames;         /*!< Frames passed to on_frame */
+    uint32_t tx_batches;     /*!< Driver writes, one per flush */
+    uint32_t overruns;       /*!< FIFO or ring buffer overflows */
+    uint32_t framing_errors; /*!< Parity and framing errors; the frame is dropped */
+    uint32_t oversize;       /*!< Buffer filled without a frame boundary */
+    uint32_t noise_bytes;    /*!< Bytes the framer skipped */
+} uart_transport_stats_t;
+
+typedef struct uart_transport uart_transport_t;
+
+/**
+ * @brief Install the UART driver and start the receive task.
+ *
+ * @return ESP_ERR_INVALID_ARG without framer or callback, ESP_ERR_NO_MEM,
+ *         or the UART driver's error.
+ */
+esp_err_t uart_transport_open(const uart_transport_config_t *cfg, uart_transport_t **out);
+
+/**
+ * @brief Stop the task and delete the driver.
+ *
+ * Waits for the callback in progress to return, so it must not be called
+ * from on_frame.
+ */
+void uart_transport_close(uart_transport_t *t);
+
+/** Queue bytes for the next flush, flushing first when the batch is full. */
+esp_err_t uart_transport_write(uart_transport_t *t, const void *data, size_t len);
+
+/**
+ * Send the batch in one driver write. With a DE GPIO, also waits until the
+ * last byte is on the wire and the tail time has passed.
+ */
+esp_err_t uart_transport_flush(uart_transport_t *t);
+
+/** uart_transport_write() then uart_transport_flush(). */
+esp_err_t uart_transport_send(uart_transport_t *t, const void *data, size_t len);
+
+/** Counters since the transport was opened. */
+void uart_transport_get_stats(uart_transport_t *t, uart_transport_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,8 +5,13 @@
 #include "file_manager.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "gui.h"
+#include "image_pool.h"
 #include "lvgl.h"
+#include "png_stream.h"
 #include "sd.h"
+#include "trace.h"
+#include "ui_font.h"
 #include <dirent.h>
 #include <limits.h>
 #include <stdio.h>
@@ -17,9 +22,44 @@
 extern display_geometry_t g_display;
 extern char g_base_path[];
 
-static const char *s_folder_choice = NULL;
-static void folder_label_cb(lv_event_t *e) {
-  s_folder_choice = (const char *)lv_event_get_user_data(e);
+/* Clicked button of a selection screen, posted from lvgl_task */
+static QueueHandle_t s_choice_queue;
+
+static bool choice_queue_reset(void) {
+  if (!s_choice_queue) {
+    s_choice_queue = xQueueCreate(1, sizeof(intptr_t));
+    if (!s_choice_queue) {
+      ESP_LOGE("NAV", "xQueueCreate failed");
+      return false;
+    }
+  }
+  xQueueReset(s_choice_queue);
+  return true;
+}
+
+static void choice_cb(lv_event_t *e) {
+  intptr_t choice = (intptr_t)lv_event_get_user_data(e);
+  xQueueOverwrite(s_choice_queue, &choice);
+}
+
+static intptr_t wait_choice(void) {
+  intptr_t choice;
+  TRACE_BEGIN("nav_wait");
+  xQueueReceive(s_choice_queue, &choice, portMAX_DELAY);
+  TRACE_END("nav_wait");
+  return choice;
+}
+
+/* Load @p scr, wait for a click on one of its buttons, then delete it */
+static intptr_t run_selection_screen(lv_obj_t *scr) {
+  lv_scr_load(scr);
+  gui_unlock();
+  intptr_t choice = wait_choice();
+  gui_lock();
+  lv_scr_load(NULL); // unload selection screen to avoid it remaining active
+  lv_obj_del(scr);   // delete screen object to prevent RAM accumulation
+  gui_unlock();
+  return choice;
 }
 
 static bool is_folder_excluded(const char *name) {
@@ -50,7 +90,9 @@ const char *draw_folder_selection(void) {
   uint16_t text_y1 = g_display.height / TEXT_Y1_DIVISOR;
   uint16_t text_y2 = text_y1 + TEXT_LINE_SPACING;
 
-  s_folder_choice = NULL;
+  if (!choice_queue_reset()) {
+    return NULL;
+  }
 
   typedef struct {
     char **names;
@@ -134,6 +176,7 @@ const char *draw_folder_selection(void) {
     return NULL;
   }
 
+  gui_lock();
   lv_obj_t *scr = lv_obj_create(NULL);
   lv_obj_t *lbl_ok = lv_label_create(scr);
   lv_label_set_text(lbl_ok, "Carte SD OK !");
@@ -145,21 +188,15 @@ const char *draw_folder_selection(void) {
   uint16_t list_y = text_y2 + TEXT_LINE_SPACING;
   for (size_t i = 0; i < fl.count; ++i) {
     lv_obj_t *lbl = lv_label_create(scr);
+    lv_obj_set_style_text_font(lbl, &ui_font_text, LV_PART_MAIN);
     lv_label_set_text(lbl, fl.names[i]);
     lv_obj_set_pos(lbl, text_x, list_y + i * TEXT_LINE_SPACING);
     lv_obj_add_flag(lbl, LV_OBJ_FLAG_CLICKABLE);
-    lv_obj_add_event_cb(lbl, folder_label_cb, LV_EVENT_CLICKED, fl.names[i]);
+    lv_obj_add_event_cb(lbl, choice_cb, LV_EVENT_CLICKED, fl.names[i]);
     fl.labels[i] = lbl;
   }
 
-  lv_scr_load(scr);
-  while (s_folder_choice == NULL) {
-    vTaskDelay(pdMS_TO_TICKS(10));
-  }
-  const char *selected_dir = s_folder_choice;
-
-  lv_scr_load(NULL); // unload selection screen to avoid it remaining active
-  lv_obj_del(scr);   // delete screen object to prevent RAM accumulation
+  const char *selected_dir = (const char *)run_selection_screen(scr);
 
   for (size_t i = 0; i < fl.count; ++i) {
     if (fl.names[i] != selected_dir) {
@@ -168,30 +205,39 @@ const char *draw_folder_selection(void) {
   }
   free(fl.names);
   free(fl.labels);
-  s_folder_choice = NULL;
 
   return selected_dir;
 }
 
 static QueueHandle_t s_nav_queue;
-static volatile int s_src_choice = -1;
+static nav_cmd_cb_t s_cmd_cb;
 static lv_obj_t *s_fname_bar = NULL;
 static lv_obj_t *s_fname_label = NULL;
 static lv_obj_t *s_main_img = NULL;
-
-static void source_btn_cb(lv_event_t *e) {
-  s_src_choice = (int)lv_event_get_user_data(e);
-}
+/* Two descriptors so the one on screen stays valid while switching */
+static lv_image_dsc_t s_mem_dsc[2];
+static int s_mem_slot = -1;
+/* Images decoded while downloading, see ui_navigation_stream_begin() */
+static png_stream_t *s_stream;
+static lv_draw_buf_t s_stream_buf[2];
+static int s_stream_slot = -1;
+static lv_timer_t *s_stream_timer;
+static volatile bool s_stream_dirty;
 
 static void nav_btn_cb(lv_event_t *e) {
   nav_cmd_t cmd = (nav_cmd_t)(intptr_t)lv_event_get_user_data(e);
-  if (s_nav_queue) {
+  if (s_cmd_cb) {
+    s_cmd_cb(cmd);
+  } else if (s_nav_queue) {
     xQueueSend(s_nav_queue, &cmd, 0);
   }
 }
 
 image_source_t draw_source_selection(void) {
-  s_src_choice = -1;
+  if (!choice_queue_reset()) {
+    return IMAGE_SOURCE_LOCAL;
+  }
+  gui_lock();
   lv_obj_t *scr = lv_obj_create(NULL);
 
   uint16_t btnL_x0 = g_display.margin_left;
@@ -205,7 +251,7 @@ image_source_t draw_source_selection(void) {
   lv_obj_t *btn_local = lv_btn_create(scr);
   lv_obj_set_size(btn_local, BTN_WIDTH, BTN_HEIGHT);
   lv_obj_set_pos(btn_local, btnL_x0, btnL_y0);
-  lv_obj_add_event_cb(btn_local, source_btn_cb, LV_EVENT_CLICKED,
+  lv_obj_add_event_cb(btn_local, choice_cb, LV_EVENT_CLICKED,
                       (void *)IMAGE_SOURCE_LOCAL);
   lv_obj_t *lbl_local = lv_label_create(btn_local);
   lv_label_set_text(lbl_local, "Locales");
@@ -213,7 +259,7 @@ image_source_t draw_source_selection(void) {
   lv_obj_t *btn_remote = lv_btn_create(scr);
   lv_obj_set_size(btn_remote, BTN_WIDTH, BTN_HEIGHT);
   lv_obj_set_pos(btn_remote, btnR_x0, btnR_y0);
-  lv_obj_add_event_cb(btn_remote, source_btn_cb, LV_EVENT_CLICKED,
+  lv_obj_add_event_cb(btn_remote, choice_cb, LV_EVENT_CLICKED,
                       (void *)IMAGE_SOURCE_REMOTE);
   lv_obj_t *lbl_remote = lv_label_create(btn_remote);
   lv_label_set_text(lbl_remote, "Distantes");
@@ -221,18 +267,12 @@ image_source_t draw_source_selection(void) {
   lv_obj_t *btn_net = lv_btn_create(scr);
   lv_obj_set_size(btn_net, BTN_WIDTH, BTN_HEIGHT);
   lv_obj_set_pos(btn_net, btnN_x0, btnN_y0);
-  lv_obj_add_event_cb(btn_net, source_btn_cb, LV_EVENT_CLICKED,
+  lv_obj_add_event_cb(btn_net, choice_cb, LV_EVENT_CLICKED,
                       (void *)IMAGE_SOURCE_NETWORK);
   lv_obj_t *lbl_net = lv_label_create(btn_net);
   lv_label_set_text(lbl_net, "Source reseau");
 
-  lv_scr_load(scr);
-  while (s_src_choice == -1) {
-    vTaskDelay(pdMS_TO_TICKS(10));
-  }
-  lv_scr_load(NULL); // unload selection screen to avoid it remaining active
-  lv_obj_del(scr);   // delete screen object to prevent RAM accumulation
-  return (image_source_t)s_src_choice;
+  return (image_source_t)run_selection_screen(scr);
 }
 
 static void add_btn_img_or_label(lv_obj_t *btn, const char *img_path,
@@ -260,6 +300,7 @@ void draw_navigation_arrows(void) {
   } else {
     xQueueReset(s_nav_queue);
   }
+  gui_lock();
   lv_obj_t *scr = lv_scr_act();
   lv_obj_t *btn_left = lv_btn_create(scr);
   lv_obj_set_size(btn_left, ARROW_WIDTH, ARROW_HEIGHT);
@@ -300,46 +341,67 @@ void draw_navigation_arrows(void) {
   lv_obj_add_event_cb(btn_exit, nav_btn_cb, LV_EVENT_CLICKED,
                       (void *)(intptr_t)NAV_CMD_EXIT);
   add_btn_img_or_label(btn_exit, MOUNT_POINT "/pic/exit.png", "Exit");
+  gui_unlock();
 }
 
-nav_action_t handle_touch_navigation(int8_t *idx) {
-  nav_cmd_t cmd;
-  if (s_nav_queue &&
-      xQueueReceive(s_nav_queue, &cmd, pdMS_TO_TICKS(50)) == pdTRUE) {
-    if (cmd == NAV_CMD_ROTATE) {
-      if (png_list.size > 0) {
-        draw_filename_bar(png_list.items[*idx]);
-      }
-      return NAV_ROTATE;
-    }
-    if (cmd == NAV_CMD_HOME) {
-      return NAV_HOME;
+void ui_navigation_set_cmd_cb(nav_cmd_cb_t cb) { s_cmd_cb = cb; }
+
+nav_action_t ui_navigation_apply_cmd(nav_cmd_t cmd, int8_t *idx) {
+  if (cmd == NAV_CMD_ROTATE) {
+    return NAV_ROTATE;
+  }
+  if (cmd == NAV_CMD_HOME) {
+    return NAV_HOME;
+  }
+  if (cmd == NAV_CMD_EXIT) {
+    return NAV_EXIT;
+  }
+  if (cmd == NAV_CMD_NEXT || cmd == NAV_CMD_PREV) {
+    if (png_list.size == 0) {
+      return NAV_NONE;
     }
-    if (cmd == NAV_CMD_EXIT) {
-      return NAV_EXIT;
-    }
-    if (cmd == NAV_CMD_NEXT || cmd == NAV_CMD_PREV) {
-      if (png_list.size == 0) {
-        return NAV_NONE;
-      }
-      *idx += (int8_t)cmd;
-      if (*idx >= (int8_t)png_list.size) {
-        *idx = 0;
-      } else if (*idx < 0) {
-        *idx = (int8_t)png_list.size - 1;
-      }
-      draw_filename_bar(png_list.items[*idx]);
-      return NAV_SCROLL;
+    *idx += (int8_t)cmd;
+    if (*idx >= (int8_t)png_list.size) {
+      *idx = 0;
+    } else if (*idx < 0) {
+      *idx = (int8_t)png_list.size - 1;
     }
+    return NAV_SCROLL;
   }
   return NAV_NONE;
 }
 
-void draw_filename_bar(const char *path) {
-  const char *fname = strrchr(path, '/');
-  fname = fname ? fname + 1 : path;
+nav_action_t ui_navigation_apply_steps(int32_t steps, int8_t *idx) {
+  if (png_list.size == 0 || steps == 0) {
+    return NAV_NONE;
+  }
+  int32_t size = (int32_t)png_list.size;
+  int32_t next = (*idx + steps % size + size) % size;
+  *idx = (int8_t)next;
+  return NAV_SCROLL;
+}
+
+nav_action_t handle_touch_navigation(int8_t *idx) {
+  nav_cmd_t cmd;
+  TRACE_BEGIN("nav_wait");
+  bool got = s_nav_queue &&
+             xQueueReceive(s_nav_queue, &cmd, pdMS_TO_TICKS(50)) == pdTRUE;
+  TRACE_END("nav_wait");
+  return got ? ui_navigation_apply_cmd(cmd, idx) : NAV_NONE;
+}
+
+/* Post a command taking a private copy of @p text */
+static void post_text(gui_cmd_fn_t fn, const char *text) {
+  char *copy = strdup(text);
+  if (!copy || gui_post(fn, copy) != ESP_OK) {
+    ESP_LOGE("NAV", "UI update dropped");
+    free(copy);
+  }
+}
 
-  const lv_font_t *font = LV_FONT_DEFAULT;
+static void filename_bar_cmd(void *arg) {
+  const char *fname = arg;
+  const lv_font_t *font = &ui_font_text;
   lv_coord_t bar_h = font->line_height + 2 * FILENAME_BAR_PAD;
 
   if (!s_fname_bar || !lv_obj_is_valid(s_fname_bar)) {
@@ -351,6 +413,7 @@ void draw_filename_bar(const char *path) {
     s_fname_label = lv_label_create(s_fname_bar);
     lv_obj_set_style_text_color(s_fname_label, lv_color_hex(0xFFFFFF),
                                 LV_PART_MAIN);
+    lv_obj_set_style_text_font(s_fname_label, font, LV_PART_MAIN);
   }
 
   lv_obj_set_size(s_fname_bar, g_display.width, bar_h);
@@ -364,13 +427,38 @@ void draw_filename_bar(const char *path) {
   } else {
     lv_obj_set_style_transform_angle(s_fname_bar, 0, LV_PART_MAIN);
   }
+  free(arg);
 }
 
-void ui_navigation_show_image(const char *path) {
+void draw_filename_bar(const char *path) {
+  const char *fname = strrchr(path, '/');
+  post_text(filename_bar_cmd, fname ? fname + 1 : path);
+}
+
+static void message_cmd(void *arg) {
+  lv_obj_t *lbl = lv_label_create(lv_scr_act());
+  lv_label_set_text(lbl, arg);
+  lv_obj_center(lbl);
+  free(arg);
+}
+
+void ui_navigation_show_message(const char *text) {
+  post_text(message_cmd, text);
+}
+
+static void clear_cmd(void *arg) { lv_obj_clean(lv_scr_act()); }
+
+void ui_navigation_clear(void) {
+  if (gui_post(clear_cmd, NULL) != ESP_OK) {
+    ESP_LOGE("NAV", "UI update dropped");
+  }
+}
+
+static void show_src(const void *src) {
   if (!s_main_img || !lv_obj_is_valid(s_main_img)) {
     s_main_img = lv_img_create(lv_scr_act());
   }
-  lv_img_set_src(s_main_img, path);
+  lv_img_set_src(s_main_img, src);
   lv_obj_center(s_main_img);
   if (g_is_portrait) {
     lv_obj_set_style_transform_angle(s_main_img, 900, LV_PART_MAIN);
@@ -379,19 +467,204 @@ void ui_navigation_show_image(const char *path) {
   }
 }
 
+/* Forget the in-memory image in @p slot once nothing displays it anymore. */
+static void mem_slot_release(int slot) {
+  if (slot < 0 || s_mem_dsc[slot].data == NULL) {
+    return;
+  }
+  lv_image_cache_drop(&s_mem_dsc[slot]);
+  memset(&s_mem_dsc[slot], 0, sizeof(s_mem_dsc[slot]));
+}
+
+static void stream_slot_release(int slot) {
+  if (slot < 0 || s_stream_buf[slot].data == NULL) {
+    return;
+  }
+  lv_image_cache_drop(&s_stream_buf[slot]);
+  image_pool_free(s_stream_buf[slot].data);
+  memset(&s_stream_buf[slot], 0, sizeof(s_stream_buf[slot]));
+}
+
+static void show_path_cmd(void *arg) {
+  TRACE_INSTANT("show_image");
+  show_src(arg); // LVGL keeps its own copy of file paths
+  free(arg);
+  mem_slot_release(s_mem_slot);
+  s_mem_slot = -1;
+  stream_slot_release(s_stream_slot);
+  s_stream_slot = -1;
+}
+
+void ui_navigation_show_image(const char *path) {
+  post_text(show_path_cmd, path);
+}
+
+/* Applied under the lock rather than posted: the caller frees the data
+ * once another image was shown, which must not overtake this one */
+void ui_navigation_show_image_mem(const uint8_t *data, size_t len) {
+  gui_lock();
+  TRACE_INSTANT("show_image");
+  int slot = s_mem_slot == 0 ? 1 : 0;
+  lv_image_dsc_t *dsc = &s_mem_dsc[slot];
+  memset(dsc, 0, sizeof(*dsc));
+  dsc->header.magic = LV_IMAGE_HEADER_MAGIC;
+  /* Still encoded: the PNG decoder reads the size from the data itself */
+  dsc->header.cf = LV_COLOR_FORMAT_RAW_ALPHA;
+  dsc->data = data;
+  dsc->data_size = len;
+  show_src(dsc);
+  mem_slot_release(s_mem_slot);
+  s_mem_slot = slot;
+  stream_slot_release(s_stream_slot);
+  s_stream_slot = -1;
+  gui_unlock();
+}
+
+void ui_navigation_show_splash(const uint16_t *rgb565, uint16_t width,
+                               uint16_t height) {
+  static lv_image_dsc_t s_splash_dsc;
+  gui_lock();
+  lv_image_cache_drop(&s_splash_dsc);
+  memset(&s_splash_dsc, 0, sizeof(s_splash_dsc));
+  s_splash_dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+  s_splash_dsc.header.cf = LV_COLOR_FORMAT_RGB565;
+  s_splash_dsc.header.w = width;
+  s_splash_dsc.header.h = height;
+  s_splash_dsc.header.stride = width * 2;
+  s_splash_dsc.data = (const uint8_t *)rgb565;
+  s_splash_dsc.data_size = (uint32_t)width * height * 2;
+  show_src(&s_splash_dsc);
+  // Drawn like splash_draw() put it on the panel, whatever g_is_portrait
+  lv_obj_set_style_transform_angle(s_main_img, 0, LV_PART_MAIN);
+  mem_slot_release(s_mem_slot);
+  s_mem_slot = -1;
+  stream_slot_release(s_stream_slot);
+  s_stream_slot = -1;
+  gui_unlock();
+}
+
+static esp_err_t stream_on_header(png_stream_t *png,
+                                  const png_stream_info_t *info, void *arg) {
+  png_stream_format_t fmt =
+      info->has_alpha ? PNG_STREAM_FMT_ARGB8888 : PNG_STREAM_FMT_RGB565;
+  size_t stride = info->width * png_stream_bpp(fmt);
+  size_t size = stride * info->height;
+  uint8_t *data = image_pool_alloc(size);
+  if (!data) {
+    return ESP_ERR_NO_MEM;
+  }
+  memset(data, 0, size);
+  gui_lock();
+  int slot = s_stream_slot == 0 ? 1 : 0;
+  lv_draw_buf_init(&s_stream_buf[slot], info->width, info->height,
+                   fmt == PNG_STREAM_FMT_RGB565 ? LV_COLOR_FORMAT_RGB565
+                                                : LV_COLOR_FORMAT_ARGB8888,
+                   stride, data, size);
+  esp_err_t err = png_stream_set_output(png, fmt, data, stride);
+  if (err != ESP_OK) {
+    image_pool_free(data);
+    memset(&s_stream_buf[slot], 0, sizeof(s_stream_buf[slot]));
+    gui_unlock();
+    return err;
+  }
+  // Shown right away, rows appear as they are decoded
+  show_src(&s_stream_buf[slot]);
+  mem_slot_release(s_mem_slot);
+  s_mem_slot = -1;
+  stream_slot_release(s_stream_slot);
+  s_stream_slot = slot;
+  gui_unlock();
+  return ESP_OK;
+}
+
+static void stream_on_row(uint32_t y, const uint8_t *pixels, void *arg) {
+  s_stream_dirty = true;
+}
+
+static void stream_refresh_cb(lv_timer_t *t) {
+  if (s_stream_dirty && s_main_img && lv_obj_is_valid(s_main_img)) {
+    s_stream_dirty = false;
+    lv_obj_invalidate(s_main_img);
+  }
+}
+
+esp_err_t ui_navigation_stream_begin(void) {
+  if (s_stream) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  png_stream_config_t cfg = {
+      .on_header = stream_on_header,
+      .on_row = stream_on_row,
+      .format = PNG_STREAM_FMT_RGB565,
+      .parallel = true, // inflate here, convert on the other core
+  };
+  s_stream = png_stream_create(&cfg);
+  if (!s_stream) {
+    return ESP_ERR_NO_MEM;
+  }
+  s_stream_dirty = false;
+  gui_lock();
+  s_stream_timer = lv_timer_create(stream_refresh_cb, STREAM_REFRESH_MS, NULL);
+  gui_unlock();
+  return ESP_OK;
+}
+
+esp_err_t ui_navigation_stream_feed(const uint8_t *data, size_t len,
+                                    void *arg) {
+  if (!s_stream) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  return png_stream_feed(s_stream, data, len);
+}
+
+esp_err_t ui_navigation_stream_end(bool commit) {
+  if (!s_stream) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_err_t err = commit ? png_stream_finish(s_stream) : ESP_ERR_INVALID_STATE;
+  png_stream_destroy(s_stream);
+  s_stream = NULL;
+  gui_lock();
+  if (s_stream_timer) {
+    lv_timer_delete(s_stream_timer);
+    s_stream_timer = NULL;
+  }
+  if (err != ESP_OK && s_stream_slot >= 0) {
+    // Never leave unverified or truncated pixels on screen
+    if (s_main_img && lv_obj_is_valid(s_main_img)) {
+      lv_img_set_src(s_main_img, NULL);
+    }
+    stream_slot_release(s_stream_slot);
+    s_stream_slot = -1;
+  } else if (s_main_img && lv_obj_is_valid(s_main_img)) {
+    lv_obj_invalidate(s_main_img);
+  }
+  gui_unlock();
+  return err;
+}
+
 void ui_navigation_deinit(void) {
   if (s_nav_queue) {
     vQueueDelete(s_nav_queue);
     s_nav_queue = NULL;
   }
 
-  if (s_fname_bar) {
+  gui_lock();
+  // Already gone when the screen was cleared
+  if (s_fname_bar && lv_obj_is_valid(s_fname_bar)) {
     lv_obj_del(s_fname_bar);
   }
   s_fname_bar = NULL;
   s_fname_label = NULL;
-  if (s_main_img) {
+  if (s_main_img && lv_obj_is_valid(s_main_img)) {
     lv_obj_del(s_main_img);
   }
   s_main_img = NULL;
+  mem_slot_release(0);
+  mem_slot_release(1);
+  stream_slot_release(0);
+  stream_slot_release(1);
+  s_stream_slot = -1;
+  s_mem_slot = -1;
+  gui_unlock();
 }
@@ -1,6 +1,9 @@
 #ifndef UI_NAVIGATION_H
 #define UI_NAVIGATION_H
 
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define TEXT_X_DIVISOR           5
@@ -18,6 +21,7 @@
 #define HOME_TOUCH_WIDTH         NAV_MARGIN
 #define HOME_TOUCH_HEIGHT        ARROW_HEIGHT
 #define FILENAME_BAR_PAD         2
+#define STREAM_REFRESH_MS        33
 
 typedef enum {
     NAV_NONE = 0,
@@ -38,17 +42,83 @@ typedef enum {
     NAV_CMD_EXIT   = 4
 } nav_cmd_t;
 
+/** Receives navigation commands, from the task that produced them. */
+typedef void (*nav_cmd_cb_t)(nav_cmd_t cmd);
+
 typedef enum {
     IMAGE_SOURCE_LOCAL = 0,
     IMAGE_SOURCE_REMOTE,
     IMAGE_SOURCE_NETWORK
 } image_source_t;
 
+/*
+ * Safe to call from any task. Calls that only update the screen post a
+ * command to the LVGL task (gui_post()) and return at once; the others run
+ * under gui_lock(). Either way they take effect in call order.
+ */
+
+/**
+ * @brief Show the folders of the SD card holding PNG files and block until
+ * one is clicked. The returned name is to be freed by the caller.
+ */
 const char *draw_folder_selection(void);
 void draw_navigation_arrows(void);
+/** Queue an update of the file name bar, @p path is copied. */
 void draw_filename_bar(const char *path);
+/** Queue the display of a PNG file, @p path is copied. */
 void ui_navigation_show_image(const char *path);
+/**
+ * @brief Show a PNG held in memory, before returning.
+ *
+ * @p data must stay valid until another image has been shown.
+ */
+void ui_navigation_show_image_mem(const uint8_t *data, size_t len);
+/**
+ * @brief Show a raw RGB565 image (the boot splash), before returning.
+ *
+ * Unlike the PNG images it is drawn in the panel's orientation. @p rgb565
+ * must stay valid until another image has been shown.
+ */
+void ui_navigation_show_splash(const uint16_t *rgb565, uint16_t width, uint16_t height);
+/** Queue a centred label with @p text on the current screen, copied. */
+void ui_navigation_show_message(const char *text);
+/** Queue the deletion of everything on the current screen. */
+void ui_navigation_clear(void);
+/**
+ * @brief Show a PNG while it is still arriving.
+ *
+ * Call ui_navigation_stream_begin(), push the file with
+ * ui_navigation_stream_feed() (usable as an image_fetch_sink_t), then
+ * ui_navigation_stream_end(). The image replaces the current one as soon as
+ * its header is decoded and fills in row by row. It is kept only when
+ * @p commit is true (hash verified) and the PNG decoded completely.
+ */
+esp_err_t ui_navigation_stream_begin(void);
+esp_err_t ui_navigation_stream_feed(const uint8_t *data, size_t len, void *arg);
+esp_err_t ui_navigation_stream_end(bool commit);
+/**
+ * @brief Wait up to 50 ms for a navigation button and apply it with
+ * ui_navigation_apply_cmd(). Unused once a callback is set.
+ */
 nav_action_t handle_touch_navigation(int8_t *idx);
+/**
+ * @brief Send the navigation button commands to @p cb instead of the
+ * internal queue read by handle_touch_navigation(); NULL restores the queue.
+ */
+void ui_navigation_set_cmd_cb(nav_cmd_cb_t cb);
+/**
+ * @brief Apply @p cmd to the image index @p idx (wrapping around png_list).
+ *
+ * Only the index changes: the caller shows the image and its file name
+ * bar for the returned action.
+ */
+nav_action_t ui_navigation_apply_cmd(nav_cmd_t cmd, int8_t *idx);
+/**
+ * @brief Move @p idx by @p steps images (negative goes back), wrapping
+ * around png_list. Like ui_navigation_apply_cmd(), draws nothing.
+ */
+nav_action_t ui_navigation_apply_steps(int32_t steps, int8_t *idx);
+/** Show the image source buttons and block until one is clicked. */
 image_source_t draw_source_selection(void);
 void ui_navigation_deinit(void);
 
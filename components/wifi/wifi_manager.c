@@ -7,6 +7,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "nvs_flash.h"
+#include "trace.h"
 #include "wifi_provisioning/manager.h"
 #ifdef CONFIG_WIFI_PROV_TRANSPORT_BLE
 #include "wifi_provisioning/scheme_ble.h"
@@ -163,6 +164,7 @@ static void wifi_manager_task(void *pv)
     wifi_internal_event_t evt;
     while (s_run) {
         if (xQueueReceive(s_event_queue, &evt, pdMS_TO_TICKS(100))) {
+            TRACE_INSTANT("wifi_event");
             if (evt.base == IP_EVENT && evt.id == IP_EVENT_STA_GOT_IP) {
                 s_retry_num = 0;
                 s_fail_notified = false;
@@ -0,0 +1,837 @@
+/*
+ * Host driver for the image pipeline.
+ *
+ *   display_bmp_host [options] decode [--chunk N] <file.png>...
+ *   display_bmp_host [options] list [dir] [--page N]
+ *   display_bmp_host bus
+ *   display_bmp_host canpush <file.png>
+ *   display_bmp_host uart
+ *   display_bmp_host fonts
+ *   display_bmp_host pool
+ *   display_bmp_host bench [-l] [-n iterations] [-d corpus] [prefix]
+ *   display_bmp_host [options] nav <touch-recording>   (LVGL builds)
+ *
+ * options: --ppm out.ppm writes the framebuffer, --trace out.json the
+ * timeline trace (Chrome trace JSON) after the command.
+ *
+ * decode and list time the same code paths as the firmware (png_stream,
+ * file_manager) against files on the workstation; run them under `perf
+ * record -g` to profile. bench runs the benchmark suite (tools/bench.py).
+ * nav drives LVGL headless from a touch recording.
+ */
+#include "bench.h"
+#include "bench_app.h"
+#include "can_display.h"
+#include "can_isotp.h"
+#include "can_xfer.h"
+#include "config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "file_manager.h"
+#include "fonts.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "gt911.h"
+#include "host_hal.h"
+#include "image_pool.h"
+#include "jobs.h"
+#include "mbedtls/sha256.h"
+#include "nvs_flash.h"
+#include "png_stream.h"
+#include "rgb_lcd_port.h"
+#include "rs485_display.h"
+#include "trace.h"
+#include "sd.h"
+#include "uart_transport.h"
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HOST_HAVE_LVGL
+#include "gui.h"
+#include "lvfs_fatfs.h"
+#include "ui_navigation.h"
+#endif
+
+static const char *TAG = "host";
+
+/* Navigation commands from the CAN and RS485 bridges */
+static QueueHandle_t s_bus_cmds;
+char g_base_path[PATH_MAX];
+
+static esp_lcd_panel_handle_t s_panel;
+
+typedef struct {
+    uint16_t *pixels;
+    uint32_t width;
+    uint32_t height;
+} decode_target_t;
+
+static esp_err_t decode_on_header(png_stream_t *s, const png_stream_info_t *info, void *arg)
+{
+    decode_target_t *t = arg;
+    t->width = info->width;
+    t->height = info->height;
+    t->pixels = malloc((size_t)info->width * info->height * sizeof(uint16_t));
+    if (!t->pixels) {
+        return ESP_ERR_NO_MEM;
+    }
+    return png_stream_set_output(s, PNG_STREAM_FMT_RGB565, (uint8_t *)t->pixels,
+                                 info->width * sizeof(uint16_t));
+}
+
+/* Centre the image on the panel, cropping what does not fit */
+static void blit_centered(const decode_target_t *t)
+{
+    uint32_t w = t->width < LCD_H_RES ? t->width : LCD_H_RES;
+    uint32_t h = t->height < LCD_V_RES ? t->height : LCD_V_RES;
+    uint32_t sx = (t->width - w) / 2;
+    uint32_t sy = (t->height - h) / 2;
+    uint32_t dx = (LCD_H_RES - w) / 2;
+    uint32_t dy = (LCD_V_RES - h) / 2;
+    for (uint32_t y = 0; y < h; ++y) {
+        esp_lcd_panel_draw_bitmap(s_panel, dx, dy + y, dx + w, dy + y + 1,
+                                  &t->pixels[(size_t)(sy + y) * t->width + sx]);
+    }
+}
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = size > 0 ? malloc((size_t)size) : NULL;
+    if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *len = data ? (size_t)size : 0;
+    return data;
+}
+
+static int cmd_decode(int argc, char **argv)
+{
+    size_t chunk = 4096;
+    bool parallel = false;
+    int failures = 0;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--parallel") == 0) {
+            parallel = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunk = strtoul(argv[++i], NULL, 0);
+            if (chunk == 0) {
+                chunk = SIZE_MAX;
+            }
+            continue;
+        }
+        size_t len;
+        uint8_t *data = read_file(argv[i], &len);
+        if (!data) {
+            ESP_LOGE(TAG, "Cannot read %s", argv[i]);
+            failures++;
+            continue;
+        }
+        decode_target_t target = { 0 };
+        png_stream_config_t cfg = {
+            .on_header = decode_on_header,
+            .format = PNG_STREAM_FMT_RGB565,
+            .parallel = parallel,
+            .arg = &target,
+        };
+        int64_t start = esp_timer_get_time();
+        png_stream_t *s = png_stream_create(&cfg);
+        esp_err_t err = s ? ESP_OK : ESP_ERR_NO_MEM;
+        for (size_t off = 0; err == ESP_OK && off < len;) {
+            size_t n = len - off < chunk ? len - off : chunk;
+            err = png_stream_feed(s, data + off, n);
+            off += n;
+        }
+        if (err == ESP_OK) {
+            err = png_stream_finish(s);
+        }
+        png_stream_destroy(s);
+        int64_t us = esp_timer_get_time() - start;
+        if (err == ESP_OK) {
+            blit_centered(&target);
+            double mpix = (double)target.width * target.height / 1e6;
+            printf("%s: %ux%u in %.3f ms, %.1f Mpx/s\n", argv[i], (unsigned)target.width,
+                   (unsigned)target.height, us / 1000.0, us ? mpix * 1e6 / us : 0.0);
+        } else {
+            printf("%s: %s\n", argv[i], esp_err_to_name(err));
+            failures++;
+        }
+        free(target.pixels);
+        free(data);
+    }
+    return failures ? 1 : 0;
+}
+
+static int cmd_list(int argc, char **argv)
+{
+    const char *dir = MOUNT_POINT;
+    size_t page = PNG_LIST_INIT_CAP;
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--page") == 0 && i + 1 < argc) {
+            page = strtoul(argv[++i], NULL, 0);
+        } else {
+            dir = argv[i];
+        }
+    }
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = list_files_sorted(dir, 0, page);
+    size_t total = 0;
+    size_t pages = 0;
+    while (err == ESP_OK) {
+        total += png_list.size;
+        pages++;
+        if (!png_has_more) {
+            break;
+        }
+        err = file_manager_next_page(page);
+    }
+    int64_t us = esp_timer_get_time() - start;
+    png_list_free();
+    if (err != ESP_OK) {
+        printf("%s: %s\n", dir, esp_err_to_name(err));
+        return 1;
+    }
+    printf("%s: %u PNG(s) in %u page(s) of %u, %.3f ms\n", dir, (unsigned)total,
+           (unsigned)pages, (unsigned)page, us / 1000.0);
+    return 0;
+}
+
+static void bus_cmd_cb(nav_cmd_t cmd)
+{
+    xQueueSend(s_bus_cmds, &cmd, 0);
+}
+
+static int s_bus_status_calls;
+
+static void bus_status_cb(can_display_status_t *status)
+{
+    s_bus_status_calls++;
+    *status = (can_display_status_t){ .index = 3, .count = 12, .brightness = 80 };
+}
+
+/* Send one ISO-TP message to the CAN bridge; its flow control comes back on @p fc_id */
+static esp_err_t bus_can_send(uint32_t id, uint32_t fc_id, const uint8_t *data, size_t len)
+{
+    can_isotp_tx_t tx;
+    esp_err_t err = can_isotp_tx_start(&tx, data, len);
+    uint8_t frame[CAN_ISOTP_FRAME_LEN];
+    int n;
+    while (err == ESP_OK && (n = can_isotp_tx_next(&tx, frame)) != 0) {
+        if (n < 0) {
+            twai_message_t fc;
+            if (host_twai_take_tx(&fc, pdMS_TO_TICKS(1000)) != ESP_OK || fc.identifier != fc_id ||
+                can_isotp_tx_flow(&tx, fc.data, fc.data_length_code) != CAN_ISOTP_FC_CTS) {
+                return ESP_ERR_TIMEOUT;
+            }
+            continue;
+        }
+        twai_message_t msg = { .identifier = id, .data_length_code = n };
+        memcpy(msg.data, frame, n);
+        err = host_twai_inject(&msg);
+    }
+    return err;
+}
+
+static void bus_can_request(uint32_t id, const uint8_t *req, uint8_t len)
+{
+    bus_can_send(id, CAN_DISPLAY_TX_BASE + CONFIG_CAN_NODE_ID, req, len);
+}
+
+/* Collect one ISO-TP reply, granting every flow control request */
+static int bus_can_reply(uint8_t *buf, size_t cap)
+{
+    can_isotp_rx_t rx;
+    can_isotp_rx_init(&rx, buf, cap, 0, 0);
+    twai_message_t msg;
+    while (host_twai_take_tx(&msg, pdMS_TO_TICKS(1000)) == ESP_OK) {
+        if (msg.identifier != CAN_DISPLAY_TX_BASE + CONFIG_CAN_NODE_ID) {
+            return -1;
+        }
+        uint8_t fc[CAN_ISOTP_FRAME_LEN];
+        can_isotp_rx_result_t r = can_isotp_rx_frame(&rx, msg.data, msg.data_length_code, fc);
+        if (r == CAN_ISOTP_RX_DONE) {
+            return (int)rx.len;
+        }
+        if (r == CAN_ISOTP_RX_FC) {
+            twai_message_t flow = { .identifier = CAN_DISPLAY_RX_BASE + CONFIG_CAN_NODE_ID,
+                                    .data_length_code = 3 };
+            memcpy(flow.data, fc, 3);
+            host_twai_inject(&flow);
+        } else if (r != CAN_ISOTP_RX_NONE) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/* STATUS needs a multi-frame reply; sending it twice must replay, not re-run */
+static int bus_can_status(void)
+{
+    static const uint8_t req[] = { 7, CAN_OP_STATUS, 0 };
+    static const uint8_t want[] = { 7, 1, CAN_OP_STATUS | CAN_DISPLAY_REPLY_BIT, CAN_STATUS_OK, 7,
+                                    3, 0, 12, 0, 80, 0, 0 };
+    int failures = 0;
+    for (int i = 0; i < 2; ++i) {
+        int64_t start = esp_timer_get_time();
+        bus_can_request(CAN_DISPLAY_RX_BASE + CONFIG_CAN_NODE_ID, req, sizeof(req));
+        uint8_t reply[64];
+        int len = bus_can_reply(reply, sizeof(reply));
+        if (len != sizeof(want) || memcmp(reply, want, sizeof(want)) != 0) {
+            printf("CAN STATUS: bad reply\n");
+            failures++;
+            continue;
+        }
+        printf("CAN STATUS: %d-byte reply after %.3f ms\n", len,
+               (esp_timer_get_time() - start) / 1000.0);
+    }
+    if (s_bus_status_calls != 1) {
+        printf("CAN STATUS: retry ran the command again\n");
+        failures++;
+    }
+    return failures;
+}
+
+static void bus_rs485_status_cb(rs485_display_status_t *status)
+{
+    *status = (rs485_display_status_t){ .index = 3, .image_count = 12, .decode_ms = 41,
+                                        .battery = 55, .fps_x10 = 300 };
+}
+
+/* Frame a Modbus request to the RS485 slave and collect up to @p expect reply bytes */
+static int bus_modbus(const uint8_t *pdu, size_t len, bool corrupt, uint8_t *reply, size_t expect)
+{
+    uint8_t frame[64];
+    frame[0] = CONFIG_MODBUS_SLAVE_ID;
+    memcpy(&frame[1], pdu, len);
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i <= len; ++i) {
+        crc ^= frame[i];
+        for (int b = 0; b < 8; ++b) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+        }
+    }
+    frame[len + 1] = (crc & 0xff) ^ (corrupt ? 0xff : 0);
+    frame[len + 2] = crc >> 8;
+    host_uart_inject(UART_NUM_1, frame, len + 3);
+    int n = host_uart_take_tx(UART_NUM_1, reply, expect, pdMS_TO_TICKS(corrupt ? 100 : 1000));
+    return n < 0 ? 0 : n;
+}
+
+/* Register reads, an exception and the diagnostic counters */
+static int bus_modbus_regs(void)
+{
+    int failures = 0;
+    uint8_t reply[64];
+    static const uint8_t bad_crc[] = { 0x04, 0, 0, 0, 1 };
+    if (bus_modbus(bad_crc, sizeof(bad_crc), true, reply, 1) != 0) {
+        printf("RS485 bad CRC: answered\n");
+        failures++;
+    }
+    static const uint8_t bad_addr[] = { 0x03, 0, RS485_HREG_COUNT, 0, 1 };
+    static const uint8_t ex[] = { CONFIG_MODBUS_SLAVE_ID, 0x83, 0x02 };
+    if (bus_modbus(bad_addr, sizeof(bad_addr), false, reply, 5) != 5 ||
+        memcmp(reply, ex, sizeof(ex)) != 0) {
+        printf("RS485 illegal address: no exception\n");
+        failures++;
+    }
+    int64_t start = esp_timer_get_time();
+    static const uint8_t read[] = { 0x04, 0, 0, 0, RS485_IREG_COUNT };
+    // 4 requests so far: the NAV writes and the exception; one CRC error
+    static const uint8_t want[] = { CONFIG_MODBUS_SLAVE_ID, 0x04, RS485_IREG_COUNT * 2,
+                                    0, 12, 0, 41, 0, 55, 1, 44, 0, 4, 0, 1, 0, 0, 0, 1 };
+    int n = bus_modbus(read, sizeof(read), false, reply, sizeof(want) + 2);
+    if (n != (int)sizeof(want) + 2 || memcmp(reply, want, sizeof(want)) != 0) {
+        printf("RS485 input registers: bad reply\n");
+        failures++;
+    } else {
+        printf("RS485 input registers: %d-byte reply after %.3f ms\n", n,
+               (esp_timer_get_time() - start) / 1000.0);
+    }
+    return failures;
+}
+
+/* Drive the CAN and RS485 bridges with next/previous commands and time them */
+static int cmd_bus(void)
+{
+    const can_display_ops_t can_ops = { .on_nav = bus_cmd_cb, .on_status = bus_status_cb };
+    const rs485_display_ops_t rs485_ops = { .on_nav = bus_cmd_cb,
+                                            .on_status = bus_rs485_status_cb };
+    s_bus_cmds = xQueueCreate(10, sizeof(nav_cmd_t));
+    if (!s_bus_cmds || can_display_init(&can_ops) != ESP_OK ||
+        rs485_display_init(&rs485_ops) != ESP_OK) {
+        return 1;
+    }
+    // CAN: addressed NEXT (acknowledged), then broadcast PREV (silent)
+    static const struct {
+        bool can;
+        bool broadcast;
+        const char *cmd;
+    } steps[] = { { true, false, "NEXT" }, { true, true, "PREV" }, { false, false, "NEXT" },
+                  { false, false, "PREV" } };
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i) {
+        int64_t start = esp_timer_get_time();
+        nav_cmd_t want = strcmp(steps[i].cmd, "NEXT") == 0 ? NAV_CMD_NEXT : NAV_CMD_PREV;
+        if (steps[i].can) {
+            uint8_t req[] = { (uint8_t)i, CAN_OP_NAV, 1, (uint8_t)(int8_t)want };
+            bus_can_request(CAN_DISPLAY_RX_BASE + (steps[i].broadcast ? 0 : CONFIG_CAN_NODE_ID),
+                            req, sizeof(req));
+        } else {
+            // Modbus write single register, echoed back once applied
+            uint8_t pdu[] = { 0x06, 0, RS485_HREG_NAV, (uint16_t)want >> 8, (uint16_t)want & 0xff };
+            uint8_t reply[16];
+            if (bus_modbus(pdu, sizeof(pdu), false, reply, 8) != 8 ||
+                memcmp(&reply[1], pdu, sizeof(pdu)) != 0) {
+                printf("RS485 %s: no echo\n", steps[i].cmd);
+                failures++;
+            }
+        }
+        nav_cmd_t cmd;
+        if (xQueueReceive(s_bus_cmds, &cmd, pdMS_TO_TICKS(1000)) != pdTRUE || cmd != want) {
+            printf("%s %s: no command\n", steps[i].can ? "CAN" : "RS485", steps[i].cmd);
+            failures++;
+            continue;
+        }
+        printf("%s %s: command after %.3f ms\n", steps[i].can ? "CAN" : "RS485", steps[i].cmd,
+               (esp_timer_get_time() - start) / 1000.0);
+        if (steps[i].can && !steps[i].broadcast) {
+            uint8_t reply[8];
+            uint8_t ack[] = { (uint8_t)i, 1, CAN_OP_NAV | CAN_DISPLAY_REPLY_BIT, CAN_STATUS_OK, 0 };
+            if (bus_can_reply(reply, sizeof(reply)) != sizeof(ack) ||
+                memcmp(reply, ack, sizeof(ack)) != 0) {
+                printf("CAN %s: no acknowledgement\n", steps[i].cmd);
+                failures++;
+            }
+        }
+    }
+    failures += bus_can_status();
+    failures += bus_modbus_regs();
+    twai_message_t extra;
+    if (host_twai_take_tx(&extra, 0) == ESP_OK) {
+        printf("CAN: unexpected frame 0x%03x\n", (unsigned)extra.identifier);
+        failures++;
+    }
+    can_display_deinit();
+    rs485_display_deinit();
+    return failures ? 1 : 0;
+}
+
+/* Send one addressed request and check the status of its single command */
+static int canpush_call(const uint8_t *req, size_t len, uint8_t *reply, size_t cap)
+{
+    if (bus_can_send(CAN_DISPLAY_RX_BASE + CONFIG_CAN_NODE_ID, CAN_DISPLAY_TX_BASE + CONFIG_CAN_NODE_ID,
+                     req, len) != ESP_OK) {
+        return -1;
+    }
+    int n = bus_can_reply(reply, cap);
+    if (n < 5 || reply[0] != req[0] || reply[3] != CAN_STATUS_OK) {
+        printf("op 0x%02x: %s\n", req[1], n < 5 ? "no reply" : "refused");
+        return -1;
+    }
+    return n;
+}
+
+/* Push an image the way a CAN controller would, then check the album copy */
+static int cmd_canpush(const char *path)
+{
+    size_t len;
+    uint8_t *data = read_file(path, &len);
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    size_t name_len = strlen(name);
+    if (!data || name_len >= CAN_XFER_NAME_MAX) {
+        ESP_LOGE(TAG, "Cannot push %s", path);
+        free(data);
+        return 1;
+    }
+    const can_display_ops_t ops = { .album_dir = MOUNT_POINT "/" CONFIG_CAN_XFER_ALBUM_DIR };
+    if (can_display_init(&ops) != ESP_OK) {
+        free(data);
+        return 1;
+    }
+
+    uint8_t req[3 + 36 + CAN_XFER_NAME_MAX] = { 1, CAN_OP_PUT_BEGIN, 36 + name_len };
+    req[3] = len & 0xff;
+    req[4] = len >> 8;
+    req[5] = len >> 16;
+    req[6] = len >> 24;
+    mbedtls_sha256(data, len, &req[7], 0);
+    memcpy(&req[39], name, name_len);
+    uint8_t reply[32];
+    int64_t start = esp_timer_get_time();
+    int ret = canpush_call(req, 39 + name_len, reply, sizeof(reply)) < 0;
+    if (!ret && bus_can_send(CAN_DISPLAY_DATA_BASE + CONFIG_CAN_NODE_ID,
+                             CAN_DISPLAY_DATA_FC_BASE + CONFIG_CAN_NODE_ID, data, len) != ESP_OK) {
+        printf("data: no flow control\n");
+        ret = 1;
+    }
+    static const uint8_t commit[] = { 2, CAN_OP_PUT_COMMIT, 0 };
+    if (!ret) {
+        ret = canpush_call(commit, sizeof(commit), reply, sizeof(reply)) < 0;
+    }
+    double host_ms = (esp_timer_get_time() - start) / 1000.0;
+
+    char album_path[PATH_MAX];
+    snprintf(album_path, sizeof(album_path), "%s/%s", ops.album_dir, name);
+    size_t stored_len = 0;
+    uint8_t *stored = ret ? NULL : read_file(album_path, &stored_len);
+    if (!ret && (!stored || stored_len != len || memcmp(stored, data, len) != 0)) {
+        printf("%s: album copy differs\n", album_path);
+        ret = 1;
+    }
+    if (!ret) {
+        can_display_xfer_stats_t st;
+        can_display_get_xfer_stats(&st);
+        // Every frame at 8 bytes with worst-case stuffing: 135 bits
+        printf("%s: %u bytes committed in %.3f ms, %" PRIu32 " frames, %" PRIu32 " flow controls, "
+               "at least %.0f ms of bus time at %d kbit/s\n", name, (unsigned)len, host_ms,
+               st.frames, st.flow_controls, st.frames * 135.0 / CONFIG_CAN_BITRATE_KBPS,
+               CONFIG_CAN_BITRATE_KBPS);
+    }
+    free(stored);
+    free(data);
+    can_display_deinit();
+    return ret;
+}
+
+/* Frames delivered by the transport under test, concatenated with '|' */
+static char s_uart_frames[128];
+
+static void uart_collect_cb(void *arg, const uint8_t *data, size_t len)
+{
+    size_t used = strlen(s_uart_frames);
+    snprintf(s_uart_frames + used, sizeof(s_uart_frames) - used, "%.*s|", (int)len,
+             (const char *)data);
+}
+
+/* Run each framer over a stream injected in two bursts, split mid-frame */
+static int cmd_uart(void)
+{
+    static const struct {
+        const char *name;
+        uart_framer_t framer;
+        const char *burst1;
+        size_t len1;
+        const char *burst2;
+        size_t len2;
+        const char *want;
+    } cases[] = {
+        { "line", uart_framer_line, "next\r\npr", 8, "ev\n\nhome\n", 10, "next|prev|home|" },
+        { "slip", uart_framer_slip, "\xc0" "a\xdb\xdc" "b\xc0" "c\xdb", 8, "\xdd" "d\xc0", 3,
+          "a\xc0" "b|c\xdb" "d|" },
+        { "len16", uart_framer_len16, "\0\3abc\0", 6, "\2de\0\0", 5, "abc|de|" },
+    };
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        const uart_transport_config_t cfg = {
+            .port = UART_NUM_2,
+            .baud_rate = 115200,
+            .rx_buf_size = 64,
+            .tx_batch_size = 64,
+            .de_pin = UART_PIN_NO_CHANGE,
+            .framer = cases[i].framer,
+            .on_frame = uart_collect_cb,
+        };
+        uart_transport_t *t;
+        if (uart_transport_open(&cfg, &t) != ESP_OK) {
+            return 1;
+        }
+        s_uart_frames[0] = '\0';
+        int64_t start = esp_timer_get_time();
+        host_uart_inject(UART_NUM_2, cases[i].burst1, cases[i].len1);
+        host_uart_inject(UART_NUM_2, cases[i].burst2, cases[i].len2);
+        uart_transport_stats_t st;
+        do {
+            vTaskDelay(1);
+            uart_transport_get_stats(t, &st);
+        } while (st.rx_bytes < cases[i].len1 + cases[i].len2 &&
+                 esp_timer_get_time() - start < 1000000);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        uart_transport_get_stats(t, &st);
+        bool ok = strcmp(s_uart_frames, cases[i].want) == 0;
+        printf("%s: %u frame(s), %u byte(s), %u noise byte(s)%s\n", cases[i].name,
+               (unsigned)st.frames, (unsigned)st.rx_bytes, (unsigned)st.noise_bytes,
+               ok ? "" : ", wrong frames");
+        failures += !ok;
+        uart_transport_close(t);
+    }
+    return failures ? 1 : 0;
+}
+
+/* The legacy lookup: compare the index of every CH_CN entry */
+static const uint8_t *cn_linear_find(const cFONT *font, const char *text)
+{
+    size_t n = (unsigned char)text[0] >= 0x80 ? 2 : 1;
+    for (uint16_t i = 0; i < font->size; ++i) {
+        const char *index = font->table[i].index;
+        if (strncmp(index, text, n) == 0 && index[n] == '\0') {
+            return (const uint8_t *)font->table[i].matrix;
+        }
+    }
+    return NULL;
+}
+
+/* One byte per pixel, as a display driver would draw it */
+static void cn_render(const uint8_t *matrix, uint16_t width, uint16_t height, uint8_t *pixels)
+{
+    size_t stride = (width + 7) / 8;
+    for (uint16_t y = 0; y < height; ++y) {
+        for (uint16_t x = 0; x < width; ++x) {
+            pixels[y * width + x] = matrix[y * stride + x / 8] >> (7 - x % 8) & 1;
+        }
+    }
+}
+
+/* Render every glyph of the CH_CN tables both ways and compare */
+static int cmd_fonts(void)
+{
+    static const struct {
+        const char *name;
+        const cFONT *legacy;
+        const cFONT_Packed *packed;
+    } fonts[] = {
+        { "Font12CN", &Font12CN, &Font12CN_Packed },
+        { "Font24CN", &Font24CN, &Font24CN_Packed },
+        { "Font48CN", &Font48CN, &Font48CN_Packed },
+    };
+    const int rounds = 20000;
+    int failures = 0;
+    for (size_t f = 0; f < sizeof(fonts) / sizeof(fonts[0]); ++f) {
+        const cFONT *legacy = fonts[f].legacy;
+        const cFONT_Packed *packed = fonts[f].packed;
+        size_t px = (size_t)packed->Width * packed->Height;
+        uint8_t *a = malloc(px);
+        uint8_t *b = malloc(px);
+        unsigned diffs = 0;
+        for (uint16_t i = 0; i < legacy->size; ++i) {
+            const char *text = legacy->table[i].index;
+            uint8_t used;
+            const uint8_t *want = cn_linear_find(legacy, text);
+            const uint8_t *got = cfont_find(packed, text, &used);
+            if (!got || used != strlen(text)) {
+                diffs++;
+                continue;
+            }
+            cn_render(want, legacy->Width, legacy->Height, a);
+            cn_render(got, packed->Width, packed->Height, b);
+            diffs += memcmp(a, b, px) != 0;
+        }
+        uint8_t used;
+        /* "\xb0\xa1" is not in any of the tables */
+        diffs += cfont_find(packed, "\xb0\xa1", &used) != NULL;
+        free(a);
+        free(b);
+
+        /* Time the lookup of the table's last entry, the legacy worst case */
+        const char *last = legacy->table[legacy->size - 1].index;
+        const uint8_t *volatile sink;
+        int64_t start = esp_timer_get_time();
+        for (int r = 0; r < rounds; ++r) {
+            sink = cn_linear_find(legacy, last);
+        }
+        int64_t linear_us = esp_timer_get_time() - start;
+        start = esp_timer_get_time();
+        for (int r = 0; r < rounds; ++r) {
+            sink = cfont_find(packed, last, &used);
+        }
+        int64_t hashed_us = esp_timer_get_time() - start;
+        (void)sink;
+
+        size_t glyph = (size_t)packed->Height * ((packed->Width + 7) / 8);
+        size_t legacy_bytes = (size_t)legacy->size * sizeof(CH_CN);
+        size_t packed_bytes = packed->slots * (glyph + sizeof(uint16_t)) +
+                              packed->buckets * sizeof(uint16_t);
+        printf("%s: %u glyph(s), %u differ; %zu -> %zu bytes; lookup %.1f -> %.1f ns\n",
+               fonts[f].name, legacy->size, diffs, legacy_bytes, packed_bytes,
+               linear_us * 1000.0 / rounds, hashed_us * 1000.0 / rounds);
+        failures += diffs != 0;
+    }
+    return failures ? 1 : 0;
+}
+
+/* The sizes image_pool is meant for take a slab; an icon does not */
+static int cmd_pool(void)
+{
+    static const struct {
+        const char *name;
+        size_t size;
+        bool slab;
+    } cases[] = {
+        { "ARGB8888 screen", (size_t)LCD_H_RES * LCD_V_RES * 4, true },
+        { "RGB565 screen", (size_t)LCD_H_RES * LCD_V_RES * 2, true },
+        { "64x64 ARGB8888 icon", 64 * 64 * 4, false },
+    };
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        image_pool_stats_t before, after;
+        image_pool_get_stats(&before);
+        void *p = image_pool_alloc(cases[i].size);
+        image_pool_get_stats(&after);
+        bool slab = after.allocs > before.allocs;
+        bool ok = p && slab == cases[i].slab;
+        printf("%s: %zu bytes, %s%s\n", cases[i].name, cases[i].size, slab ? "slab" : "heap",
+               ok ? "" : ", wrong");
+        failures += !ok;
+        image_pool_free(p);
+    }
+    return failures ? 1 : 0;
+}
+
+#ifdef HOST_HAVE_LVGL
+static int cmd_nav(const char *recording)
+{
+    esp_lcd_touch_handle_t tp = NULL;
+    if (host_touch_replay_load(recording) != ESP_OK || touch_gt911_init(&tp) != ESP_OK) {
+        return 1;
+    }
+    gui_init(s_panel);
+    gui_attach_touch(tp);
+    lvfs_fatfs_register('S');
+    snprintf(g_base_path, sizeof(g_base_path), "%s", MOUNT_POINT);
+    if (list_files_sorted(g_base_path, 0, PNG_LIST_INIT_CAP) != ESP_OK || png_list.size == 0) {
+        ESP_LOGE(TAG, "No PNG in %s", g_base_path);
+        return 1;
+    }
+    int8_t index = 0;
+    ui_navigation_show_image(png_list.items[index]);
+    draw_navigation_arrows();
+    unsigned shown = 1;
+    while (!host_touch_replay_done()) {
+        nav_action_t act = handle_touch_navigation(&index);
+        if (act == NAV_SCROLL) {
+            int64_t start = esp_timer_get_time();
+            ui_navigation_show_image(png_list.items[index]);
+            draw_filename_bar(png_list.items[index]);
+            /* Apply the posted command now, so it is part of the timing */
+            gui_lock();
+            gui_unlock();
+            ESP_LOGI(TAG, "%s shown in %.3f ms", png_list.items[index],
+                     (esp_timer_get_time() - start) / 1000.0);
+            shown++;
+        } else if (act == NAV_EXIT || act == NAV_HOME) {
+            break;
+        }
+    }
+    /* Let the render loop draw the last image */
+    vTaskDelay(pdMS_TO_TICKS(200));
+    uint32_t flushes;
+    uint64_t pixels;
+    host_lcd_get_counters(&flushes, &pixels);
+    printf("nav: %u image(s) shown, %u flush(es), %llu pixel(s) sent\n", shown,
+           (unsigned)flushes, (unsigned long long)pixels);
+    ui_navigation_deinit();
+    touch_gt911_deinit();
+    png_list_free();
+    return 0;
+}
+#endif
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: display_bmp_host [--ppm out.ppm] [--trace out.json] <command>\n"
+            "  decode [--chunk N] [--parallel] <file.png>...\n"
+            "                                     decode with png_stream\n"
+            "  list [dir] [--page N]              page through a directory with file_manager\n"
+            "  bus                                CAN/RS485 remote control round trip\n"
+            "  canpush <file.png>                 push an image over CAN into the album\n"
+            "  uart                               UART transport framers\n"
+            "  fonts                              packed GB2312 tables against the CH_CN ones\n"
+            "  pool                               image_pool slab/heap split by image size\n"
+            "  bench [-l] [-n N] [-d dir] [name]  benchmark suite, JSON report\n"
+#ifdef HOST_HAVE_LVGL
+            "  nav <touch-recording>              navigate " MOUNT_POINT " with LVGL\n"
+#endif
+           );
+}
+
+int main(int argc, char **argv)
+{
+    const char *ppm = NULL;
+    const char *trace_out = NULL;
+    int i = 1;
+    for (; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--ppm") == 0) {
+            ppm = argv[i + 1];
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            trace_out = argv[i + 1];
+        } else {
+            break;
+        }
+    }
+    if (i >= argc) {
+        usage();
+        return 2;
+    }
+    const char *cmd = argv[i++];
+
+    ESP_ERROR_CHECK(nvs_flash_init());
+    display_update_geometry();
+    ESP_ERROR_CHECK(sd_mmc_init());
+    s_panel = waveshare_esp32_s3_rgb_lcd_init();
+    if (!s_panel) {
+        return 1;
+    }
+    if (trace_out) {
+        ESP_ERROR_CHECK(trace_init(CONFIG_APP_TRACE_EVENTS));
+    }
+    ESP_ERROR_CHECK(jobs_init());
+    ESP_ERROR_CHECK(image_pool_init(LCD_H_RES * LCD_V_RES * 4, CONFIG_IMAGE_POOL_SLABS));
+
+    int ret;
+    if (strcmp(cmd, "decode") == 0) {
+        ret = cmd_decode(argc - i, argv + i);
+    } else if (strcmp(cmd, "list") == 0) {
+        ret = cmd_list(argc - i, argv + i);
+    } else if (strcmp(cmd, "bus") == 0) {
+        ret = cmd_bus();
+    } else if (strcmp(cmd, "uart") == 0) {
+        ret = cmd_uart();
+    } else if (strcmp(cmd, "fonts") == 0) {
+        ret = cmd_fonts();
+    } else if (strcmp(cmd, "pool") == 0) {
+        ret = cmd_pool();
+    } else if (strcmp(cmd, "canpush") == 0 && i < argc) {
+        ret = cmd_canpush(argv[i]);
+    } else if (strcmp(cmd, "bench") == 0) {
+        ESP_ERROR_CHECK(bench_app_register());
+        /* bench_main() expects argv[0] to be the command name */
+        ret = bench_main(argc - i + 1, argv + i - 1, MOUNT_POINT "/bench");
+#ifdef HOST_HAVE_LVGL
+    } else if (strcmp(cmd, "nav") == 0 && i < argc) {
+        ret = cmd_nav(argv[i]);
+#endif
+    } else {
+        usage();
+        return 2;
+    }
+
+    if (ppm && host_lcd_save_ppm(ppm) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot write %s", ppm);
+        ret = 1;
+    }
+    if (trace_out) {
+        FILE *f = fopen(trace_out, "w");
+        if (!f || trace_export_json(trace_write_file, f) != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot write %s", trace_out);
+            ret = 1;
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+    return ret;
+}
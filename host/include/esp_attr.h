@@ -0,0 +1,8 @@
+#pragma once
+/* Host build: placement attributes are meaningless off target */
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define NOINIT_ATTR
@@ -0,0 +1,15 @@
+#pragma once
+/* Host build: panel IO handle type only, no bus behind it */
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_lcd_panel_io_t *esp_lcd_panel_io_handle_t;
+
+#ifdef __cplusplus
+}
+#endif
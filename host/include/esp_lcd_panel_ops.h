@@ -0,0 +1,53 @@
+#pragma once
+/* Host build: panel operations dispatched to the memory framebuffer panel */
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_lcd_panel_t esp_lcd_panel_t;
+typedef esp_lcd_panel_t *esp_lcd_panel_handle_t;
+
+struct esp_lcd_panel_t {
+    esp_err_t (*draw_bitmap)(esp_lcd_panel_t *panel, int x_start, int y_start, int x_end,
+                             int y_end, const void *color_data);
+    esp_err_t (*disp_on_off)(esp_lcd_panel_t *panel, bool on_off);
+    esp_err_t (*del)(esp_lcd_panel_t *panel);
+    void *user_data;
+};
+
+static inline esp_err_t esp_lcd_panel_draw_bitmap(esp_lcd_panel_handle_t panel, int x_start,
+                                                  int y_start, int x_end, int y_end,
+                                                  const void *color_data)
+{
+    return panel->draw_bitmap(panel, x_start, y_start, x_end, y_end, color_data);
+}
+
+static inline esp_err_t esp_lcd_panel_disp_on_off(esp_lcd_panel_handle_t panel, bool on_off)
+{
+    return panel->disp_on_off ? panel->disp_on_off(panel, on_off) : ESP_OK;
+}
+
+static inline esp_err_t esp_lcd_panel_reset(esp_lcd_panel_handle_t panel)
+{
+    (void)panel;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_lcd_panel_init(esp_lcd_panel_handle_t panel)
+{
+    (void)panel;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_lcd_panel_del(esp_lcd_panel_handle_t panel)
+{
+    return panel->del ? panel->del(panel) : ESP_OK;
+}
+
+#ifdef __cplusplus
+}
+#endif
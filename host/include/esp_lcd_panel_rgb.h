@@ -0,0 +1,3 @@
+#pragma once
+/* Host build: the RGB panel is a framebuffer in memory, see host_hal.h */
+#include "esp_lcd_panel_ops.h"
@@ -0,0 +1,11 @@
+#pragma once
+/* Host build: ROM busy-wait */
+#include <stdint.h>
+#include "esp_timer.h"
+
+static inline void esp_rom_delay_us(uint32_t us)
+{
+    int64_t end = esp_timer_get_time() + us;
+    while (esp_timer_get_time() < end) {
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+/* Host build: subset of ESP-IDF esp_system.h */
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Exits the process: there is nothing to reboot into. */
+void esp_restart(void) __attribute__((noreturn));
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+#ifdef __cplusplus
+}
+#endif
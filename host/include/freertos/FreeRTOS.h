@@ -0,0 +1,80 @@
+#pragma once
+/*
+ * Host build: FreeRTOS API on POSIX threads.
+ *
+ * Ticks are milliseconds. Tasks are threads; priorities and core affinity are
+ * ignored. Critical sections take one process-wide recursive lock, so code
+ * that relies on them for mutual exclusion behaves as on target.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE  ((BaseType_t)0)
+#define pdTRUE   ((BaseType_t)1)
+#define pdFAIL   pdFALSE
+#define pdPASS   pdTRUE
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL  ((BaseType_t)0)
+
+#define configTICK_RATE_HZ      1000
+#define configMAX_PRIORITIES    25
+#define configMINIMAL_STACK_SIZE 768
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS   ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000U))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(((uint64_t)(ticks) * 1000U) / configTICK_RATE_HZ))
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_FREE_VAL 0xB33FFFFF
+#define portMUX_INITIALIZER_UNLOCKED { .owner = portMUX_FREE_VAL, .count = 0 }
+
+static inline void portMUX_INITIALIZE(portMUX_TYPE *mux)
+{
+    mux->owner = portMUX_FREE_VAL;
+    mux->count = 0;
+}
+
+void host_critical_enter(portMUX_TYPE *mux);
+void host_critical_exit(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)      host_critical_enter(mux)
+#define portEXIT_CRITICAL(mux)       host_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux)  host_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux)   host_critical_exit(mux)
+#define portENTER_CRITICAL_SAFE(mux) host_critical_enter(mux)
+#define portEXIT_CRITICAL_SAFE(mux)  host_critical_exit(mux)
+#define taskENTER_CRITICAL(mux)      host_critical_enter(mux)
+#define taskEXIT_CRITICAL(mux)       host_critical_exit(mux)
+#define taskENTER_CRITICAL_ISR(mux)  host_critical_enter(mux)
+#define taskEXIT_CRITICAL_ISR(mux)   host_critical_exit(mux)
+
+#define portYIELD_FROM_ISR(...)  ((void)0)
+#define portNUM_PROCESSORS       2
+
+/* Threads are not pinned: report everything on core 0 */
+static inline BaseType_t xPortGetCoreID(void)
+{
+    return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
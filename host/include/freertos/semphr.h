@@ -0,0 +1,44 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* As in FreeRTOS, a semaphore is a queue of zero-sized items */
+typedef QueueHandle_t SemaphoreHandle_t;
+
+typedef struct {
+    SemaphoreHandle_t handle;
+} StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem);
+
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+#define xSemaphoreGiveFromISR(sem, woken) xSemaphoreGive(sem)
+#define xSemaphoreTakeFromISR(sem, woken) xSemaphoreTake((sem), 0)
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf)
+{
+    buf->handle = xSemaphoreCreateMutex();
+    return buf->handle;
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buf)
+{
+    buf->handle = xSemaphoreCreateBinary();
+    return buf->handle;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+#include <sched.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *out,
+                                   BaseType_t core_id);
+
+static inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                     void *arg, UBaseType_t priority, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, out, tskNO_AFFINITY);
+}
+
+/**
+ * Deleting another task cancels its thread at the next blocking call
+ * (delay, queue, semaphore, event group or notification wait).
+ */
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment);
+#define vTaskDelayUntil(prev, inc) ((void)xTaskDelayUntil(prev, inc))
+TickType_t xTaskGetTickCount(void);
+#define xTaskGetTickCountFromISR xTaskGetTickCount
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+const char *pcTaskGetName(TaskHandle_t task);
+/* Thread stacks are not instrumented on the host */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+#define taskYIELD() sched_yield()
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value,
+                           TickType_t ticks);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+#define xTaskNotifyGive(task) xTaskNotify((task), 0, eIncrement)
+#define xTaskNotifyFromISR(task, value, action, woken) xTaskNotify((task), (value), (action))
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+/*
+ * Hooks into the host build mocks, for the host application and benchmarks.
+ * None of this exists on target.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/twai.h"
+#include "driver/uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---- rgb_lcd_port: RGB565 framebuffer in memory ------------------------------ */
+
+/** Framebuffer of the panel created by waveshare_esp32_s3_rgb_lcd_init(). */
+uint16_t *host_lcd_framebuffer(uint16_t *width, uint16_t *height);
+/** Number of draw_bitmap calls and pixels written since the panel was created. */
+void host_lcd_get_counters(uint32_t *flushes, uint64_t *pixels);
+/** Write the framebuffer as a binary PPM, for eyeballing results. */
+esp_err_t host_lcd_save_ppm(const char *path);
+
+/* ---- touch: replay of recorded GT911 frames ---------------------------------- */
+
+/**
+ * @brief Load a touch recording, replayed from touch_gt911_init().
+ *
+ * One frame per line, `#` starts a comment:
+ *
+ *     <t_ms> <cnt> [<x> <y>]...
+ *
+ * `t_ms` is the time since the start of the recording and `cnt` the number of
+ * points; `0 0` releases. Each frame fires the interrupt callback registered
+ * with esp_lcd_touch_register_interrupt_callback(), as the GT911 INT line
+ * would, and is what touch_gt911_read_point() returns until the next one.
+ */
+esp_err_t host_touch_replay_load(const char *path);
+/** Block until the last frame was played. */
+esp_err_t host_touch_replay_wait(uint32_t timeout_ms);
+/** True once every frame was played (or when nothing was loaded). */
+bool host_touch_replay_done(void);
+
+/* ---- twai -------------------------------------------------------------------- */
+
+/** Deliver @p msg as if received from the bus. */
+esp_err_t host_twai_inject(const twai_message_t *msg);
+/** Take the next frame transmitted by the firmware. */
+esp_err_t host_twai_take_tx(twai_message_t *msg, TickType_t ticks);
+
+/* ---- uart -------------------------------------------------------------------- */
+
+/** Deliver @p len bytes on the RX line of @p port, then let the line go idle. */
+esp_err_t host_uart_inject(uart_port_t port, const void *data, size_t len);
+/** Take up to @p len bytes written by the firmware, returns the count. */
+int host_uart_take_tx(uart_port_t port, void *buf, size_t len, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
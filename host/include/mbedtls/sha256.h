@@ -0,0 +1,49 @@
+#pragma once
+/* Host build: the mbedtls SHA-256 calls used by the firmware, on OpenSSL */
+#define OPENSSL_SUPPRESS_DEPRECATED
+#include <openssl/sha.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef SHA256_CTX mbedtls_sha256_context;
+
+static inline void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    SHA256_Init(ctx);
+}
+
+static inline void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    (void)ctx;
+}
+
+static inline int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224)
+{
+    (void)is224;
+    return SHA256_Init(ctx) == 1 ? 0 : -1;
+}
+
+static inline int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input,
+                                        size_t ilen)
+{
+    return SHA256_Update(ctx, input, ilen) == 1 ? 0 : -1;
+}
+
+static inline int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    return SHA256_Final(output, ctx) == 1 ? 0 : -1;
+}
+
+static inline int mbedtls_sha256(const unsigned char *input, size_t ilen, unsigned char output[32],
+                                 int is224)
+{
+    (void)is224;
+    return SHA256(input, ilen, output) ? 0 : -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,27 @@
+#ifndef __SD_H
+#define __SD_H
+/*
+ * Host build of components/sd/sd.h: the card is a directory on the
+ * workstation. MOUNT_POINT stays a string literal, as the firmware pastes it
+ * into paths; it is set with -DHOST_SD_DIR=... when configuring the build.
+ */
+#include <stddef.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "esp_err.h"
+
+#define SD_TAG "sd"
+
+#ifndef HOST_MOUNT_POINT
+#error "HOST_MOUNT_POINT must be defined by the host build"
+#endif
+#define MOUNT_POINT HOST_MOUNT_POINT
+
+/** Creates the directory if needed. */
+esp_err_t sd_mmc_init();
+esp_err_t sd_mmc_unmount();
+void sd_card_print_info();
+/** Capacities of the file system holding the directory, in KB. */
+esp_err_t read_sd_capacity(size_t *total_capacity, size_t *available_capacity);
+
+#endif // __SD_H
@@ -0,0 +1,94 @@
+#pragma once
+/*
+ * Host build: the Kconfig defaults of main/Kconfig.projbuild. Override any of
+ * them from CMake, e.g. -DHOST_EXTRA_DEFINES="CONFIG_DISPLAY_WIDTH=800".
+ */
+
+#ifndef CONFIG_DISPLAY_WIDTH
+#define CONFIG_DISPLAY_WIDTH 1024
+#endif
+#ifndef CONFIG_DISPLAY_HEIGHT
+#define CONFIG_DISPLAY_HEIGHT 600
+#endif
+#ifndef CONFIG_DISPLAY_MARGIN_LEFT
+#define CONFIG_DISPLAY_MARGIN_LEFT 120
+#endif
+#ifndef CONFIG_DISPLAY_MARGIN_RIGHT
+#define CONFIG_DISPLAY_MARGIN_RIGHT 120
+#endif
+#ifndef CONFIG_DISPLAY_MARGIN_TOP
+#define CONFIG_DISPLAY_MARGIN_TOP 0
+#endif
+#ifndef CONFIG_DISPLAY_MARGIN_BOTTOM
+#define CONFIG_DISPLAY_MARGIN_BOTTOM 0
+#endif
+#ifndef CONFIG_INACTIVITY_TIMEOUT_MS
+#define CONFIG_INACTIVITY_TIMEOUT_MS 60000
+#endif
+#ifndef CONFIG_MIN_BRIGHTNESS
+#define CONFIG_MIN_BRIGHTNESS 25
+#endif
+#ifndef CONFIG_MAX_BRIGHTNESS
+#define CONFIG_MAX_BRIGHTNESS 100
+#endif
+#ifndef CONFIG_UI_NAV_EXCLUDED_DIRS
+#define CONFIG_UI_NAV_EXCLUDED_DIRS "pic"
+#endif
+#ifndef CONFIG_LCD_BIT_PER_PIXEL
+#define CONFIG_LCD_BIT_PER_PIXEL 16
+#endif
+#ifndef CONFIG_LCD_RGB_BUFFER_NUMS
+#define CONFIG_LCD_RGB_BUFFER_NUMS 2
+#endif
+
+#ifndef CONFIG_APP_TRACE
+#define CONFIG_APP_TRACE 1
+#endif
+#ifndef CONFIG_APP_TRACE_EVENTS
+#define CONFIG_APP_TRACE_EVENTS 4096
+#endif
+#ifndef CONFIG_IMAGE_POOL_SLABS
+#define CONFIG_IMAGE_POOL_SLABS 2
+#endif
+#ifndef CONFIG_CAN_NODE_ID
+#define CONFIG_CAN_NODE_ID 1
+#endif
+#ifndef CONFIG_CAN_BITRATE_KBPS
+#define CONFIG_CAN_BITRATE_KBPS 250
+#endif
+#ifndef CONFIG_CAN_XFER_ALBUM_DIR
+#define CONFIG_CAN_XFER_ALBUM_DIR "can"
+#endif
+#ifndef CONFIG_CAN_XFER_MAX_KB
+#define CONFIG_CAN_XFER_MAX_KB 4096
+#endif
+#ifndef CONFIG_CAN_XFER_BLOCK_SIZE
+#define CONFIG_CAN_XFER_BLOCK_SIZE 32
+#endif
+#ifndef CONFIG_CAN_XFER_ST_MIN
+#define CONFIG_CAN_XFER_ST_MIN 0
+#endif
+#ifndef CONFIG_MODBUS_SLAVE_ID
+#define CONFIG_MODBUS_SLAVE_ID 1
+#endif
+#ifndef CONFIG_MODBUS_BAUD_RATE
+#define CONFIG_MODBUS_BAUD_RATE 115200
+#endif
+#define CONFIG_MODBUS_PARITY_EVEN 1
+
+#ifndef CONFIG_IMAGE_SYNC_ALBUM_DIR
+#define CONFIG_IMAGE_SYNC_ALBUM_DIR "remote"
+#endif
+#ifndef CONFIG_IMAGE_FETCH_PARALLEL
+#define CONFIG_IMAGE_FETCH_PARALLEL 2
+#endif
+#ifndef CONFIG_IMAGE_FETCH_CHUNK_KB
+#define CONFIG_IMAGE_FETCH_CHUNK_KB 32
+#endif
+#ifndef CONFIG_IMAGE_FETCH_BUFFERS
+#define CONFIG_IMAGE_FETCH_BUFFERS 6
+#endif
+
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_ESP32S3_DEFAULT_CPU_FREQ_MHZ 240
+#define CONFIG_SPIRAM 1
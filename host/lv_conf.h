@@ -0,0 +1,18 @@
+/*
+ * LVGL configuration of the host build: the firmware settings, with the C
+ * library allocator instead of the ESP-IDF TLSF pools of components/lvgl_mem.
+ */
+#include "../lv_conf.h"
+
+#ifndef LV_CONF_HOST_H
+#define LV_CONF_HOST_H
+
+#undef LV_USE_STDLIB_MALLOC
+#define LV_USE_STDLIB_MALLOC  LV_STDLIB_CLIB
+#define LV_USE_STDLIB_STRING  LV_STDLIB_CLIB
+#define LV_USE_STDLIB_SPRINTF LV_STDLIB_CLIB
+#define LV_USE_LOG 1
+#define LV_LOG_LEVEL LV_LOG_LEVEL_WARN
+#define LV_LOG_PRINTF 1
+
+#endif /* LV_CONF_HOST_H */
@@ -0,0 +1,13 @@
+/*
+ * Battery gauge for the host build: always full.
+ */
+#include "battery.h"
+
+void battery_init(void)
+{
+}
+
+uint8_t battery_get_percentage(void)
+{
+    return 100;
+}
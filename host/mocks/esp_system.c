@@ -0,0 +1,114 @@
+/*
+ * esp_log, esp_err and esp_system for the host build.
+ */
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAGS_MAX 16
+
+typedef struct {
+    char tag[32];
+    esp_log_level_t level;
+} log_tag_level_t;
+
+static esp_log_level_t s_default_level = ESP_LOG_INFO;
+static log_tag_level_t s_tag_levels[LOG_TAGS_MAX];
+static size_t s_tag_count;
+static pthread_mutex_t s_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    pthread_mutex_lock(&s_log_lock);
+    if (strcmp(tag, "*") == 0) {
+        s_default_level = level;
+        s_tag_count = 0;
+    } else {
+        size_t i = 0;
+        while (i < s_tag_count && strcmp(s_tag_levels[i].tag, tag) != 0) {
+            i++;
+        }
+        if (i < LOG_TAGS_MAX) {
+            snprintf(s_tag_levels[i].tag, sizeof(s_tag_levels[i].tag), "%s", tag);
+            s_tag_levels[i].level = level;
+            if (i == s_tag_count) {
+                s_tag_count++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_log_lock);
+}
+
+static esp_log_level_t level_for(const char *tag)
+{
+    for (size_t i = 0; i < s_tag_count; ++i) {
+        if (strcmp(s_tag_levels[i].tag, tag) == 0) {
+            return s_tag_levels[i].level;
+        }
+    }
+    return s_default_level;
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    pthread_mutex_lock(&s_log_lock);
+    if (level <= level_for(tag)) {
+        va_list ap;
+        va_start(ap, format);
+        fprintf(stderr, "%c (%lu) %s: ", letters[level], (unsigned long)esp_log_timestamp(), tag);
+        vfprintf(stderr, format, ap);
+        fputc('\n', stderr);
+        va_end(ap);
+    }
+    pthread_mutex_unlock(&s_log_lock);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_INVALID_MAC: return "ESP_ERR_INVALID_MAC";
+    case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+    case ESP_ERR_NOT_ALLOWED: return "ESP_ERR_NOT_ALLOWED";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+void esp_restart(void)
+{
+    ESP_LOGW("host", "esp_restart() called, exiting");
+    exit(0);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 8 * 1024 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 8 * 1024 * 1024;
+}
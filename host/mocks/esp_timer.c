@@ -0,0 +1,184 @@
+/*
+ * esp_timer for the host build: one thread per timer, sleeping on a
+ * CLOCK_MONOTONIC deadline. Callbacks run without any lock held, so they may
+ * stop or restart their own timer.
+ */
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool armed;
+    bool deleted;
+    uint64_t period_us; /* 0 for one-shot */
+    int64_t due_us;
+    uint32_t generation; /* bumped by every start/stop */
+};
+
+static struct timespec s_epoch;
+
+__attribute__((constructor)) static void timer_epoch_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_epoch);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - s_epoch.tv_sec) * 1000000 +
+           (now.tv_nsec - s_epoch.tv_nsec) / 1000;
+}
+
+static struct timespec to_timespec(int64_t us)
+{
+    struct timespec ts = s_epoch;
+    ts.tv_sec += us / 1000000;
+    ts.tv_nsec += (long)(us % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void *timer_thread(void *p)
+{
+    struct esp_timer *t = p;
+    pthread_setname_np(pthread_self(), t->args.name ? t->args.name : "esp_timer");
+    pthread_mutex_lock(&t->lock);
+    while (!t->deleted) {
+        if (!t->armed) {
+            pthread_cond_wait(&t->cond, &t->lock);
+            continue;
+        }
+        struct timespec due = to_timespec(t->due_us);
+        uint32_t gen = t->generation;
+        pthread_cond_timedwait(&t->cond, &t->lock, &due);
+        if (t->deleted || !t->armed || gen != t->generation ||
+            esp_timer_get_time() < t->due_us) {
+            continue;
+        }
+        if (t->period_us) {
+            t->due_us += t->period_us;
+            int64_t now = esp_timer_get_time();
+            if (t->args.skip_unhandled_events && t->due_us < now) {
+                t->due_us = now + t->period_us;
+            }
+        } else {
+            t->armed = false;
+        }
+        pthread_mutex_unlock(&t->lock);
+        t->args.callback(t->args.arg);
+        pthread_mutex_lock(&t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+    if (!args || !args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->args = *args;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&t->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&t->thread, NULL, timer_thread, t) != 0) {
+        free(t);
+        return ESP_ERR_NO_MEM;
+    }
+    *out_handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t delay_us, uint64_t period_us)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&t->lock);
+    if (t->armed) {
+        pthread_mutex_unlock(&t->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->armed = true;
+    t->period_us = period_us;
+    t->due_us = esp_timer_get_time() + (int64_t)delay_us;
+    t->generation++;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return timer_arm(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&t->lock);
+    esp_err_t err = t->armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+    t->armed = false;
+    t->generation++;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    return err;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t)
+{
+    pthread_mutex_lock(&t->lock);
+    bool armed = t->armed;
+    pthread_mutex_unlock(&t->lock);
+    return armed;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&t->lock);
+    if (t->armed) {
+        pthread_mutex_unlock(&t->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->deleted = true;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    if (pthread_equal(t->thread, pthread_self())) {
+        /* Deleted from its own callback: the thread exits, the descriptor is leaked */
+        pthread_detach(t->thread);
+        return ESP_OK;
+    }
+    pthread_join(t->thread, NULL);
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->cond);
+    free(t);
+    return ESP_OK;
+}
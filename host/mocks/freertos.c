@@ -0,0 +1,631 @@
+/*
+ * FreeRTOS on POSIX threads for the host build.
+ *
+ * Every blocking primitive waits on a condition variable against a
+ * CLOCK_MONOTONIC deadline. Those waits are cancellation points, which is how
+ * vTaskDelete() of another task is emulated; the cleanup handlers release the
+ * object lock so a cancelled waiter never leaves it held.
+ */
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TASK_NAME_MAX 16
+
+static const char *TAG = "host_rtos";
+
+struct host_task {
+    pthread_t thread;
+    char name[TASK_NAME_MAX];
+    TaskFunction_t fn;
+    void *arg;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *buf;
+    size_t item_size; /* 0 for semaphores */
+    size_t length;
+    size_t head;
+    size_t count;
+    bool recursive;
+    pthread_t owner;
+    unsigned depth;
+};
+
+struct host_event_group {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    EventBits_t bits;
+};
+
+static pthread_mutex_t s_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread struct host_task *s_self;
+
+/* ---- Helpers -------------------------------------------------------------- */
+
+static void cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ms = pdTICKS_TO_MS(ticks);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void unlock_cleanup(void *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+/*
+ * Wait for @p cond with @p lock held. Returns false once the deadline has
+ * passed; a zero timeout returns false immediately.
+ */
+static bool wait_cond(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks,
+                      const struct timespec *deadline)
+{
+    if (ticks == 0) {
+        return false;
+    }
+    int rc;
+    pthread_cleanup_push(unlock_cleanup, lock);
+    if (ticks == portMAX_DELAY) {
+        rc = pthread_cond_wait(cond, lock);
+    } else {
+        rc = pthread_cond_timedwait(cond, lock, deadline);
+    }
+    pthread_cleanup_pop(0);
+    return rc != ETIMEDOUT;
+}
+
+void host_critical_enter(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_lock(&s_critical);
+}
+
+void host_critical_exit(portMUX_TYPE *mux)
+{
+    (void)mux;
+    pthread_mutex_unlock(&s_critical);
+}
+
+/* ---- Tasks ---------------------------------------------------------------- */
+
+static struct host_task *task_alloc(const char *name)
+{
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) {
+        return NULL;
+    }
+    strncpy(t->name, name ? name : "", sizeof(t->name) - 1);
+    pthread_mutex_init(&t->lock, NULL);
+    cond_init(&t->cond);
+    return t;
+}
+
+static struct host_task *current_task(void)
+{
+    if (!s_self) {
+        /* main() or a thread not created through xTaskCreate() */
+        s_self = task_alloc("main");
+        if (!s_self) {
+            abort();
+        }
+        s_self->thread = pthread_self();
+    }
+    return s_self;
+}
+
+static void *task_trampoline(void *p)
+{
+    struct host_task *t = p;
+    s_self = t;
+    pthread_setname_np(pthread_self(), t->name);
+    t->fn(t->arg);
+    /* Returning from a task function is a bug on target */
+    ESP_LOGE(TAG, "Task %s returned", t->name);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t priority, TaskHandle_t *out,
+                                   BaseType_t core_id)
+{
+    (void)priority;
+    (void)core_id;
+    struct host_task *t = task_alloc(name);
+    if (!t) {
+        return pdFAIL;
+    }
+    t->fn = fn;
+    t->arg = arg;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    /* Stack depth is in bytes on ESP-IDF; the host needs more headroom */
+    size_t stack = (size_t)stack_depth * 4;
+    if (stack < 64 * 1024) {
+        stack = 64 * 1024;
+    }
+    pthread_attr_setstacksize(&attr, stack);
+    /* The handle must be valid before the task can use it */
+    if (out) {
+        *out = t;
+    }
+    int rc = pthread_create(&t->thread, &attr, task_trampoline, t);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        if (out) {
+            *out = NULL;
+        }
+        free(t);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == s_self) {
+        pthread_exit(NULL);
+    }
+    /* The descriptor is leaked: the thread may still be unwinding */
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint64_t ms = pdTICKS_TO_MS(ticks);
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    if (ms == 0) {
+        sched_yield();
+        pthread_testcancel();
+        return;
+    }
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+{
+    TickType_t wake = *previous_wake + increment;
+    TickType_t now = xTaskGetTickCount();
+    *previous_wake = wake;
+    if ((int32_t)(wake - now) <= 0) {
+        return pdFALSE;
+    }
+    vTaskDelay(wake - now);
+    return pdTRUE;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(esp_timer_get_time() / (1000000 / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task();
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task ? task : current_task())->name;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    (void)task;
+    return 4096;
+}
+
+void vTaskSuspendAll(void)
+{
+    pthread_mutex_lock(&s_critical);
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    pthread_mutex_unlock(&s_critical);
+    return pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *t = current_task();
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&t->lock);
+    while (t->notify_value == 0 && wait_cond(&t->cond, &t->lock, ticks, &deadline)) {
+    }
+    uint32_t value = t->notify_value;
+    if (value) {
+        t->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    t->notify_pending = false;
+    pthread_mutex_unlock(&t->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value,
+                           TickType_t ticks)
+{
+    struct host_task *t = current_task();
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&t->lock);
+    if (!t->notify_pending) {
+        t->notify_value &= ~clear_on_entry;
+    }
+    while (!t->notify_pending && wait_cond(&t->cond, &t->lock, ticks, &deadline)) {
+    }
+    BaseType_t got = t->notify_pending ? pdTRUE : pdFALSE;
+    if (value) {
+        *value = t->notify_value;
+    }
+    if (got) {
+        t->notify_value &= ~clear_on_exit;
+    }
+    t->notify_pending = false;
+    pthread_mutex_unlock(&t->lock);
+    return got;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    if (!task) {
+        return pdFAIL;
+    }
+    BaseType_t ret = pdPASS;
+    pthread_mutex_lock(&task->lock);
+    switch (action) {
+    case eSetBits:
+        task->notify_value |= value;
+        break;
+    case eIncrement:
+        task->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->notify_value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notify_pending) {
+            ret = pdFAIL;
+        } else {
+            task->notify_value = value;
+        }
+        break;
+    case eNoAction:
+        break;
+    }
+    task->notify_pending = true;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return ret;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotify(task, 0, eIncrement);
+    if (woken) {
+        *woken = pdFALSE;
+    }
+}
+
+/* ---- Queues and semaphores -------------------------------------------------- */
+
+static QueueHandle_t queue_alloc(size_t length, size_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (!q) {
+        return NULL;
+    }
+    if (item_size) {
+        q->buf = malloc(length * item_size);
+        if (!q->buf) {
+            free(q);
+            return NULL;
+        }
+    }
+    q->length = length;
+    q->item_size = item_size;
+    pthread_mutex_init(&q->lock, NULL);
+    cond_init(&q->cond);
+    return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    if (length == 0) {
+        return NULL;
+    }
+    return queue_alloc(length, item_size);
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) {
+        return;
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+    free(q->buf);
+    free(q);
+}
+
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t ticks, bool front,
+                             bool overwrite)
+{
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&q->lock);
+    if (overwrite && q->count == q->length) {
+        q->count = 0;
+        q->head = 0;
+    }
+    while (q->count == q->length && wait_cond(&q->cond, &q->lock, ticks, &deadline)) {
+    }
+    if (q->count == q->length) {
+        pthread_mutex_unlock(&q->lock);
+        return errQUEUE_FULL;
+    }
+    if (q->item_size) {
+        size_t slot;
+        if (front) {
+            q->head = (q->head + q->length - 1) % q->length;
+            slot = q->head;
+        } else {
+            slot = (q->head + q->count) % q->length;
+        }
+        memcpy(q->buf + slot * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+static BaseType_t queue_receive(QueueHandle_t q, void *item, TickType_t ticks, bool peek)
+{
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && wait_cond(&q->cond, &q->lock, ticks, &deadline)) {
+    }
+    if (q->count == 0) {
+        pthread_mutex_unlock(&q->lock);
+        return errQUEUE_EMPTY;
+    }
+    if (q->item_size && item) {
+        memcpy(item, q->buf + q->head * q->item_size, q->item_size);
+    }
+    if (!peek) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_send(q, item, ticks, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return queue_send(q, item, ticks, true, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void *item)
+{
+    return queue_send(q, item, 0, false, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return queue_receive(q, item, ticks, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return queue_receive(q, item, ticks, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->count = 0;
+    q->head = 0;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->length - q->count;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return queue_alloc(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    SemaphoreHandle_t sem = queue_alloc(max_count, 0);
+    if (sem) {
+        sem->count = initial_count;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    SemaphoreHandle_t sem = xSemaphoreCreateMutex();
+    if (sem) {
+        sem->recursive = true;
+    }
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return queue_receive(sem, NULL, ticks, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return queue_send(sem, NULL, 0, false, false);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    pthread_mutex_lock(&sem->lock);
+    if (sem->depth > 0 && pthread_equal(sem->owner, pthread_self())) {
+        sem->depth++;
+        pthread_mutex_unlock(&sem->lock);
+        return pdPASS;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    if (xSemaphoreTake(sem, ticks) != pdPASS) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&sem->lock);
+    sem->owner = pthread_self();
+    sem->depth = 1;
+    pthread_mutex_unlock(&sem->lock);
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    if (sem->depth == 0 || !pthread_equal(sem->owner, pthread_self())) {
+        pthread_mutex_unlock(&sem->lock);
+        return pdFAIL;
+    }
+    bool release = --sem->depth == 0;
+    pthread_mutex_unlock(&sem->lock);
+    return release ? xSemaphoreGive(sem) : pdPASS;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem)
+{
+    return uxQueueMessagesWaiting(sem);
+}
+
+/* ---- Event groups ----------------------------------------------------------- */
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    struct host_event_group *g = calloc(1, sizeof(*g));
+    if (g) {
+        pthread_mutex_init(&g->lock, NULL);
+        cond_init(&g->cond);
+    }
+    return g;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    if (!group) {
+        return;
+    }
+    pthread_mutex_destroy(&group->lock);
+    pthread_cond_destroy(&group->cond);
+    free(group);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    group->bits |= bits;
+    EventBits_t now = group->bits;
+    pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->lock);
+    return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&group->lock);
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    pthread_mutex_lock(&group->lock);
+    EventBits_t bits = group->bits;
+    pthread_mutex_unlock(&group->lock);
+    return bits;
+}
+
+static bool bits_met(EventBits_t have, EventBits_t want, BaseType_t all)
+{
+    return all ? (have & want) == want : (have & want) != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits,
+                                BaseType_t clear_on_exit, BaseType_t wait_for_all,
+                                TickType_t ticks)
+{
+    struct timespec deadline = deadline_after(ticks);
+    pthread_mutex_lock(&group->lock);
+    while (!bits_met(group->bits, bits, wait_for_all) &&
+           wait_cond(&group->cond, &group->lock, ticks, &deadline)) {
+    }
+    EventBits_t result = group->bits;
+    if (clear_on_exit && bits_met(result, bits, wait_for_all)) {
+        group->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&group->lock);
+    return result;
+}
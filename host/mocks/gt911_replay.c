@@ -0,0 +1,274 @@
+/*
+ * GT911 for the host build: replays a recording of touch frames (format in
+ * host_hal.h) on a thread, raising the interrupt callback for every frame.
+ */
+#include "gt911.h"
+#include "host_hal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *TAG = "host_gt911";
+
+typedef struct {
+    uint32_t t_ms;
+    touch_gt911_point_t point;
+} replay_frame_t;
+
+static replay_frame_t *s_frames;
+static size_t s_frame_count;
+static size_t s_played;
+static touch_gt911_point_t s_current;
+static struct esp_lcd_touch_s *s_touch;
+static pthread_t s_thread;
+static bool s_running;
+static bool s_stop;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+
+esp_err_t host_touch_replay_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        ESP_LOGE(TAG, "Cannot open %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    size_t cap = 0;
+    size_t count = 0;
+    replay_frame_t *frames = NULL;
+    char line[256];
+    unsigned lineno = 0;
+    esp_err_t err = ESP_OK;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        char *p = line;
+        char *end;
+        unsigned long t = strtoul(p, &end, 10);
+        if (end == p) {
+            continue; /* blank or comment */
+        }
+        p = end;
+        unsigned long cnt = strtoul(p, &end, 10);
+        if (end == p || cnt > ESP_LCD_TOUCH_MAX_POINTS) {
+            err = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        p = end;
+        replay_frame_t fr = { .t_ms = (uint32_t)t, .point.cnt = (uint8_t)cnt };
+        for (unsigned long i = 0; i < cnt && err == ESP_OK; ++i) {
+            unsigned long x = strtoul(p, &end, 10);
+            if (end == p) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            p = end;
+            unsigned long y = strtoul(p, &end, 10);
+            if (end == p) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            p = end;
+            fr.point.x[i] = (uint16_t)x;
+            fr.point.y[i] = (uint16_t)y;
+        }
+        if (err != ESP_OK) {
+            break;
+        }
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+            replay_frame_t *grown = realloc(frames, cap * sizeof(*frames));
+            if (!grown) {
+                err = ESP_ERR_NO_MEM;
+                break;
+            }
+            frames = grown;
+        }
+        frames[count++] = fr;
+    }
+    fclose(f);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "%s:%u: bad frame", path, lineno);
+        free(frames);
+        return err;
+    }
+    pthread_mutex_lock(&s_lock);
+    free(s_frames);
+    s_frames = frames;
+    s_frame_count = count;
+    s_played = 0;
+    pthread_mutex_unlock(&s_lock);
+    ESP_LOGI(TAG, "%u frame(s) loaded from %s", (unsigned)count, path);
+    return ESP_OK;
+}
+
+static void *replay_thread(void *arg)
+{
+    (void)arg;
+    pthread_setname_np(pthread_self(), "gt911_replay");
+    int64_t start = esp_timer_get_time();
+    pthread_mutex_lock(&s_lock);
+    while (!s_stop && s_played < s_frame_count) {
+        const replay_frame_t *fr = &s_frames[s_played];
+        int64_t due = start + (int64_t)fr->t_ms * 1000;
+        int64_t now = esp_timer_get_time();
+        if (now < due) {
+            pthread_mutex_unlock(&s_lock);
+            struct timespec ts = { .tv_sec = (due - now) / 1000000,
+                                   .tv_nsec = (long)((due - now) % 1000000) * 1000 };
+            nanosleep(&ts, NULL);
+            pthread_mutex_lock(&s_lock);
+            continue;
+        }
+        s_current = fr->point;
+        s_played++;
+        esp_lcd_touch_interrupt_callback_t cb = s_touch ? s_touch->config.interrupt_callback : NULL;
+        pthread_mutex_unlock(&s_lock);
+        if (cb) {
+            cb(s_touch);
+        }
+        pthread_mutex_lock(&s_lock);
+    }
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+    return NULL;
+}
+
+esp_err_t host_touch_replay_wait(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    while (s_played < s_frame_count && err == ESP_OK) {
+        if (pthread_cond_timedwait(&s_cond, &s_lock, &deadline) != 0) {
+            err = ESP_ERR_TIMEOUT;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+bool host_touch_replay_done(void)
+{
+    pthread_mutex_lock(&s_lock);
+    bool done = s_played >= s_frame_count;
+    pthread_mutex_unlock(&s_lock);
+    return done;
+}
+
+esp_err_t touch_gt911_init(esp_lcd_touch_handle_t *out_touch)
+{
+    if (s_touch) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_touch = calloc(1, sizeof(*s_touch));
+    if (!s_touch) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_touch->config.x_max = CONFIG_DISPLAY_WIDTH;
+    s_touch->config.y_max = CONFIG_DISPLAY_HEIGHT;
+    memset(&s_current, 0, sizeof(s_current));
+    s_stop = false;
+    s_running = pthread_create(&s_thread, NULL, replay_thread, NULL) == 0;
+    if (!s_running) {
+        free(s_touch);
+        s_touch = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    if (out_touch) {
+        *out_touch = s_touch;
+    }
+    return ESP_OK;
+}
+
+touch_gt911_point_t touch_gt911_read_point(uint8_t max_touch_cnt)
+{
+    pthread_mutex_lock(&s_lock);
+    touch_gt911_point_t p = s_current;
+    pthread_mutex_unlock(&s_lock);
+    if (p.cnt > max_touch_cnt) {
+        p.cnt = max_touch_cnt;
+    }
+    return p;
+}
+
+void touch_gt911_deinit(void)
+{
+    if (s_running) {
+        pthread_mutex_lock(&s_lock);
+        s_stop = true;
+        pthread_mutex_unlock(&s_lock);
+        pthread_join(s_thread, NULL);
+        s_running = false;
+    }
+    free(s_touch);
+    s_touch = NULL;
+}
+
+esp_err_t esp_lcd_touch_register_interrupt_callback(esp_lcd_touch_handle_t tp,
+                                                    esp_lcd_touch_interrupt_callback_t callback)
+{
+    return esp_lcd_touch_register_interrupt_callback_with_data(tp, callback, NULL);
+}
+
+esp_err_t esp_lcd_touch_register_interrupt_callback_with_data(esp_lcd_touch_handle_t tp,
+                                                              esp_lcd_touch_interrupt_callback_t callback,
+                                                              void *user_data)
+{
+    if (!tp) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    tp->config.interrupt_callback = callback;
+    tp->config.user_data = user_data;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_touch_read_data(esp_lcd_touch_handle_t tp)
+{
+    touch_gt911_point_t p = touch_gt911_read_point(ESP_LCD_TOUCH_MAX_POINTS);
+    tp->data.points = p.cnt;
+    for (uint8_t i = 0; i < p.cnt; ++i) {
+        tp->data.coords[i].x = p.x[i];
+        tp->data.coords[i].y = p.y[i];
+        tp->data.coords[i].strength = 1;
+    }
+    return ESP_OK;
+}
+
+bool esp_lcd_touch_get_coordinates(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y,
+                                   uint16_t *strength, uint8_t *point_num, uint8_t max_point_num)
+{
+    uint8_t n = tp->data.points < max_point_num ? tp->data.points : max_point_num;
+    for (uint8_t i = 0; i < n; ++i) {
+        x[i] = tp->data.coords[i].x;
+        y[i] = tp->data.coords[i].y;
+        if (strength) {
+            strength[i] = tp->data.coords[i].strength;
+        }
+    }
+    *point_num = n;
+    return n > 0;
+}
+
+esp_err_t esp_lcd_touch_del(esp_lcd_touch_handle_t tp)
+{
+    (void)tp;
+    touch_gt911_deinit();
+    return ESP_OK;
+}
@@ -0,0 +1,105 @@
+/*
+ * lvgl_fs for the host build: the drive letter maps straight onto the host
+ * file system with stdio, where the firmware goes through FatFs.
+ */
+#include "lvgl.h"
+#include "lvfs_fatfs.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+
+static void *fs_open(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
+{
+    (void)drv;
+    const char *fmode = (mode & LV_FS_MODE_WR) ? ((mode & LV_FS_MODE_RD) ? "rb+" : "ab") : "rb";
+    return fopen(path, fmode);
+}
+
+static lv_fs_res_t fs_read(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br)
+{
+    (void)drv;
+    size_t n = fread(buf, 1, btr, file_p);
+    if (br) {
+        *br = (uint32_t)n;
+    }
+    return ferror((FILE *)file_p) ? LV_FS_RES_FS_ERR : LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_close(lv_fs_drv_t *drv, void *file_p)
+{
+    (void)drv;
+    return fclose(file_p) == 0 ? LV_FS_RES_OK : LV_FS_RES_FS_ERR;
+}
+
+static lv_fs_res_t fs_seek(lv_fs_drv_t *drv, void *file_p, uint32_t offset, lv_fs_whence_t whence)
+{
+    (void)drv;
+    int w;
+    switch (whence) {
+    case LV_FS_SEEK_SET:
+        w = SEEK_SET;
+        break;
+    case LV_FS_SEEK_CUR:
+        w = SEEK_CUR;
+        break;
+    case LV_FS_SEEK_END:
+        w = SEEK_END;
+        break;
+    default:
+        return LV_FS_RES_INV_PARAM;
+    }
+    return fseek(file_p, (long)offset, w) == 0 ? LV_FS_RES_OK : LV_FS_RES_FS_ERR;
+}
+
+static lv_fs_res_t fs_tell(lv_fs_drv_t *drv, void *file_p, uint32_t *pos)
+{
+    (void)drv;
+    long p = ftell(file_p);
+    if (p < 0) {
+        return LV_FS_RES_FS_ERR;
+    }
+    if (pos) {
+        *pos = (uint32_t)p;
+    }
+    return LV_FS_RES_OK;
+}
+
+static void *fs_dir_open(lv_fs_drv_t *drv, const char *path)
+{
+    (void)drv;
+    return opendir(path);
+}
+
+static lv_fs_res_t fs_dir_read(lv_fs_drv_t *drv, void *dir_p, char *fn, uint32_t size)
+{
+    (void)drv;
+    struct dirent *e = readdir(dir_p);
+    if (size > 0) {
+        snprintf(fn, size, "%s", e ? e->d_name : "");
+    }
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_dir_close(lv_fs_drv_t *drv, void *dir_p)
+{
+    (void)drv;
+    return closedir(dir_p) == 0 ? LV_FS_RES_OK : LV_FS_RES_FS_ERR;
+}
+
+void lvfs_fatfs_register(char letter)
+{
+    static lv_fs_drv_t drv;
+    lv_fs_drv_init(&drv);
+
+    drv.letter = letter;
+    drv.open_cb = fs_open;
+    drv.read_cb = fs_read;
+    drv.close_cb = fs_close;
+    drv.seek_cb = fs_seek;
+    drv.tell_cb = fs_tell;
+    drv.dir_open_cb = fs_dir_open;
+    drv.dir_read_cb = fs_dir_read;
+    drv.dir_close_cb = fs_dir_close;
+
+    lv_fs_drv_register(&drv);
+}
@@ -0,0 +1,238 @@
+/*
+ * In-memory NVS for the host build. Values are typed blobs keyed by
+ * namespace and key; commit is a no-op.
+ */
+#include "nvs.h"
+#include "nvs_flash.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NVS_NAMESPACES_MAX 16
+
+typedef enum {
+    NVS_TYPE_U8,
+    NVS_TYPE_U32,
+    NVS_TYPE_I32,
+    NVS_TYPE_STR,
+    NVS_TYPE_BLOB,
+} nvs_type_t;
+
+typedef struct nvs_entry {
+    struct nvs_entry *next;
+    uint32_t ns;
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    size_t len;
+    uint8_t data[];
+} nvs_entry_t;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool s_init;
+static char s_namespaces[NVS_NAMESPACES_MAX][NVS_KEY_NAME_MAX_SIZE];
+static size_t s_ns_count;
+static nvs_entry_t *s_entries;
+
+/* Handles encode the namespace index and the write permission */
+#define HANDLE_WRITE 0x80000000u
+
+esp_err_t nvs_flash_init(void)
+{
+    s_init = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_deinit(void)
+{
+    s_init = false;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&s_lock);
+    while (s_entries) {
+        nvs_entry_t *next = s_entries->next;
+        free(s_entries);
+        s_entries = next;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!s_init) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    pthread_mutex_lock(&s_lock);
+    size_t i = 0;
+    while (i < s_ns_count && strcmp(s_namespaces[i], namespace_name) != 0) {
+        i++;
+    }
+    if (i == s_ns_count) {
+        if (open_mode == NVS_READONLY) {
+            pthread_mutex_unlock(&s_lock);
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        if (s_ns_count == NVS_NAMESPACES_MAX) {
+            pthread_mutex_unlock(&s_lock);
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        strncpy(s_namespaces[i], namespace_name, NVS_KEY_NAME_MAX_SIZE - 1);
+        s_ns_count++;
+    }
+    pthread_mutex_unlock(&s_lock);
+    *out_handle = (nvs_handle_t)(i + 1) | (open_mode == NVS_READWRITE ? HANDLE_WRITE : 0);
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+static nvs_entry_t **find(uint32_t ns, const char *key)
+{
+    nvs_entry_t **p = &s_entries;
+    while (*p && ((*p)->ns != ns || strcmp((*p)->key, key) != 0)) {
+        p = &(*p)->next;
+    }
+    return p;
+}
+
+static esp_err_t set_value(nvs_handle_t handle, const char *key, nvs_type_t type,
+                           const void *data, size_t len)
+{
+    if (!(handle & HANDLE_WRITE)) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (!key || strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_entry_t *e = malloc(sizeof(*e) + len);
+    if (!e) {
+        return ESP_ERR_NO_MEM;
+    }
+    e->ns = handle & ~HANDLE_WRITE;
+    strcpy(e->key, key);
+    e->type = type;
+    e->len = len;
+    memcpy(e->data, data, len);
+    pthread_mutex_lock(&s_lock);
+    nvs_entry_t **p = find(e->ns, key);
+    if (*p) {
+        nvs_entry_t *old = *p;
+        e->next = old->next;
+        free(old);
+    } else {
+        e->next = NULL;
+    }
+    *p = e;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+/* Copies the value into @p out; *len is updated to the stored size. */
+static esp_err_t get_value(nvs_handle_t handle, const char *key, nvs_type_t type, void *out,
+                           size_t *len)
+{
+    pthread_mutex_lock(&s_lock);
+    nvs_entry_t *e = *find(handle & ~HANDLE_WRITE, key);
+    esp_err_t err = ESP_OK;
+    if (!e) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (e->type != type) {
+        err = ESP_ERR_NVS_TYPE_MISMATCH;
+    } else if (out && *len < e->len) {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        if (out) {
+            memcpy(out, e->data, e->len);
+        }
+        *len = e->len;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    if (!(handle & HANDLE_WRITE)) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    pthread_mutex_lock(&s_lock);
+    nvs_entry_t **p = find(handle & ~HANDLE_WRITE, key);
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+    if (*p) {
+        nvs_entry_t *old = *p;
+        *p = old->next;
+        free(old);
+        err = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    if (!(handle & HANDLE_WRITE)) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    uint32_t ns = handle & ~HANDLE_WRITE;
+    pthread_mutex_lock(&s_lock);
+    nvs_entry_t **p = &s_entries;
+    while (*p) {
+        if ((*p)->ns == ns) {
+            nvs_entry_t *old = *p;
+            *p = old->next;
+            free(old);
+        } else {
+            p = &(*p)->next;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+#define NVS_SCALAR(suffix, ctype, tag)                                                   \
+    esp_err_t nvs_set_##suffix(nvs_handle_t handle, const char *key, ctype value)        \
+    {                                                                                    \
+        return set_value(handle, key, tag, &value, sizeof(value));                       \
+    }                                                                                    \
+    esp_err_t nvs_get_##suffix(nvs_handle_t handle, const char *key, ctype *out_value)   \
+    {                                                                                    \
+        size_t len = sizeof(*out_value);                                                 \
+        return get_value(handle, key, tag, out_value, &len);                             \
+    }
+
+NVS_SCALAR(u8, uint8_t, NVS_TYPE_U8)
+NVS_SCALAR(u32, uint32_t, NVS_TYPE_U32)
+NVS_SCALAR(i32, int32_t, NVS_TYPE_I32)
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return set_value(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return get_value(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return set_value(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return get_value(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
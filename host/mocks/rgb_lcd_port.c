@@ -0,0 +1,144 @@
+/*
+ * rgb_lcd_port for the host build: the panel is an RGB565 framebuffer of
+ * LCD_H_RES x LCD_V_RES in memory.
+ */
+#include "rgb_lcd_port.h"
+#include "host_hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "host_lcd";
+
+static esp_lcd_panel_t s_panel;
+static uint16_t *s_fb;
+static uint8_t s_brightness = 100;
+static uint32_t s_flushes;
+static uint64_t s_pixels;
+
+static esp_err_t fb_draw_bitmap(esp_lcd_panel_t *panel, int x_start, int y_start, int x_end,
+                                int y_end, const void *color_data)
+{
+    (void)panel;
+    if (x_start < 0 || y_start < 0 || x_end > LCD_H_RES || y_end > LCD_V_RES ||
+        x_start >= x_end || y_start >= y_end) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Same contract as esp_lcd: end coordinates are exclusive */
+    size_t w = (size_t)(x_end - x_start);
+    const uint16_t *src = color_data;
+    for (int y = y_start; y < y_end; ++y) {
+        memcpy(&s_fb[(size_t)y * LCD_H_RES + x_start], src, w * sizeof(uint16_t));
+        src += w;
+    }
+    s_flushes++;
+    s_pixels += w * (size_t)(y_end - y_start);
+    return ESP_OK;
+}
+
+esp_lcd_panel_handle_t waveshare_esp32_s3_rgb_lcd_init()
+{
+    if (!s_fb) {
+        s_fb = calloc((size_t)LCD_H_RES * LCD_V_RES, sizeof(uint16_t));
+        if (!s_fb) {
+            ESP_LOGE(TAG, "No memory for the framebuffer");
+            return NULL;
+        }
+    }
+    s_panel.draw_bitmap = fb_draw_bitmap;
+    s_flushes = 0;
+    s_pixels = 0;
+    ESP_LOGI(TAG, "Framebuffer panel %dx%d", LCD_H_RES, LCD_V_RES);
+    return &s_panel;
+}
+
+void waveshare_esp32_s3_rgb_lcd_deinit(void)
+{
+    free(s_fb);
+    s_fb = NULL;
+}
+
+void waveshare_rgb_lcd_bl_on()
+{
+    s_brightness = 100;
+}
+
+void waveshare_rgb_lcd_bl_off()
+{
+    s_brightness = 0;
+}
+
+void waveshare_rgb_lcd_set_brightness(uint8_t level)
+{
+    s_brightness = level > 100 ? 100 : level;
+}
+
+void waveshare_rgb_lcd_display_window(int16_t Xstart, int16_t Ystart, int16_t Xend, int16_t Yend,
+                                      uint8_t *Image)
+{
+    /* Image is a full frame; copy the window out of it */
+    if (!s_fb) {
+        return;
+    }
+    const uint16_t *src = (const uint16_t *)Image;
+    for (int y = Ystart; y < Yend && y < LCD_V_RES; ++y) {
+        size_t off = (size_t)y * LCD_H_RES + Xstart;
+        memcpy(&s_fb[off], &src[off], (size_t)(Xend - Xstart) * sizeof(uint16_t));
+    }
+    s_flushes++;
+}
+
+void waveshare_rgb_lcd_display(uint8_t *Image)
+{
+    if (s_fb) {
+        memcpy(s_fb, Image, (size_t)LCD_H_RES * LCD_V_RES * sizeof(uint16_t));
+        s_flushes++;
+    }
+}
+
+void waveshare_get_frame_buffer(void **buf1, void **buf2)
+{
+    *buf1 = s_fb;
+    if (buf2) {
+        *buf2 = NULL;
+    }
+}
+
+uint16_t *host_lcd_framebuffer(uint16_t *width, uint16_t *height)
+{
+    if (width) {
+        *width = LCD_H_RES;
+    }
+    if (height) {
+        *height = LCD_V_RES;
+    }
+    return s_fb;
+}
+
+void host_lcd_get_counters(uint32_t *flushes, uint64_t *pixels)
+{
+    *flushes = s_flushes;
+    *pixels = s_pixels;
+}
+
+esp_err_t host_lcd_save_ppm(const char *path)
+{
+    if (!s_fb) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return ESP_FAIL;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", LCD_H_RES, LCD_V_RES);
+    for (size_t i = 0; i < (size_t)LCD_H_RES * LCD_V_RES; ++i) {
+        uint16_t c = s_fb[i];
+        uint8_t rgb[3] = {
+            (uint8_t)(((c >> 11) & 0x1F) * 255 / 31),
+            (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+            (uint8_t)((c & 0x1F) * 255 / 31),
+        };
+        fwrite(rgb, 1, sizeof(rgb), f);
+    }
+    return fclose(f) == 0 ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,59 @@
+/*
+ * SD card for the host build: MOUNT_POINT is a plain directory.
+ */
+#include "sd.h"
+#include "esp_log.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/statvfs.h>
+
+static bool s_mounted;
+
+esp_err_t sd_mmc_init()
+{
+    if (s_mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    struct stat st;
+    if (stat(MOUNT_POINT, &st) != 0) {
+        if (mkdir(MOUNT_POINT, 0755) != 0) {
+            ESP_LOGE(SD_TAG, "Cannot create %s: %s", MOUNT_POINT, strerror(errno));
+            return ESP_FAIL;
+        }
+    } else if (!S_ISDIR(st.st_mode)) {
+        ESP_LOGE(SD_TAG, "%s is not a directory", MOUNT_POINT);
+        return ESP_FAIL;
+    }
+    s_mounted = true;
+    ESP_LOGI(SD_TAG, "Filesystem mounted on %s", MOUNT_POINT);
+    return ESP_OK;
+}
+
+esp_err_t sd_mmc_unmount()
+{
+    if (!s_mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_mounted = false;
+    return ESP_OK;
+}
+
+void sd_card_print_info()
+{
+    ESP_LOGI(SD_TAG, "Host directory %s", MOUNT_POINT);
+}
+
+esp_err_t read_sd_capacity(size_t *total_capacity, size_t *available_capacity)
+{
+    if (!s_mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    struct statvfs vfs;
+    if (statvfs(MOUNT_POINT, &vfs) != 0) {
+        return ESP_FAIL;
+    }
+    *total_capacity = (size_t)((uint64_t)vfs.f_blocks * vfs.f_frsize / 1024);
+    *available_capacity = (size_t)((uint64_t)vfs.f_bavail * vfs.f_frsize / 1024);
+    return ESP_OK;
+}
@@ -0,0 +1,157 @@
+/*
+ * TWAI for the host build: RX and TX are FreeRTOS queues sized from the
+ * general config, filled and drained by host_twai_inject()/host_twai_take_tx().
+ */
+#include "driver/twai.h"
+#include "host_hal.h"
+#include "freertos/queue.h"
+#include <string.h>
+
+static QueueHandle_t s_rx;
+static QueueHandle_t s_tx;
+static twai_state_t s_state = TWAI_STATE_STOPPED;
+static uint32_t s_alerts_enabled;
+static twai_status_info_t s_status;
+
+esp_err_t twai_driver_install(const twai_general_config_t *g_config,
+                              const twai_timing_config_t *t_config,
+                              const twai_filter_config_t *f_config)
+{
+    (void)t_config;
+    (void)f_config;
+    if (s_rx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_rx = xQueueCreate(g_config->rx_queue_len ? g_config->rx_queue_len : 1, sizeof(twai_message_t));
+    s_tx = xQueueCreate(g_config->tx_queue_len ? g_config->tx_queue_len : 1, sizeof(twai_message_t));
+    if (!s_rx || !s_tx) {
+        vQueueDelete(s_rx);
+        vQueueDelete(s_tx);
+        s_rx = s_tx = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    s_alerts_enabled = g_config->alerts_enabled;
+    memset(&s_status, 0, sizeof(s_status));
+    s_state = TWAI_STATE_STOPPED;
+    return ESP_OK;
+}
+
+esp_err_t twai_driver_uninstall(void)
+{
+    if (!s_rx || s_state == TWAI_STATE_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    vQueueDelete(s_rx);
+    vQueueDelete(s_tx);
+    s_rx = s_tx = NULL;
+    return ESP_OK;
+}
+
+esp_err_t twai_start(void)
+{
+    if (!s_rx || s_state != TWAI_STATE_STOPPED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_state = TWAI_STATE_RUNNING;
+    return ESP_OK;
+}
+
+esp_err_t twai_stop(void)
+{
+    if (!s_rx || s_state != TWAI_STATE_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_state = TWAI_STATE_STOPPED;
+    return ESP_OK;
+}
+
+esp_err_t twai_transmit(const twai_message_t *message, TickType_t ticks_to_wait)
+{
+    if (!message || message->data_length_code > TWAI_FRAME_MAX_DLC) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_state != TWAI_STATE_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xQueueSend(s_tx, message, ticks_to_wait) != pdTRUE) {
+        s_status.tx_failed_count++;
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t twai_receive(twai_message_t *message, TickType_t ticks_to_wait)
+{
+    if (!message) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_rx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return xQueueReceive(s_rx, message, ticks_to_wait) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_read_alerts(uint32_t *alerts, TickType_t ticks_to_wait)
+{
+    /* Only RX_DATA is emulated */
+    twai_message_t peek;
+    bool data = s_rx && xQueuePeek(s_rx, &peek, ticks_to_wait) == pdTRUE;
+    *alerts = data ? (TWAI_ALERT_RX_DATA & s_alerts_enabled) : 0;
+    return *alerts ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_reconfigure_alerts(uint32_t alerts_enabled, uint32_t *current_alerts)
+{
+    s_alerts_enabled = alerts_enabled;
+    if (current_alerts) {
+        *current_alerts = 0;
+    }
+    return ESP_OK;
+}
+
+esp_err_t twai_get_status_info(twai_status_info_t *status_info)
+{
+    if (!s_rx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_status.state = s_state;
+    s_status.msgs_to_rx = uxQueueMessagesWaiting(s_rx);
+    s_status.msgs_to_tx = uxQueueMessagesWaiting(s_tx);
+    *status_info = s_status;
+    return ESP_OK;
+}
+
+esp_err_t twai_initiate_recovery(void)
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t twai_clear_receive_queue(void)
+{
+    return s_rx ? (xQueueReset(s_rx), ESP_OK) : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t twai_clear_transmit_queue(void)
+{
+    return s_tx ? (xQueueReset(s_tx), ESP_OK) : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t host_twai_inject(const twai_message_t *msg)
+{
+    if (!s_rx || s_state != TWAI_STATE_RUNNING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xQueueSend(s_rx, msg, 0) != pdTRUE) {
+        s_status.rx_missed_count++;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t host_twai_take_tx(twai_message_t *msg, TickType_t ticks)
+{
+    if (!s_tx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return xQueueReceive(s_tx, msg, ticks) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
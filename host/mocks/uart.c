@@ -0,0 +1,229 @@
+/*
+ * UART for the host build: each installed port has an RX and a TX byte
+ * queue, filled and drained by host_uart_inject()/host_uart_take_tx(), and
+ * an optional event queue.
+ */
+#include "driver/uart.h"
+#include "host_hal.h"
+#include "freertos/task.h"
+#include <string.h>
+
+#define UART_HOST_TX_BUF 4096
+
+typedef struct {
+    QueueHandle_t rx;
+    QueueHandle_t tx;
+    QueueHandle_t events;
+    uint32_t baudrate;
+    uart_mode_t mode;
+} uart_port_state_t;
+
+static uart_port_state_t s_ports[UART_NUM_MAX];
+
+static uart_port_state_t *port_get(uart_port_t uart_num)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || !s_ports[uart_num].rx) {
+        return NULL;
+    }
+    return &s_ports[uart_num];
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void)tx_buffer_size;
+    (void)intr_alloc_flags;
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || rx_buffer_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_port_state_t *p = &s_ports[uart_num];
+    if (p->rx) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    p->rx = xQueueCreate(rx_buffer_size, 1);
+    p->tx = xQueueCreate(UART_HOST_TX_BUF, 1);
+    if (uart_queue && queue_size > 0) {
+        p->events = xQueueCreate(queue_size, sizeof(uart_event_t));
+    }
+    if (!p->rx || !p->tx || (uart_queue && queue_size > 0 && !p->events)) {
+        vQueueDelete(p->rx);
+        vQueueDelete(p->tx);
+        vQueueDelete(p->events);
+        p->rx = p->tx = p->events = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    if (uart_queue) {
+        *uart_queue = p->events;
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    uart_port_state_t *p = port_get(uart_num);
+    if (!p) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    vQueueDelete(p->rx);
+    vQueueDelete(p->tx);
+    vQueueDelete(p->events);
+    memset(p, 0, sizeof(*p));
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX || !uart_config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ports[uart_num].baudrate = (uint32_t)uart_config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num,
+                       int cts_io_num)
+{
+    (void)tx_io_num;
+    (void)rx_io_num;
+    (void)rts_io_num;
+    (void)cts_io_num;
+    return (uart_num >= 0 && uart_num < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_mode(uart_port_t uart_num, uart_mode_t mode)
+{
+    uart_port_state_t *p = port_get(uart_num);
+    if (!p) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    p->mode = mode;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ports[uart_num].baudrate = baudrate;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t uart_num, uint32_t *baudrate)
+{
+    if (uart_num < 0 || uart_num >= UART_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *baudrate = s_ports[uart_num].baudrate;
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    uart_port_state_t *p = port_get(uart_num);
+    if (!p) {
+        return -1;
+    }
+    const uint8_t *b = src;
+    for (size_t i = 0; i < size; ++i) {
+        if (xQueueSend(p->tx, &b[i], portMAX_DELAY) != pdTRUE) {
+            return (int)i;
+        }
+    }
+    return (int)size;
+}
+
+/* Collect up to @p length bytes from @p q, waiting at most @p ticks overall. */
+static int read_queue(QueueHandle_t q, void *buf, size_t length, TickType_t ticks)
+{
+    uint8_t *out = buf;
+    TickType_t start = xTaskGetTickCount();
+    size_t n = 0;
+    while (n < length) {
+        TickType_t wait = 0;
+        if (ticks == portMAX_DELAY) {
+            wait = portMAX_DELAY;
+        } else {
+            TickType_t spent = xTaskGetTickCount() - start;
+            wait = spent < ticks ? ticks - spent : 0;
+        }
+        if (xQueueReceive(q, &out[n], wait) != pdTRUE) {
+            break;
+        }
+        n++;
+    }
+    return (int)n;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    uart_port_state_t *p = port_get(uart_num);
+    if (!p) {
+        return -1;
+    }
+    return read_queue(p->rx, buf, length, ticks_to_wait);
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    uart_port_state_t *p = port_get(uart_num);
+    if (!p) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *size = uxQueueMessagesWaiting(p->rx);
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    uart_port_state_t *p = port_get(uart_num);
+    if (!p) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xQueueReset(p->rx);
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+    return port_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_set_rx_timeout(uart_port_t uart_num, const uint8_t tout_thresh)
+{
+    (void)tout_thresh;
+    return port_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t host_uart_inject(uart_port_t port, const void *data, size_t len)
+{
+    uart_port_state_t *p = port_get(port);
+    if (!p) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint8_t *b = data;
+    for (size_t i = 0; i < len; ++i) {
+        if (xQueueSend(p->rx, &b[i], 0) != pdTRUE) {
+            if (p->events) {
+                uart_event_t evt = {.type = UART_BUFFER_FULL};
+                xQueueSend(p->events, &evt, 0);
+            }
+            return ESP_ERR_NO_MEM; /* RX FIFO overflow */
+        }
+    }
+    if (p->events && len > 0) {
+        uart_event_t evt = {.type = UART_DATA, .size = len, .timeout_flag = true};
+        xQueueSend(p->events, &evt, 0);
+    }
+    return ESP_OK;
+}
+
+int host_uart_take_tx(uart_port_t port, void *buf, size_t len, TickType_t ticks)
+{
+    uart_port_state_t *p = port_get(port);
+    if (!p) {
+        return -1;
+    }
+    return read_queue(p->tx, buf, len, ticks);
+}
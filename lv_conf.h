@@ -2,8 +2,10 @@
 #define LV_CONF_H
 
 #define LV_USE_PNG 1
+#define LV_USE_LODEPNG 1
 #define LV_PNG_USE_LV_FILESYSTEM 1
 #define LV_COLOR_DEPTH 16
-#define LV_MEM_SIZE (128U * 1024U)
+/* lv_malloc() comes from components/lvgl_mem, sized in Kconfig */
+#define LV_USE_STDLIB_MALLOC LV_STDLIB_CUSTOM
 
 #endif /* LV_CONF_H */
@@ -0,0 +1,73 @@
+#include "app_console.h"
+#include "bench.h"
+#include "bench_app.h"
+#include "boot.h"
+#include "can_display.h"
+#include "esp_check.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "gui_perf.h"
+#include "i2c_bus.h"
+#include "image_pool.h"
+#include "input_bus.h"
+#include "lvmem_tlsf.h"
+#include "sd.h"
+#include "trace.h"
+#include "ui_font.h"
+
+#define CONSOLE_TASK_STACK 8192
+
+static const char *TAG = "CONSOLE";
+static esp_console_repl_t *s_repl;
+
+esp_err_t app_console_start(void) {
+  if (s_repl) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+  repl_config.prompt = "display>";
+  // Les benchmarks décodent et dessinent depuis la tâche de la console
+  repl_config.task_stack_size = CONSOLE_TASK_STACK;
+
+#if defined(CONFIG_ESP_CONSOLE_UART_DEFAULT) ||                                \
+    defined(CONFIG_ESP_CONSOLE_UART_CUSTOM)
+  esp_console_dev_uart_config_t hw_config =
+      ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+  ESP_RETURN_ON_ERROR(
+      esp_console_new_repl_uart(&hw_config, &repl_config, &s_repl), TAG,
+      "Création de la console UART impossible");
+#elif defined(CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG)
+  esp_console_dev_usb_serial_jtag_config_t hw_config =
+      ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+  ESP_RETURN_ON_ERROR(esp_console_new_repl_usb_serial_jtag(
+                          &hw_config, &repl_config, &s_repl),
+                      TAG, "Création de la console USB impossible");
+#elif defined(CONFIG_ESP_CONSOLE_USB_CDC)
+  esp_console_dev_usb_cdc_config_t hw_config =
+      ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+  ESP_RETURN_ON_ERROR(
+      esp_console_new_repl_usb_cdc(&hw_config, &repl_config, &s_repl), TAG,
+      "Création de la console USB CDC impossible");
+#else
+  ESP_LOGW(TAG, "Aucun port de console configuré");
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+
+  ESP_RETURN_ON_ERROR(esp_console_register_help_command(), TAG,
+                      "Commande help");
+  ESP_RETURN_ON_ERROR(bench_app_register(), TAG, "Benchmarks");
+  ESP_RETURN_ON_ERROR(bench_console_register(MOUNT_POINT "/bench"), TAG,
+                      "Commande bench");
+  ESP_RETURN_ON_ERROR(gui_perf_console_register(), TAG, "Commande perf");
+  ESP_RETURN_ON_ERROR(can_display_console_register(), TAG, "Commande can");
+  ESP_RETURN_ON_ERROR(input_bus_console_register(), TAG, "Commande input");
+  ESP_RETURN_ON_ERROR(i2c_bus_console_register(), TAG, "Commande i2c");
+  ESP_RETURN_ON_ERROR(image_pool_console_register(), TAG, "Commande pool");
+  ESP_RETURN_ON_ERROR(lvmem_console_register(), TAG, "Commande lvmem");
+  ESP_RETURN_ON_ERROR(ui_font_console_register(), TAG, "Commande font");
+  ESP_RETURN_ON_ERROR(boot_console_register(), TAG, "Commande boot");
+#if CONFIG_APP_TRACE
+  ESP_RETURN_ON_ERROR(trace_console_register(), TAG, "Commande trace");
+#endif
+  return esp_console_start_repl(s_repl);
+}
@@ -0,0 +1,23 @@
+#ifndef APP_CONSOLE_H
+#define APP_CONSOLE_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the serial console (esp_console REPL) with the diagnostic
+ * commands: help, bench, perf, trace.
+ *
+ * The REPL runs on the port selected by CONFIG_ESP_CONSOLE_* (UART or
+ * USB Serial/JTAG). Call once the SD card is mounted.
+ */
+esp_err_t app_console_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // APP_CONSOLE_H
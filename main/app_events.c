@@ -0,0 +1,140 @@
+#include "app_events.h"
+#include "battery.h"
+#include "config.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "input_bus.h"
+#include "pm.h"
+#include "rgb_lcd_port.h"
+#include "trace.h"
+#include "ui_navigation.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define APP_EVENT_QUEUE_LEN 16
+
+static const char *TAG = "APP_EVT";
+static QueueHandle_t s_queue;
+static esp_timer_handle_t s_bg_timer;
+static volatile TickType_t s_last_activity_ticks;
+static volatile bool s_idle_posted;
+static esp_timer_handle_t s_slide_timer;
+static uint16_t s_slide_period_s;
+static volatile uint8_t s_max_brightness = CONFIG_MAX_BRIGHTNESS;
+static volatile int s_prev_level = -1;
+
+void pm_update_activity(void) {
+  s_last_activity_ticks = xTaskGetTickCount();
+  s_idle_posted = false;
+}
+
+bool pm_is_idle(void) {
+  return pdTICKS_TO_MS(xTaskGetTickCount() - s_last_activity_ticks) >
+         INACTIVITY_TIMEOUT_MS;
+}
+
+// Tâche esp_timer : luminosité selon la batterie, puis inactivité
+static void background_timer_cb(void *arg) {
+  uint8_t batt = battery_get_percentage();
+  float normalized = batt / 100.0f;
+  float corrected = powf(normalized, BRIGHTNESS_GAMMA);
+  uint8_t max = s_max_brightness;
+  uint8_t min = max < CONFIG_MIN_BRIGHTNESS ? max : CONFIG_MIN_BRIGHTNESS;
+  uint8_t level = min + (uint8_t)((max - min) * corrected);
+
+  if (s_prev_level < 0 ||
+      abs((int)level - s_prev_level) >= CONFIG_BRIGHTNESS_HYSTERESIS) {
+    waveshare_rgb_lcd_set_brightness(level);
+    s_prev_level = level;
+  }
+  TRACE_COUNTER("battery_pct", batt);
+
+  // Une seule notification par période d'inactivité
+  if (!s_idle_posted && pm_is_idle()) {
+    s_idle_posted = app_events_post(APP_EVT_IDLE, 0);
+  }
+}
+
+esp_err_t app_events_init(void) {
+  if (s_queue) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  s_queue = xQueueCreate(APP_EVENT_QUEUE_LEN, sizeof(app_event_t));
+  if (!s_queue) {
+    return ESP_ERR_NO_MEM;
+  }
+  pm_update_activity();
+  const esp_timer_create_args_t args = {
+      .callback = background_timer_cb,
+      .name = "app_bg",
+  };
+  ESP_RETURN_ON_ERROR(esp_timer_create(&args, &s_bg_timer), TAG,
+                      "Création du timer de fond impossible");
+  ESP_RETURN_ON_ERROR(
+      esp_timer_start_periodic(s_bg_timer, CONFIG_BG_TASK_DELAY_MS * 1000ULL),
+      TAG, "Démarrage du timer de fond impossible");
+  return ESP_OK;
+}
+
+bool app_events_post(app_event_type_t type, int32_t value) {
+  if (!s_queue) {
+    return false;
+  }
+  app_event_t evt = {.type = type, .value = value};
+  if (xQueueSend(s_queue, &evt, 0) != pdTRUE) {
+    ESP_LOGW(TAG, "File pleine, événement %d perdu", (int)type);
+    return false;
+  }
+  return true;
+}
+
+bool app_events_wait(app_event_t *evt, TickType_t timeout) {
+  TRACE_BEGIN("app_wait");
+  bool got = s_queue && xQueueReceive(s_queue, evt, timeout) == pdTRUE;
+  TRACE_END("app_wait");
+  return got;
+}
+
+void app_events_reset(void) {
+  if (s_queue) {
+    xQueueReset(s_queue);
+  }
+  // Leur APP_EVT_NAV_STEPS vient d'être jeté
+  input_bus_take_steps();
+}
+
+void app_events_set_max_brightness(uint8_t percent) {
+  s_max_brightness = percent > 100 ? 100 : percent;
+  s_prev_level = -1; // Appliqué au prochain tour, sans hystérésis
+}
+
+uint8_t app_events_get_brightness(void) {
+  int level = s_prev_level;
+  return level < 0 ? 0 : (uint8_t)level;
+}
+
+static void slideshow_timer_cb(void *arg) {
+  input_bus_publish(INPUT_SRC_SLIDESHOW, NAV_CMD_NEXT);
+}
+
+esp_err_t app_events_set_slideshow(uint16_t period_s) {
+  if (!s_slide_timer) {
+    const esp_timer_create_args_t args = {
+        .callback = slideshow_timer_cb,
+        .name = "app_slide",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&args, &s_slide_timer), TAG,
+                        "Création du timer de diaporama impossible");
+  }
+  esp_timer_stop(s_slide_timer);
+  s_slide_period_s = period_s;
+  if (period_s == 0) {
+    return ESP_OK;
+  }
+  return esp_timer_start_periodic(s_slide_timer, period_s * 1000000ULL);
+}
+
+uint16_t app_events_get_slideshow(void) { return s_slide_period_s; }
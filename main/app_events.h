@@ -0,0 +1,84 @@
+#ifndef APP_EVENTS_H
+#define APP_EVENTS_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Event queue of the application task.
+ *
+ * Everything app_main() reacts to is posted here: navigation buttons,
+ * Wi-Fi status, remote images landing in memory and the inactivity timer.
+ * app_main() blocks in app_events_wait() between events instead of polling,
+ * so a command is handled as soon as it is posted and the CPU idles
+ * otherwise.
+ */
+
+typedef enum {
+  APP_EVT_NAV = 0,     /*!< Navigation button, nav_cmd_t in value */
+  APP_EVT_NAV_STEPS,   /*!< Next/previous pending, see input_bus_take_steps() */
+  APP_EVT_WIFI,        /*!< wifi_manager_event_t in value */
+  APP_EVT_IMAGE_READY, /*!< Remote image prefetched, index in value */
+  APP_EVT_IDLE,        /*!< No activity for CONFIG_INACTIVITY_TIMEOUT_MS */
+  APP_EVT_GOTO_INDEX,  /*!< Show the image at the index in value */
+  APP_EVT_GOTO_HASH,   /*!< Show the image whose name hash is in value */
+  APP_EVT_ALBUM_ADDED, /*!< An image was pushed into the CAN album */
+  APP_EVT_OPEN_FOLDER, /*!< Open the SD folder whose name hash is in value */
+} app_event_type_t;
+
+typedef struct {
+  app_event_type_t type;
+  int32_t value;
+} app_event_t;
+
+/**
+ * @brief Create the queue and start the background timer, which adjusts
+ * the backlight to the battery level every CONFIG_BG_TASK_DELAY_MS and
+ * posts APP_EVT_IDLE once per inactivity period.
+ */
+esp_err_t app_events_init(void);
+
+/** Post an event without blocking; false when the queue is full. */
+bool app_events_post(app_event_type_t type, int32_t value);
+
+/**
+ * @brief Wait up to @p timeout for the next event.
+ *
+ * A caller that drops APP_EVT_NAV_STEPS must call input_bus_take_steps(),
+ * or next/previous stop working.
+ */
+bool app_events_wait(app_event_t *evt, TickType_t timeout);
+
+/** Drop every pending event, including the input bus's pending steps. */
+void app_events_reset(void);
+
+/**
+ * @brief Cap the backlight at @p percent instead of CONFIG_MAX_BRIGHTNESS.
+ *
+ * Applied by the next background timer period.
+ */
+void app_events_set_max_brightness(uint8_t percent);
+
+/** Backlight level last applied, in percent. */
+uint8_t app_events_get_brightness(void);
+
+/**
+ * @brief Publish NAV_CMD_NEXT every @p period_s seconds; 0 stops the
+ * slideshow.
+ */
+esp_err_t app_events_set_slideshow(uint16_t period_s);
+
+/** Current slideshow period in seconds, 0 when stopped. */
+uint16_t app_events_get_slideshow(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // APP_EVENTS_H
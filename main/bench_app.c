@@ -0,0 +1,163 @@
+#include "bench_app.h"
+#include "bench.h"
+#include "file_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if BENCH_HAVE_LVGL
+#include "gui.h"
+#include "lvgl.h"
+#include "ui_navigation.h"
+#endif
+
+// Listing de répertoire : première page (ce que coûte l'ouverture d'un
+// dossier) et parcours complet page par page.
+typedef struct {
+  const char *dir;
+  bool all;
+} list_arg_t;
+
+typedef struct {
+  const list_arg_t *arg;
+  char path[256];
+  file_manager_state_t saved;
+} list_state_t;
+
+static esp_err_t list_setup(const void *arg, const char *corpus,
+                            void **state) {
+  const list_arg_t *a = arg;
+  list_state_t *st = calloc(1, sizeof(*st));
+  if (st == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  st->arg = a;
+  snprintf(st->path, sizeof(st->path), "%s/list/%s", corpus, a->dir);
+  DIR *d = opendir(st->path);
+  if (d == NULL) {
+    free(st);
+    return ESP_ERR_NOT_FOUND;
+  }
+  closedir(d);
+  // Ne pas perdre la page affichée à l'utilisateur
+  file_manager_save(&st->saved);
+  *state = st;
+  return ESP_OK;
+}
+
+static esp_err_t list_run(void *state, uint64_t *work) {
+  list_state_t *st = state;
+  esp_err_t err = list_files_sorted(st->path, 0, PNG_LIST_INIT_CAP);
+  uint64_t total = 0;
+  while (err == ESP_OK) {
+    total += png_list.size;
+    if (!st->arg->all || !png_has_more) {
+      break;
+    }
+    err = file_manager_next_page(PNG_LIST_INIT_CAP);
+  }
+  png_list_free();
+  *work = total;
+  return err;
+}
+
+static void list_teardown(void *state) {
+  list_state_t *st = state;
+  file_manager_restore(&st->saved);
+  free(st);
+}
+
+static const list_arg_t k_list_10 = {"10", false};
+static const list_arg_t k_list_1k = {"1k", false};
+static const list_arg_t k_list_100k = {"100k", false};
+static const list_arg_t k_list_10_all = {"10", true};
+static const list_arg_t k_list_1k_all = {"1k", true};
+static const list_arg_t k_list_100k_all = {"100k", true};
+
+#define LIST_CASE(n, unit, a)                                                  \
+  {                                                                            \
+      .name = n,                                                               \
+      .rate_unit = unit,                                                       \
+      .rate_scale = 1e3,                                                       \
+      .setup = list_setup,                                                     \
+      .run = list_run,                                                         \
+      .teardown = list_teardown,                                               \
+      .arg = &a,                                                               \
+  }
+
+static const bench_case_t k_list_cases[] = {
+    LIST_CASE("list/10", NULL, k_list_10),
+    LIST_CASE("list/1k", NULL, k_list_1k),
+    LIST_CASE("list/100k", NULL, k_list_100k),
+    LIST_CASE("list_all/10", "kfiles/s", k_list_10_all),
+    LIST_CASE("list_all/1k", "kfiles/s", k_list_1k_all),
+    LIST_CASE("list_all/100k", "kfiles/s", k_list_100k_all),
+};
+
+#if BENCH_HAVE_LVGL
+// Bout en bout : commande de navigation -> image décodée, rendue et envoyée
+// au panneau. lv_refr_now() déroule le rendu et les flush de façon synchrone.
+typedef struct {
+  char paths[2][256];
+  unsigned next;
+} e2e_state_t;
+
+static esp_err_t e2e_setup(const void *arg, const char *corpus, void **state) {
+  (void)arg;
+  e2e_state_t *st = calloc(1, sizeof(*st));
+  if (st == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  // Deux images en alternance pour que chaque itération change l'écran
+  snprintf(st->paths[0], sizeof(st->paths[0]), "%s/png/rgb8_1024x600.png",
+           corpus);
+  snprintf(st->paths[1], sizeof(st->paths[1]), "%s/png/rgb8_800x480.png",
+           corpus);
+  for (int i = 0; i < 2; ++i) {
+    FILE *f = fopen(st->paths[i], "rb");
+    if (f == NULL) {
+      free(st);
+      return ESP_ERR_NOT_FOUND;
+    }
+    fclose(f);
+  }
+  *state = st;
+  return ESP_OK;
+}
+
+static esp_err_t e2e_run(void *state, uint64_t *work) {
+  e2e_state_t *st = state;
+  ui_navigation_show_image(st->paths[st->next]);
+  draw_filename_bar(st->paths[st->next]);
+  st->next ^= 1;
+  lv_refr_now(NULL);
+  (void)work;
+  return ESP_OK;
+}
+
+static void e2e_teardown(void *state) { free(state); }
+
+static const bench_case_t k_e2e_cases[] = {
+    {
+        .name = "e2e/nav_to_pixels",
+        .setup = e2e_setup,
+        .run = e2e_run,
+        .teardown = e2e_teardown,
+    },
+};
+#endif
+
+esp_err_t bench_app_register(void) {
+  esp_err_t err = bench_register_core();
+  if (err == ESP_OK) {
+    err = bench_register(k_list_cases,
+                         sizeof(k_list_cases) / sizeof(k_list_cases[0]));
+  }
+#if BENCH_HAVE_LVGL
+  if (err == ESP_OK) {
+    err = bench_register(k_e2e_cases,
+                         sizeof(k_e2e_cases) / sizeof(k_e2e_cases[0]));
+  }
+  bench_set_lock(gui_lock, gui_unlock);
+#endif
+  return err;
+}
@@ -0,0 +1,22 @@
+#ifndef BENCH_APP_H
+#define BENCH_APP_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register every benchmark: the kernels of the bench component plus
+ * the application cases (directory listing, navigation to pixels).
+ *
+ * The runs hold the GUI lock, so nothing else draws while they are timed.
+ */
+esp_err_t bench_app_register(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_APP_H
@@ -0,0 +1,160 @@
+#include "boot.h"
+#include "esp_console.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BOOT_MAX_MARKS 16
+#define BOOT_PATH_MAX 256
+// Délai sans changement d'image avant l'écriture en NVS
+#define BOOT_SAVE_DELAY_US (3 * 1000 * 1000)
+
+#define NVS_NAMESPACE "boot"
+#define NVS_KEY_PATH "last_path"
+#define NVS_KEY_PAGE "last_page"
+
+static const char *TAG = "BOOT";
+
+typedef struct {
+  const char *stage;
+  int64_t us;
+} boot_mark_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static boot_mark_t s_marks[BOOT_MAX_MARKS];
+static size_t s_mark_count;
+
+// Image à enregistrer, et ce qui est déjà en NVS pour éviter les réécritures
+static char s_pending[BOOT_PATH_MAX];
+static size_t s_pending_page;
+static char s_saved[BOOT_PATH_MAX];
+static size_t s_saved_page;
+static esp_timer_handle_t s_save_timer;
+
+void boot_mark(const char *stage) {
+  int64_t now = esp_timer_get_time();
+  int64_t prev = 0;
+  portENTER_CRITICAL(&s_lock);
+  if (s_mark_count > 0) {
+    prev = s_marks[s_mark_count - 1].us;
+  }
+  if (s_mark_count < BOOT_MAX_MARKS) {
+    s_marks[s_mark_count++] = (boot_mark_t){stage, now};
+  }
+  portEXIT_CRITICAL(&s_lock);
+  TRACE_INSTANT(stage);
+  ESP_LOGI(TAG, "%-12s %5" PRId64 " ms (+%" PRId64 " ms)", stage, now / 1000,
+           (now - prev) / 1000);
+}
+
+// Tâche esp_timer : écrit l'image restée affichée assez longtemps
+static void save_timer_cb(void *arg) {
+  char path[BOOT_PATH_MAX];
+  size_t page;
+  portENTER_CRITICAL(&s_lock);
+  memcpy(path, s_pending, sizeof(path));
+  page = s_pending_page;
+  portEXIT_CRITICAL(&s_lock);
+  if (strcmp(path, s_saved) == 0 && page == s_saved_page) {
+    return;
+  }
+
+  nvs_handle_t nvs;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "NVS indisponible : %s", esp_err_to_name(err));
+    return;
+  }
+  if (path[0] == '\0') {
+    err = nvs_erase_key(nvs, NVS_KEY_PATH);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+      err = ESP_OK;
+    }
+  } else {
+    err = nvs_set_str(nvs, NVS_KEY_PATH, path);
+    if (err == ESP_OK) {
+      err = nvs_set_u32(nvs, NVS_KEY_PAGE, (uint32_t)page);
+    }
+  }
+  if (err == ESP_OK) {
+    err = nvs_commit(nvs);
+  }
+  nvs_close(nvs);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Dernière image non enregistrée : %s", esp_err_to_name(err));
+    return;
+  }
+  memcpy(s_saved, path, sizeof(s_saved));
+  s_saved_page = page;
+}
+
+void boot_remember_image(const char *path, size_t page_start) {
+  if (!s_save_timer) {
+    const esp_timer_create_args_t args = {
+        .callback = save_timer_cb,
+        .name = "boot_save",
+    };
+    if (esp_timer_create(&args, &s_save_timer) != ESP_OK) {
+      return;
+    }
+  }
+  portENTER_CRITICAL(&s_lock);
+  snprintf(s_pending, sizeof(s_pending), "%s", path);
+  s_pending_page = page_start;
+  portEXIT_CRITICAL(&s_lock);
+  // Repart de zéro à chaque image : seule la dernière est écrite
+  esp_timer_stop(s_save_timer);
+  esp_timer_start_once(s_save_timer, BOOT_SAVE_DELAY_US);
+}
+
+bool boot_last_image(char *path, size_t len, size_t *page_start) {
+  nvs_handle_t nvs;
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return false;
+  }
+  uint32_t page = 0;
+  size_t size = sizeof(s_saved);
+  bool found = nvs_get_str(nvs, NVS_KEY_PATH, s_saved, &size) == ESP_OK &&
+               nvs_get_u32(nvs, NVS_KEY_PAGE, &page) == ESP_OK &&
+               strlen(s_saved) < len;
+  nvs_close(nvs);
+  if (!found) {
+    s_saved[0] = '\0';
+    return false;
+  }
+  s_saved_page = page;
+  memcpy(path, s_saved, strlen(s_saved) + 1);
+  *page_start = page;
+  return true;
+}
+
+static int cmd_boot(int argc, char **argv) {
+  boot_mark_t marks[BOOT_MAX_MARKS];
+  portENTER_CRITICAL(&s_lock);
+  size_t count = s_mark_count;
+  memcpy(marks, s_marks, sizeof(marks));
+  portEXIT_CRITICAL(&s_lock);
+  printf("%-12s %8s %8s\n", "stage", "ms", "delta");
+  for (size_t i = 0; i < count; ++i) {
+    int64_t prev = i > 0 ? marks[i - 1].us : 0;
+    printf("%-12s %8" PRId64 " %8" PRId64 "\n", marks[i].stage,
+           marks[i].us / 1000, (marks[i].us - prev) / 1000);
+  }
+  printf("last image: %s\n", s_saved[0] ? s_saved : "(none)");
+  return 0;
+}
+
+esp_err_t boot_console_register(void) {
+  const esp_console_cmd_t cmd = {
+      .command = "boot",
+      .help = "Start-up stage timestamps and the image reopened at boot",
+      .hint = NULL,
+      .func = cmd_boot,
+  };
+  return esp_console_cmd_register(&cmd);
+}
@@ -0,0 +1,47 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Boot timeline and the image to reopen at the next boot.
+ *
+ * boot_mark() timestamps the start-up stages (esp_timer, so from the end
+ * of the ROM and second-stage bootloaders), logs each one with the time
+ * since the previous mark and keeps them for the `boot` console command.
+ * The mark named "first_image" is the time-to-first-image.
+ */
+
+/** Record the end of @p stage, a string literal. Callable from any task. */
+void boot_mark(const char *stage);
+
+/**
+ * @brief Remember @p path, shown from the png_list page starting at
+ * @p page_start, as the image to reopen at the next boot.
+ *
+ * Written to NVS once no other image was shown for a few seconds, so
+ * browsing does not wear the flash. An empty @p path forgets it.
+ */
+void boot_remember_image(const char *path, size_t page_start);
+
+/**
+ * @brief The image remembered by a previous run.
+ *
+ * @return false when there is none or it does not fit in @p len.
+ */
+bool boot_last_image(char *path, size_t len, size_t *page_start);
+
+/** Add the `boot` command to the esp_console REPL. */
+esp_err_t boot_console_register(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_H
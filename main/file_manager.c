@@ -16,6 +16,34 @@ DIR *png_dir = NULL;
 static const char *TAG = "FILE_MANAGER";
 static char s_base_path[PATH_MAX];
 
+struct png_str_block {
+  struct png_str_block *next;
+  size_t used;
+  size_t size;
+  char data[];
+};
+
+/* Take @p length bytes for a string from the list's blocks. Thousands of
+ * paths then cost a handful of allocations instead of one each, and
+ * clearing the list gives whole blocks back to the heap. */
+static char *png_str_alloc(png_list_t *list, size_t length) {
+  struct png_str_block *b = list->strings;
+  if (b == NULL || b->size - b->used < length) {
+    size_t size = length > PNG_STR_BLOCK_SIZE ? length : PNG_STR_BLOCK_SIZE;
+    b = heap_caps_malloc(sizeof(*b) + size, MALLOC_CAP_DEFAULT);
+    if (b == NULL) {
+      return NULL;
+    }
+    b->used = 0;
+    b->size = size;
+    b->next = list->strings;
+    list->strings = b;
+  }
+  char *str = b->data + b->used;
+  b->used += length;
+  return str;
+}
+
 static esp_err_t png_list_append(png_list_t *list, char *path) {
   if (list->size == list->capacity) {
     size_t new_cap = list->capacity ? list->capacity * 2 : PNG_LIST_INIT_CAP;
@@ -37,8 +65,10 @@ static bool is_png(const char *name) {
 }
 
 static void png_list_clear(void) {
-  for (size_t i = 0; i < png_list.size; ++i) {
-    free(png_list.items[i]);
+  while (png_list.strings) {
+    struct png_str_block *next = png_list.strings->next;
+    free(png_list.strings);
+    png_list.strings = next;
   }
   free(png_list.items);
   png_list.items = NULL;
@@ -70,8 +100,7 @@ static esp_err_t read_dir_page(size_t max_files) {
       continue;
     }
     size_t length = strlen(s_base_path) + strlen(entry->d_name) + 2;
-    char *full_path =
-        heap_caps_calloc(length, sizeof(char), MALLOC_CAP_DEFAULT);
+    char *full_path = png_str_alloc(&png_list, length);
     if (full_path == NULL) {
       ret = ESP_ERR_NO_MEM;
       break;
@@ -79,13 +108,11 @@ static esp_err_t read_dir_page(size_t max_files) {
     int written =
         snprintf(full_path, length, "%s/%s", s_base_path, entry->d_name);
     if (written < 0 || (size_t)written >= length) {
-      free(full_path);
       ret = ESP_ERR_INVALID_SIZE;
       break;
     }
     ret = png_list_append(&png_list, full_path);
     if (ret != ESP_OK) {
-      free(full_path);
       break;
     }
   }
@@ -157,6 +184,16 @@ esp_err_t file_manager_next_page(size_t max_files) {
   return ret;
 }
 
+esp_err_t png_list_add(const char *path) {
+  size_t length = strlen(path) + 1;
+  char *copy = png_str_alloc(&png_list, length);
+  if (copy == NULL) {
+    return ESP_ERR_NO_MEM;
+  }
+  memcpy(copy, path, length);
+  return png_list_append(&png_list, copy);
+}
+
 void png_list_free(void) {
   png_list_clear();
   if (png_dir) {
@@ -167,3 +204,27 @@ void png_list_free(void) {
   png_last_page_size = 0;
   png_has_more = false;
 }
+
+void file_manager_save(file_manager_state_t *state) {
+  state->list = png_list;
+  state->page_start = png_page_start;
+  state->has_more = png_has_more;
+  state->last_page_size = png_last_page_size;
+  state->dir = png_dir;
+  memcpy(state->base_path, s_base_path, sizeof(state->base_path));
+
+  memset(&png_list, 0, sizeof(png_list));
+  png_dir = NULL;
+  png_list_free();
+}
+
+void file_manager_restore(file_manager_state_t *state) {
+  png_list_free();
+  png_list = state->list;
+  png_page_start = state->page_start;
+  png_has_more = state->has_more;
+  png_last_page_size = state->last_page_size;
+  png_dir = state->dir;
+  memcpy(s_base_path, state->base_path, sizeof(s_base_path));
+  memset(state, 0, sizeof(*state));
+}
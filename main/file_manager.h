@@ -3,6 +3,7 @@
 
 #include "esp_err.h"
 #include <dirent.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -10,10 +11,14 @@
 extern "C" {
 #endif
 
+struct png_str_block;
+
 typedef struct {
   char **items;
   size_t size;
   size_t capacity;
+  /* The item strings, packed into a few blocks freed together */
+  struct png_str_block *strings;
 } png_list_t;
 
 extern png_list_t png_list;
@@ -23,8 +28,27 @@ extern size_t png_last_page_size;
 extern DIR *png_dir;
 
 #define PNG_LIST_INIT_CAP 16
+/** Size of the blocks holding the paths of ::png_list. */
+#define PNG_STR_BLOCK_SIZE 4096
+
+/** Complete browsing state, see file_manager_save(). */
+typedef struct {
+  png_list_t list;
+  size_t page_start;
+  bool has_more;
+  size_t last_page_size;
+  DIR *dir;
+  char base_path[PATH_MAX];
+} file_manager_state_t;
 
 void png_list_free(void);
+/**
+ * @brief Append a copy of @p path to ::png_list.
+ *
+ * Used for lists that do not come from a directory, such as a remote album
+ * shown from memory.
+ */
+esp_err_t png_list_add(const char *path);
 /**
  * @brief Load a page of PNG files sorted alphabetically.
  *
@@ -35,6 +59,15 @@ void png_list_free(void);
 esp_err_t list_files_sorted(const char *base_path, size_t start_idx,
                             size_t max_files);
 esp_err_t file_manager_next_page(size_t max_files);
+/**
+ * @brief Move the browsing state into @p state and leave the manager empty.
+ *
+ * Lets a tool such as the benchmarks list other directories without losing
+ * the page shown to the user; file_manager_restore() puts it back.
+ */
+void file_manager_save(file_manager_state_t *state);
+/** Free the current list and reinstate the state saved in @p state. */
+void file_manager_restore(file_manager_state_t *state);
 
 #ifdef __cplusplus
 }
@@ -1,8 +1,10 @@
 #include "http_server.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "input_bus.h"
 #include "sd.h"
 #include "sdkconfig.h"
+#include "trace.h"
 #include <ctype.h>
 #include <errno.h>
 #include <stdint.h>
@@ -45,20 +47,8 @@ static void sanitize_filename(char *out, const char *in, size_t len) {
   out[j] = '\0';
 }
 
-static esp_err_t root_get_handler(httpd_req_t *req) {
-  httpd_resp_set_type(req, "text/html");
-  return httpd_resp_send(req, upload_html, HTTPD_RESP_USE_STRLEN);
-}
-
-static esp_err_t upload_post_handler(httpd_req_t *req) {
-  char filepath[128] = "";
-  FILE *f = NULL;
-  const char *filename = req->uri + sizeof("/upload/") - 1;
-  if (strlen(filename) == 0) {
-    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Filename required");
-    return ESP_FAIL;
-  }
-
+// Vérifie le jeton d'accès s'il est configuré ; répond 401 sinon
+static bool check_auth(httpd_req_t *req) {
 #ifdef CONFIG_UPLOAD_AUTH_TOKEN_PRESENT
   size_t auth_len = httpd_req_get_hdr_value_len(req, "Authorization");
   char auth[64];
@@ -67,52 +57,53 @@ static esp_err_t upload_post_handler(httpd_req_t *req) {
           ESP_OK) {
     httpd_resp_set_status(req, "401 Unauthorized");
     httpd_resp_send(req, "Unauthorized", HTTPD_RESP_USE_STRLEN);
-    return ESP_FAIL;
+    return false;
   }
 
   uint8_t hash[32];
   mbedtls_sha256_context ctx;
   mbedtls_sha256_init(&ctx);
   int rc = mbedtls_sha256_starts(&ctx, 0);
-  if (rc != 0) {
-    ESP_LOGE(TAG, "mbedtls_sha256_starts failed: %d", rc);
-    mbedtls_sha256_free(&ctx);
-    if (f) {
-      fclose(f);
-      unlink(filepath);
-    }
-    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "hash fail");
-    return ESP_FAIL;
+  if (rc == 0) {
+    rc = mbedtls_sha256_update(&ctx, (const unsigned char *)auth,
+                               strlen(auth));
   }
-  rc = mbedtls_sha256_update(&ctx, (const unsigned char *)auth, strlen(auth));
-  if (rc != 0) {
-    ESP_LOGE(TAG, "mbedtls_sha256_update failed: %d", rc);
-    mbedtls_sha256_free(&ctx);
-    if (f) {
-      fclose(f);
-      unlink(filepath);
-    }
-    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "hash fail");
-    return ESP_FAIL;
+  if (rc == 0) {
+    rc = mbedtls_sha256_finish(&ctx, hash);
   }
-  rc = mbedtls_sha256_finish(&ctx, hash);
   mbedtls_sha256_free(&ctx);
   if (rc != 0) {
-    ESP_LOGE(TAG, "mbedtls_sha256_finish failed: %d", rc);
-    if (f) {
-      fclose(f);
-      unlink(filepath);
-    }
+    ESP_LOGE(TAG, "mbedtls_sha256 failed: %d", rc);
     httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "hash fail");
-    return ESP_FAIL;
+    return false;
   }
 
   if (memcmp(hash, upload_token_hash, sizeof(hash)) != 0) {
     httpd_resp_set_status(req, "401 Unauthorized");
     httpd_resp_send(req, "Unauthorized", HTTPD_RESP_USE_STRLEN);
-    return ESP_FAIL;
+    return false;
   }
 #endif
+  return true;
+}
+
+static esp_err_t root_get_handler(httpd_req_t *req) {
+  httpd_resp_set_type(req, "text/html");
+  return httpd_resp_send(req, upload_html, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t upload_post_handler(httpd_req_t *req) {
+  char filepath[128] = "";
+  FILE *f = NULL;
+  const char *filename = req->uri + sizeof("/upload/") - 1;
+  if (strlen(filename) == 0) {
+    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Filename required");
+    return ESP_FAIL;
+  }
+
+  if (!check_auth(req)) {
+    return ESP_FAIL;
+  }
 
   size_t ctype_len = httpd_req_get_hdr_value_len(req, "Content-Type");
   char ctype[32];
@@ -176,8 +167,10 @@ static esp_err_t upload_post_handler(httpd_req_t *req) {
   char buf[1024];
   size_t remaining = req->content_len;
   while (remaining > 0) {
+    TRACE_BEGIN("httpd_recv");
     ssize_t received = httpd_req_recv(
         req, buf, remaining > sizeof(buf) ? sizeof(buf) : remaining);
+    TRACE_END("httpd_recv");
     if (received < 0) {
       if (received == HTTPD_SOCK_ERR_TIMEOUT) {
         continue;
@@ -208,6 +201,58 @@ static esp_err_t upload_post_handler(httpd_req_t *req) {
   return ESP_OK;
 }
 
+// POST /nav/next, /nav/prev, /nav/rotate ou /nav/home
+static esp_err_t nav_post_handler(httpd_req_t *req) {
+  static const struct {
+    const char *name;
+    nav_cmd_t cmd;
+  } k_cmds[] = {{"next", NAV_CMD_NEXT},
+                {"prev", NAV_CMD_PREV},
+                {"rotate", NAV_CMD_ROTATE},
+                {"home", NAV_CMD_HOME}};
+  if (!check_auth(req)) {
+    return ESP_FAIL;
+  }
+  const char *name = req->uri + sizeof("/nav/") - 1;
+  for (size_t i = 0; i < sizeof(k_cmds) / sizeof(k_cmds[0]); ++i) {
+    if (strcmp(name, k_cmds[i].name) != 0) {
+      continue;
+    }
+    if (!input_bus_publish(INPUT_SRC_HTTP, k_cmds[i].cmd)) {
+      httpd_resp_set_status(req, "429 Too Many Requests");
+      httpd_resp_send(req, "Too many commands", HTTPD_RESP_USE_STRLEN);
+      return ESP_FAIL;
+    }
+    return httpd_resp_sendstr(req, "OK");
+  }
+  httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown command");
+  return ESP_FAIL;
+}
+
+#if CONFIG_APP_TRACE
+static esp_err_t trace_send_chunk(void *ctx, const char *data, size_t len) {
+  return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+static esp_err_t trace_get_handler(httpd_req_t *req) {
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Content-Disposition",
+                     "attachment; filename=\"trace.json\"");
+  esp_err_t err = trace_export_json(trace_send_chunk, req);
+  if (err == ESP_ERR_INVALID_STATE) {
+    // Rien n'a encore été envoyé
+    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR,
+                        "trace not initialised");
+    return ESP_FAIL;
+  }
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "trace export failed: %s", esp_err_to_name(err));
+  }
+  httpd_resp_send_chunk(req, NULL, 0);
+  return err;
+}
+#endif
+
 esp_err_t start_file_server(void) {
   if (s_server) {
     return ESP_OK;
@@ -230,6 +275,20 @@ esp_err_t start_file_server(void) {
                         .handler = upload_post_handler,
                         .user_ctx = NULL};
   httpd_register_uri_handler(s_server, &upload);
+
+  httpd_uri_t nav = {.uri = "/nav/*",
+                     .method = HTTP_POST,
+                     .handler = nav_post_handler,
+                     .user_ctx = NULL};
+  httpd_register_uri_handler(s_server, &nav);
+
+#if CONFIG_APP_TRACE
+  httpd_uri_t trace = {.uri = "/trace",
+                       .method = HTTP_GET,
+                       .handler = trace_get_handler,
+                       .user_ctx = NULL};
+  httpd_register_uri_handler(s_server, &trace);
+#endif
   ESP_LOGI(TAG, "server started");
   return ESP_OK;
 }
@@ -0,0 +1,149 @@
+#include "input_bus.h"
+#include "app_events.h"
+#include "config.h"
+#include "esp_console.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+// Jetons en millièmes de commande
+#define TOKEN_UNIT 1000
+
+typedef struct {
+  const char *name;
+  bool limited;
+} input_source_desc_t;
+
+static const input_source_desc_t k_sources[INPUT_SRC_COUNT] = {
+    [INPUT_SRC_TOUCH] = {"touch", false},
+    [INPUT_SRC_CAN] = {"can", true},
+    [INPUT_SRC_RS485] = {"rs485", true},
+    [INPUT_SRC_HTTP] = {"http", true},
+    [INPUT_SRC_SLIDESHOW] = {"slideshow", false},
+};
+
+typedef struct {
+  int64_t tokens;
+  int64_t last_us;
+  input_bus_stats_t stats;
+} input_source_state_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static input_source_state_t s_state[INPUT_SRC_COUNT];
+// Pas cumulés en attente, et vrai si leur événement est déjà dans la file
+static int32_t s_steps;
+static bool s_steps_posted;
+
+// Seau à jetons : appelé sous s_lock
+static bool take_token(input_source_t src, int64_t now) {
+  input_source_state_t *st = &s_state[src];
+  const int64_t cap = (int64_t)CONFIG_INPUT_REMOTE_BURST * TOKEN_UNIT;
+  if (st->last_us == 0) {
+    st->tokens = cap;
+  } else {
+    st->tokens +=
+        (now - st->last_us) * CONFIG_INPUT_REMOTE_RATE * TOKEN_UNIT / 1000000;
+    if (st->tokens > cap) {
+      st->tokens = cap;
+    }
+  }
+  st->last_us = now;
+  if (st->tokens < TOKEN_UNIT) {
+    return false;
+  }
+  st->tokens -= TOKEN_UNIT;
+  return true;
+}
+
+bool input_bus_publish(input_source_t src, nav_cmd_t cmd) {
+  if (src >= INPUT_SRC_COUNT || cmd == NAV_CMD_NONE) {
+    return false;
+  }
+  bool step = cmd == NAV_CMD_NEXT || cmd == NAV_CMD_PREV;
+  int64_t now = esp_timer_get_time();
+  bool post = false;
+
+  portENTER_CRITICAL(&s_lock);
+  input_bus_stats_t *stats = &s_state[src].stats;
+  bool ok = !k_sources[src].limited || take_token(src, now);
+  if (!ok) {
+    stats->dropped++;
+  } else if (step) {
+    s_steps += cmd;
+    post = !s_steps_posted;
+    s_steps_posted = true;
+    if (!post) {
+      stats->coalesced++;
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  if (!ok) {
+    return false;
+  }
+
+  if (!step) {
+    ok = app_events_post(APP_EVT_NAV, cmd);
+  } else if (post) {
+    ok = app_events_post(APP_EVT_NAV_STEPS, 0);
+  }
+  portENTER_CRITICAL(&s_lock);
+  if (ok) {
+    stats->accepted++;
+  } else {
+    stats->dropped++;
+    if (step) {
+      // File pleine : le pas est retiré, le suivant retentera l'envoi
+      s_steps -= cmd;
+      s_steps_posted = false;
+    }
+  }
+  portEXIT_CRITICAL(&s_lock);
+  TRACE_COUNTER("input_steps", s_steps);
+  return ok;
+}
+
+int32_t input_bus_take_steps(void) {
+  portENTER_CRITICAL(&s_lock);
+  int32_t steps = s_steps;
+  s_steps = 0;
+  s_steps_posted = false;
+  portEXIT_CRITICAL(&s_lock);
+  return steps;
+}
+
+esp_err_t input_bus_get_stats(input_source_t src, input_bus_stats_t *stats) {
+  if (src >= INPUT_SRC_COUNT || !stats) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&s_lock);
+  *stats = s_state[src].stats;
+  portEXIT_CRITICAL(&s_lock);
+  return ESP_OK;
+}
+
+const char *input_bus_source_name(input_source_t src) {
+  return src < INPUT_SRC_COUNT ? k_sources[src].name : "?";
+}
+
+static int cmd_input(int argc, char **argv) {
+  printf("%-10s %9s %9s %9s\n", "source", "accepted", "coalesced", "dropped");
+  for (int i = 0; i < INPUT_SRC_COUNT; ++i) {
+    input_bus_stats_t st;
+    input_bus_get_stats(i, &st);
+    printf("%-10s %9u %9u %9u\n", k_sources[i].name, (unsigned)st.accepted,
+           (unsigned)st.coalesced, (unsigned)st.dropped);
+  }
+  return 0;
+}
+
+esp_err_t input_bus_console_register(void) {
+  const esp_console_cmd_t cmd = {
+      .command = "input",
+      .help = "Navigation commands accepted, coalesced and dropped per source",
+      .hint = NULL,
+      .func = cmd_input,
+  };
+  return esp_console_cmd_register(&cmd);
+}
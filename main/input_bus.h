@@ -0,0 +1,73 @@
+#ifndef INPUT_BUS_H
+#define INPUT_BUS_H
+
+#include "esp_err.h"
+#include "ui_navigation.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Single entry point for navigation commands, whatever their origin.
+ *
+ * Every input source publishes typed nav_cmd_t values here instead of
+ * talking to app_main() directly. Next/previous commands are coalesced
+ * into one pending step count: a burst of ten NEXT posts a single
+ * APP_EVT_NAV_STEPS and app_main() moves ten images at once, so the
+ * event queue never fills up and the display never replays a backlog
+ * image by image. Other commands are posted as APP_EVT_NAV, in order.
+ * No other step event is posted until input_bus_take_steps() is called,
+ * so every path that discards APP_EVT_NAV_STEPS, or flushes the app event
+ * queue, must call it; app_events_reset() does.
+ *
+ * Remote sources are rate limited by a token bucket each
+ * (CONFIG_INPUT_REMOTE_RATE commands per second, bursts of
+ * CONFIG_INPUT_REMOTE_BURST); touch and the slideshow are not.
+ */
+
+typedef enum {
+  INPUT_SRC_TOUCH = 0,
+  INPUT_SRC_CAN,
+  INPUT_SRC_RS485,
+  INPUT_SRC_HTTP,
+  INPUT_SRC_SLIDESHOW,
+  INPUT_SRC_COUNT
+} input_source_t;
+
+typedef struct {
+  uint32_t accepted;  /*!< Commands passed on to app_main() */
+  uint32_t coalesced; /*!< Steps merged into an already pending event */
+  uint32_t dropped;   /*!< Refused by the rate limit or a full queue */
+} input_bus_stats_t;
+
+/**
+ * @brief Publish a command from @p src. Callable from any task, never
+ * blocks.
+ *
+ * @return false when the command was dropped.
+ */
+bool input_bus_publish(input_source_t src, nav_cmd_t cmd);
+
+/**
+ * @brief Take the pending step count (positive forward) and rearm the
+ * next APP_EVT_NAV_STEPS.
+ */
+int32_t input_bus_take_steps(void);
+
+/** Counters of @p src since boot. */
+esp_err_t input_bus_get_stats(input_source_t src, input_bus_stats_t *stats);
+
+/** Short name of @p src ("touch", "can", ...). */
+const char *input_bus_source_name(input_source_t src);
+
+/** Add the `input` command to the esp_console REPL. */
+esp_err_t input_bus_console_register(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INPUT_BUS_H
@@ -13,22 +13,35 @@
  *
  ******************************************************************************/
 
+#include "app_console.h"
+#include "app_events.h"
 #include "battery.h"
+#include "boot.h"
 #include "can_display.h"
 #include "config.h"
 #include "esp_netif.h"
 #include "file_manager.h"
 #include "gui.h"
+#include "gui_perf.h"
 #include "http_server.h"
+#include "i2c.h"
 #include "image_fetcher.h"
+#include "image_pool.h"
+#include "image_sync.h"
+#include "input_bus.h"
+#include "io_extension.h"
+#include "jobs.h"
+#include "download_pool.h"
+#include "remote_album.h"
 #include "lvfs_fatfs.h"
-#include "lvgl.h"
 #include "lwip/inet.h"
 #include "pm.h"
 #include "rgb_lcd_port.h" // En-tête du pilote LCD RGB Waveshare
 #include "rs485_display.h"
 #include "sd.h" // En-tête des opérations sur carte SD
+#include "splash.h"
 #include "touch_task.h"
+#include "trace.h"
 #include "ui_navigation.h"
 #include "wifi_manager.h"
 
@@ -39,17 +52,34 @@
 #include "esp_psram.h"
 #include "esp_sleep.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
-#include <math.h>
+#include <dirent.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
 
 #define BASE_PATH_LEN 128
 #define WIFI_CONNECT_TIMEOUT_MS 10000
+#define BOOT_TASK_STACK 4096
+// Attente maximale du décodage de la première image
+#define FIRST_IMAGE_TIMEOUT_MS 2000
+
+// Fin des tâches de démarrage lancées sur l'autre cœur
+#define BOOT_BIT_TOUCH BIT0
+#define BOOT_BIT_SD BIT1
+
+#if CONFIG_IMAGE_REMOTE_DIRECT
+#define REMOTE_DIRECT_ENABLED 1
+#else
+#define REMOTE_DIRECT_ENABLED 0
+#endif
 
 char g_base_path[BASE_PATH_LEN]; // Chemin du dossier actuellement affiché
 static const char *TAG = "APP";
@@ -62,21 +92,319 @@ typedef enum {
   APP_STATE_EXIT
 } app_state_t;
 
-static volatile bool s_wifi_ready = false;
-static volatile bool s_wifi_failed = false;
+// Vrai quand png_list décrit l'album distant affiché depuis la PSRAM
+static bool s_remote_direct = false;
+// L'image courante n'a pas pu être affichée, nouvel essai à son arrivée
+static bool s_show_pending = false;
+// Index affiché, pour l'état renvoyé sur les bus CAN et RS485
+static volatile int8_t s_shown_index = 0;
+
+static EventGroupHandle_t s_boot_events;
+static bool s_touch_ok;
+static esp_err_t s_sd_ret = ESP_FAIL;
 
 static void wifi_status_cb(wifi_manager_event_t event) {
-  if (event == WIFI_MANAGER_EVENT_CONNECTED) {
-    s_wifi_ready = true;
-  } else if (event == WIFI_MANAGER_EVENT_FAIL) {
-    s_wifi_failed = true;
+  app_events_post(APP_EVT_WIFI, event);
+}
+
+// Chaque source publie sur le bus d'entrées, limité et fusionné par source
+static void touch_nav_cb(nav_cmd_t cmd) {
+  input_bus_publish(INPUT_SRC_TOUCH, cmd);
+}
+
+static void can_nav_cb(nav_cmd_t cmd) { input_bus_publish(INPUT_SRC_CAN, cmd); }
+
+static void rs485_nav_cb(nav_cmd_t cmd) {
+  input_bus_publish(INPUT_SRC_RS485, cmd);
+}
+
+// Commandes CAN et Modbus : appelées depuis la tâche du bus, traitées par
+// app_main
+static bool remote_goto_index_cb(uint16_t index) {
+  return index < png_list.size && index <= INT8_MAX &&
+         app_events_post(APP_EVT_GOTO_INDEX, index);
+}
+
+static bool remote_goto_hash_cb(uint32_t name_hash) {
+  return app_events_post(APP_EVT_GOTO_HASH, (int32_t)name_hash);
+}
+
+static bool remote_open_folder_cb(uint32_t name_hash) {
+  return app_events_post(APP_EVT_OPEN_FOLDER, (int32_t)name_hash);
+}
+
+static bool remote_brightness_cb(uint8_t percent) {
+  app_events_set_max_brightness(percent);
+  return true;
+}
+
+static bool remote_slideshow_cb(uint16_t period_s) {
+  return app_events_set_slideshow(period_s) == ESP_OK;
+}
+
+static void can_status_cb(can_display_status_t *status) {
+  status->index = s_shown_index;
+  status->count = png_list.size;
+  status->brightness = app_events_get_brightness();
+  status->slideshow_s = app_events_get_slideshow();
+}
+
+static void can_image_added_cb(const char *path) {
+  app_events_post(APP_EVT_ALBUM_ADDED, 0);
+}
+
+static const can_display_ops_t s_can_ops = {
+    .on_nav = can_nav_cb,
+    .on_goto_index = remote_goto_index_cb,
+    .on_goto_hash = remote_goto_hash_cb,
+    .on_brightness = remote_brightness_cb,
+    .on_slideshow = remote_slideshow_cb,
+    .on_status = can_status_cb,
+    .album_dir = MOUNT_POINT "/" CONFIG_CAN_XFER_ALBUM_DIR,
+    .on_image_added = can_image_added_cb,
+};
+
+// Registres Modbus, lus depuis la tâche RS485 une fois par requête
+static void rs485_status_cb(rs485_display_status_t *status) {
+  static uint32_t s_fps_frames;
+  static int64_t s_fps_us;
+  static uint16_t s_fps_x10;
+  // Images par seconde sur la dernière seconde écoulée au moins
+  uint32_t frames = gui_perf_total(GUI_PERF_RENDER);
+  int64_t now = esp_timer_get_time();
+  if (now - s_fps_us >= 1000000) {
+    if (s_fps_us != 0 && frames >= s_fps_frames) {
+      s_fps_x10 = (uint16_t)((uint64_t)(frames - s_fps_frames) * 10000000 /
+                             (uint64_t)(now - s_fps_us));
+    }
+    s_fps_frames = frames;
+    s_fps_us = now;
   }
+
+  const char *folder = strrchr(g_base_path, '/');
+  status->index = s_shown_index;
+  status->folder_hash =
+      can_display_name_hash(folder ? folder + 1 : g_base_path);
+  status->brightness = app_events_get_brightness();
+  status->slideshow_s = app_events_get_slideshow();
+  status->image_count = png_list.size;
+  status->decode_ms = gui_perf_last(GUI_PERF_DECODE) / 1000;
+  status->battery = battery_get_percentage();
+  status->fps_x10 = s_fps_x10;
+}
+
+static const rs485_display_ops_t s_rs485_ops = {
+    .on_nav = rs485_nav_cb,
+    .on_goto_index = remote_goto_index_cb,
+    .on_open_folder = remote_open_folder_cb,
+    .on_brightness = remote_brightness_cb,
+    .on_slideshow = remote_slideshow_cb,
+    .on_status = rs485_status_cb,
+};
+
+// Index de l'image dont le nom a ce hachage, -1 si absente de la page
+static int32_t find_name_hash(uint32_t name_hash) {
+  for (size_t i = 0; i < png_list.size && i <= INT8_MAX; ++i) {
+    if (can_display_name_hash(png_list.items[i]) == name_hash) {
+      return (int32_t)i;
+    }
+  }
+  return -1;
+}
+
+// Vrai si le dossier contient au moins un PNG
+static bool folder_has_png(const char *path) {
+  DIR *dir = opendir(path);
+  if (!dir) {
+    return false;
+  }
+  bool found = false;
+  struct dirent *e;
+  while (!found && (e = readdir(dir)) != NULL) {
+    const char *ext = strrchr(e->d_name, '.');
+    found = e->d_type == DT_REG && ext && strcasecmp(ext, ".png") == 0;
+  }
+  closedir(dir);
+  return found;
+}
+
+// Cherche le dossier de la carte dont le nom a ce hachage ; false si absent
+static bool find_folder_hash(uint32_t name_hash, char *path, size_t len) {
+  DIR *dir = opendir(MOUNT_POINT);
+  if (!dir) {
+    return false;
+  }
+  bool found = false;
+  struct dirent *e;
+  while (!found && (e = readdir(dir)) != NULL) {
+    if (e->d_type != DT_DIR || e->d_name[0] == '.' ||
+        can_display_name_hash(e->d_name) != name_hash) {
+      continue;
+    }
+    snprintf(path, len, "%s/%s", MOUNT_POINT, e->d_name);
+    found = folder_has_png(path);
+  }
+  closedir(dir);
+  return found;
+}
+
+static void image_ready_cb(size_t index) {
+  app_events_post(APP_EVT_IMAGE_READY, (int32_t)index);
+}
+
+// Démarre le Wi-Fi et attend l'événement de connexion ou d'échec
+static bool wifi_connect(void) {
+  app_events_reset();
+  wifi_manager_start();
+  TickType_t start = xTaskGetTickCount();
+  TickType_t timeout = pdMS_TO_TICKS(WIFI_CONNECT_TIMEOUT_MS);
+  TickType_t elapsed;
+  app_event_t evt;
+  while ((elapsed = xTaskGetTickCount() - start) < timeout &&
+         app_events_wait(&evt, timeout - elapsed)) {
+    if (evt.type == APP_EVT_NAV_STEPS) {
+      // Événement jeté : ses pas aussi, sinon le bus n'en posterait plus
+      input_bus_take_steps();
+      continue;
+    }
+    if (evt.type != APP_EVT_WIFI) {
+      continue;
+    }
+    if (evt.value == WIFI_MANAGER_EVENT_CONNECTED) {
+      return true;
+    }
+    if (evt.value == WIFI_MANAGER_EVENT_FAIL) {
+      return false;
+    }
+  }
+  return false;
+}
+
+static bool show_remote_at(int8_t index);
+
+static void show_image_at(int8_t index) {
+  s_shown_index = index;
+  if (!s_remote_direct) {
+    ui_navigation_show_image(png_list.items[index]);
+    s_show_pending = false;
+#if CONFIG_BOOT_RESTORE_LAST
+    boot_remember_image(png_list.items[index], png_page_start);
+#endif
+    return;
+  }
+  s_show_pending = !show_remote_at(index);
+  if (s_show_pending) {
+    // Téléchargement en arrière-plan, APP_EVT_IMAGE_READY à l'arrivée
+    remote_album_prefetch(index);
+  }
+}
+
+static bool show_remote_at(int8_t index) {
+  const uint8_t *data = NULL;
+  size_t len = 0;
+  esp_err_t err = remote_album_lookup(index, &data, &len);
+  if (err == ESP_OK) {
+    ui_navigation_show_image_mem(data, len);
+    return true;
+  }
+#if CONFIG_IMAGE_REMOTE_STREAM
+  // Pas encore en mémoire : décodage pendant le téléchargement
+  char url[IMAGE_SYNC_URL_MAX + IMAGE_SYNC_NAME_MAX];
+  const uint8_t *sha256 = NULL;
+  err = remote_album_source(index, url, sizeof(url), &sha256);
+  if (err == ESP_OK) {
+    err = ui_navigation_stream_begin();
+  }
+  if (err == ESP_OK) {
+    esp_err_t fetch_err =
+        image_fetch_http_stream(url, sha256, ui_navigation_stream_feed, NULL);
+    err = ui_navigation_stream_end(fetch_err == ESP_OK);
+    if (fetch_err != ESP_OK) {
+      err = fetch_err;
+    }
+  }
+  if (err == ESP_OK) {
+    remote_album_shown(index);
+    return true;
+  }
+  ESP_LOGW(TAG, "Image distante %s indisponible : %s", png_list.items[index],
+           esp_err_to_name(err));
+  return false;
+#else
+  err = remote_album_get(index, &data, &len);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Image distante %s indisponible : %s", png_list.items[index],
+             esp_err_to_name(err));
+    return false;
+  }
+  ui_navigation_show_image_mem(data, len);
+  return true;
+#endif
+}
+
+// Relit la page de l'album CAN s'il est affiché, sans changer d'image
+static void reload_can_album(int8_t *index) {
+  if (s_remote_direct ||
+      strcmp(g_base_path, MOUNT_POINT "/" CONFIG_CAN_XFER_ALBUM_DIR) != 0) {
+    return;
+  }
+  char *shown =
+      *index < png_list.size ? strdup(png_list.items[*index]) : NULL;
+  if (list_files_sorted(g_base_path, png_page_start, PNG_LIST_INIT_CAP) ==
+          ESP_OK &&
+      png_list.size > 0) {
+    int8_t found = -1;
+    for (size_t i = 0; shown && i < png_list.size && i <= INT8_MAX; ++i) {
+      if (strcmp(png_list.items[i], shown) == 0) {
+        found = (int8_t)i;
+        break;
+      }
+    }
+    if (found < 0) {
+      *index = 0;
+      show_image_at(*index);
+    } else {
+      *index = found;
+    }
+    draw_filename_bar(png_list.items[*index]);
+  }
+  free(shown);
+}
+
+static void remote_direct_close(void) {
+  if (s_remote_direct) {
+    remote_album_close();
+    s_remote_direct = false;
+  }
+}
+
+// Ouvre le dossier demandé par Modbus et affiche sa première image
+static void open_folder_hash(uint32_t name_hash, int8_t *index) {
+  char path[BASE_PATH_LEN];
+  if (!find_folder_hash(name_hash, path, sizeof(path))) {
+    ESP_LOGW(TAG, "Dossier %08lx introuvable", (unsigned long)name_hash);
+    return;
+  }
+  remote_direct_close();
+  snprintf(g_base_path, sizeof(g_base_path), "%s", path);
+  png_page_start = 0;
+  if (list_files_sorted(g_base_path, png_page_start, PNG_LIST_INIT_CAP) !=
+          ESP_OK ||
+      png_list.size == 0) {
+    ui_navigation_show_message("Aucun fichier PNG dans ce dossier.");
+    return;
+  }
+  *index = 0;
+  show_image_at(*index);
+  draw_filename_bar(png_list.items[*index]);
 }
 
 static void app_cleanup(void) {
   ui_navigation_deinit();
+  remote_direct_close();
   touch_task_deinit();
   touch_gt911_deinit();
+  dl_pool_stop();
   wifi_manager_stop();
   stop_file_server();
   esp_err_t unmount_ret = sd_mmc_unmount();
@@ -85,16 +413,83 @@ static void app_cleanup(void) {
   }
   png_list_free();
   gui_deinit();
+  // Bus partagé par l'écran, le GT911 et la batterie : arrêté en dernier
+  IO_EXTENSION_Deinit();
+  DEV_I2C_Deinit();
+}
+
+// Reset du GT911 : surtout des attentes, faites sur l'autre cœur
+static void boot_touch_task(void *arg) {
+  s_touch_ok = touch_task_init();
+  if (!s_touch_ok) {
+    ESP_LOGE(TAG, "Échec d'initialisation de la tâche tactile");
+  }
+  boot_mark("touch");
+  xEventGroupSetBits(s_boot_events, BOOT_BIT_TOUCH);
+  vTaskDelete(NULL);
+}
+
+// Montage de la carte SD, en parallèle du démarrage de l'écran
+static void boot_sd_task(void *arg) {
+  s_sd_ret = sd_mmc_init();
+  boot_mark("sd");
+  xEventGroupSetBits(s_boot_events, BOOT_BIT_SD);
+  vTaskDelete(NULL);
+}
+
+static bool start_boot_task(TaskFunction_t fn, const char *name,
+                            EventBits_t bit) {
+  if (xTaskCreatePinnedToCore(fn, name, BOOT_TASK_STACK, NULL, 5, NULL,
+                              CONFIG_BOOT_TOUCH_SD_CORE) != pdPASS) {
+    ESP_LOGE(TAG, "Création de la tâche %s impossible", name);
+    // Personne ne la posera : app_main ne doit pas l'attendre
+    xEventGroupSetBits(s_boot_events, bit);
+    return false;
+  }
+  return true;
 }
 
 static bool init_peripherals(void) {
+  boot_mark("app_main");
   ESP_ERROR_CHECK(nvs_flash_init());
   display_load_orientation();
 
   ESP_ERROR_CHECK(esp_psram_init());
+  // Réservé avant tout le reste : la PSRAM n'est pas encore morcelée
+  if (image_pool_init(LCD_H_RES * LCD_V_RES * 4, CONFIG_IMAGE_POOL_SLABS) !=
+      ESP_OK) {
+    ESP_LOGW(TAG, "Images allouées sur le tas");
+  }
+  // Un ouvrier par cœur : conversion des PNG sur le cœur libre
+  if (jobs_init() != ESP_OK) {
+    ESP_LOGW(TAG, "Décodage sur un seul cœur");
+  }
+#if CONFIG_APP_TRACE
+  // Enregistre en continu : les dernières secondes restent disponibles
+  if (trace_init(CONFIG_APP_TRACE_EVENTS) != ESP_OK) {
+    ESP_LOGW(TAG, "Trace indisponible");
+  }
+#endif
+  boot_mark("memory");
 
-  if (!touch_task_init()) {
-    ESP_LOGE(TAG, "Échec d'initialisation de la tâche tactile");
+  // L'écran et le GT911 partagent l'extension d'E/S : démarrée une fois ici,
+  // avant que les deux s'initialisent en même temps
+  DEV_I2C_Init();
+  if (IO_EXTENSION_Init() != ESP_OK) {
+    ESP_LOGE(TAG, "Échec d'initialisation de l'extension d'E/S");
+    return false;
+  }
+  boot_mark("io_ext");
+
+  s_boot_events = xEventGroupCreate();
+  if (s_boot_events == NULL) {
+    ESP_LOGE(TAG, "Échec de création des événements de démarrage");
+    return false;
+  }
+  bool tasks_ok =
+      start_boot_task(boot_touch_task, "boot_touch", BOOT_BIT_TOUCH);
+  tasks_ok = start_boot_task(boot_sd_task, "boot_sd", BOOT_BIT_SD) && tasks_ok;
+  if (!tasks_ok) {
     return false;
   }
 
@@ -103,51 +498,155 @@ static bool init_peripherals(void) {
     ESP_LOGE(TAG, "Échec d'initialisation du LCD");
     return false;
   }
-
+  // Image de démarrage lue directement en flash, sans décodage ni carte SD
+  splash_image_t splash;
+  bool splash_ok =
+      splash_load(&splash) == ESP_OK && splash_draw(panel, &splash) == ESP_OK;
   waveshare_rgb_lcd_bl_on();
   waveshare_rgb_lcd_set_brightness(100);
+  boot_mark("panel");
+
   battery_init();
   gui_init(panel);
+  if (splash_ok) {
+    // LVGL redessine tout l'écran : l'image de démarrage doit y être
+    ui_navigation_show_splash(splash.pixels, splash.width, splash.height);
+  }
+  boot_mark("gui");
+  return true;
+}
 
-  if (can_display_init() != ESP_OK) {
+// CAN, RS485 et console : rien ne les attend à l'écran, démarrés après la
+// première image
+static bool start_deferred_services(void) {
+  if (can_display_init(&s_can_ops) != ESP_OK) {
     ESP_LOGE(TAG, "Échec d'initialisation du module CAN");
     return false;
   }
-  if (rs485_display_init() != ESP_OK) {
+  if (rs485_display_init(&s_rs485_ops) != ESP_OK) {
     ESP_LOGE(TAG, "Échec d'initialisation du module RS485");
     return false;
   }
-
+#if CONFIG_APP_CONSOLE
+  esp_err_t console_ret = app_console_start();
+  if (console_ret != ESP_OK) {
+    ESP_LOGW(TAG, "Console indisponible : %s", esp_err_to_name(console_ret));
+  }
+#endif
+  boot_mark("services");
   return true;
 }
 
-static TickType_t s_last_activity_ticks;
+// Attend que l'image postée soit décodée puis dessinée, au plus timeout_ms
+static void wait_image_drawn(uint32_t decodes_before, uint32_t timeout_ms) {
+  TickType_t start = xTaskGetTickCount();
+  bool decoded = false;
+  uint32_t frames = 0;
+  while (xTaskGetTickCount() - start < pdMS_TO_TICKS(timeout_ms)) {
+    if (!decoded && gui_perf_total(GUI_PERF_DECODE) != decodes_before) {
+      // Le rendu en cours, qui a décodé l'image, est compté à sa fin
+      decoded = true;
+      frames = gui_perf_total(GUI_PERF_RENDER);
+    } else if (decoded && gui_perf_total(GUI_PERF_RENDER) != frames) {
+      return;
+    }
+    vTaskDelay(1);
+  }
+  ESP_LOGW(TAG, "Première image toujours pas dessinée");
+}
+
+#if CONFIG_BOOT_RESTORE_LAST
+// Index de @p path dans png_list, -1 s'il n'est pas dans la page
+static int32_t find_path(const char *path) {
+  for (size_t i = 0; i < png_list.size && i <= INT8_MAX; ++i) {
+    if (strcmp(png_list.items[i], path) == 0) {
+      return (int32_t)i;
+    }
+  }
+  return -1;
+}
 
-void pm_update_activity(void) { s_last_activity_ticks = xTaskGetTickCount(); }
 
-static void process_background_tasks(void) {
-  static int s_prev_level = -1;
-  uint8_t batt = battery_get_percentage();
-  float normalized = batt / 100.0f;
-  float corrected = powf(normalized, BRIGHTNESS_GAMMA);
-  uint8_t level =
-      CONFIG_MIN_BRIGHTNESS +
-      (uint8_t)((CONFIG_MAX_BRIGHTNESS - CONFIG_MIN_BRIGHTNESS) * corrected);
+// Rouvre la dernière image vue, dans son dossier ; false si elle a disparu
+static bool restore_last_image(int8_t *index) {
+  char path[BASE_PATH_LEN * 2];
+  size_t page = 0;
+  struct stat st;
+  if (!boot_last_image(path, sizeof(path), &page) || stat(path, &st) != 0) {
+    return false;
+  }
+  char *slash = strrchr(path, '/');
+  if (slash == NULL) {
+    return false;
+  }
+  // Affichée avant de lister le dossier, qui peut être long
+  ui_navigation_show_image(path);
+  draw_filename_bar(path);
+
+  *slash = '\0';
+  snprintf(g_base_path, sizeof(g_base_path), "%s", path);
+  *slash = '/';
+  png_page_start = page;
+  int32_t found = -1;
+  if (list_files_sorted(g_base_path, png_page_start, PNG_LIST_INIT_CAP) ==
+      ESP_OK) {
+    found = find_path(path);
+  }
+  if (found < 0 && page != 0) {
+    // Le dossier a changé depuis : la page enregistrée ne la contient plus
+    png_page_start = 0;
+    if (list_files_sorted(g_base_path, png_page_start, PNG_LIST_INIT_CAP) ==
+        ESP_OK) {
+      found = find_path(path);
+    }
+  }
+  if (png_list.size == 0) {
+    return false;
+  }
+  *index = found < 0 ? 0 : (int8_t)found;
+  s_shown_index = *index;
+  if (found < 0) {
+    show_image_at(*index);
+    draw_filename_bar(png_list.items[*index]);
+  }
+  draw_navigation_arrows();
+  return true;
+}
+#endif
 
-  if (s_prev_level < 0 ||
-      abs((int)level - s_prev_level) >= CONFIG_BRIGHTNESS_HYSTERESIS) {
-    waveshare_rgb_lcd_set_brightness(level);
-    s_prev_level = level;
+// Première image : la dernière vue si elle existe encore, sinon la première
+// de la racine de la carte sous l'écran de choix de la source
+static app_state_t show_first_image(int8_t *index) {
+  uint32_t decodes = gui_perf_total(GUI_PERF_DECODE);
+#if CONFIG_BOOT_RESTORE_LAST
+  if (restore_last_image(index)) {
+    wait_image_drawn(decodes, FIRST_IMAGE_TIMEOUT_MS);
+    boot_mark("first_image");
+    return APP_STATE_NAVIGATION;
+  }
+#endif
+  snprintf(g_base_path, sizeof(g_base_path), "%s", MOUNT_POINT);
+  png_page_start = 0;
+  if (list_files_sorted(g_base_path, png_page_start, PNG_LIST_INIT_CAP) ==
+          ESP_OK &&
+      png_list.size > 0) {
+    ui_navigation_show_image(png_list.items[0]);
+    draw_filename_bar(png_list.items[0]);
+    wait_image_drawn(decodes, FIRST_IMAGE_TIMEOUT_MS);
+    boot_mark("first_image");
   }
+  return APP_STATE_SOURCE_SELECTION;
+}
 
-  TickType_t now = xTaskGetTickCount();
-  if (pdTICKS_TO_MS(now - s_last_activity_ticks) > INACTIVITY_TIMEOUT_MS) {
+static void enter_light_sleep(void) {
+  // L'événement a pu attendre pendant un écran de sélection
+  if (pm_is_idle()) {
     esp_err_t slp_ret = esp_light_sleep_start();
     if (slp_ret != ESP_OK) {
       ESP_LOGW(TAG, "Light sleep failed: %s", esp_err_to_name(slp_ret));
     }
-    pm_update_activity();
   }
+  pm_update_activity();
 }
 
 // Fonction principale de l'application
@@ -170,95 +669,105 @@ void app_main(void) {
       ESP_ERROR_CHECK(err);
     }
 #endif
-    pm_update_activity();
-
-    esp_err_t sd_ret = sd_mmc_init();
-    if (sd_ret != ESP_OK) {
-      ESP_LOGE(TAG, "sd_mmc_init a échoué : %s", esp_err_to_name(sd_ret));
-      lv_obj_t *lbl = lv_label_create(lv_scr_act());
-      lv_label_set_text(lbl, "Échec carte SD !");
-      lv_obj_center(lbl);
+    ESP_ERROR_CHECK(app_events_init());
+    ui_navigation_set_cmd_cb(touch_nav_cb);
+    remote_album_set_ready_cb(image_ready_cb);
+
+    // Monte en parallèle depuis init_peripherals()
+    xEventGroupWaitBits(s_boot_events, BOOT_BIT_SD, pdFALSE, pdTRUE,
+                        portMAX_DELAY);
+    if (s_sd_ret != ESP_OK) {
+      ESP_LOGE(TAG, "sd_mmc_init a échoué : %s", esp_err_to_name(s_sd_ret));
+      ui_navigation_show_message("Échec carte SD !");
       init_failed = true;
     } else {
       lvfs_fatfs_register('S');
-      snprintf(g_base_path, sizeof(g_base_path), "%s", MOUNT_POINT);
-      png_page_start = 0;
-      if (list_files_sorted(g_base_path, png_page_start, PNG_LIST_INIT_CAP) ==
-              ESP_OK &&
-          png_list.size > 0) {
-        ui_navigation_show_image(png_list.items[0]);
-        draw_filename_bar(png_list.items[0]);
+      int8_t index = 0;
+      app_state_t state = show_first_image(&index);
+
+      xEventGroupWaitBits(s_boot_events, BOOT_BIT_TOUCH, pdFALSE, pdTRUE,
+                          portMAX_DELAY);
+      if (!s_touch_ok || !start_deferred_services()) {
+        init_failed = true;
+        state = APP_STATE_EXIT;
+      } else {
+        // Stop the temporary touch task and free its queue, but keep GT911
+        // initialized: LVGL reads it directly on its INT line.
+        touch_task_deinit();
+        if (gui_attach_touch(s_touch_handle) != ESP_OK) {
+          ESP_LOGE(TAG, "Tactile indisponible pour LVGL");
+        }
       }
 
-      // Stop the temporary touch task and free its queue, but keep GT911
-      // initialized so LVGL can continue polling the controller directly.
-      touch_task_deinit();
-
       wifi_manager_register_callback(wifi_status_cb);
 
       const char *selected_dir = NULL;
       image_source_t img_src = IMAGE_SOURCE_LOCAL;
-      int8_t index = 0;
-
-      app_state_t state = APP_STATE_SOURCE_SELECTION;
 
       while (state != APP_STATE_EXIT) {
         switch (state) {
         case APP_STATE_SOURCE_SELECTION:
+          dl_pool_stop();
           wifi_manager_stop();
           stop_file_server();
           img_src = draw_source_selection();
-          lv_obj_clean(lv_scr_act());
+          pm_update_activity();
+          ui_navigation_clear();
           if (img_src == IMAGE_SOURCE_REMOTE) {
-            s_wifi_ready = false;
-            s_wifi_failed = false;
-            wifi_manager_start();
-            int wait_ms = WIFI_CONNECT_TIMEOUT_MS;
-          while (!s_wifi_ready && !s_wifi_failed && wait_ms > 0) {
-            vTaskDelay(pdMS_TO_TICKS(100));
-            wait_ms -= 100;
-          }
-          if (!s_wifi_ready) {
-            lv_obj_t *lbl = lv_label_create(lv_scr_act());
-            lv_label_set_text(lbl, "Échec WiFi...");
-            lv_obj_center(lbl);
+          if (!wifi_connect()) {
+            ui_navigation_show_message("Échec WiFi...");
             state = APP_STATE_ERROR;
             break;
           }
-            image_fetch_http_to_sd(CONFIG_IMAGE_FETCH_URL,
-                                   MOUNT_POINT "/remote.png");
-            snprintf(g_base_path, sizeof(g_base_path), "%s", MOUNT_POINT);
+            esp_err_t err = ESP_OK;
             png_page_start = 0;
-            esp_err_t err = list_files_sorted(g_base_path, png_page_start,
-                                              PNG_LIST_INIT_CAP);
+            if (CONFIG_IMAGE_SYNC_MANIFEST_URL[0] != '\0' &&
+                REMOTE_DIRECT_ENABLED) {
+              // Album affiché depuis la PSRAM, sans passer par la carte SD
+              png_list_free();
+              err = remote_album_open(CONFIG_IMAGE_SYNC_MANIFEST_URL);
+              for (size_t i = 0; err == ESP_OK && i < remote_album_count();
+                   ++i) {
+                err = png_list_add(remote_album_name(i));
+              }
+              s_remote_direct = err == ESP_OK;
+              if (!s_remote_direct) {
+                remote_album_close();
+              }
+            } else if (CONFIG_IMAGE_SYNC_MANIFEST_URL[0] != '\0') {
+              snprintf(g_base_path, sizeof(g_base_path), "%s/%s", MOUNT_POINT,
+                       CONFIG_IMAGE_SYNC_ALBUM_DIR);
+              esp_err_t sync_ret = image_sync_album(
+                  CONFIG_IMAGE_SYNC_MANIFEST_URL, g_base_path, NULL);
+              if (sync_ret != ESP_OK) {
+                ESP_LOGW(TAG, "Synchronisation incomplète : %s",
+                         esp_err_to_name(sync_ret));
+              }
+              dl_pool_log_stats();
+              err = list_files_sorted(g_base_path, png_page_start,
+                                      PNG_LIST_INIT_CAP);
+            } else {
+              image_fetch_http_to_sd(CONFIG_IMAGE_FETCH_URL,
+                                     MOUNT_POINT "/remote.png");
+              snprintf(g_base_path, sizeof(g_base_path), "%s", MOUNT_POINT);
+              err = list_files_sorted(g_base_path, png_page_start,
+                                      PNG_LIST_INIT_CAP);
+            }
             if (err != ESP_OK || png_list.size == 0) {
-              lv_obj_t *lbl = lv_label_create(lv_scr_act());
-              lv_label_set_text(lbl, "Aucune image distante.");
-              lv_obj_center(lbl);
+              ui_navigation_show_message("Aucune image distante.");
               state = APP_STATE_ERROR;
             } else {
-              ui_navigation_show_image(png_list.items[index]);
+              show_image_at(index);
               draw_navigation_arrows();
               draw_filename_bar(png_list.items[index]);
               state = APP_STATE_NAVIGATION;
             }
           } else if (img_src == IMAGE_SOURCE_NETWORK) {
-            s_wifi_ready = false;
-            s_wifi_failed = false;
-            wifi_manager_start();
-            int wait_ms = WIFI_CONNECT_TIMEOUT_MS;
-            while (!s_wifi_ready && !s_wifi_failed && wait_ms > 0) {
-              vTaskDelay(pdMS_TO_TICKS(100));
-              wait_ms -= 100;
-            }
+            bool connected = wifi_connect();
             esp_err_t err = start_file_server();
-            if (!s_wifi_ready || s_wifi_failed || err != ESP_OK) {
-              const char *msg = (!s_wifi_ready || s_wifi_failed)
-                                     ? "Échec WiFi..."
-                                     : "Échec serveur.";
-              lv_obj_t *lbl = lv_label_create(lv_scr_act());
-              lv_label_set_text(lbl, msg);
-              lv_obj_center(lbl);
+            if (!connected || err != ESP_OK) {
+              const char *msg = !connected ? "Échec WiFi..." : "Échec serveur.";
+              ui_navigation_show_message(msg);
               wifi_manager_stop();
               stop_file_server();
               state = APP_STATE_SOURCE_SELECTION;
@@ -269,15 +778,10 @@ void app_main(void) {
               if (netif && esp_netif_get_ip_info(netif, &ip) == ESP_OK) {
                 char ip_str[IP4ADDR_STRLEN_MAX];
                 ip4addr_ntoa_r((ip4_addr_t *)&ip.ip, ip_str, sizeof(ip_str));
-                char url[32];
-                snprintf(url, sizeof(url), "http://%s", ip_str);
-                lv_obj_clean(lv_scr_act());
-                lv_obj_t *l1 = lv_label_create(lv_scr_act());
-                lv_label_set_text(l1, "Upload PNG via:");
-                lv_obj_align(l1, LV_ALIGN_TOP_MID, 0, 0);
-                lv_obj_t *l2 = lv_label_create(lv_scr_act());
-                lv_label_set_text(l2, url);
-                lv_obj_align(l2, LV_ALIGN_TOP_MID, 0, 40);
+                char msg[48];
+                snprintf(msg, sizeof(msg), "Upload PNG via:\nhttp://%s", ip_str);
+                ui_navigation_clear();
+                ui_navigation_show_message(msg);
                 state = APP_STATE_NAVIGATION;
               }
             }
@@ -288,6 +792,7 @@ void app_main(void) {
 
         case APP_STATE_FOLDER_SELECTION:
           selected_dir = draw_folder_selection();
+          pm_update_activity();
           if (selected_dir == NULL) {
             state = APP_STATE_EXIT;
             break;
@@ -301,14 +806,12 @@ void app_main(void) {
             ESP_LOGE(TAG, "Erreur lors du listage : %s", esp_err_to_name(err));
           }
           if (png_list.size == 0) {
-            lv_obj_t *lbl = lv_label_create(lv_scr_act());
-            lv_label_set_text(lbl, "Aucun fichier PNG dans ce dossier.");
-            lv_obj_center(lbl);
+            ui_navigation_show_message("Aucun fichier PNG dans ce dossier.");
 
             app_cleanup();
             state = APP_STATE_ERROR;
           } else {
-            ui_navigation_show_image(png_list.items[index]);
+            show_image_at(index);
             draw_navigation_arrows();
             draw_filename_bar(png_list.items[index]);
             state = APP_STATE_NAVIGATION;
@@ -318,28 +821,76 @@ void app_main(void) {
           break;
 
         case APP_STATE_NAVIGATION: {
-          nav_action_t act = handle_touch_navigation(&index);
+          app_event_t evt;
+          if (!app_events_wait(&evt, portMAX_DELAY)) {
+            break;
+          }
+          if (evt.type == APP_EVT_IDLE) {
+            enter_light_sleep();
+            break;
+          }
+          if (evt.type == APP_EVT_IMAGE_READY) {
+            // Image courante arrivée après un premier échec d'affichage
+            if (s_show_pending && evt.value == index) {
+              show_image_at(index);
+              draw_filename_bar(png_list.items[index]);
+            }
+            break;
+          }
+          if (evt.type == APP_EVT_ALBUM_ADDED) {
+            reload_can_album(&index);
+            break;
+          }
+          if (evt.type == APP_EVT_OPEN_FOLDER) {
+            pm_update_activity();
+            open_folder_hash((uint32_t)evt.value, &index);
+            break;
+          }
+          if (evt.type == APP_EVT_GOTO_INDEX || evt.type == APP_EVT_GOTO_HASH) {
+            int32_t target = evt.type == APP_EVT_GOTO_INDEX
+                                 ? evt.value
+                                 : find_name_hash((uint32_t)evt.value);
+            if (target < 0 || (size_t)target >= png_list.size) {
+              ESP_LOGW(TAG, "Image demandée à distance introuvable");
+              break;
+            }
+            pm_update_activity();
+            index = (int8_t)target;
+            show_image_at(index);
+            draw_filename_bar(png_list.items[index]);
+            break;
+          }
+          if (evt.type != APP_EVT_NAV && evt.type != APP_EVT_NAV_STEPS) {
+            break;
+          }
+          pm_update_activity();
+          // Une rafale de suivant/précédent arrive en un seul déplacement
+          nav_action_t act =
+              evt.type == APP_EVT_NAV_STEPS
+                  ? ui_navigation_apply_steps(input_bus_take_steps(), &index)
+                  : ui_navigation_apply_cmd((nav_cmd_t)evt.value, &index);
           if (act == NAV_EXIT) {
             ui_navigation_deinit();
             state = APP_STATE_EXIT;
           } else if (act == NAV_HOME) {
             ui_navigation_deinit();
+            remote_direct_close();
             png_list_free();
             index = 0;
             selected_dir = NULL;
-            lv_obj_clean(lv_scr_act());
+            ui_navigation_clear();
             state = APP_STATE_SOURCE_SELECTION;
           } else if (act == NAV_SCROLL) {
             if (index >= png_list.size)
               index = 0;
             else if (index < 0)
               index = png_list.size - 1;
-            ui_navigation_show_image(png_list.items[index]);
+            show_image_at(index);
             draw_filename_bar(png_list.items[index]);
           } else if (act == NAV_ROTATE) {
             display_set_orientation(!g_is_portrait);
-            lv_obj_clean(lv_scr_act());
-            ui_navigation_show_image(png_list.items[index]);
+            ui_navigation_clear();
+            show_image_at(index);
             draw_navigation_arrows();
             draw_filename_bar(png_list.items[index]);
             display_save_orientation();
@@ -354,12 +905,15 @@ void app_main(void) {
         case APP_STATE_EXIT:
           break;
         }
-        process_background_tasks();
-        vTaskDelay(pdMS_TO_TICKS(CONFIG_BG_TASK_DELAY_MS));
       }
     }
   }
 
+  if (s_boot_events) {
+    // Les tâches de démarrage doivent avoir fini avant de tout libérer
+    xEventGroupWaitBits(s_boot_events, BOOT_BIT_TOUCH | BOOT_BIT_SD, pdFALSE,
+                        pdTRUE, portMAX_DELAY);
+  }
   app_cleanup();
 
   if (init_failed) {
@@ -1,2 +1,7 @@
 #pragma once
+#include <stdbool.h>
+
+/** Record user activity, restarting the inactivity period. */
 void pm_update_activity(void);
+/** True once CONFIG_INACTIVITY_TIMEOUT_MS passed without activity. */
+bool pm_is_idle(void);
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Run the benchmark suite and check it against regression thresholds.
+
+Host build:
+  tools/bench.py --host build-host/display_bmp_host --corpus /tmp/corpus
+Target, over the serial console (needs pyserial, CONFIG_APP_CONSOLE=y):
+  tools/bench.py --port /dev/ttyACM0
+
+The report written with --out is the firmware JSON with a "threshold" and a
+"verdict" (pass, fail, skipped, failed, untracked) added to every result.
+Thresholds live in tools/bench_thresholds.json, one section per platform:
+
+  {"host": {"png_decode/rgb8_1024x600": {"max_median_us": 60000,
+                                         "min_rate": 10.0}}}
+
+--update rewrites the section of the current platform from this run, with
+--margin of headroom (1.5 means 50 % slower still passes).
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+
+DEFAULT_THRESHOLDS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bench_thresholds.json")
+# ESP_LOG lines ("I (1234) tag: ..."), possibly wrapped in colour codes
+LOG_LINE = re.compile(r"^(\x1b\[[0-9;]*m)?[EWIDV] \(\d+\)")
+
+
+def extract_report(lines):
+    """JSON between the BENCH-BEGIN and BENCH-END markers, log lines removed."""
+    body = []
+    inside = False
+    for line in lines:
+        line = line.rstrip("\r\n")
+        if line.endswith("BENCH-BEGIN"):
+            inside, body = True, []
+        elif line.endswith("BENCH-END") and inside:
+            return json.loads("\n".join(body))
+        elif inside and not LOG_LINE.match(line):
+            body.append(line)
+    raise RuntimeError("no complete BENCH-BEGIN/BENCH-END block in the output")
+
+
+def run_host(binary, args):
+    cmd = [binary, "bench"] + args
+    out = subprocess.run(cmd, check=False, stdout=subprocess.PIPE, text=True).stdout
+    return extract_report(out.splitlines())
+
+
+def run_serial(port, baud, args, timeout):
+    import serial  # pyserial
+
+    with serial.Serial(port, baud, timeout=1) as ser:
+        ser.reset_input_buffer()
+        ser.write(("bench " + " ".join(args) + "\r\n").encode())
+        lines = []
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            raw = ser.readline()
+            if not raw:
+                continue
+            line = raw.decode("utf-8", "replace")
+            lines.append(line)
+            if line.rstrip().endswith("BENCH-END"):
+                return extract_report(lines)
+    raise RuntimeError(f"timed out after {timeout} s waiting for the report")
+
+
+def verdict(result, threshold):
+    if result["status"] != "ok":
+        return result["status"]
+    if not threshold:
+        return "untracked"
+    if "max_median_us" in threshold and result["median_us"] > threshold["max_median_us"]:
+        return "fail"
+    if "min_rate" in threshold and result.get("rate", 0.0) < threshold["min_rate"]:
+        return "fail"
+    return "pass"
+
+
+def make_threshold(result, margin):
+    # At least 1 ms of slack: sub-millisecond cases are dominated by jitter
+    median = result["median_us"]
+    limit = max(int(median * margin), median + 1000)
+    t = {"max_median_us": limit}
+    if "rate" in result:
+        t["min_rate"] = round(result["rate"] * median / limit, 3)
+    return t
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    where = parser.add_mutually_exclusive_group(required=True)
+    where.add_argument("--host", metavar="BINARY", help="host build executable (display_bmp_host)")
+    where.add_argument("--port", help="serial port of the board")
+    where.add_argument("--report", metavar="JSON", help="check a report saved earlier")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=600.0, help="seconds to wait on target")
+    parser.add_argument("--corpus", help="corpus directory (default: /sdcard/bench or <sdcard>/bench)")
+    parser.add_argument("-n", "--iterations", type=int)
+    parser.add_argument("--filter", help="run only benchmarks whose name starts with this")
+    parser.add_argument("--thresholds", default=DEFAULT_THRESHOLDS)
+    parser.add_argument("--out", help="write the checked report here")
+    parser.add_argument("--update", action="store_true", help="record this run as the new thresholds")
+    parser.add_argument("--margin", type=float, default=1.5)
+    args = parser.parse_args()
+
+    bench_args = []
+    if args.iterations:
+        bench_args += ["-n", str(args.iterations)]
+    if args.corpus:
+        bench_args += ["-d", args.corpus]
+    if args.filter:
+        bench_args.append(args.filter)
+
+    if args.host:
+        report = run_host(args.host, bench_args)
+    elif args.port:
+        report = run_serial(args.port, args.baud, bench_args, args.timeout)
+    else:
+        with open(args.report) as f:
+            report = json.load(f)
+
+    thresholds = {}
+    if os.path.exists(args.thresholds):
+        with open(args.thresholds) as f:
+            thresholds = json.load(f)
+    platform = report["platform"]
+    section = thresholds.setdefault(platform, {})
+
+    regressions = 0
+    for r in report["results"]:
+        r["threshold"] = section.get(r["name"])
+        r["verdict"] = verdict(r, r["threshold"])
+        if r["verdict"] in ("fail", "failed"):
+            regressions += 1
+        rate = f"{r['rate']:10.2f} {r['unit']}" if "rate" in r else ""
+        median = f"{r['median_us'] / 1000:10.3f} ms" if r["status"] == "ok" else r.get("error", "")
+        print(f"{r['verdict']:9} {r['name']:32} {median:>14} {rate}")
+        if args.update and r["status"] == "ok":
+            section[r["name"]] = make_threshold(r, args.margin)
+    report["regressions"] = regressions
+
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(report, f, indent=2)
+            f.write("\n")
+    if args.update:
+        with open(args.thresholds, "w") as f:
+            json.dump(thresholds, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"thresholds for {platform} written to {args.thresholds}")
+        return 0
+    print(f"{platform}: {len(report['results'])} benchmark(s), {regressions} regression(s)")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
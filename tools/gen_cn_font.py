@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Pack a GB2312 cFONT table (fontNNCN.c) into a size-specific glyph blob.
+
+A CH_CN entry reserves MAX_HEIGHT_FONT * MAX_WIDTH_FONT / 8 + 2 bytes of
+matrix whatever the font size (670 bytes for a 42-byte Font12CN glyph), and
+the legacy lookup compares `index` entry by entry. The packed form keeps
+Height * ceil(Width / 8) bytes per glyph and a perfect hash over the
+GB2312 codes, so cfont_find() is two hashes and one compare.
+
+  tools/gen_cn_font.py components/fonts/font12CN.c -o font12CN_packed.c --verify
+
+The symbol is the table's name with a _Packed suffix (Font12CN_Packed).
+--verify reads the generated file back and checks that every entry of the
+source table hashes to a slot holding its code and the same pixels.
+"""
+import argparse
+import os
+import re
+import sys
+
+from gen_lv_font import cfont_entries, font_hash, hex_bytes, perfect_hash, strip_comments
+
+
+def gb2312_code(index):
+    """Key of a CH_CN index: the two GB2312 bytes, or the ASCII byte."""
+    return index[0] << 8 | index[1] if len(index) == 2 else index[0]
+
+
+def load(path):
+    src = strip_comments(open(path, "rb").read())
+    m = re.search(rb"cFONT\s+(\w+)\s*=\s*\{\s*\w+\s*,[^,]*,\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+)", src)
+    if not m:
+        raise ValueError(f"{path}: no cFONT table")
+    name = m.group(1).decode()
+    ascii_width, width, height = (int(g) for g in m.groups()[1:])
+    size = height * ((width + 7) // 8)
+    glyphs = {}
+    for index, matrix in cfont_entries(path, src):
+        if any(matrix[size:]):
+            raise ValueError(f"{path}: {index.decode('gb2312')} has pixels beyond {width}x{height}")
+        glyphs[gb2312_code(index)] = bytes(matrix[:size]).ljust(size, b"\0")
+    return name, ascii_width, width, height, glyphs
+
+
+def c_rows(values, fmt, per_line):
+    return "\n".join("    " + ", ".join(fmt.format(v) for v in values[i:i + per_line]) + ","
+                     for i in range(0, len(values), per_line))
+
+
+def emit(path, out, name, ascii_width, width, height, glyphs):
+    keys, disp = perfect_hash(sorted(glyphs))
+    size = height * ((width + 7) // 8)
+    blob = b"".join(glyphs[k] if k is not None else bytes(size) for k in keys)
+    per_line = min(size, 16)
+    lines = [
+        f"/* Generated by tools/gen_cn_font.py from {os.path.basename(path)}: do not edit */",
+        '#include "fonts.h"',
+        "",
+        f"/* {size} bytes per glyph, in hash slot order */",
+        f"static const uint8_t s_glyphs[{len(keys)} * {size}] = {{",
+        c_rows(list(blob), "0x{:02X}", per_line),
+        "};",
+        "",
+        "static const uint16_t s_keys[] = {",
+        c_rows([k or 0 for k in keys], "0x{:04X}", 8),
+        "};",
+        "",
+        "static const uint16_t s_disp[] = {",
+        c_rows(disp, "{}", 16),
+        "};",
+        "",
+        f"const cFONT_Packed {name}_Packed = {{",
+        "  s_glyphs,",
+        "  s_keys,",
+        "  s_disp,",
+        f"  {len(keys)}, /* slots */",
+        f"  {len(disp)}, /* buckets */",
+        f"  {ascii_width}, /* ASCII Width */",
+        f"  {width}, /* Width */",
+        f"  {height}, /* Height */",
+        "};",
+        "",
+    ]
+    with open(out, "w") as f:
+        f.write("\n".join(lines))
+    return len(keys), len(blob) + 2 * len(keys) + 2 * len(disp)
+
+
+def verify(out, height, width, glyphs):
+    src = open(out, "rb").read()
+    arrays = dict(re.findall(rb"static const \w+ (s_\w+)\[[^\]]*\] = \{(.*?)\};", src, re.S))
+    blob = hex_bytes(arrays[b"s_glyphs"])
+    keys = [int(x, 16) for x in re.findall(rb"0x([0-9A-F]{4})", arrays[b"s_keys"])]
+    disp = [int(x) for x in re.findall(rb"\d+", arrays[b"s_disp"])]
+    size = height * ((width + 7) // 8)
+    for code, matrix in glyphs.items():
+        slot = font_hash(code, disp[font_hash(code, 0) % len(disp)]) % len(keys)
+        if keys[slot] != code:
+            raise ValueError(f"{out}: 0x{code:04X} does not hash to its slot")
+        if bytes(blob[slot * size:(slot + 1) * size]) != matrix:
+            raise ValueError(f"{out}: 0x{code:04X} pixels differ from the source table")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("table", help="cFONT source (fontNNCN.c)")
+    parser.add_argument("-o", "--out", required=True)
+    parser.add_argument("--verify", action="store_true", help="check the output against the table")
+    args = parser.parse_args()
+
+    name, ascii_width, width, height, glyphs = load(args.table)
+    slots, packed = emit(args.table, args.out, name, ascii_width, width, height, glyphs)
+    if args.verify:
+        verify(args.out, height, width, glyphs)
+    # sizeof(CH_CN) in the legacy table, see fonts.h
+    legacy = len(glyphs) * (4 + 83 * 64 // 8 + 2)
+    print(f"{args.out}: {len(glyphs)} glyphs in {slots} slots, {packed} bytes (CH_CN table: {legacy})"
+          f"{', verified' if args.verify else ''}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
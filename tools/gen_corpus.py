@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""Generate the benchmark corpus used by the `bench` command.
+
+The output is deterministic for a given --seed, so results from different
+runs and boards compare like for like. Copy the directory to /sdcard/bench on
+the card, or point the host build at it with `bench -d DIR`.
+
+Layout:
+  VERSION                      corpus format and seed, echoed in the report
+  png/<kind>_<w>x<h>.png       decode inputs (rgb8, rgba8, rgb16, pal4, gray1)
+  png/stored_*.png             stored deflate, filter None: conversion only
+  list/{10,1k,100k}/           empty .png entries mixed with other files
+  fatfs/read_4m.bin            4 MiB of pseudo-random data
+
+FAT limits a directory to 65535 entries, so list/100k cannot be copied to the
+SD card; use --lists 10,1k for the card and keep 100k for the host build.
+"""
+import argparse
+import os
+import random
+import struct
+import sys
+import zlib
+
+CORPUS_FORMAT = 1
+
+PNG_IMAGES = [
+    # kind, width, height
+    ("rgb8", 320, 240),
+    ("rgb8", 800, 480),
+    ("rgb8", 1024, 600),
+    ("rgba8", 1024, 600),
+    ("rgb16", 1024, 600),
+    ("pal4", 1024, 600),
+    ("gray1", 1024, 600),
+    ("stored_rgb8", 1024, 600),
+    ("stored_rgba8", 1024, 600),
+]
+
+LIST_SIZES = {"10": 10, "1k": 1000, "100k": 100000}
+
+# colour type, bit depth, samples per pixel
+PNG_LAYOUT = {
+    "rgb8": (2, 8, 3),
+    "rgba8": (6, 8, 4),
+    "rgb16": (2, 16, 3),
+    "pal4": (3, 4, 1),
+    "gray1": (0, 1, 1),
+}
+
+
+def chunk(tag, data):
+    body = tag + data
+    return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def sample_rows(kind, width, height, rng):
+    """Photo-like content: smooth gradients, a few flat blocks and grain."""
+    _, depth, spp = PNG_LAYOUT[kind]
+    grain = rng.randbytes(width * spp)
+    blocks = [(rng.randrange(width), rng.randrange(height), rng.randrange(32, 256)) for _ in range(8)]
+    for y in range(height):
+        shift = rng.randrange(width)
+        row = []
+        for x in range(width):
+            flat = any(bx <= x < bx + size and by <= y < by + size for bx, by, size in blocks)
+            for c in range(spp):
+                if flat:
+                    v = (c * 85 + 40) & 0xFF
+                else:
+                    g = grain[(x * spp + c + shift) % len(grain)] & 0x0F
+                    v = ((x * (c + 1) * 255) // width + (y * 255) // height + g) & 0xFF
+                    if spp == 4 and c == 3:
+                        v = (x * 255) // width
+                row.append(v)
+        if depth == 16:
+            yield b"".join(struct.pack(">H", v * 257) for v in row)
+        elif depth < 8:
+            levels = (1 << depth) - 1
+            per_byte = 8 // depth
+            packed = bytearray((width * depth + 7) // 8)
+            for x, v in enumerate(row):
+                q = v * levels // 255
+                packed[x // per_byte] |= q << (8 - depth - (x % per_byte) * depth)
+            yield bytes(packed)
+        else:
+            yield bytes(row)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filter_row(ftype, row, prev, bpp):
+    """Apply PNG filter @ftype; rows cycle through all five types."""
+    if ftype == 0:
+        return row
+    out = bytearray(len(row))
+    for i, v in enumerate(row):
+        a = row[i - bpp] if i >= bpp else 0
+        b = prev[i]
+        c = prev[i - bpp] if i >= bpp else 0
+        if ftype == 1:
+            p = a
+        elif ftype == 2:
+            p = b
+        elif ftype == 3:
+            p = (a + b) >> 1
+        else:
+            p = paeth(a, b, c)
+        out[i] = (v - p) & 0xFF
+    return bytes(out)
+
+
+def make_png(kind, width, height, rng):
+    stored = kind.startswith("stored_")
+    base = kind[len("stored_"):] if stored else kind
+    ctype, depth, spp = PNG_LAYOUT[base]
+    bpp = max(1, spp * depth // 8)
+    raw = bytearray()
+    prev = bytes((width * spp * depth + 7) // 8)
+    for y, row in enumerate(sample_rows(base, width, height, rng)):
+        ftype = 0 if stored else y % 5
+        raw.append(ftype)
+        raw += filter_row(ftype, row, prev, bpp)
+        prev = row
+    out = b"\x89PNG\r\n\x1a\n"
+    out += chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, depth, ctype, 0, 0, 0))
+    if ctype == 3:
+        palette = bytearray()
+        for i in range(1 << depth):
+            palette += bytes((i * 17 & 0xFF, (255 - i * 17) & 0xFF, (i * 40) & 0xFF))
+        out += chunk(b"PLTE", bytes(palette))
+    data = zlib.compress(bytes(raw), 0 if stored else 6)
+    # Several IDAT chunks, as encoders write them
+    for off in range(0, len(data), 65536):
+        out += chunk(b"IDAT", data[off:off + 65536])
+    out += chunk(b"IEND", b"")
+    return out
+
+
+def write(path, data):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def make_list(directory, count, rng):
+    os.makedirs(directory, exist_ok=True)
+    names = [f"img_{i:06d}.png" for i in range(count)]
+    names += [f"note_{i:05d}.txt" for i in range(max(1, count // 10))]
+    # Directory order is creation order on FAT: do not hand it over sorted
+    rng.shuffle(names)
+    for name in names:
+        open(os.path.join(directory, name), "wb").close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("out", help="output directory")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--lists", default="10,1k,100k", help="directory sizes to create (10, 1k, 100k)")
+    parser.add_argument("--no-png", action="store_true", help="skip the PNG images")
+    args = parser.parse_args()
+
+    lists = [s for s in args.lists.split(",") if s]
+    for name in lists:
+        if name not in LIST_SIZES:
+            parser.error(f"unknown list size {name}")
+
+    write(os.path.join(args.out, "VERSION"), f"v{CORPUS_FORMAT} seed={args.seed}\n".encode())
+    if not args.no_png:
+        for kind, w, h in PNG_IMAGES:
+            rng = random.Random(f"{args.seed}/{kind}/{w}x{h}")
+            path = os.path.join(args.out, "png", f"{kind}_{w}x{h}.png")
+            write(path, make_png(kind, w, h, rng))
+            print(f"{path}: {os.path.getsize(path)} bytes")
+    for name in lists:
+        rng = random.Random(f"{args.seed}/list/{name}")
+        make_list(os.path.join(args.out, "list", name), LIST_SIZES[name], rng)
+        print(f"list/{name}: {LIST_SIZES[name]} PNG entries")
+    rng = random.Random(f"{args.seed}/fatfs")
+    write(os.path.join(args.out, "fatfs", "read_4m.bin"), rng.randbytes(4 << 20))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
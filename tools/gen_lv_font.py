@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+"""Generate an LVGL font from the legacy bitmap tables or a TrueType font.
+
+The output is a C file defining one lv_font_t backed by the ui_font runtime
+(components/fonts/ui_font.c). The build runs it, see components/fonts/
+CMakeLists.txt; it can also be run by hand to inspect the result.
+
+From the sFONT/cFONT tables of components/fonts (1 bit per pixel):
+  tools/gen_lv_font.py --ascii components/fonts/font20.c \\
+      --cjk components/fonts/font12CN.c --name ui_font_text -o ui_font_text.c
+From a TTF (4 bits per pixel, needs freetype-py):
+  tools/gen_lv_font.py --ttf NotoSansSC.ttf --size 20 \\
+      --chars album_names.txt --name ui_font_text -o ui_font_text.c
+
+Glyphs are cropped to their ink. Printable ASCII is indexed directly; every
+other code point goes through a hash-and-displace perfect hash, so a lookup
+is two hashes and one compare whatever the glyph count. The hash must match
+font_hash() in components/fonts/font_hash.h.
+"""
+import argparse
+import math
+import os
+import re
+import sys
+
+ASCII_FIRST = 0x20
+ASCII_LAST = 0x7E
+ASCII_COUNT = ASCII_LAST - ASCII_FIRST + 1
+MAX_DISP = 0xFFFF
+
+# Latin-1 supplement and Latin Extended-A: French, and most European names
+LATIN_RANGES = [(0xA0, 0x17F), (0x2018, 0x201E), (0x2026, 0x2026), (0x20AC, 0x20AC)]
+
+
+class Glyph:
+    def __init__(self, adv, box_w, box_h, ofs_x, ofs_y, pixels):
+        self.adv = adv
+        self.box_w = box_w
+        self.box_h = box_h
+        self.ofs_x = ofs_x
+        self.ofs_y = ofs_y
+        self.pixels = pixels  # box_h rows of box_w values in 0..(1 << bpp) - 1
+
+
+def font_hash(key, seed):
+    h = ((key ^ seed) * 0x9E3779B1) & 0xFFFFFFFF
+    return h ^ (h >> 16)
+
+
+def strip_comments(src):
+    src = re.sub(rb"/\*.*?\*/", b"", src, flags=re.S)
+    return re.sub(rb"//[^\n]*", b"", src)
+
+
+def hex_bytes(text):
+    return [int(x, 16) for x in re.findall(rb"0[xX]([0-9A-Fa-f]{1,2})", text)]
+
+
+def crop(rows, width, baseline, adv):
+    """Glyph from full cell rows (top first), cropped to the set pixels."""
+    ink = [(y, x) for y, row in enumerate(rows) for x in range(width) if row[x]]
+    if not ink:
+        return Glyph(adv, 0, 0, 0, 0, [])
+    y0 = min(y for y, _ in ink)
+    y1 = max(y for y, _ in ink)
+    x0 = min(x for _, x in ink)
+    x1 = max(x for _, x in ink)
+    pixels = [row[x0:x1 + 1] for row in rows[y0:y1 + 1]]
+    return Glyph(adv, x1 - x0 + 1, y1 - y0 + 1, x0, baseline - (y1 + 1), pixels)
+
+
+def cell_rows(data, width, height):
+    stride = (width + 7) // 8
+    rows = []
+    for y in range(height):
+        line = data[y * stride:(y + 1) * stride]
+        rows.append([(line[x // 8] >> (7 - x % 8)) & 1 for x in range(width)])
+    return rows
+
+
+def ink_bottom(rows):
+    set_rows = [y for y, row in enumerate(rows) if any(row)]
+    return set_rows[-1] + 1 if set_rows else None
+
+
+def load_sfont(path):
+    """ASCII table: 0x20..0x7E, Height rows of ceil(Width / 8) bytes each."""
+    src = strip_comments(open(path, "rb").read())
+    m = re.search(rb"sFONT\s+\w+\s*=\s*\{\s*\w+\s*,\s*(\d+)\s*,\s*(\d+)", src)
+    table = re.search(rb"_Table\s*\[\s*\]\s*=\s*\{(.*?)\}\s*;", src, re.S)
+    if not m or not table:
+        raise ValueError(f"{path}: no sFONT table")
+    width, height = int(m.group(1)), int(m.group(2))
+    data = hex_bytes(table.group(1))
+    size = (width + 7) // 8 * height
+    if len(data) != size * ASCII_COUNT:
+        raise ValueError(f"{path}: {len(data)} bytes, expected {size * ASCII_COUNT}")
+    cells = {ASCII_FIRST + i: cell_rows(data[i * size:(i + 1) * size], width, height)
+             for i in range(ASCII_COUNT)}
+    # The baseline sits under 'H', descenders go below it
+    baseline = ink_bottom(cells[ord("H")])
+    return {cp: crop(rows, width, baseline, width) for cp, rows in cells.items()}
+
+
+def cfont_entries(path, src):
+    """(index bytes, matrix bytes) of each CH_CN entry; the first of duplicates wins, as in a linear scan."""
+    seen = set()
+    entries = []
+    for key, body in re.findall(rb'\{\s*\{\s*"([^"]*)"\s*\}\s*,\s*\{([^}]*)\}\s*\}', src):
+        if len(key.decode("gb2312")) != 1:
+            raise ValueError(f"{path}: bad index {key!r}")
+        if key not in seen:
+            seen.add(key)
+            entries.append((key, hex_bytes(body)))
+    return entries
+
+
+def load_cfont(path):
+    """GB2312 table: CH_CN entries keyed by their encoded bytes, ASCII keyed by one byte."""
+    src = strip_comments(open(path, "rb").read())
+    m = re.search(rb"cFONT\s+\w+\s*=\s*\{\s*\w+\s*,[^,]*,\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+)", src)
+    if not m:
+        raise ValueError(f"{path}: no cFONT table")
+    ascii_width, width, height = (int(g) for g in m.groups())
+    cells = {ord(key.decode("gb2312")): cell_rows(matrix, width, height)
+             for key, matrix in cfont_entries(path, src)}
+    if not cells:
+        raise ValueError(f"{path}: empty table")
+    # Align on the table's own Latin letters when it has some
+    latin = [ink_bottom(rows) for cp, rows in cells.items() if chr(cp) in "aceoxAHX"]
+    latin = [b for b in latin if b]
+    baseline = max(latin) if latin else max(ink_bottom(r) or 0 for r in cells.values())
+    return {cp: crop(rows, width, baseline, ascii_width if cp <= ASCII_LAST else width)
+            for cp, rows in cells.items()}
+
+
+def load_ttf(path, size, codepoints, bpp):
+    import freetype  # freetype-py
+
+    face = freetype.Face(path)
+    face.set_pixel_sizes(0, size)
+    glyphs = {}
+    for cp in codepoints:
+        if face.get_char_index(cp) == 0:
+            continue
+        face.load_char(cp, freetype.FT_LOAD_RENDER | freetype.FT_LOAD_TARGET_NORMAL)
+        g = face.glyph
+        bmp = g.bitmap
+        shift = 8 - bpp
+        pixels = [[bmp.buffer[y * bmp.pitch + x] >> shift for x in range(bmp.width)]
+                  for y in range(bmp.rows)]
+        glyphs[cp] = Glyph((g.advance.x + 32) >> 6, bmp.width, bmp.rows, g.bitmap_left,
+                           g.bitmap_top - bmp.rows, pixels)
+    metrics = face.size
+    return glyphs, (metrics.ascender + 63) >> 6, (-metrics.descender + 63) >> 6
+
+
+def perfect_hash(keys):
+    """Hash and displace: bucket = h(k, 0) % buckets, slot = h(k, disp[bucket]) % slots."""
+    n = len(keys)
+    if n == 0:
+        return [], []
+    slots = n
+    while True:
+        buckets_n = max(1, (n + 2) // 3)
+        buckets = [[] for _ in range(buckets_n)]
+        for k in keys:
+            buckets[font_hash(k, 0) % buckets_n].append(k)
+        table = [None] * slots
+        disp = [0] * buckets_n
+        ok = True
+        for b in sorted(range(buckets_n), key=lambda i: -len(buckets[i])):
+            if not buckets[b]:
+                break
+            for d in range(1, MAX_DISP + 1):
+                pos = [font_hash(k, d) % slots for k in buckets[b]]
+                if len(set(pos)) == len(pos) and all(table[p] is None for p in pos):
+                    for k, p in zip(buckets[b], pos):
+                        table[p] = k
+                    disp[b] = d
+                    break
+            else:
+                ok = False
+                break
+        if ok:
+            return table, disp
+        slots = math.ceil(slots * 1.1) + 1
+
+
+def pack(pixels, bpp):
+    out = bytearray()
+    acc = nbits = 0
+    for row in pixels:
+        for v in row:
+            acc = acc << bpp | v
+            nbits += bpp
+            if nbits == 8:
+                out.append(acc)
+                acc = nbits = 0
+    if nbits:
+        out.append(acc << (8 - nbits))
+    return bytes(out)
+
+
+def c_array(data, per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append("    " + ", ".join(f"0x{b:02X}" for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def emit(out, name, glyphs, bpp, line_height, base_line, sources, fallback):
+    hashed = sorted(cp for cp in glyphs if not ASCII_FIRST <= cp <= ASCII_LAST)
+    keys, disp = perfect_hash(hashed)
+    for cp in hashed:
+        slot = font_hash(cp, disp[font_hash(cp, 0) % len(disp)]) % len(keys)
+        assert keys[slot] == cp, f"U+{cp:04X} does not hash to its slot"
+
+    order = [ASCII_FIRST + i for i in range(ASCII_COUNT)] + keys
+    bitmap = bytearray()
+    descs = []
+    for cp in order:
+        g = glyphs.get(cp) if cp is not None else None
+        if g is None:
+            descs.append("    {0},")
+            continue
+        descs.append(f"    {{{len(bitmap)}, {g.adv}, {g.box_w}, {g.box_h}, {g.ofs_x}, {g.ofs_y}}},"
+                     f" /* U+{cp:04X} */")
+        bitmap += pack(g.pixels, bpp)
+
+    lines = [
+        f"/* Generated by tools/gen_lv_font.py from {', '.join(sources)}: do not edit */",
+        '#include "ui_font.h"',
+        "",
+        f"static const uint8_t s_bitmap[] = {{\n{c_array(bitmap) if bitmap else '    0,'}\n}};",
+        "",
+        f"/* Printable ASCII from U+{ASCII_FIRST:04X}, then one glyph per hash slot */",
+        "static const ui_font_glyph_t s_glyphs[] = {",
+        *descs,
+        "};",
+        "",
+    ]
+    if keys:
+        lines += [
+            "static const uint32_t s_hash_keys[] = {",
+            *(f"    0x{k or 0:04X}," for k in keys),
+            "};",
+            "",
+            "static const uint16_t s_hash_disp[] = {",
+            *(f"    {', '.join(str(d) for d in disp[i:i + 16])}," for i in range(0, len(disp), 16)),
+            "};",
+            "",
+        ]
+    lines += [
+        "static const ui_font_dsc_t s_dsc = {",
+        "    .bitmap = s_bitmap,",
+        "    .glyphs = s_glyphs,",
+        f"    .hash_keys = {'s_hash_keys' if keys else 'NULL'},",
+        f"    .hash_disp = {'s_hash_disp' if keys else 'NULL'},",
+        f"    .hash_slots = {len(keys)},",
+        f"    .hash_buckets = {len(disp)},",
+        f"    .bpp = {bpp},",
+        "};",
+        "",
+        f"const lv_font_t {name} = {{",
+        "    .get_glyph_dsc = ui_font_get_glyph_dsc,",
+        "    .get_glyph_bitmap = ui_font_get_glyph_bitmap,",
+        f"    .line_height = {line_height},",
+        f"    .base_line = {base_line},",
+        "    .subpx = LV_FONT_SUBPX_NONE,",
+        "    .underline_position = -1,",
+        "    .underline_thickness = 1,",
+        "    .dsc = &s_dsc,",
+        f"    .fallback = {fallback},",
+        "};",
+        "",
+    ]
+    with open(out, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines))
+    return len(glyphs), len(bitmap), len(keys)
+
+
+def read_chars(path):
+    with open(path, encoding="utf-8") as f:
+        return {ord(c) for c in f.read() if c >= " "}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--ascii", help="sFONT table (fontNN.c) for printable ASCII")
+    parser.add_argument("--cjk", help="cFONT table (fontNNCN.c) for GB2312 characters")
+    parser.add_argument("--ttf", help="TrueType/OpenType font, replaces the tables")
+    parser.add_argument("--size", type=int, default=20, help="TTF pixel size")
+    parser.add_argument("--chars", help="UTF-8 text file, every character in it is added (TTF)")
+    parser.add_argument("--bpp", type=int, choices=(1, 2, 4), default=4, help="TTF bits per pixel")
+    parser.add_argument("--name", default="ui_font_text", help="lv_font_t symbol")
+    parser.add_argument("--fallback", default="LV_FONT_DEFAULT", help="font for missing glyphs, or NULL")
+    parser.add_argument("-o", "--out", required=True)
+    args = parser.parse_args()
+
+    if args.ttf:
+        cps = set(range(ASCII_FIRST, ASCII_LAST + 1))
+        for lo, hi in LATIN_RANGES:
+            cps.update(range(lo, hi + 1))
+        if args.chars:
+            cps |= read_chars(args.chars)
+        glyphs, ascent, descent = load_ttf(args.ttf, args.size, sorted(cps), args.bpp)
+        bpp = args.bpp
+        sources = [os.path.basename(args.ttf)]
+    elif args.ascii or args.cjk:
+        glyphs = {}
+        sources = []
+        # Table glyphs only: the CN tables' few Latin letters do not replace the ASCII font
+        for path in (args.cjk, args.ascii):
+            if path:
+                glyphs.update(load_cfont(path) if path == args.cjk else load_sfont(path))
+                sources.append(os.path.basename(path))
+        bpp = 1
+        ascent = max(g.ofs_y + g.box_h for g in glyphs.values())
+        descent = max(0, -min(g.ofs_y for g in glyphs.values() if g.box_h))
+    else:
+        parser.error("give --ttf or at least one of --ascii/--cjk")
+
+    count, size, slots = emit(args.out, args.name, glyphs, bpp, ascent + descent, descent,
+                              sorted(sources), args.fallback)
+    print(f"{args.out}: {count} glyphs, {size} bitmap bytes, {slots} hash slots")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Convert a PNG into the boot splash image (components/splash).
+
+The output is what the "splash" partition holds: a 12-byte header
+(magic "SPLH", u16 width, u16 height, u32 pixel bytes, little endian)
+followed by RGB565 pixels, row by row, as the panel takes them.
+
+  tools/mk_splash.py logo.png -o splash.bin
+  esptool.py write_flash 0xED0000 splash.bin   # or idf.py flash, see README
+
+Only the Python standard library is used: 8-bit grey, RGB, palette and
+RGBA PNGs are read, alpha is blended over black. The image should not be
+larger than the panel (1024x600 by default); it is drawn centred, in the
+panel's landscape orientation.
+"""
+import argparse
+import struct
+import sys
+import zlib
+
+PNG_SIG = b"\x89PNG\r\n\x1a\n"
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+
+
+def chunks(data):
+    pos = len(PNG_SIG)
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        yield kind, data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def unfilter(raw, width, height, bpp):
+    stride = width * bpp
+    rows = []
+    prev = bytearray(stride)
+    pos = 0
+    for _ in range(height):
+        ftype = raw[pos]
+        line = bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += 1 + stride
+        for i in range(stride):
+            a = line[i - bpp] if i >= bpp else 0
+            b = prev[i]
+            c = prev[i - bpp] if i >= bpp else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + ((a + b) >> 1)) & 0xFF
+            elif ftype == 4:
+                line[i] = (line[i] + paeth(a, b, c)) & 0xFF
+            elif ftype != 0:
+                raise ValueError(f"bad filter type {ftype}")
+        rows.append(line)
+        prev = line
+    return rows
+
+
+def load_png(path):
+    """Pixels of @p path as rows of (r, g, b) tuples."""
+    data = open(path, "rb").read()
+    if not data.startswith(PNG_SIG):
+        raise ValueError(f"{path}: not a PNG")
+    idat = b""
+    palette = None
+    for kind, body in chunks(data):
+        if kind == b"IHDR":
+            width, height, depth, ctype, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif kind == b"PLTE":
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif kind == b"IDAT":
+            idat += body
+    if depth != 8 or ctype not in CHANNELS or interlace:
+        raise ValueError(f"{path}: only non-interlaced 8-bit PNGs are supported")
+    bpp = CHANNELS[ctype]
+    rows = unfilter(zlib.decompress(idat), width, height, bpp)
+    pixels = []
+    for line in rows:
+        row = []
+        for x in range(width):
+            px = line[x * bpp:(x + 1) * bpp]
+            if ctype == 3:
+                rgb, alpha = palette[px[0]], 255
+            elif ctype in (0, 4):
+                rgb, alpha = (px[0],) * 3, px[1] if ctype == 4 else 255
+            else:
+                rgb, alpha = tuple(px[:3]), px[3] if ctype == 6 else 255
+            row.append(tuple(c * alpha // 255 for c in rgb))
+        pixels.append(row)
+    return width, height, pixels
+
+
+def rgb565(r, g, b):
+    return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("png")
+    parser.add_argument("-o", "--out", required=True)
+    args = parser.parse_args()
+
+    width, height, pixels = load_png(args.png)
+    body = b"".join(struct.pack("<H", rgb565(*p)) for row in pixels for p in row)
+    with open(args.out, "wb") as f:
+        f.write(struct.pack("<4sHHI", b"SPLH", width, height, len(body)))
+        f.write(body)
+    print(f"{args.out}: {width}x{height}, {12 + len(body)} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Save the device timeline trace as Chrome trace JSON.
+
+Over the serial console (needs pyserial, CONFIG_APP_CONSOLE=y):
+  tools/trace_dump.py --port /dev/ttyACM0 -o trace.json
+Over HTTP, while the file server runs:
+  tools/trace_dump.py --url http://192.168.1.42/trace -o trace.json
+
+Open the file in https://ui.perfetto.dev or chrome://tracing.
+"""
+import argparse
+import json
+import re
+import sys
+import time
+import urllib.request
+
+# ESP_LOG lines ("I (1234) tag: ..."), possibly wrapped in colour codes
+LOG_LINE = re.compile(r"^(\x1b\[[0-9;]*m)?[EWIDV] \(\d+\)")
+
+
+def dump_serial(port, baud, timeout):
+    import serial  # pyserial
+
+    with serial.Serial(port, baud, timeout=1) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"trace dump\r\n")
+        body = None
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            raw = ser.readline()
+            if not raw:
+                continue
+            line = raw.decode("utf-8", "replace").rstrip("\r\n")
+            if line.endswith("TRACE-BEGIN"):
+                body = []
+            elif line.endswith("TRACE-END") and body is not None:
+                return json.loads("\n".join(body))
+            elif body is not None and not LOG_LINE.match(line):
+                body.append(line)
+    raise RuntimeError(f"timed out after {timeout} s waiting for the trace")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    where = parser.add_mutually_exclusive_group(required=True)
+    where.add_argument("--port", help="serial port of the board")
+    where.add_argument("--url", help="http://<device>/trace")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=120.0)
+    parser.add_argument("-o", "--out", default="trace.json")
+    args = parser.parse_args()
+
+    if args.port:
+        trace = dump_serial(args.port, args.baud, args.timeout)
+    else:
+        with urllib.request.urlopen(args.url, timeout=args.timeout) as resp:
+            trace = json.load(resp)
+
+    with open(args.out, "w") as f:
+        json.dump(trace, f)
+    events = [e for e in trace["traceEvents"] if e["ph"] != "M"]
+    if events:
+        span = (max(e["ts"] for e in events) - min(e["ts"] for e in events)) / 1e6
+        print(f"{len(events)} events over {span:.1f} s written to {args.out}")
+    else:
+        print(f"no events, {args.out} is empty")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())